@@ -5,6 +5,7 @@
 #include <map>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <stdint.h>
 
 #if __APPLE__
@@ -21,6 +22,8 @@
 #endif
 #endif
 
+#include "md5.h"
+
 
 
 namespace sasl {
@@ -56,6 +59,9 @@ struct Buffer
 {
     ALuint id;
     int usage;
+
+    // MD5 of wave file
+    std::string digest;
 };
 
 
@@ -92,11 +98,23 @@ struct SaslAlSound
     // current scene
     int scene;
 
+    // true if buffers left by previous engine weren't checked yet
+    bool trimIdle;
+
     // reference to sasl
     SASL sasl;
 };
 
 
+// OpenAL device shared by sound engines.  Buffers belong to device, so
+// buffers of destroyed engine may be reused by next one when panel is
+// reloaded.
+static ALCdevice *sharedDevice = NULL;
+
+// buffers of destroyed engines by MD5 of wave file
+static std::multimap<std::string, ALuint> idleBuffers;
+
+
 
 /**************************************************************************************************************
  * WAVE FILE LOADING
@@ -163,38 +181,41 @@ static char* chunk_end(char *chunk_start, int swapped)
     return chunk_start + (swapped ? SWAP_32(h->size) : h->size);
 }
 
-#define FAIL(X) { sasl_log_error(sasl, X); free(mem); return 0; }
+#define FAIL(X) { sasl_log_error(sasl, X); return 0; }
 
 #define RIFF_ID 0x46464952			// 'RIFF'
 #define FMT_ID  0x20746D66			// 'FMT '
 #define DATA_ID 0x61746164			// 'DATA'
 
 
-static ALuint load_wave(SASL sasl, const char *file_name)
-{
-    // First: we open the file and copy it into a single large memory buffer for processing.
+static ALuint load_wave_data(SASL sasl, char *mem, int32_t file_size);
 
+// read wave file into memory.  Returns 0 on success
+static int read_wave(SASL sasl, const char *file_name, std::vector<char> &mem)
+{
     FILE *fi = fopen(file_name,"rb");
     if (! fi) {
         sasl_log_error(sasl, "WAVE file load failed - could not open.");	
-        return 0;
-    }
-    fseek(fi, 0, SEEK_END);
-    int32_t file_size = ftell(fi);
-    fseek(fi, 0, SEEK_SET);
-    char *mem = (char*)malloc(file_size);
-    if (! mem) {
-        sasl_log_error(sasl, "WAVE file load failed - could not allocate memory.");
-        fclose(fi);
-        return 0;
+        return -1;
     }
-    if ((int)fread(mem, 1, file_size, fi) != file_size) {
+    char buf[16384];
+    size_t len;
+    while (0 < (len = fread(buf, 1, sizeof(buf), fi)))
+        mem.insert(mem.end(), buf, buf + len);
+    bool failed = ferror(fi) || mem.empty();
+    fclose(fi);
+    if (failed) {
         sasl_log_error(sasl, "WAVE file load failed - could not read file.");	
-        free(mem);
-        fclose(fi);
-        return 0;
+        return -1;
     }
-    fclose(fi);
+    return 0;
+}
+
+
+// Creates buffer from wave file in memory.  Data of swapped files is
+// modified in place.
+static ALuint load_wave_data(SASL sasl, char *mem, int32_t file_size)
+{
     char *mem_end = mem + file_size;
     
     // Second: find the RIFF chunk.  Note that by searching for RIFF both normal
@@ -273,15 +294,53 @@ static ALuint load_wave(SASL sasl, const char *file_name)
             (fmt->num_channels == 2 ? AL_FORMAT_STEREO16 : AL_FORMAT_MONO16) : 
             (fmt->num_channels == 2 ? AL_FORMAT_STEREO8 : AL_FORMAT_MONO8), 
             data, data_bytes, fmt->sample_rate);
-    free(mem);
     return buf_id;
 }
 
 
 
 
-// load sound from disk or reuses already loaded sound
-static int loadSound(struct SaslSoundCallbacks *callbacks, const char *fileName)
+// returns MD5 of wave file
+static std::string getDigest(const std::vector<char> &mem)
+{
+    unsigned char digest[16];
+    xa::md5_state_t md5;
+    xa::md5_init(&md5);
+    xa::md5_append(&md5, (const unsigned char*)&mem[0], mem.size());
+    xa::md5_finish(&md5, digest);
+    return std::string((const char*)digest, sizeof(digest));
+}
+
+
+// take buffer with the same wave left by previous engine.  Returns 0 if
+// there is no such buffer
+static ALuint takeIdleBuffer(const std::string &digest)
+{
+    std::multimap<std::string, ALuint>::iterator i = idleBuffers.find(digest);
+    if (i == idleBuffers.end())
+        return 0;
+    ALuint id = (*i).second;
+    idleBuffers.erase(i);
+    return id;
+}
+
+
+// delete buffers left by previous engine.  Current context should be set
+static void deleteIdleBuffers()
+{
+    for (std::multimap<std::string, ALuint>::iterator i = idleBuffers.begin();
+            i != idleBuffers.end(); i++)
+    {
+        ALuint buffer = (*i).second;
+        alDeleteBuffers(1, &buffer);
+    }
+    idleBuffers.clear();
+}
+
+
+// load sound from disk or memory or reuses already loaded sound
+static int loadSample(struct SaslSoundCallbacks *callbacks, 
+        const char *fileName, const void *data, int size)
 {
     SaslAlSound *sound = (SaslAlSound*)callbacks;
 
@@ -291,9 +350,21 @@ static int loadSound(struct SaslSoundCallbacks *callbacks, const char *fileName)
     ContextChanger changer(sound->context);
 
     ALuint bufId = 0;
+    std::string digest;
     std::map<std::string, Buffer>::iterator i = sound->buffers.find(fileName);
     if (i == sound->buffers.end()) {
-        bufId = load_wave(sound->sasl, fileName);
+        // wave loader swaps bytes in place, OpenAL copies samples anyway
+        std::vector<char> mem;
+        if (data)
+            mem.assign((const char*)data, (const char*)data + size);
+        else
+            read_wave(sound->sasl, fileName, mem);
+        if (! mem.empty()) {
+            digest = getDigest(mem);
+            bufId = takeIdleBuffer(digest);
+            if (! bufId)
+                bufId = load_wave_data(sound->sasl, &mem[0], mem.size());
+        }
         if (! bufId) {
             sasl_log_error(sound->sasl, "Can't load sound '%s'", fileName);
             return 0;
@@ -335,6 +406,7 @@ static int loadSound(struct SaslSoundCallbacks *callbacks, const char *fileName)
         Buffer buffer;
         buffer.id = bufId;
         buffer.usage = 1;
+        buffer.digest = digest;
         sound->buffers[fileName] = buffer;
         src.buffer = &sound->buffers[fileName];
     } else {
@@ -356,6 +428,8 @@ static void deleteBuffer(SaslAlSound *sound, ALuint id)
             i != sound->buffers.end(); i++)
     {
         Buffer &buffer = (*i).second;
+        if (buffer.id != id)
+            continue;
         alDeleteBuffers(1, &buffer.id);
         sound->buffers.erase(i);
         return;
@@ -363,6 +437,23 @@ static void deleteBuffer(SaslAlSound *sound, ALuint id)
 }
 
 
+// load sound from disk or reuses already loaded sound
+static int loadSound(struct SaslSoundCallbacks *callbacks, const char *fileName)
+{
+    return loadSample(callbacks, fileName, NULL, 0);
+}
+
+
+// load sound from memory or reuses already loaded sound
+static int loadSoundBuffer(struct SaslSoundCallbacks *callbacks, 
+        const char *name, const void *data, int size)
+{
+    if (! data)
+        return 0;
+    return loadSample(callbacks, name, data, size);
+}
+
+
 // unload sound
 static void unloadSound(struct SaslSoundCallbacks *s, int sampleId)
 {
@@ -812,9 +903,16 @@ static void getListenerOrientation(struct SaslSoundCallbacks *s,
 }
 
 
-// nothing needed
-static void update(struct SaslSoundCallbacks *sound)
+// free buffers of previous engine not reused by loaded panel
+static void update(struct SaslSoundCallbacks *s)
 {
+    SaslAlSound *sound = (SaslAlSound*)s;
+
+    if (sound && sound->trimIdle && sound->context) {
+        ContextChanger changer(sound->context);
+        deleteIdleBuffers();
+        sound->trimIdle = false;
+    }
 }
 
 
@@ -829,13 +927,17 @@ SaslAlSound* sasl_init_al_sound(SASL sasl)
         setMaxDistance, setRolloff, setRefDistance, setCone, getCone,
         setRelative, getRelative, setListenerEnv, setListenerPosition,
         getListenerPosition, setListenerOrientation, getListenerOrientation,
-        setMasterGain, update };
+        setMasterGain, update, loadSoundBuffer };
     sound->callbacks = cb;
-    sound->device = alcOpenDevice(NULL);
-    sound->context = alcCreateContext(sound->device, NULL);
+    if (! sharedDevice)
+        sharedDevice = alcOpenDevice(NULL);
+    sound->device = sharedDevice;
+    sound->context = sound->device ? 
+        alcCreateContext(sound->device, NULL) : NULL;
     sound->maxSource = 0;
     sound->sasl = sasl;
     sound->scene = 1;
+    sound->trimIdle = ! idleBuffers.empty();
 
     // some magic
     alGetError();
@@ -863,11 +965,15 @@ void sasl_done_al_sound(SaslAlSound *sound)
         }
         sound->sources.clear();
         
+        // buffers are kept in device for next engine
         for (std::map<std::string, Buffer>::iterator i = sound->buffers.begin(); 
                 i != sound->buffers.end(); i++)
         {
-            ALuint buffer = (*i).second.id;
-            alDeleteBuffers(1, &buffer);
+            Buffer &buffer = (*i).second;
+            if (buffer.digest.empty())
+                alDeleteBuffers(1, &buffer.id);
+            else
+                idleBuffers.insert(std::make_pair(buffer.digest, buffer.id));
         }
         sound->buffers.clear();
     }
@@ -876,9 +982,31 @@ void sasl_done_al_sound(SaslAlSound *sound)
         alcMakeContextCurrent(NULL);
     alcDestroyContext(sound->context);
     sound->context = NULL;
-    alcCloseDevice(sound->device);
     sound->device = NULL;
     
     sasl_set_sound_engine(sound->sasl, NULL);
 }
 
+
+// free buffers kept for next engine and close OpenAL device
+void sasl_close_al_sound()
+{
+    if (! sharedDevice)
+        return;
+
+    if (! idleBuffers.empty()) {
+        ALCcontext *context = alcCreateContext(sharedDevice, NULL);
+        if (context) {
+            {
+                ContextChanger changer(context);
+                deleteIdleBuffers();
+            }
+            alcDestroyContext(context);
+        }
+        idleBuffers.clear();
+    }
+
+    alcCloseDevice(sharedDevice);
+    sharedDevice = NULL;
+}
+
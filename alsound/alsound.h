@@ -17,9 +17,14 @@ struct SaslAlSound;
 // initialize sound engine
 SaslAlSound* sasl_init_al_sound(SASL sasl);
 
-// destroy sound engine
+// destroy sound engine.  Buffers of loaded samples are kept for next
+// sound engine until sasl_close_al_sound is called
 void sasl_done_al_sound(SaslAlSound *sound);
 
+// free buffers kept for next sound engine and close OpenAL device.
+// call it after last sound engine is destroyed
+void sasl_close_al_sound();
+
 #if defined(__cplusplus)
 };
 #endif
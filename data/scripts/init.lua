@@ -282,6 +282,9 @@ function globalPropertyd(name, default)
     local ref = findProp(name, "double")
     return {
         __property = 1;
+        __ref = ref;
+        __name = name;
+        __type = "double";
         get = function() return getPropd(ref, default); end;
         set = function(self, value) setPropd(ref, value); end;
     }
@@ -294,8 +297,11 @@ function createGlobalPropertyd(name, default)
 end
 
 -- create new global functional double property
-function createFuncPropertyd(name, getter, setter)
-    local ref = createFuncProp(name, 'double', getter, setter)
+-- cache is optional caching policy of getter results: "frame" calls getter
+-- at most once per frame, "ttl" reuses value for ttl milliseconds and
+-- "manual" reuses value till invalidateProperty or setter call
+function createFuncPropertyd(name, getter, setter, cache, ttl)
+    local ref = createFuncProp(name, 'double', getter, setter, 0, cache, ttl)
     return globalPropertyd(name)
 end
 
@@ -305,6 +311,9 @@ function globalPropertyf(name, default)
     local ref = findProp(name, "float")
     return {
         __property = 1;
+        __ref = ref;
+        __name = name;
+        __type = "float";
         get = function() return getPropf(ref, default); end;
         set = function(self, value) setPropf(ref, value); end;
     }
@@ -317,8 +326,8 @@ function createGlobalPropertyf(name, default)
 end
 
 -- create new global functional float property
-function createFuncPropertyf(name, getter, setter)
-    local ref = createFuncProp(name, 'float', getter, setter)
+function createFuncPropertyf(name, getter, setter, cache, ttl)
+    local ref = createFuncProp(name, 'float', getter, setter, 0, cache, ttl)
     return globalPropertyf(name)
 end
 
@@ -328,6 +337,9 @@ function globalPropertyi(name, default)
     local ref = findProp(name, "int")
     return {
         __property = 1;
+        __ref = ref;
+        __name = name;
+        __type = "int";
         get = function(doNotCall) return getPropi(ref, default); end;
         set = function(self, value) setPropi(ref, value); end;
     }
@@ -340,8 +352,8 @@ function createGlobalPropertyi(name, default)
 end
 
 -- create new global functional int property
-function createFuncPropertyi(name, getter, setter)
-    local ref = createFuncProp(name, 'int', getter, setter)
+function createFuncPropertyi(name, getter, setter, cache, ttl)
+    local ref = createFuncProp(name, 'int', getter, setter, 0, cache, ttl)
     return globalPropertyi(name)
 end
 
@@ -350,6 +362,9 @@ function globalPropertys(name, default)
     local ref = findProp(name, "string")
     return {
         __property = 1;
+        __ref = ref;
+        __name = name;
+        __type = "string";
         get = function(doNotCall) return getProps(ref, default); end;
         set = function(self, value) setProps(ref, value); end;
     }
@@ -362,11 +377,57 @@ function createGlobalPropertys(name, maxLen, default)
 end
 
 -- create new global functional string property
-function createFuncPropertys(name, getter, setter, maxSize)
-    local ref = createFuncProp(name, 'string', getter, setter, maxSize)
+function createFuncPropertys(name, getter, setter, maxSize, cache, ttl)
+    local ref = createFuncProp(name, 'string', getter, setter, maxSize, 
+            cache, ttl)
     return globalPropertys(name)
 end
 
+-- drop cached value of functional property
+function invalidateProperty(property)
+    if isProperty(property) and property.__ref then
+        invalidateFuncProp(property.__ref)
+    end
+end
+
+
+-- create property calculated natively from expression over other
+-- simulator properties.  vars is table which maps variables names used in
+-- expression to properties, for example:
+-- createExprPropertyf("my/alt_m", "alt * 0.3048", { alt = altitudeFt })
+local function createExprProperty(name, type, expression, vars)
+    local refs = { }
+    for k, v in pairs(vars or { }) do
+        if isProperty(v) and v.__ref then
+            refs[k] = { v.__ref, v.__type }
+        else
+            logError("variable '" .. k .. "' is not simulator property")
+        end
+    end
+    local ref, err = createExprProp(name, type, expression, refs)
+    if not ref then
+        logError("can't create property '" .. name .. "': " .. tostring(err))
+    end
+end
+
+-- create new double property calculated from expression
+function createExprPropertyd(name, expression, vars)
+    createExprProperty(name, 'double', expression, vars)
+    return globalPropertyd(name)
+end
+
+-- create new float property calculated from expression
+function createExprPropertyf(name, expression, vars)
+    createExprProperty(name, 'float', expression, vars)
+    return globalPropertyf(name)
+end
+
+-- create new int property calculated from expression
+function createExprPropertyi(name, expression, vars)
+    createExprProperty(name, 'int', expression, vars)
+    return globalPropertyi(name)
+end
+
 
 -- returns value of property
 -- traverse recursive properties
@@ -391,6 +452,157 @@ function get(property, doNotCall)
 end
 
 
+-- watchers of properties which are not simulator properties
+local localWatchers = { }
+
+-- call callback(newValue, oldValue) when value of property changes.
+-- numeric values are considered changed if they differ from last
+-- reported value more than epsilon.  Simulator properties are compared
+-- natively once per frame.
+-- returns handle to pass to removeOnChange
+function onChange(property, callback, epsilon)
+    if isProperty(property) and property.__ref then
+        return watchProp(property.__name, property.__type, callback, epsilon)
+    else
+        local watcher = {
+            property = property;
+            callback = callback;
+            epsilon = epsilon or 0;
+            last = get(property);
+        }
+        table.insert(localWatchers, watcher)
+        return watcher
+    end
+end
+
+-- stop watching property changes
+function removeOnChange(handle)
+    if "table" == type(handle) then
+        for i, v in ipairs(localWatchers) do
+            if v == handle then
+                table.remove(localWatchers, i)
+                return
+            end
+        end
+    elseif handle then
+        unwatchProp(handle)
+    end
+end
+
+-- call callbacks of changed properties which are not simulator properties
+local function notifyLocalWatchers()
+    for _, v in ipairs(localWatchers) do
+        local value = get(v.property)
+        local changed
+        if ("number" == type(value)) and ("number" == type(v.last)) then
+            changed = math.abs(value - v.last) > v.epsilon
+        else
+            changed = value ~= v.last
+        end
+        if changed then
+            local old = v.last
+            v.last = value
+            v.callback(value, old)
+        end
+    end
+end
+
+
+-- suspend task for specified number of milliseconds.
+-- can be called from tasks started by startTask only
+function sleep(ms)
+    coroutine.yield('sleep', ms)
+end
+
+-- suspend task for specified number of frames
+function waitFrames(frames)
+    coroutine.yield('frames', frames or 1)
+end
+
+-- watchers of tasks waiting in waitUntil by task handle
+local taskWatchers = { }
+
+-- suspend task until predicate of property value returns true.
+-- predicate is checked when property changes, by default task waits
+-- for true value of property
+function waitUntil(property, predicate)
+    predicate = predicate or toboolean
+    if predicate(get(property)) then
+        return
+    end
+
+    local task = getCurrentTask()
+    if not task then
+        logError("waitUntil can be called from tasks only")
+        return
+    end
+    local done = false
+    local handle = onChange(property, function(value)
+        if (not done) and predicate(value) then
+            done = true
+            wakeTask(task)
+        end
+    end)
+    taskWatchers[task] = handle
+    while not done do
+        coroutine.yield('event')
+    end
+    taskWatchers[task] = nil
+    removeOnChange(handle)
+end
+
+-- cancel task, watcher of task waiting in waitUntil is removed too
+local cancelTask = stopTask
+function stopTask(task)
+    local handle = task and taskWatchers[task]
+    if handle then
+        taskWatchers[task] = nil
+        removeOnChange(handle)
+    end
+    cancelTask(task)
+end
+
+
+-- attach history of values to simulator property.
+-- capacity is maximum number of samples, rate is number of samples per
+-- second (every frame if not specified).  Samples are stored natively.
+-- returns history object or nil on errors
+function createHistory(property, capacity, rate)
+    if not (isProperty(property) and property.__ref) then
+        logError("history can be attached to simulator properties only")
+        return nil
+    end
+    local id = createPropHistory(property.__name, property.__type, 
+            capacity, rate or 0)
+    if not id then
+        return nil
+    end
+    return {
+        id = id;
+        -- value sampled n samples ago, 0 is latest
+        ago = function(self, n) return getPropHistoryAgo(id, n or 0) end;
+        -- number of stored samples
+        size = function(self) return getPropHistorySize(id) end;
+        -- minimum, maximum and mean of last window samples
+        stats = function(self, window) 
+            return getPropHistoryStats(id, window or 0) 
+        end;
+        -- change of value per second over last window samples
+        derivative = function(self, window) 
+            return getPropHistoryDerivative(id, window or 0) 
+        end;
+        -- copy last window samples to table from oldest to latest
+        toTable = function(self, tbl, window) 
+            return propHistoryToTable(id, tbl, window or 0) 
+        end;
+        -- raw ring buffer of doubles for FFI access
+        data = function(self) return getPropHistoryData(id) end;
+        clear = function(self) clearPropHistory(id) end;
+        destroy = function(self) destroyPropHistory(id) end;
+    }
+end
+
+
 -- set value of property
 function set(property, value)
     if property.set then
@@ -446,19 +658,82 @@ function updateComponent(v)
     end
 end
 
+-- components with reduced update rate by id of scheduled update.
+-- Values are weak so destroyed components don't stay alive here.
+local scheduledComponents = setmetatable({ }, { __mode = 'v' })
+
+-- ids of scheduled updates due on current frame
+local dueUpdates = { }
+
+-- returns true if component should be updated on current frame.
+-- Components may declare updateRate in Hz and updatePhase as part of
+-- update period, phases are spread automatically by default.  Rate is
+-- read on first update.
+local function isUpdateDue(v)
+    local id = rawget(v, '__updateId')
+    if nil == id then
+        local rate = get(rawget(v, 'updateRate'))
+        if rate and (0 < rate) then
+            id = addScheduledUpdate(rate, get(rawget(v, 'updatePhase')))
+            scheduledComponents[id] = v
+        else
+            id = false
+        end
+        rawset(v, '__updateId', id)
+        return true
+    end
+    if id and not rawget(v, '__updateDue') then
+        return false
+    end
+    rawset(v, '__updateDue', nil)
+    return true
+end
+
+-- mark components with reduced update rate due on current frame.
+-- Updates of collected components are removed from scheduler.
+local function scheduleUpdates()
+    for i = 1, collectDueUpdates(dueUpdates) do
+        local id = dueUpdates[i]
+        local v = scheduledComponents[id]
+        if v then
+            rawset(v, '__updateDue', true)
+        else
+            removeScheduledUpdate(id)
+        end
+    end
+end
+
+-- forget components with reduced update rate of previous panel
+local function resetScheduledUpdates()
+    for id, _ in pairs(scheduledComponents) do
+        removeScheduledUpdate(id)
+    end
+    scheduledComponents = setmetatable({ }, { __mode = 'v' })
+end
+
 -- update all components from table
 function updateAll(table)
     for _, v in pairs(table) do
-        updateComponent(v)
+        if isUpdateDue(v) then
+            updateComponent(v)
+        end
     end
 end
 
+-- components of layer being drawn by id in hit index
+local hitLayerComponents = nil
+
 -- draw component
 function drawComponent(v)
     if v and toboolean(get(v.visible)) then
         saveGraphicsContext()
         local pos = get(v.position)
         setTranslation(pos[1], pos[2], pos[3], pos[4], v.size[1], v.size[2])
+        local hitId = pushHitArea(pos[1], pos[2], pos[3], pos[4], 
+                v.size[1], v.size[2])
+        if hitId then
+            hitLayerComponents[hitId] = v
+        end
         local clip = toboolean(get(v.clip))
         if clip then
             setClipArea(0, 0, v.size[1], v.size[2])
@@ -467,11 +742,313 @@ function drawComponent(v)
         if clip then
             resetClipArea()
         end
+        popHitArea()
         restoreGraphicsContext()
     end
 end
 
 
+-- not profiled versions of component functions
+local plainUpdateComponent = updateComponent
+local plainDrawComponent = drawComponent
+
+-- true if components profiler is enabled
+local componentsProfiling = false
+
+-- true if LuaJIT sampling profiler is running
+local componentsSampling = false
+
+-- returns path of component names starting from root component
+-- path is cached in component
+local function getComponentPath(v)
+    local path = rawget(v, '__path')
+    if not path then
+        local comp = v
+        while nil ~= comp do
+            local name = rawget(comp, 'name')
+            if nil ~= name then
+                name = tostring(get(name))
+            else
+                name = '?'
+            end
+            if path then
+                path = name .. '/' .. path
+            else
+                path = name
+            end
+            comp = rawget(comp, '_P')
+        end
+        rawset(v, '__path', path)
+    end
+    return path
+end
+
+-- returns profiler entry of component
+-- entry is named by path of component and cached in component
+local function getProfileId(v)
+    local id = rawget(v, '__profileId')
+    if not id then
+        id = getProfileEntry(getComponentPath(v))
+        rawset(v, '__profileId', id)
+    end
+    return id
+end
+
+-- update component measuring time of update
+local function profiledUpdateComponent(v)
+    if v and v.update then
+        profileBegin(getProfileId(v), 0)
+        plainUpdateComponent(v)
+        profileEnd()
+    end
+end
+
+-- draw component measuring time of draw
+local function profiledDrawComponent(v)
+    if v and toboolean(get(v.visible)) then
+        profileBegin(getProfileId(v), 1)
+        plainDrawComponent(v)
+        profileEnd()
+    end
+end
+
+-- component functions wrapped by sampler
+local innerUpdateComponent = plainUpdateComponent
+local innerDrawComponent = plainDrawComponent
+
+-- component being updated or drawn while sampling profiler is running
+local sampledComponent = nil
+
+-- update component remembering it for sampler
+local function sampledUpdateComponent(v)
+    local saved = sampledComponent
+    sampledComponent = v
+    innerUpdateComponent(v)
+    sampledComponent = saved
+end
+
+-- draw component remembering it for sampler
+local function sampledDrawComponent(v)
+    local saved = sampledComponent
+    sampledComponent = v
+    innerDrawComponent(v)
+    sampledComponent = saved
+end
+
+-- set global component functions according to profiling state
+local function selectComponentFunctions()
+    if componentsProfiling then
+        innerUpdateComponent = profiledUpdateComponent
+        innerDrawComponent = profiledDrawComponent
+    else
+        innerUpdateComponent = plainUpdateComponent
+        innerDrawComponent = plainDrawComponent
+    end
+    if componentsSampling then
+        updateComponent = sampledUpdateComponent
+        drawComponent = sampledDrawComponent
+    else
+        updateComponent = innerUpdateComponent
+        drawComponent = innerDrawComponent
+    end
+end
+
+-- switch components functions between profiled and plain versions
+-- called by avionics when profiler is enabled or disabled
+function setComponentsProfiling(enable)
+    componentsProfiling = enable
+    selectComponentFunctions()
+end
+
+
+-- jit.profile and jit.util modules while sampling is running
+local jitProfile = nil
+local jitUtil = nil
+
+-- trace abort messages from jit.vmdef module
+local traceErrors = nil
+
+-- names of VM states reported by jit.profile
+local vmStates = {
+    N = '[compiled]',
+    I = '[interpreted]',
+    C = '[C]',
+    G = '[GC]',
+    J = '[JIT compiler]',
+}
+
+-- interval of debug hook sampler in milliseconds
+local hookInterval = 1
+
+-- time of last sample taken by debug hook sampler
+local hookLastSample = 0
+
+-- number of VM instructions between calls of debug hook sampler
+local HOOK_COUNT = 1000
+
+-- returns path of current component as folded stack frames
+local function getSampledPath()
+    if sampledComponent then
+        return (string.gsub(getComponentPath(sampledComponent), '/', ';'))
+    end
+    return '?'
+end
+
+-- store samples with stack prefixed by path of current component
+local function onSample(thread, samples, vmstate)
+    local stack = jitProfile.dumpstack(thread, 'plZ;', -100)
+    addSamples(getSampledPath() .. ';' .. stack .. ';' .. 
+            (vmStates[vmstate] or vmstate), samples)
+end
+
+-- sample stack of main thread from count hook.  Used when jit.profile
+-- isn't available (it appeared in LuaJIT 2.1).  Compiled traces don't
+-- call hooks, so their time goes to interpreted code running after them
+-- and tasks running in coroutines are not sampled.
+local function onSampleHook()
+    local now = os.clock() * 1000
+    local elapsed = now - hookLastSample
+    if elapsed < hookInterval then
+        return
+    end
+    hookLastSample = now
+
+    local frames = { }
+    for level = 2, 101 do
+        local info = debug.getinfo(level, 'Sl')
+        if not info then
+            break
+        end
+        if 'C' == info.what then
+            table.insert(frames, 1, '[C]')
+        else
+            table.insert(frames, 1, info.short_src .. ':' .. info.currentline)
+        end
+    end
+    addSamples(getSampledPath() .. ';' .. table.concat(frames, ';') .. 
+            ';[interpreted]', math.floor(elapsed / hookInterval))
+end
+
+-- count trace aborts by function
+local function onTrace(what, tr, func, pc, otr, oex)
+    if 'abort' ~= what then
+        return
+    end
+    local info = jitUtil.funcinfo(func, pc)
+    local location = info.loc or '?'
+    if info.source and info.linedefined then
+        location = info.source .. ':' .. info.linedefined
+    end
+    local reason = tostring(otr)
+    if traceErrors and ('number' == type(otr)) and traceErrors[otr] then
+        if 'function' == type(oex) then
+            oex = jitUtil.funcinfo(oex).loc
+        end
+        local ok, msg = pcall(string.format, traceErrors[otr], oex)
+        if ok then
+            reason = msg
+        end
+    end
+    if info.currentline then
+        reason = reason .. ' at line ' .. info.currentline
+    end
+    addTraceAbort(location, reason)
+end
+
+-- start LuaJIT sampling profiler and trace aborts collection
+-- previously collected samples are discarded
+-- interval is sampling interval in milliseconds
+-- falls back to debug hook sampler if LuaJIT is older than 2.1
+-- returns true on success
+function startSampling(interval)
+    if componentsSampling then
+        stopSampling()
+    end
+
+    resetSamples()
+    componentsSampling = true
+    selectComponentFunctions()
+
+    local ok, profile = pcall(require, 'jit.profile')
+    if ok then
+        jitProfile = profile
+        jitProfile.start('li' .. (interval or 1), onSample)
+    else
+        logInfo("jit.profile requires LuaJIT 2.1, using debug hook sampler")
+        hookInterval = interval or 1
+        hookLastSample = os.clock() * 1000
+        debug.sethook(onSampleHook, '', HOOK_COUNT)
+    end
+
+    local util
+    ok, util = pcall(require, 'jit.util')
+    if ok then
+        jitUtil = util
+        local vmdef
+        ok, vmdef = pcall(require, 'jit.vmdef')
+        if ok then
+            traceErrors = vmdef.traceerr
+        end
+        jit.attach(onTrace, 'trace')
+    end
+
+    return true
+end
+
+-- stop LuaJIT sampling profiler
+-- returns true if profiler was running
+function stopSampling()
+    if not componentsSampling then
+        return false
+    end
+
+    if jitProfile then
+        jitProfile.stop()
+    else
+        debug.sethook()
+    end
+    if jitUtil then
+        jit.attach(onTrace)
+    end
+    jitProfile = nil
+    jitUtil = nil
+    componentsSampling = false
+    selectComponentFunctions()
+    dumpSamples()
+
+    return true
+end
+
+-- returns true if LuaJIT sampling profiler is running
+function isSampling()
+    return componentsSampling
+end
+
+-- start or stop sampling by simulator command
+-- samples and trace aborts are written to panel directory on stop
+local function toggleSamplingCommand(phase)
+    if 0 == phase then
+        if componentsSampling then
+            stopSampling()
+            writeSamples(panelDir .. '/samples.folded')
+            writeTraceAborts(panelDir .. '/traceaborts.txt')
+        else
+            startSampling(1)
+        end
+    end
+    return 0
+end
+
+-- register command which toggles sampling profiler
+local function createSamplingCommand()
+    local command = createCommand("sasl/toggle_sampling",
+            "Start or stop SASL sampling profiler")
+    if command then
+        registerCommandHandler(command, 0, toggleSamplingCommand)
+    end
+end
+
+
 -- draw all components from table
 function drawAll(table)
     for _, v in pairs(table) do
@@ -540,8 +1117,8 @@ function openFile(fileName)
         end
 
         -- check if it is available at current path
-        if isFileExists(fullName) then
-            local f, errorMsg = loadfile(fullName)
+        if isFileIndexed(fullName) then
+            local f, errorMsg = loadCachedFile(fullName)
             if f then
                 return f
             else
@@ -551,8 +1128,8 @@ function openFile(fileName)
 
         -- check subdir
         local subFullName = subdir .. '/' .. fileName
-        if isFileExists(subFullName) then
-            local f, errorMsg = loadfile(subFullName)
+        if isFileIndexed(subFullName) then
+            local f, errorMsg = loadCachedFile(subFullName)
             if f then
                 return f, subdir
             else
@@ -619,13 +1196,16 @@ function loadComponent(name, fileName)
         fileName = name .. ".lua"
     end
 
+    startupComponentBegin(name)
     local f, subdir = openFile(fileName)
+    startupComponentEnd()
     if not f then
         logError("can't load component", name)
         return nil
     end
 
     local constr = function(args)
+        startupComponentBegin(name)
         local parent = creatingComponents[#creatingComponents]
         if subdir then
             addSearchPath(subdir)
@@ -646,6 +1226,7 @@ function loadComponent(name, fileName)
         if subdir then
             popSearchPath()
         end
+        startupComponentEnd()
         return t
     end
 
@@ -669,6 +1250,7 @@ end
 -- load panel from file
 -- panel table will be stored in panel global variable
 function loadPanel(fileName, panelWidth, panelHeight, popupWidth, popupHeight)
+    resetScheduledUpdates()
     popups = createComponent("popups")
     popups.position = createProperty { 0, 0, popupWidth, popupHeight }
     popups.size = { popupWidth, popupHeight }
@@ -678,12 +1260,20 @@ function loadPanel(fileName, panelWidth, panelHeight, popupWidth, popupHeight)
         panelsPositions = loadTableFromFile(panelsFileName, 'positions')
     end
 
+    -- images and sounds declared in preload.txt are decoded in background
+    -- while components are created
+    local preloadFileName = panelDir .. '/preload.txt'
+    if isFileExists(preloadFileName) then
+        preloadAssets(loadTableFromFile(preloadFileName, 'assets'))
+    end
+
     local c = loadComponent("panel", fileName)
     if not c then
         logError("Error loading panel", fileName)
         return nil
     end
     panel = c({position = { 0, 0, panelWidth, panelHeight}})
+    createSamplingCommand()
 
     return panel
 end
@@ -716,15 +1306,36 @@ cursor = {
 }
 
 
+-- true to find components under mouse using hit index recorded while
+-- layers are drawn.  Components tree is traversed if layer wasn't drawn.
+-- Only components drawn through drawAll are recorded, so children which
+-- custom draw() doesn't draw that way can't be clicked with hit index.
+-- Disabled by default, panels enable it when all clickable components
+-- are drawn through drawAll.
+useHitIndex = false
+
+-- components of hit index layers by id
+local hitComponents = { { }, { } }
+
+-- draw layer recording positions of components in hit index
+local function drawHitLayer(layer, component)
+    hitLayerComponents = hitComponents[layer]
+    beginHitLayer(layer)
+    drawComponent(component)
+    endHitLayer()
+    hitLayerComponents = nil
+end
+
+
 -- Draw panel on screen
 function drawPanelLayer()
-    drawComponent(panel)
+    drawHitLayer(2, panel)
 end
 
 
 -- draw popup panels
 function drawPopupsLayer()
-    drawComponent(popups)
+    drawHitLayer(1, popups)
 
     if cursor.shape then
         drawCursor()
@@ -740,6 +1351,8 @@ end
 
 -- update all component
 function update()
+    notifyLocalWatchers()
+    scheduleUpdates()
     updateComponent(panel)
     updateComponent(popups)
 end
@@ -751,14 +1364,8 @@ end
 --    center part of image.  width and height sets size of image part
 -- loadImage(fileName, x, y, width, height) - loads specified part of image
 function loadImage(fileName, x, y, width, height)
-    for _, v in ipairs(searchImagePath) do
-        local t = getGLTexture(v .. '/' .. fileName, x, y, width, height)
-        if t then
-            return t
-        end
-    end
-
-    local tex = getGLTexture(fileName, x, y, width, height)
+    local f = findFile(fileName, searchImagePath)
+    local tex = f and getGLTexture(f, x, y, width, height)
     if not tex then
         logError("Can't load texture", fileName)
     end
@@ -766,20 +1373,31 @@ function loadImage(fileName, x, y, width, height)
 end
 
 
--- load font
-function loadFont(fileName)
-    for _, v in ipairs(searchImagePath) do
-        local t = getGLFont(v .. '/' .. fileName)
-        if t then
-            return t
+-- start loading images and sounds in background.  Assets are found on
+-- images search path like loadImage and loadSample do, loading them later
+-- waits only for assets not loaded yet.  Returns table of handles by file
+-- name which can be checked with isAssetReady
+function preloadAssets(fileNames)
+    local assets = { }
+    for _, v in ipairs(fileNames or { }) do
+        local f = findFile(v, searchImagePath)
+        local handle = f and preloadAsset(f)
+        if handle then
+            assets[v] = handle
         end
     end
+    return assets
+end
+
 
-    local font = getGLFont(fileName)
+-- load font
+function loadFont(fileName)
+    local f = findFile(fileName, searchImagePath)
+    local font = f and getGLFont(f)
     if not font then
         logError("Can't load font", fileName)
     end
-    return tex
+    return font
 end
 
 
@@ -853,18 +1471,54 @@ function getFocusedPath(component, x, y, path)
 end
 
 
+-- returns true if components of layer can be found in hit index
+local function isHitIndexed(layer)
+    return useHitIndex and isHitLayerValid(layer)
+end
+
+
+-- returns path to component under mouse found in hit index.
+-- Hits are ordered from topmost to root, so ancestors of each hit not
+-- added yet are added from root down.  This gives the same order as
+-- getFocusedPath: parents before children, topmost siblings first.
+local function getIndexedFocusedPath(layer, x, y, path)
+    local components = hitComponents[layer]
+    local added = { }
+    for i = 1, hitTest(layer, x, y) do
+        local chain = { }
+        local id = getHit(i)
+        while id and not added[id] do
+            added[id] = true
+            table.insert(chain, id)
+            id = getHitParent(layer, id)
+        end
+        for j = #chain, 1, -1 do
+            table.insert(path, components[chain[j]])
+        end
+    end
+end
+
+
 -- returns path to component under mouse
 function getTopFocusedPath(layer, x, y)
     local path = { }
     if (1 == layer) or (3 == layer) then
-        getFocusedPath(popups, x, y, path)
+        if isHitIndexed(1) then
+            getIndexedFocusedPath(1, x, y, path)
+        else
+            getFocusedPath(popups, x, y, path)
+        end
         if 1 < #path then
             return path
         end
         path = { }
     end
     if (2 == layer) or (3 == layer) then
-        getFocusedPath(panel, x, y, path)
+        if isHitIndexed(2) then
+            getIndexedFocusedPath(2, x, y, path)
+        else
+            getFocusedPath(panel, x, y, path)
+        end
     end
     return path
 end
@@ -889,33 +1543,100 @@ function runPressedHandler(path, name, x, y, button)
 end
 
 
+-- run handlers of components under mouse found in hit index until one
+-- of them returns true.  Path from handling component to root is
+-- stored in path
+local function runIndexedHandler(layer, component, name, x, y, button, 
+        path)
+    if not isHitIndexed(layer) then
+        return runHandler(component, name, x, y, button, path)
+    end
+
+    local components = hitComponents[layer]
+    for i = 1, hitTest(layer, x, y) do
+        local id, mx, my, px, py = getHit(i)
+        if runComponentHandler(components[id], name, mx, my, button, 
+                px, py) 
+        then
+            while id do
+                table.insert(path, components[id])
+                id = getHitParent(layer, id)
+            end
+            return true
+        end
+    end
+    return false
+end
+
+
 -- traverse components and finds best handler with specified name
 function runTopHandler(layer, name, x, y, button)
     local path = { }
     if (1 == layer) or (3 == layer) then
-        local res = runHandler(popups, name, x, y, button, path)
+        local res = runIndexedHandler(1, popups, name, x, y, button, path)
         if res then
             return true, path
         end
     end
     if (2 == layer) or (3 == layer) then
-        return runHandler(panel, name, x, y, button, path), path
+        return runIndexedHandler(2, panel, name, x, y, button, path), path
+    end
+end
+
+-- returns cursor of first component under mouse which has it
+local function getIndexedCursorShape(layer, component, x, y)
+    if not isHitIndexed(layer) then
+        return getCursorShape(component, x, y)
+    end
+
+    local components = hitComponents[layer]
+    for i = 1, hitTest(layer, x, y) do
+        local cursor = rawget(components[getHit(i)], "cursor")
+        if cursor then
+            return cursor
+        end
     end
 end
 
 -- returns value of cursor property for specified layer
 function getTopCursorShape(layer, x, y)
     if (1 == layer) or (3 == layer) then
-        local cursor = getCursorShape(popups, x, y)
+        local cursor = getIndexedCursorShape(1, popups, x, y)
         if cursor then
             return cursor
         end
     end
     if (2 == layer) or (3 == layer) then
-        return getCursorShape(panel, x, y)
+        return getIndexedCursorShape(2, panel, x, y)
     end
 end
 
+-- returns true if any popup panel is under mouse
+local function isPopupUnderMouse(x, y)
+    if isHitIndexed(1) then
+        for i = 1, hitTest(1, x, y) do
+            if 1 == getHitParent(1, getHit(i)) then
+                return true
+            end
+        end
+        return false
+    end
+
+    local size = popups.size
+    local position = get(popups.position)
+    local mx = (x - position[1]) * size[1] / position[3]
+    local my = (y - position[2]) * size[2] / position[4]
+    for i = #popups.components, 1, -1 do
+        local v = popups.components[i]
+        if toboolean(get(v.visible)) and 
+                isInRect(get(v.position), mx, my) 
+        then
+            return true
+        end
+    end
+    return false
+end
+
 -- returns value of cursor property
 function getCursorShape(component, x, y)
     local position = get(component.position)
@@ -1050,19 +1771,7 @@ function onMouseMove(x, y, layer)
         cursorArrow = true
     else
         if ((1 == layer) or (3 == layer)) and 0 < #popups.components then
-            local size = popups.size
-            local position = get(popups.position)
-            local mx = (x - position[1]) * size[1] / position[3]
-            local my = (y - position[2]) * size[2] / position[4]
-            for i = #popups.components, 1, -1 do
-                local v = popups.components[i]
-                if toboolean(get(v.visible)) and 
-                        isInRect(get(v.position), mx, my) 
-                then
-                    cursorArrow = true
-                    break
-                end
-            end
+            cursorArrow = isPopupUnderMouse(x, y)
         end
     end
     if pressedComponentPath then
@@ -1330,19 +2039,13 @@ end
 -- load sample from file
 -- find file using the same rules as for textures
 function loadSample(fileName)
-    for _, v in ipairs(searchImagePath) do
-        local f = v .. '/' .. fileName
-        if isFileExists(f) then
-            return loadSampleFromFile(f)
-        end
-    end
-
-    if not isFileExists(fileName) then
+    local f = findFile(fileName, searchImagePath)
+    if not f then
         logError("Can't find sound", fileName)
         return 0
     end
 
-    local s = loadSampleFromFile(fileName)
+    local s = loadSampleFromFile(f)
     if 0 == s then
         logError("Can't load sound", fileName)
     end
@@ -1364,19 +2067,13 @@ SOUND_EVERYWHERE = 3
 -- load object from file
 -- find file using the same rules as for textures
 function loadObject(fileName)
-    for _, v in ipairs(searchImagePath) do
-        local f = v .. '/' .. fileName
-        if isFileExists(f) then
-            return loadObjectFromFile(f)
-        end
-    end
-
-    if not isFileExists(fileName) then
+    local f = findFile(fileName, searchImagePath)
+    if not f then
         logError("Can't find object", fileName)
         return 0
     end
 
-    local o = loadObjectFromFile(fileName)
+    local o = loadObjectFromFile(f)
     if 0 == o then
         logError("Can't load object", fileName)
     end
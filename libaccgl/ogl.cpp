@@ -91,6 +91,9 @@ struct OglCanvas
     // number of batches drawn
     int batches;
 
+    /// number of vertices drawn
+    int vertices;
+
     // number of batches because of texture changed
     int batchTex;
     
@@ -174,6 +177,7 @@ static void drawBegin(struct SaslGraphicsCallbacks *canvas)
     c->triangles = 0;
     c->lines = 0;
     c->batches = 0;
+    c->vertices = 0;
 
     c->batchTex = 0;
     c->batchTrans = 0;
@@ -241,6 +245,7 @@ static void dumpBuffers(OglCanvas *c)
 {
     if (c->numVertices) {
         glDrawArrays(c->currentMode, 0, c->numVertices);
+        c->vertices += c->numVertices;
         c->numVertices = 0;
         c->batches++;
     }
@@ -328,6 +333,40 @@ static void getTextureSize(const char *buffer, int length, int *width,
 #endif
 
 
+// set parameters of just created texture and count it
+static void initTexture(OglCanvas *c, unsigned id, int *width, int *height)
+{
+    // because of SOIL issue
+    setTexture(c, id);
+
+#ifndef USE_GLES1
+
+    if (width) {
+        GLint w;
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &w);
+        *width = w;
+    }
+    if (height) {
+        GLint h;
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &h);
+        *height = h;
+    }
+
+#endif
+
+    if (width && height)
+        c->texturesSize += (*width) * (*height);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT); 
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR); 
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+
+    c->textures++;
+}
+
+
 /// load texture to memory.
 /// Returns texture ID or -1 on failure.  On success returns texture width
 //  and height in pixels
@@ -348,43 +387,62 @@ static int loadTexture(struct SaslGraphicsCallbacks *canvas,
     if (! id) 
         return -1;
  
-    texId = id;
-
-    // because of SOIL issue
-    setTexture(c, id);
-
 #ifdef USE_GLES1
-
     if (width || height)
         getTextureSize(buffer, length, width, height);
+#endif
 
-#else
+    initTexture(c, id, width, height);
 
-    if (width) {
-        GLint w;
-        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &w);
-        *width = w;
-    }
-    if (height) {
-        GLint h;
-        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &h);
-        *height = h;
-    }
+    return id;
+}
 
-#endif
 
-    if (width && height)
-        c->texturesSize += (*width) * (*height);
+// decode image without touching OpenGL, safe to call from any thread
+static void* decodeImage(struct SaslGraphicsCallbacks *canvas,
+        const char *buffer, int length, int *width, int *height,
+        int *channels)
+{
+    return SOIL_load_image_from_memory((const unsigned char*)buffer, length,
+            width, height, channels, SOIL_LOAD_AUTO);
+}
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT); 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR); 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+// create texture from decoded image
+static int uploadImage(struct SaslGraphicsCallbacks *canvas, void *pixels,
+        int width, int height, int channels, int *textureWidth, 
+        int *textureHeight)
+{
+    OglCanvas *c = (OglCanvas*)canvas;
+    if ((! c) || (! pixels))
+        return -1;
 
-    c->textures++;
+    GLuint texId = 0;
+    if (c->genTexNameCallback)
+        texId = c->genTexNameCallback();
+
+    unsigned id = SOIL_create_OGL_texture((const unsigned char*)pixels,
+            width, height, channels, texId, SOIL_FLAG_POWER_OF_TWO);
+    if (! id) 
+        return -1;
+
+#ifdef USE_GLES1
+    if (textureWidth)
+        *textureWidth = width;
+    if (textureHeight)
+        *textureHeight = height;
+#endif
+
+    initTexture(c, id, textureWidth, textureHeight);
 
-    return texId;
+    return id;
+}
+
+
+// free decoded image
+static void freeImage(struct SaslGraphicsCallbacks *canvas, void *pixels)
+{
+    SOIL_free_image_data((unsigned char*)pixels);
 }
 
 
@@ -594,6 +652,18 @@ static void rotateTransform(struct SaslGraphicsCallbacks *canvas,
 }
 
 
+// fill statistics of drawing since last draw_begin
+static void getStats(struct SaslGraphicsCallbacks *canvas,
+        struct SaslGraphicsStats *stats)
+{
+    OglCanvas *c = (OglCanvas*)canvas;
+    if (c && stats) {
+        stats->batches = c->batches;
+        stats->vertices = c->vertices;
+    }
+}
+
+
 #ifdef USE_GLES1
 
 static int findTexture(struct SaslGraphicsCallbacks *canvas, 
@@ -863,6 +933,10 @@ struct SaslGraphicsCallbacks* saslgl_init_graphics()
     c->callbacks.find_texture = findTexture;
     c->callbacks.set_render_target = setRenderTarget;
     c->callbacks.recreate_texture = recreateTexture;
+    c->callbacks.get_stats = getStats;
+    c->callbacks.decode_image = decodeImage;
+    c->callbacks.upload_image = uploadImage;
+    c->callbacks.free_image = freeImage;
  
     c->binderCallback = NULL;   
     c->genTexNameCallback = NULL;   
@@ -879,6 +953,7 @@ struct SaslGraphicsCallbacks* saslgl_init_graphics()
 #endif
     c->triangles = c->lines = c->textures = c->texturesSize = 0;
     c->batches = c->batchTrans = c->batchNoTex = c->batchLines = 0;
+    c->vertices = 0;
     c->currentTexture = 0;
     c->defaultFbo = 0;
     c->currentFboTex = 0;
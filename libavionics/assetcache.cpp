@@ -0,0 +1,153 @@
+#include "assetcache.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "md5.h"
+
+
+using namespace xa;
+
+
+AssetCache::AssetCache()
+{
+    hits = 0;
+}
+
+
+std::string AssetCache::getDigest(const unsigned char *data, size_t size)
+{
+    unsigned char digest[16];
+    md5_state_t md5;
+    md5_init(&md5);
+    md5_append(&md5, data, size);
+    md5_finish(&md5, digest);
+    return std::string((const char*)digest, sizeof(digest));
+}
+
+
+int AssetCache::findDigest(const std::string &fileName, std::string &digest)
+{
+    std::unordered_map<std::string, FileDigest>::iterator i =
+        files.find(fileName);
+    if (i == files.end())
+        return -1;
+
+    struct stat st;
+    if (stat(fileName.c_str(), &st) || 
+            ((*i).second.mtime != (long long)st.st_mtime) ||
+            ((*i).second.size != (uint64_t)st.st_size))
+    {
+        files.erase(i);
+        return -1;
+    }
+
+    digest = (*i).second.digest;
+    return 0;
+}
+
+
+void AssetCache::setDigest(const std::string &fileName,
+        const std::string &digest)
+{
+    struct stat st;
+    if (digest.empty() || stat(fileName.c_str(), &st))
+        return;
+
+    FileDigest &file = files[fileName];
+    file.mtime = st.st_mtime;
+    file.size = st.st_size;
+    file.digest = digest;
+}
+
+
+void AssetCache::putTexture(const std::string &digest,
+        SaslGraphicsCallbacks *graphics, int id, int width, int height)
+{
+    IdleTexture texture;
+    texture.graphics = graphics;
+    texture.id = id;
+    texture.width = width;
+    texture.height = height;
+    textures.insert(std::make_pair(digest, texture));
+}
+
+
+int AssetCache::takeTexture(const std::string &digest,
+        SaslGraphicsCallbacks *graphics, int &width, int &height)
+{
+    typedef std::unordered_multimap<std::string, IdleTexture>::iterator Iter;
+    std::pair<Iter, Iter> range = textures.equal_range(digest);
+    for (Iter i = range.first; i != range.second; i++) {
+        IdleTexture &texture = (*i).second;
+        if (texture.graphics != graphics)
+            continue;
+        int id = texture.id;
+        width = texture.width;
+        height = texture.height;
+        textures.erase(i);
+        hits++;
+        return id;
+    }
+
+    return -1;
+}
+
+
+bool AssetCache::hasTexture(const std::string &digest,
+        SaslGraphicsCallbacks *graphics) const
+{
+    typedef std::unordered_multimap<std::string, IdleTexture>::const_iterator
+        Iter;
+    std::pair<Iter, Iter> range = textures.equal_range(digest);
+    for (Iter i = range.first; i != range.second; i++)
+        if ((*i).second.graphics == graphics)
+            return true;
+    return false;
+}
+
+
+void AssetCache::trim()
+{
+    for (std::unordered_multimap<std::string, IdleTexture>::iterator i =
+            textures.begin(); i != textures.end(); i++)
+    {
+        IdleTexture &texture = (*i).second;
+        if (texture.graphics && texture.graphics->free_texture)
+            texture.graphics->free_texture(texture.graphics, texture.id);
+    }
+    textures.clear();
+}
+
+
+void AssetCache::clear()
+{
+    trim();
+    files.clear();
+}
+
+
+AssetCache& xa::getAssetCache()
+{
+    static AssetCache cache;
+    return cache;
+}
+
+
+/// Returns number of textures reused since start of process and number
+/// of idle textures
+static int luaGetAssetCacheStats(lua_State *L)
+{
+    AssetCache &cache = getAssetCache();
+    lua_pushnumber(L, cache.getHits());
+    lua_pushnumber(L, cache.getIdleCount());
+    return 2;
+}
+
+
+void xa::exportAssetCacheToLua(Luna &lua)
+{
+    lua_State *L = lua.getLua();
+
+    lua_register(L, "getAssetCacheStats", luaGetAssetCacheStats);
+}
+
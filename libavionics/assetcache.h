@@ -0,0 +1,116 @@
+#ifndef __ASSET_CACHE_H__
+#define __ASSET_CACHE_H__
+
+
+#include <string>
+#include <unordered_map>
+#include <stdint.h>
+#include "luna.h"
+#include "libavcallbacks.h"
+
+
+namespace xa {
+
+
+/// Textures left by destroyed panels.  Cache is shared by all avionics
+/// instances of process, so panel reload gets textures of unchanged
+/// files back instead of decoding them again.  Textures are addressed
+/// by MD5 of file contents.  Digest is calculated from file data when
+/// image is loaded and remembered with size and modification time of
+/// file, so unchanged files aren't read at all on reload.  Textures not
+/// reused by next loaded panel are freed.  Cache is used from thread
+/// owning graphics context only.
+class AssetCache
+{
+    private:
+        /// Digest of file on disk
+        struct FileDigest
+        {
+            /// Modification time of file
+            long long mtime;
+
+            /// Size of file
+            uint64_t size;
+
+            /// MD5 of contents
+            std::string digest;
+        };
+
+        /// Texture not used by any panel
+        struct IdleTexture
+        {
+            /// Graphics backend owning texture
+            SaslGraphicsCallbacks *graphics;
+
+            /// Texture ID
+            int id;
+
+            /// Size of texture
+            int width, height;
+        };
+
+        /// Digests of files by file name
+        std::unordered_map<std::string, FileDigest> files;
+
+        /// Idle textures by digest
+        std::unordered_multimap<std::string, IdleTexture> textures;
+
+        /// Number of textures reused
+        int hits;
+
+    public:
+        /// Create empty cache
+        AssetCache();
+
+    public:
+        /// Get remembered MD5 of file on disk.  Returns 0 on success or
+        /// -1 if file is unknown or its size or modification time changed.
+        int findDigest(const std::string &fileName, std::string &digest);
+
+        /// Remember MD5 of file on disk
+        void setDigest(const std::string &fileName, const std::string &digest);
+
+        /// Returns MD5 of data.  May be called from any thread.
+        static std::string getDigest(const unsigned char *data, size_t size);
+
+        /// Keep texture for reuse
+        void putTexture(const std::string &digest,
+                SaslGraphicsCallbacks *graphics, int id, int width,
+                int height);
+
+        /// Take texture with the same contents.  Returns texture ID or -1
+        /// if there is no such texture.
+        int takeTexture(const std::string &digest,
+                SaslGraphicsCallbacks *graphics, int &width, int &height);
+
+        /// Returns true if texture with the same contents can be taken
+        bool hasTexture(const std::string &digest,
+                SaslGraphicsCallbacks *graphics) const;
+
+        /// Free textures which weren't taken
+        void trim();
+
+        /// Free textures and forget digests of files
+        void clear();
+
+        /// Returns number of reused textures
+        int getHits() const { return hits; }
+
+        /// Returns number of idle textures
+        int getIdleCount() const { return (int)textures.size(); }
+};
+
+
+/// Returns cache shared by all avionics instances
+AssetCache& getAssetCache();
+
+
+/// Register asset cache functions in Lua
+void exportAssetCacheToLua(Luna &lua);
+
+
+};
+
+
+#endif
+
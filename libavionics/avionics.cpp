@@ -16,15 +16,20 @@ Avionics::Avionics(const std::string &path,
         sasl_lua_creator_callback luaCreator, 
         sasl_lua_destroyer_callback luaDestroyer): path(path), 
     lua(luaCreator, luaDestroyer), clickEmulator(timer),
-    fontManager(textureManager), properties(lua), server(log, properties), 
-    commands(lua)
+    textureManager(vfs, preloader, startup), 
+    fontManager(textureManager, vfs), properties(lua, log), 
+    server(log, properties), recorder(properties, log), commands(lua), 
+    profiler(log), sampler(log), metrics(properties), gcScheduler(lua),
+    handlers(lua, log), tasks(lua, log)
 {
+    eventTime = 0;
+    bytecodeCache.setDirectory(path + "/cache");
     log.exportToLua(lua);
     panelWidth = popupWidth = 1024;
     panelHeight = popupHeight = 768;
     setGraphicsCallbacks(getGraphicsStub());
 
-    lastGcTime = 0;
+    gcPending = false;
 
     bgR = bgG = bgB = 1.0f;
     bgA = 0.0f;
@@ -34,6 +39,22 @@ Avionics::Avionics(const std::string &path,
     exportTextureToLua(lua);
     exportFontToLua(lua);
     exportPropsToLua(lua);
+    exportPropHistoryToLua(lua);
+    exportRecorderToLua(lua);
+    exportProfilerToLua(lua);
+    exportSamplerToLua(lua);
+    exportTracerToLua(lua);
+    exportGcToLua(lua);
+    exportAllocToLua(lua);
+    exportInputToLua(lua);
+    exportHitIndexToLua(lua);
+    exportUpdateSchedulerToLua(lua);
+    exportTasksToLua(lua);
+    exportBytecodeCacheToLua(lua);
+    exportVfsToLua(lua);
+    exportPreloaderToLua(lua);
+    exportStartupToLua(lua);
+    exportAssetCacheToLua(lua);
     sound.exportSoundToLua(lua);
 
     clickEmulation = false;
@@ -57,6 +78,7 @@ int Avionics::initLua()
     addSearchPath(path + "/scripts");
     addSearchPath(path + "/components");
     addSearchImagePath(path + "/images");
+    handlers.bind();
 
     return 0;
 }
@@ -106,6 +128,18 @@ int Avionics::loadPanel(const std::string &fileName)
     lua_pushstring(L, panelDir.c_str());
     lua_setglobal(L, "panelDir");
 
+    preloader.clear();
+    vfs.clear();
+    if (! vfs.mount(panelDir + "/Custom Avionics.pak",
+                panelDir + "/Custom Avionics"))
+        log.info("Mounted Custom Avionics.pak");
+    hitIndex.clear();
+    updateScheduler.clear();
+    tasks.clear();
+
+    prefetchAssets(panelDir);
+    startup.begin();
+
     lua_getglobal(L, "loadPanel");              // loadPanel
     lua_pushstring(L, fileName.c_str());        // loadPanel "fileName"
     lua_pushnumber(L, panelWidth);
@@ -120,84 +154,172 @@ int Avionics::loadPanel(const std::string &fileName)
         else
             log.error("Error loading panel");
         lua_pop(L, 1);
+        startup.end();
+        getAssetCache().trim();
         return -1;
     }
     if (lua_isnil(L, -1)) {
         lua_pop(L, 1);
+        startup.end();
+        getAssetCache().trim();
         return -1;
     }
+    lua_pop(L, 1);
+
+    // textures of previous panel not used by this one
+    startup.end();
+    getAssetCache().trim();
+    writeStartupProfile(panelDir);
+
+    handlers.bind();
 
     return 0;
 }
 
+
+int Avionics::preloadAsset(const std::string &fileName, int kind)
+{
+    if ((-1 == kind) || ((Preloader::PRELOAD_SAMPLE == kind) &&
+                (! sound.canLoadBuffers())) || 
+            ((Preloader::PRELOAD_IMAGE == kind) && 
+                textureManager.canReuse(fileName)))
+        return -1;
+
+    // packed files are copied, archive may be remounted while loading
+    const unsigned char *data = NULL;
+    size_t size = 0;
+    if (vfs.readPacked(fileName, data, size))
+        data = NULL;
+
+    return preloader.request(fileName, kind, data, size);
+}
+
+
+void Avionics::prefetchAssets(const std::string &panelDir)
+{
+    std::vector<StartupAsset> assets;
+    if ((! startup.isEnabled()) || StartupProfile::readManifest(
+                panelDir + "/startup-manifest.txt", panelDir, assets))
+        return;
+
+    // assets are requested in order panel used them last time
+    int count = 0;
+    for (std::vector<StartupAsset>::iterator i = assets.begin();
+            i != assets.end(); i++)
+        if (vfs.exists((*i).fileName) &&
+                (-1 != preloadAsset((*i).fileName, (*i).kind)))
+            count++;
+    log.info("Prefetching %i assets of startup manifest", count);
+}
+
+
+void Avionics::writeStartupProfile(const std::string &panelDir)
+{
+    if (! startup.isEnabled())
+        return;
+
+    log.info("Panel loaded in %.0f ms", startup.getLoadTime());
+    if (startup.writeManifest(panelDir + "/startup-manifest.txt", panelDir))
+        log.warning("Can't write startup manifest");
+    if (startup.writeReport(panelDir + "/startup-report.txt", 30))
+        log.warning("Can't write startup report");
+}
+
 void Avionics::update()
 {
+    collectGarbage();
+
+    TRACE_SCOPE("update");
+    double startTime = Profiler::getTime();
+
+    hitIndex.nextFrame();
+    dispatchInput();
+
     if (properties.update())
         log.error("Error updating properties");
 
+    properties.updateHistories(timer.getTime());
+    properties.notifyWatchers();
+    recorder.update(timer.getTime());
+
     if (server.isRunning())
         if (server.update())
             log.error("Server error");
 
     if (clickEmulation) {
         if (clickEmulator.update())
-            onMouseClick(clickEmulator.getX(), clickEmulator.getY(),
+            handleMouseClick(clickEmulator.getX(), clickEmulator.getY(),
                     clickEmulator.getButton(), clickEmulator.getLayer());
     }
     
     sound.update();
 
-    lua_State *L = lua.getLua();
-    lua_getglobal(L, "update");
-    if (lua_isfunction(L, -1)) {
-        if (lua_pcall(L, 0, 0, 0)) {
-            std::string msg(lua_tostring(L, -1));
-            lua_pop(L, 1);
-            log.error("Error updating avionics: %s",  msg.c_str());
-        }
-    } else
-        lua_pop(L, 1);
+    tasks.update(timer.getTime());
+
+    profiler.resetStack();
+
+    if (handlers.push(HANDLER_UPDATE))
+        handlers.pcall(HANDLER_UPDATE, 0, 0);
 
     long currentTime = timer.getTime();
-    if (currentTime - lastGcTime > 3000) {
-//        lua_gc(L, LUA_GCCOLLECT, 0);
-        lastGcTime = currentTime;
-    }
+    profiler.update(currentTime);
+
+    metrics.addUpdateTime(Profiler::getTime() - startTime);
+    metrics.update(currentTime, lua.getLua(), server, textureManager);
+
+    gcPending = true;
 }
 
-void Avionics::draw(int stage)
+
+void Avionics::collectGarbage()
 {
-    lua_State *L = lua.getLua();
+    if (! gcPending)
+        return;
+    gcPending = false;
 
-    graphics->draw_begin(graphics);
+    TRACE_SCOPE("gc");
+    metrics.addGcTime(gcScheduler.collect());
+}
 
-    const char *drawFunc;
+void Avionics::draw(int stage)
+{
+    Handler drawFunc;
+    const char *traceName;
     switch (stage) {
-        case STAGE_GAUGES: drawFunc = "drawPanelLayer"; break;
-        case STAGE_POPUPS: drawFunc = "drawPopupsLayer"; break;
-        case STAGE_ALL: drawFunc = "drawPanel"; break;
-        default: drawFunc = "";
+        case STAGE_GAUGES: 
+            drawFunc = HANDLER_DRAW_GAUGES; 
+            traceName = "draw gauges";
+            break;
+        case STAGE_POPUPS: 
+            drawFunc = HANDLER_DRAW_POPUPS; 
+            traceName = "draw popups";
+            break;
+        default: 
+            drawFunc = HANDLER_DRAW_PANEL; 
+            traceName = "draw";
     }
+    TRACE_SCOPE(traceName);
+    double startTime = Profiler::getTime();
 
-    lua_getglobal(L, drawFunc);
-    if (! lua_isfunction(L, -1)) {
-        lua_pop(L, 1);
-        log.error("Can't find drawPanel function");
-    }
+    graphics->draw_begin(graphics);
+    profiler.resetStack();
 
-    if (lua_pcall(L, 0, 0, 0)) {
-        // panel error message
-        const char* msg = lua_tostring(L, -1);
-        lua_pop(L, 1);
-        std::string reason;
-        if (msg)
-            reason = std::string("Error drawing panel: ") + msg;
-        else
-            reason = std::string("Error drawing panel");
-        log.error(reason.c_str());
-    }
+    if (handlers.push(drawFunc))
+        handlers.pcall(drawFunc, 0, 0);
+    else
+        log.error("Can't find %s function", Handlers::getName(drawFunc));
     
     graphics->draw_end(graphics);
+
+    if (graphics->get_stats) {
+        SaslGraphicsStats stats;
+        graphics->get_stats(graphics, &stats);
+        metrics.addDrawTime(stage, Profiler::getTime() - startTime, &stats);
+    } else
+        metrics.addDrawTime(stage, Profiler::getTime() - startTime, NULL);
+
+    if ((STAGE_POPUPS == stage) || (STAGE_ALL == stage))
+        collectGarbage();
 }
 
 void Avionics::addSearchPath(const std::string &path)
@@ -224,92 +346,68 @@ void Avionics::addSearchImagePath(const std::string &path)
     }
 }
 
-static bool call2(Luna &lua, const std::string &name, int a1, int a2, Log &log)
+bool Avionics::onMouseUp(int x, int y, int button, int layer)
 {
-    lua_State *L = lua.getLua();
-    lua_getglobal(L, name.c_str());
-    lua_pushnumber(L, a1);
-    lua_pushnumber(L, a2);
-    if (lua_pcall(L, 2, 1, 0)) {
-        std::string msg = lua_tostring(L, -1);
-        lua_pop(L, 1);
-        log.error("Error calling %s: %s", name.c_str(), msg.c_str());
-        return false;
-    }
-    bool res = lua_toboolean(L, -1);
-    lua_pop(L, 1);
-    return res;
+    eventTime = timer.getTime();
+    if (inputQueue.isEnabled())
+        return inputQueue.add(INPUT_MOUSE_UP, x, y, button, layer, eventTime);
+    return handleMouseUp(x, y, button, layer);
 }
 
-static bool call3(Luna &lua, const std::string &name, int a1, int a2, int a3,
-        Log &log)
+bool Avionics::onMouseDown(int x, int y, int button, int layer)
 {
-    lua_State *L = lua.getLua();
-    lua_getglobal(L, name.c_str());
-    lua_pushnumber(L, a1);
-    lua_pushnumber(L, a2);
-    lua_pushnumber(L, a3);
-    if (lua_pcall(L, 3, 1, 0)) {
-        std::string msg = lua_tostring(L, -1);
-        lua_pop(L, 1);
-        log.error("Error calling %s: %s", name.c_str(), msg.c_str());
-        return false;
-    }
-    bool res = lua_toboolean(L, -1);
-    lua_pop(L, 1);
-    return res;
+    eventTime = timer.getTime();
+    if (inputQueue.isEnabled())
+        return inputQueue.add(INPUT_MOUSE_DOWN, x, y, button, layer, 
+                eventTime);
+    return handleMouseDown(x, y, button, layer);
 }
 
-static bool call4(Luna &lua, const std::string &name, 
-        int a1, int a2, int a3, int a4, Log &log)
+bool Avionics::onMouseMove(int x, int y, int layer)
 {
-    lua_State *L = lua.getLua();
-    lua_getglobal(L, name.c_str());
-    lua_pushnumber(L, a1);
-    lua_pushnumber(L, a2);
-    lua_pushnumber(L, a3);
-    lua_pushnumber(L, a4);
-    if (lua_pcall(L, 4, 1, 0)) {
-        std::string msg = lua_tostring(L, -1);
-        lua_pop(L, 1);
-        log.error("Error calling %s: %s", name.c_str(), msg.c_str());
-        return false;
-    }
-    bool res = lua_toboolean(L, -1);
-    lua_pop(L, 1);
-    return res;
+    eventTime = timer.getTime();
+    if (inputQueue.isEnabled())
+        return inputQueue.add(INPUT_MOUSE_MOVE, x, y, 0, layer, eventTime);
+    return handleMouseMove(x, y, layer);
 }
 
+bool Avionics::onMouseClick(int x, int y, int button, int layer)
+{
+    eventTime = timer.getTime();
+    if (inputQueue.isEnabled())
+        return inputQueue.add(INPUT_MOUSE_CLICK, x, y, button, layer, 
+                eventTime);
+    return handleMouseClick(x, y, button, layer);
+}
 
-bool Avionics::onMouseUp(int x, int y, int button, int layer)
+bool Avionics::handleMouseUp(int x, int y, int button, int layer)
 {
     if (clickEmulation)
         clickEmulator.onMouseUp();
-    return call4(lua, "onMouseUp", x, y, button, layer, log);
+    return handlers.call(HANDLER_MOUSE_UP, x, y, button, layer);
 }
 
-bool Avionics::onMouseDown(int x, int y, int button, int layer)
+bool Avionics::handleMouseDown(int x, int y, int button, int layer)
 {
     if (clickEmulation) {
-        bool res = call4(lua, "onMouseDown", x, y, button, layer, log);
+        bool res = handlers.call(HANDLER_MOUSE_DOWN, x, y, button, layer);
         clickEmulator.onMouseDown(button, x, y, layer);
-        if (onMouseClick(x, y, button, layer) || res)
+        if (handleMouseClick(x, y, button, layer) || res)
             return true;
     }
-    return call4(lua, "onMouseDown", x, y, button, layer, log);
+    return handlers.call(HANDLER_MOUSE_DOWN, x, y, button, layer);
 }
 
-bool Avionics::onMouseMove(int x, int y, int layer)
+bool Avionics::handleMouseMove(int x, int y, int layer)
 {
     if (clickEmulation)
         clickEmulator.onMouseMove(x, y, layer);
-    return call3(lua, "onMouseMove", x, y, layer, log);
+    return handlers.call(HANDLER_MOUSE_MOVE, x, y, layer);
 }
 
-
-bool Avionics::onMouseClick(int x, int y, int button, int layer)
+bool Avionics::handleMouseClick(int x, int y, int button, int layer)
 {
-    return call4(lua, "onMouseClick", x, y, button, layer, log);
+    return handlers.call(HANDLER_MOUSE_CLICK, x, y, button, layer);
 }
 
 void Avionics::setClickParams(int delay, int period)
@@ -324,12 +422,66 @@ void Avionics::enableClickEmulator(bool enable)
 
 bool Avionics::onKeyUp(int charCode, int keyCode)
 {
-    return call2(lua, "onKeyUp", charCode, keyCode, log);
+    eventTime = timer.getTime();
+    if (inputQueue.isEnabled())
+        return inputQueue.add(INPUT_KEY_UP, charCode, keyCode, 0, 0, 
+                eventTime);
+    return handlers.call(HANDLER_KEY_UP, charCode, keyCode);
 }
 
 bool Avionics::onKeyDown(int charCode, int keyCode)
 {
-    return call2(lua, "onKeyDown", charCode, keyCode, log);
+    eventTime = timer.getTime();
+    if (inputQueue.isEnabled())
+        return inputQueue.add(INPUT_KEY_DOWN, charCode, keyCode, 0, 0, 
+                eventTime);
+    return handlers.call(HANDLER_KEY_DOWN, charCode, keyCode);
+}
+
+void Avionics::setInputQueue(bool enable)
+{
+    if (! enable)
+        dispatchInput();
+    inputQueue.setEnabled(enable);
+}
+
+void Avionics::dispatchInput()
+{
+    const std::vector<InputEvent> &events = inputQueue.take();
+    if (events.empty())
+        return;
+
+    TRACE_SCOPE("input");
+    for (std::vector<InputEvent>::const_iterator i = events.begin();
+            i != events.end(); i++)
+    {
+        const InputEvent &e = *i;
+        eventTime = e.time;
+        bool res = false;
+        switch (e.type) {
+            case INPUT_MOUSE_DOWN:
+                res = handleMouseDown(e.a, e.b, e.c, e.d);
+                break;
+            case INPUT_MOUSE_UP:
+                res = handleMouseUp(e.a, e.b, e.c, e.d);
+                break;
+            case INPUT_MOUSE_MOVE:
+                res = handleMouseMove(e.a, e.b, e.d);
+                break;
+            case INPUT_MOUSE_CLICK:
+                res = handleMouseClick(e.a, e.b, e.c, e.d);
+                break;
+            case INPUT_KEY_DOWN:
+                res = handlers.call(HANDLER_KEY_DOWN, e.a, e.b);
+                break;
+            case INPUT_KEY_UP:
+                res = handlers.call(HANDLER_KEY_UP, e.a, e.b);
+                break;
+            default:
+                break;
+        }
+        inputQueue.setResult(e.type, res);
+    }
 }
 
 void Avionics::setBackgroundColor(float r, float g, float b, float a)
@@ -368,6 +520,54 @@ void Avionics::stopPropsServer()
 }
 
 
+void Avionics::enableProfiler(bool enable, long dumpPeriod)
+{
+    profiler.setEnabled(enable);
+    profiler.setDumpPeriod(dumpPeriod);
+    profiler.resetStack();
+
+    lua_State *L = lua.getLua();
+    lua_getglobal(L, "setComponentsProfiling");
+    lua_pushboolean(L, enable);
+    if (lua_pcall(L, 1, 0, 0)) {
+        log.error("Can't switch profiling: %s", lua_tostring(L, -1));
+        lua_pop(L, 1);
+    }
+}
+
+
+/// Call global Lua function which returns true on success.
+/// Returns zero on success.
+static int callBoolFunction(lua_State *L, Log &log, const char *name,
+        int nargs)
+{
+    lua_getglobal(L, name);
+    lua_insert(L, -1 - nargs);
+    if (lua_pcall(L, nargs, 1, 0)) {
+        log.error("Error calling %s: %s", name, lua_tostring(L, -1));
+        lua_pop(L, 1);
+        return -1;
+    }
+    bool ok = lua_toboolean(L, -1);
+    lua_pop(L, 1);
+    return ok ? 0 : -1;
+}
+
+
+int Avionics::startSampling(int interval)
+{
+    lua_State *L = lua.getLua();
+    lua_pushnumber(L, interval);
+    return callBoolFunction(L, log, "startSampling", 1);
+}
+
+
+int Avionics::stopSampling()
+{
+    return callBoolFunction(lua.getLua(), log, "stopSampling", 0);
+}
+
+
 void Avionics::setCommandsCallbacks(SaslCommandCallbacks *callbacks, 
         void *data)
 {
@@ -378,6 +578,7 @@ void Avionics::setGraphicsCallbacks(SaslGraphicsCallbacks *callbacks)
 {
     graphics = callbacks;
     textureManager.setGraphicsCallbacks(callbacks);
+    preloader.setGraphicsCallbacks(callbacks);
 }
 
 
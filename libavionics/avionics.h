@@ -14,6 +14,23 @@
 #include "commands.h"
 #include "log.h"
 #include "sound.h"
+#include "recorder.h"
+#include "profiler.h"
+#include "sampler.h"
+#include "tracer.h"
+#include "perfmetrics.h"
+#include "gcscheduler.h"
+#include "luaalloc.h"
+#include "handlers.h"
+#include "inputqueue.h"
+#include "hitindex.h"
+#include "updatesched.h"
+#include "tasks.h"
+#include "bytecache.h"
+#include "vfs.h"
+#include "preloader.h"
+#include "startup.h"
+#include "assetcache.h"
 
 
 namespace xa {
@@ -53,6 +70,15 @@ class Avionics
         /// Muse click events emulator
         ClickEmulator clickEmulator;
 
+        /// Index of files on search paths
+        Vfs vfs;
+
+        /// Loads assets on worker threads
+        Preloader preloader;
+
+        /// Costs of panel loading
+        StartupProfile startup;
+
         /// Textures cache
         TextureManager textureManager;
         
@@ -68,18 +94,54 @@ class Avionics
         /// Properties server
         PropsServer server;
 
+        /// Flight-data recorder
+        Recorder recorder;
+
         /// Commands API
         Commands commands;
 
         /// Graphics functions
         SaslGraphicsCallbacks *graphics;
 
-        /// Time passed since last garbage collection
-        long lastGcTime;
+        /// True if garbage wasn't collected since last update
+        bool gcPending;
 
         /// Sound related functions
         Sound sound;
 
+        /// Components profiler
+        Profiler profiler;
+
+        /// Samples of LuaJIT sampling profiler
+        Sampler sampler;
+
+        /// Frame metrics published as properties
+        PerfMetrics metrics;
+
+        /// Incremental garbage collector
+        GcScheduler gcScheduler;
+
+        /// Cached Lua entry points
+        Handlers handlers;
+
+        /// Input events waiting for next update
+        InputQueue inputQueue;
+
+        /// Time of input event being handled
+        long eventTime;
+
+        /// Components under mouse finder
+        HitIndex hitIndex;
+
+        /// Components with reduced update rate
+        UpdateScheduler updateScheduler;
+
+        /// Lua timers and coroutines
+        TaskScheduler tasks;
+
+        /// Compiled components cache
+        BytecodeCache bytecodeCache;
+
     public:
         /// Initialize avionics internal data
         Avionics(const std::string &path, 
@@ -173,6 +235,15 @@ class Avionics
         /// Stop ptops server
         void stopPropsServer();
 
+        /// Returns props server
+        PropsServer& getPropsServer() { return server; };
+
+        /// Returns flight-data recorder
+        Recorder& getRecorder() { return recorder; };
+
+        /// Returns number of milliseconds since avionics creation
+        long getTime() { return timer.getTime(); };
+
         /// Returns commands API
         Commands& getCommands() { return commands; };
 
@@ -195,11 +266,96 @@ class Avionics
         /// Returns sound API object
         Sound& getSound() { return sound; };
 
+        /// Returns components profiler
+        Profiler& getProfiler() { return profiler; };
+
+        /// Enable or disable profiling of components update and draw calls
+        /// \param dumpPeriod period of report dumps to log in milliseconds
+        ///     or 0 to disable dumps
+        void enableProfiler(bool enable, long dumpPeriod);
+
+        /// Returns frame metrics
+        PerfMetrics& getMetrics() { return metrics; };
+
+        /// Returns garbage collection scheduler
+        GcScheduler& getGcScheduler() { return gcScheduler; };
+
+        /// Run garbage collection step of current frame if it wasn't
+        /// done yet.  Called after last draw stage of frame or before
+        /// next update if panel wasn't drawn.
+        void collectGarbage();
+
+        /// Returns LuaJIT samples collector
+        Sampler& getSampler() { return sampler; };
+
+        /// Start LuaJIT sampling profiler and trace aborts collection.
+        /// Returns zero on success.
+        /// \param interval sampling interval in milliseconds
+        int startSampling(int interval);
+
+        /// Stop LuaJIT sampling profiler.  Collected samples are kept
+        /// until next start.  Returns zero on success.
+        int stopSampling();
+
+        /// Returns input events queue
+        InputQueue& getInputQueue() { return inputQueue; };
+
+        /// Enable or disable queueing of input events.  Queued events
+        /// are dispatched at start of update.  Pending events are
+        /// dispatched immediately when queue is disabled.
+        void setInputQueue(bool enable);
+
+        /// Returns time of input event being handled in milliseconds
+        /// since avionics creation
+        long getEventTime() { return eventTime; };
+
+        /// Returns components hit index
+        HitIndex& getHitIndex() { return hitIndex; };
+
+        /// Returns scheduler of components updates
+        UpdateScheduler& getUpdateScheduler() { return updateScheduler; };
+
+        /// Returns Lua timers and coroutines scheduler
+        TaskScheduler& getTasks() { return tasks; };
+
+        /// Returns cache of compiled components
+        BytecodeCache& getBytecodeCache() { return bytecodeCache; };
+
+        /// Returns index of files on search paths
+        Vfs& getVfs() { return vfs; };
+
+        /// Returns assets preloader
+        Preloader& getPreloader() { return preloader; };
+
+        /// Returns costs of panel loading
+        StartupProfile& getStartupProfile() { return startup; };
+
+        /// Start loading asset on worker threads.  Files of mounted
+        /// archives are copied.  Returns handle of asset or -1 if asset
+        /// of this kind can't be preloaded or its texture is reused.
+        int preloadAsset(const std::string &fileName, int kind);
+
         /// Add path to components search list
         void addSearchPath(const std::string &path);
         
         /// Add path to images search list
         void addSearchImagePath(const std::string &path);
+
+    private:
+        /// Call Lua handlers of input events
+        bool handleMouseUp(int x, int y, int button, int layer);
+        bool handleMouseDown(int x, int y, int button, int layer);
+        bool handleMouseMove(int x, int y, int layer);
+        bool handleMouseClick(int x, int y, int button, int layer);
+
+        /// Dispatch queued input events
+        void dispatchInput();
+
+        /// Prefetch assets listed in startup manifest of panel
+        void prefetchAssets(const std::string &panelDir);
+
+        /// Write startup manifest and report of loaded panel
+        void writeStartupProfile(const std::string &panelDir);
 };
 
 };
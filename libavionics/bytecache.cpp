@@ -0,0 +1,411 @@
+#include "bytecache.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef WINDOWS
+#include <direct.h>
+#else
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include "md5.h"
+#include "avionics.h"
+
+
+using namespace xa;
+
+
+/// Signature of cache file
+static const char CACHE_SIGNATURE[8] = { 'S', 'A', 'S', 'L', 'L', 'B', 'C', 2 };
+
+
+/// Nanoseconds in second
+#define NSEC_PER_SEC 1000000000LL
+
+/// Source modified less than this number of nanoseconds before cache
+/// was written may be modified again without changing modification
+/// time on file systems with coarse timestamps, so it is hashed
+#define RACY_TIME (2 * NSEC_PER_SEC)
+
+
+/// Header of cache file followed by path of source and bytecode
+struct CacheHeader
+{
+    /// CACHE_SIGNATURE
+    char signature[8];
+
+    /// Size of pointer: bytecode of 32 and 64 bit builds differs
+    uint32_t pointerSize;
+
+    /// Length of path of source
+    uint32_t pathSize;
+
+    /// Modification time of source in nanoseconds
+    int64_t mtime;
+
+    /// Time of writing cache file in nanoseconds
+    int64_t written;
+
+    /// Size of source
+    uint64_t sourceSize;
+
+    /// Size of bytecode
+    uint64_t codeSize;
+
+    /// MD5 of source
+    unsigned char digest[16];
+};
+
+
+/// Cache file mapped to memory or read if mapping is unavailable
+class CacheFile
+{
+    public:
+        /// File data
+        const unsigned char *data;
+
+        /// Size of data
+        size_t size;
+
+    private:
+        /// File data if memory mapping is unavailable
+        std::vector<unsigned char> buffer;
+
+    public:
+        CacheFile() { data = NULL; size = 0; };
+
+        ~CacheFile() {
+#ifndef WINDOWS
+            if (data)
+                munmap((void*)data, size);
+#endif
+        };
+
+    public:
+        /// Map file to memory.  Returns 0 on success.
+        int open(const std::string &fileName) {
+#ifndef WINDOWS
+            int fd = ::open(fileName.c_str(), O_RDONLY);
+            if (-1 == fd)
+                return -1;
+            struct stat st;
+            if (fstat(fd, &st) || (! st.st_size)) {
+                ::close(fd);
+                return -1;
+            }
+            void *p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            ::close(fd);
+            if (MAP_FAILED == p)
+                return -1;
+            data = (const unsigned char*)p;
+            size = st.st_size;
+#else
+            FILE *f = fopen(fileName.c_str(), "rb");
+            if (! f)
+                return -1;
+            unsigned char buf[4096];
+            size_t len;
+            while (0 < (len = fread(buf, 1, sizeof(buf), f)))
+                buffer.insert(buffer.end(), buf, buf + len);
+            fclose(f);
+            if (buffer.empty())
+                return -1;
+            data = &buffer[0];
+            size = buffer.size();
+#endif
+            return 0;
+        };
+};
+
+
+/// Read and validate header of cache file.  Returns pointer to bytecode
+/// or NULL if cache file doesn't belong to source.
+static const unsigned char* getCode(const CacheFile &file,
+        const std::string &fileName, size_t sourceSize, CacheHeader &header)
+{
+    if (file.size < sizeof(header))
+        return NULL;
+    memcpy(&header, file.data, sizeof(header));
+    if (memcmp(header.signature, CACHE_SIGNATURE, sizeof(CACHE_SIGNATURE)) ||
+            (sizeof(void*) != header.pointerSize) ||
+            (fileName.size() != header.pathSize) ||
+            (sourceSize != header.sourceSize) || (! header.codeSize) ||
+            (file.size != sizeof(header) + header.pathSize + header.codeSize))
+        return NULL;
+
+    // different files with the same hash of path
+    const unsigned char *path = file.data + sizeof(header);
+    if (memcmp(path, fileName.c_str(), header.pathSize))
+        return NULL;
+
+    return path + header.pathSize;
+}
+
+
+/// Returns modification time of file in nanoseconds.  Precision is
+/// limited to seconds where stat has no sub-second fields.
+static long long getModificationTime(const struct stat &st)
+{
+#if defined(WINDOWS)
+    return st.st_mtime * NSEC_PER_SEC;
+#elif defined(APL)
+    return st.st_mtimespec.tv_sec * NSEC_PER_SEC + st.st_mtimespec.tv_nsec;
+#else
+    return st.st_mtim.tv_sec * NSEC_PER_SEC + st.st_mtim.tv_nsec;
+#endif
+}
+
+
+/// Returns true if source could be modified after cache was written
+/// without changing its modification time
+static bool isRacy(const CacheHeader &header)
+{
+    return header.written - header.mtime < RACY_TIME;
+}
+
+
+/// Calculate MD5 of data
+static void getDigest(const unsigned char *data, size_t size,
+        unsigned char *digest)
+{
+    md5_state_t md5;
+    md5_init(&md5);
+    md5_append(&md5, data, size);
+    md5_finish(&md5, digest);
+}
+
+
+/// Append part of bytecode to buffer
+static int writeCode(lua_State *L, const void *p, size_t size, void *data)
+{
+    std::vector<unsigned char> *code = (std::vector<unsigned char>*)data;
+    code->insert(code->end(), (const unsigned char*)p,
+            (const unsigned char*)p + size);
+    return 0;
+}
+
+
+BytecodeCache::BytecodeCache()
+{
+    enabled = true;
+    created = false;
+    hits = misses = 0;
+}
+
+
+void BytecodeCache::setDirectory(const std::string &dir)
+{
+    directory = dir;
+    created = false;
+}
+
+
+std::string BytecodeCache::getCacheName(const std::string &fileName)
+{
+    unsigned char digest[16];
+    getDigest((const unsigned char*)fileName.c_str(), fileName.size(),
+            digest);
+
+    char name[40];
+    for (int i = 0; i < 16; i++)
+        sprintf(name + i * 2, "%02x", digest[i]);
+    strcpy(name + 32, ".luac");
+    return directory + "/" + name;
+}
+
+
+int BytecodeCache::readSource(const std::string &fileName)
+{
+    source.clear();
+    FILE *f = fopen(fileName.c_str(), "rb");
+    if (! f)
+        return -1;
+    unsigned char buf[4096];
+    size_t len;
+    while (0 < (len = fread(buf, 1, sizeof(buf), f)))
+        source.insert(source.end(), buf, buf + len);
+    bool failed = ferror(f);
+    fclose(f);
+    return failed ? -1 : 0;
+}
+
+
+int BytecodeCache::write(const std::string &cacheName,
+        const std::string &fileName, long long mtime,
+        const unsigned char *digest, const unsigned char *bytecode,
+        size_t size)
+{
+    if (! created) {
+#ifdef WINDOWS
+        _mkdir(directory.c_str());
+#else
+        mkdir(directory.c_str(), 0755);
+#endif
+        created = true;
+    }
+
+    CacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.signature, CACHE_SIGNATURE, sizeof(CACHE_SIGNATURE));
+    header.pointerSize = sizeof(void*);
+    header.pathSize = fileName.size();
+    header.mtime = mtime;
+    header.written = time(NULL) * NSEC_PER_SEC;
+    header.sourceSize = source.size();
+    header.codeSize = size;
+    memcpy(header.digest, digest, sizeof(header.digest));
+
+    // temporary file keeps cache consistent if writing fails
+    std::string tmpName = cacheName + ".tmp";
+    FILE *f = fopen(tmpName.c_str(), "wb");
+    if (! f)
+        return -1;
+    bool failed = (1 != fwrite(&header, sizeof(header), 1, f)) ||
+        (1 != fwrite(fileName.c_str(), fileName.size(), 1, f)) ||
+        (1 != fwrite(bytecode, size, 1, f));
+    if (fclose(f) || failed) {
+        remove(tmpName.c_str());
+        return -1;
+    }
+
+#ifdef WINDOWS
+    remove(cacheName.c_str());
+#endif
+    if (rename(tmpName.c_str(), cacheName.c_str())) {
+        remove(tmpName.c_str());
+        return -1;
+    }
+
+    return 0;
+}
+
+
+int BytecodeCache::load(lua_State *L, const std::string &fileName)
+{
+    struct stat st;
+    if ((! isEnabled()) || stat(fileName.c_str(), &st))
+        return luaL_loadfile(L, fileName.c_str());
+
+    std::string chunkName = "@" + fileName;
+    std::string cacheName = getCacheName(fileName);
+    long long mtime = getModificationTime(st);
+
+    CacheFile cache;
+    CacheHeader header;
+    const unsigned char *bytecode = NULL;
+    if (! cache.open(cacheName))
+        bytecode = getCode(cache, fileName, st.st_size, header);
+
+    if (bytecode && (header.mtime == mtime) && (! isRacy(header))) {
+        if (! luaL_loadbuffer(L, (const char*)bytecode, header.codeSize,
+                    chunkName.c_str()))
+        {
+            hits++;
+            return 0;
+        }
+        // bytecode of other Lua version
+        lua_pop(L, 1);
+        bytecode = NULL;
+    }
+
+    if (readSource(fileName) || source.empty())
+        return luaL_loadfile(L, fileName.c_str());
+
+    unsigned char digest[16];
+    getDigest(&source[0], source.size(), digest);
+
+    // source was touched but not modified or was modified too close
+    // to writing of cache to trust modification time
+    if (bytecode && (! memcmp(header.digest, digest, sizeof(digest)))) {
+        if (! luaL_loadbuffer(L, (const char*)bytecode, header.codeSize,
+                    chunkName.c_str()))
+        {
+            write(cacheName, fileName, mtime, digest, bytecode,
+                    header.codeSize);
+            hits++;
+            return 0;
+        }
+        lua_pop(L, 1);
+    }
+
+    // skip first line starting with # like luaL_loadfile does
+    if ('#' == source[0])
+        for (size_t i = 0; (i < source.size()) && ('\n' != source[i]); i++)
+            source[i] = ' ';
+
+    int status = luaL_loadbuffer(L, (const char*)&source[0], source.size(),
+            chunkName.c_str());
+    if (status)
+        return status;
+    misses++;
+
+    code.clear();
+    if ((! lua_dump(L, writeCode, &code)) && (! code.empty()))
+        write(cacheName, fileName, mtime, digest, &code[0], code.size());
+
+    return 0;
+}
+
+
+/// Load Lua file using bytecode cache.  Files of mounted archives are
+/// compiled from archive memory.
+/// arguments: name of file
+/// returns: compiled chunk or nil and error message like loadfile
+static int luaLoadCachedFile(lua_State *L)
+{
+    const char *fileName = luaL_checkstring(L, 1);
+    Avionics *avionics = getAvionics(L);
+
+    int status;
+    const unsigned char *data;
+    size_t size;
+    if (! avionics->getVfs().readPacked(fileName, data, size)) {
+        std::string chunkName = std::string("@") + fileName;
+        status = luaL_loadbuffer(L, (const char*)data, size,
+                chunkName.c_str());
+    } else
+        status = avionics->getBytecodeCache().load(L, fileName);
+
+    if (status) {
+        lua_pushnil(L);
+        lua_insert(L, -2);
+        return 2;
+    }
+    return 1;
+}
+
+
+/// Enable or disable bytecode cache
+/// arguments: true to enable cache
+static int luaEnableBytecodeCache(lua_State *L)
+{
+    getAvionics(L)->getBytecodeCache().setEnabled(lua_toboolean(L, 1));
+    return 0;
+}
+
+
+/// Returns number of chunks loaded from cache and number of chunks
+/// compiled from sources
+static int luaGetBytecodeCacheStats(lua_State *L)
+{
+    BytecodeCache &cache = getAvionics(L)->getBytecodeCache();
+    lua_pushnumber(L, cache.getHits());
+    lua_pushnumber(L, cache.getMisses());
+    return 2;
+}
+
+
+void xa::exportBytecodeCacheToLua(Luna &lua)
+{
+    lua_State *L = lua.getLua();
+
+    lua_register(L, "loadCachedFile", luaLoadCachedFile);
+    lua_register(L, "enableBytecodeCache", luaEnableBytecodeCache);
+    lua_register(L, "getBytecodeCacheStats", luaGetBytecodeCacheStats);
+}
+
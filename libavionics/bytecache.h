@@ -0,0 +1,92 @@
+#ifndef __BYTECODE_CACHE_H__
+#define __BYTECODE_CACHE_H__
+
+
+#include <string>
+#include <vector>
+#include "luna.h"
+
+
+namespace xa {
+
+
+/// On-disk cache of compiled Lua chunks.  Cache file of source is named
+/// by hash of its path and stores modification time, size and content
+/// hash of source followed by dumped bytecode.  Cache file is mapped to
+/// memory and used without reading source if modification time and size
+/// match.  If only modification time differs source is hashed and cache
+/// is still used when content is the same.  Source is hashed as well if
+/// it was modified shortly before cache was written: modification time
+/// of same-size edit made within timestamp precision doesn't change.
+class BytecodeCache
+{
+    private:
+        /// Directory of cache files
+        std::string directory;
+
+        /// True if cache is used
+        bool enabled;
+
+        /// True if cache directory was created
+        bool created;
+
+        /// Source file contents
+        std::vector<unsigned char> source;
+
+        /// Dumped bytecode
+        std::vector<unsigned char> code;
+
+        /// Number of chunks loaded from cache
+        unsigned long hits;
+
+        /// Number of chunks compiled from source
+        unsigned long misses;
+
+    public:
+        /// Create enabled cache without directory
+        BytecodeCache();
+
+    public:
+        /// Set directory of cache files
+        void setDirectory(const std::string &dir);
+
+        /// Enable or disable cache.  Disabled cache loads files
+        /// directly, useful while components are edited.
+        void setEnabled(bool enable) { enabled = enable; };
+
+        /// Returns true if cache is used
+        bool isEnabled() const { return enabled && ! directory.empty(); };
+
+        /// Load Lua file like luaL_loadfile does: pushes compiled chunk or
+        /// error message on stack and returns 0 on success
+        int load(lua_State *L, const std::string &fileName);
+
+        /// Returns number of chunks loaded from cache
+        unsigned long getHits() const { return hits; };
+
+        /// Returns number of chunks compiled from source
+        unsigned long getMisses() const { return misses; };
+
+    private:
+        /// Returns name of cache file of source
+        std::string getCacheName(const std::string &fileName);
+
+        /// Read source file.  Returns 0 on success.
+        int readSource(const std::string &fileName);
+
+        /// Write cache file.  Returns 0 on success.
+        int write(const std::string &cacheName, const std::string &fileName,
+                long long mtime, const unsigned char *digest,
+                const unsigned char *bytecode, size_t size);
+};
+
+
+/// Register bytecode cache functions in Lua
+void exportBytecodeCacheToLua(Luna &lua);
+
+
+};
+
+
+#endif
+
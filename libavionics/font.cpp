@@ -1,6 +1,7 @@
 #include "font.h"
 
 #include <fstream>
+#include <sstream>
 #include <string>
 #include <ctype.h>
 #include "texture.h"
@@ -62,7 +63,7 @@ struct xa::Font
 
 /// read line from file.
 /// returns empty line on errors
-static std::string readLine(std::ifstream &f)
+static std::string readLine(std::istream &f)
 {
     std::string s;
     std::getline(f, s);
@@ -159,9 +160,8 @@ static std::string splitLine(const std::string &line, Attrs &attrs)
 
 /// Load font.  Returns NULL on loading errors
 static Font* loadFont(TextureManager &textureManager,
-        const std::string &fileName)
+        const std::string &fileName, std::istream &f)
 {
-    std::ifstream f(fileName.c_str(), std::ifstream::in);
     if (! f.good())
         return NULL;   
 
@@ -322,8 +322,8 @@ void xa::drawFont(Font* font, SaslGraphicsCallbacks *graphics, double x, double
 
 
 
-xa::FontManager::FontManager(TextureManager &textureManager): 
-    textureManager(textureManager)
+xa::FontManager::FontManager(TextureManager &textureManager, Vfs &vfs): 
+    textureManager(textureManager), vfs(vfs)
 {
 }
 
@@ -342,7 +342,16 @@ Font* xa::FontManager::loadFont(const std::string &fileName)
     if (i != cache.end()) {
         return (*i).second;
     } else {
-        Font* font = ::loadFont(textureManager, fileName);
+        Font* font;
+        const unsigned char *data;
+        size_t size;
+        if (! vfs.readPacked(fileName, data, size)) {
+            std::istringstream f(std::string((const char*)data, size));
+            font = ::loadFont(textureManager, fileName, f);
+        } else {
+            std::ifstream f(fileName.c_str(), std::ifstream::in);
+            font = ::loadFont(textureManager, fileName, f);
+        }
         if (font)
             cache[fileName] = font;
         return font;
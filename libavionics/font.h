@@ -16,6 +16,7 @@ struct Font;
 
 
 class TextureManager;
+class Vfs;
 
 
 
@@ -45,9 +46,12 @@ class FontManager
         /// textures loader
         TextureManager &textureManager;
 
+        /// Files of search paths
+        Vfs &vfs;
+
     public:
         /// Create new fonts manager
-        FontManager(TextureManager &textureManager);
+        FontManager(TextureManager &textureManager, Vfs &vfs);
 
         /// Destroy fonts manager and all fonts
         ~FontManager();
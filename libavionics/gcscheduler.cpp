@@ -0,0 +1,230 @@
+#include "gcscheduler.h"
+
+#include "avionics.h"
+#include "luaalloc.h"
+
+
+using namespace xa;
+
+
+/// Default time budget in microseconds
+#define DEFAULT_BUDGET 1000
+
+/// Collection cycle starts when heap grows by this factor after last
+/// finished cycle
+#define PAUSE 1.5
+
+/// Collection exceeds budget when heap grows by this factor after last
+/// finished cycle
+#define LIMIT 2.0
+
+/// Minimal heap limit in kilobytes
+#define MIN_LIMIT 1024.0
+
+/// Maximum step size in kilobytes
+#define MAX_STEP 1024
+
+/// Part of Lua memory limit which heap may reach before collection
+/// exceeds budget.  Near memory limit automatic collector is left
+/// running because Lua has no emergency collection on failed allocation.
+#define MEMORY_LIMIT_SHARE 0.75
+
+
+GcScheduler::GcScheduler(Luna &lua): lua(lua)
+{
+    budget = DEFAULT_BUDGET;
+    stepSize = 16;
+    stepCost = 0;
+    lastHeap = cycleHeap = 0;
+    resetStats();
+}
+
+
+void GcScheduler::setBudget(double budget)
+{
+    if ((0 >= budget) && (0 < this->budget))
+        lua_gc(lua.getLua(), LUA_GCRESTART, 0);
+    this->budget = budget;
+}
+
+
+void GcScheduler::resetStats()
+{
+    stats.steps = stats.cycles = stats.overruns = 0;
+    stats.totalTime = stats.lastPause = stats.maxPause = 0;
+    stats.allocRate = stats.heapSize = stats.heapLimit = 0;
+}
+
+
+double GcScheduler::getHeapLimit(double memoryLimit)
+{
+    double limit = cycleHeap * LIMIT;
+    if (MIN_LIMIT > limit)
+        limit = MIN_LIMIT;
+    if (memoryLimit && (memoryLimit < limit))
+        limit = memoryLimit;
+    return limit;
+}
+
+
+double GcScheduler::getMemoryLimit()
+{
+    LuaAllocator *allocator = getLuaAllocator(lua.getLua());
+    if ((! allocator) || (! allocator->getStats().limit))
+        return 0;
+    return allocator->getStats().limit / 1024.0 * MEMORY_LIMIT_SHARE;
+}
+
+
+double GcScheduler::getHeapSize()
+{
+    lua_State *L = lua.getLua();
+    return lua_gc(L, LUA_GCCOUNT, 0) + lua_gc(L, LUA_GCCOUNTB, 0) / 1024.0;
+}
+
+
+double GcScheduler::collect()
+{
+    if (0 >= budget)
+        return 0;
+
+    lua_State *L = lua.getLua();
+    double start = Profiler::getTime();
+    double heap = getHeapSize();
+
+    // first frame: take over from automatic collector
+    if (! cycleHeap)
+        lastHeap = cycleHeap = heap;
+
+    // collector runs only inside this function so heap grows by
+    // allocations only
+    double allocated = heap - lastHeap;
+    if (0 > allocated)
+        allocated = 0;
+    stats.allocRate = stats.allocRate * 0.9 + allocated * 0.1;
+
+    double memoryLimit = getMemoryLimit();
+    double limit = getHeapLimit(memoryLimit);
+
+    double now = start;
+    bool overrun = false;
+    // heap near memory limit is collected at once unless live data
+    // itself is that large, then automatic collector paces collection
+    bool collecting = (heap > cycleHeap * PAUSE) || 
+        ((heap > limit) && (cycleHeap < limit));
+
+    // start cycle earlier if at current allocation rate heap would reach
+    // limit before cycle finished within budget
+    if ((! collecting) && (0 < stepCost)) {
+        double frames = heap * stepCost / budget;
+        collecting = heap + stats.allocRate * frames > limit;
+    }
+
+    while (collecting) {
+        if (now - start >= budget) {
+            if (heap <= limit)
+                break;
+            overrun = true;
+        }
+
+        double stepStart = now;
+        int finished = lua_gc(L, LUA_GCSTEP, stepSize);
+        now = Profiler::getTime();
+        stats.steps++;
+
+        // adapt step size to take quarter of budget
+        double cost = (now - stepStart) / stepSize;
+        stepCost = stepCost ? stepCost * 0.8 + cost * 0.2 : cost;
+        if (0 < stepCost) {
+            stepSize = (int)(budget / 4 / stepCost);
+            if (1 > stepSize)
+                stepSize = 1;
+            else if (MAX_STEP < stepSize)
+                stepSize = MAX_STEP;
+        }
+
+        heap = getHeapSize();
+        if (finished) {
+            stats.cycles++;
+            cycleHeap = heap;
+            limit = getHeapLimit(memoryLimit);
+            collecting = false;
+        }
+    }
+
+    // stepping rearms automatic collector.  Near memory limit it keeps
+    // running so allocations of next frame collect garbage instead of
+    // failing.
+    if (memoryLimit && (heap > memoryLimit))
+        lua_gc(L, LUA_GCRESTART, 0);
+    else
+        lua_gc(L, LUA_GCSTOP, 0);
+
+    double elapsed = Profiler::getTime() - start;
+    lastHeap = heap;
+    if (overrun)
+        stats.overruns++;
+    stats.totalTime += elapsed;
+    stats.lastPause = elapsed;
+    if (elapsed > stats.maxPause)
+        stats.maxPause = elapsed;
+    stats.heapSize = heap;
+    stats.heapLimit = limit;
+
+    return elapsed;
+}
+
+
+/// Set garbage collection budget
+/// arguments: budget in milliseconds, 0 to restore automatic collection
+static int luaSetGcBudget(lua_State *L)
+{
+    getAvionics(L)->getGcScheduler().setBudget(lua_tonumber(L, 1) * 1000.0);
+    return 0;
+}
+
+
+/// Set field of table on top of stack
+static void setField(lua_State *L, const char *name, double value)
+{
+    lua_pushnumber(L, value);
+    lua_setfield(L, -2, name);
+}
+
+
+/// Returns table of garbage collection statistics.
+/// Times are in milliseconds, sizes in kilobytes
+static int luaGetGcStats(lua_State *L)
+{
+    const GcStats &stats = getAvionics(L)->getGcScheduler().getStats();
+    lua_newtable(L);
+    setField(L, "steps", stats.steps);
+    setField(L, "cycles", stats.cycles);
+    setField(L, "overruns", stats.overruns);
+    setField(L, "totalTime", stats.totalTime / 1000.0);
+    setField(L, "lastPause", stats.lastPause / 1000.0);
+    setField(L, "maxPause", stats.maxPause / 1000.0);
+    setField(L, "allocRate", stats.allocRate);
+    setField(L, "heapSize", stats.heapSize);
+    setField(L, "heapLimit", stats.heapLimit);
+    return 1;
+}
+
+
+/// Lua wrapper for resetStats
+static int luaResetGcStats(lua_State *L)
+{
+    getAvionics(L)->getGcScheduler().resetStats();
+    return 0;
+}
+
+
+void xa::exportGcToLua(Luna &lua)
+{
+    lua_State *L = lua.getLua();
+
+    lua_register(L, "setGcBudget", luaSetGcBudget);
+    lua_register(L, "getGcStats", luaGetGcStats);
+    lua_register(L, "resetGcStats", luaResetGcStats);
+}
+
@@ -0,0 +1,120 @@
+#ifndef __GC_SCHEDULER_H__
+#define __GC_SCHEDULER_H__
+
+
+#include "luna.h"
+
+
+namespace xa {
+
+
+/// Garbage collection statistics
+struct GcStats
+{
+    /// Number of incremental steps done
+    unsigned long steps;
+
+    /// Number of finished collection cycles
+    unsigned long cycles;
+
+    /// Number of frames collection exceeded budget to bound heap
+    unsigned long overruns;
+
+    /// Total time spent in collection in microseconds
+    double totalTime;
+
+    /// Time spent in collection during last frame in microseconds
+    double lastPause;
+
+    /// Longest collection pause in microseconds
+    double maxPause;
+
+    /// Estimated allocation rate in kilobytes per frame
+    double allocRate;
+
+    /// Current size of Lua heap in kilobytes
+    double heapSize;
+
+    /// Heap size which forces collection beyond budget in kilobytes
+    double heapLimit;
+};
+
+
+/// Runs Lua garbage collector in small incremental steps within time
+/// budget once per frame.  Automatic collection is stopped while
+/// scheduler is enabled so collector never interrupts drawing.  Step size
+/// adapts to measured collector speed and amount of work follows
+/// allocation rate.  If budget is not enough and heap exceeds limit
+/// collection continues beyond budget until heap shrinks.  Heap limit
+/// never exceeds part of memory limit of SASL allocator and automatic
+/// collector keeps running while heap is close to memory limit.
+class GcScheduler
+{
+    private:
+        /// Lua to collect
+        Luna &lua;
+
+        /// Time budget per frame in microseconds or 0 if disabled
+        double budget;
+
+        /// Size of next step in kilobytes
+        int stepSize;
+
+        /// Estimated collector speed in microseconds per kilobyte
+        double stepCost;
+
+        /// Heap size after last frame collection in kilobytes
+        double lastHeap;
+
+        /// Heap size after last finished cycle in kilobytes
+        double cycleHeap;
+
+        /// Collection statistics
+        GcStats stats;
+
+    public:
+        /// Create disabled scheduler
+        GcScheduler(Luna &lua);
+
+    public:
+        /// Set time budget of collection per frame.  Zero budget disables
+        /// scheduler and restores automatic collection.
+        /// \param budget time in microseconds
+        void setBudget(double budget);
+
+        /// Returns time budget in microseconds
+        double getBudget() const { return budget; }
+
+        /// Collect garbage for one frame.  Returns time spent in
+        /// microseconds.
+        double collect();
+
+        /// Returns collection statistics
+        const GcStats& getStats() const { return stats; }
+
+        /// Zero statistics counters
+        void resetStats();
+
+    private:
+        /// Returns size of Lua heap in kilobytes
+        double getHeapSize();
+
+        /// Returns part of Lua memory limit which heap may reach in
+        /// kilobytes or 0 if memory is not limited
+        double getMemoryLimit();
+
+        /// Returns heap size which forces collection beyond budget
+        /// \param memoryLimit value of getMemoryLimit()
+        double getHeapLimit(double memoryLimit);
+};
+
+
+/// Register garbage collection functions in Lua
+void exportGcToLua(Luna &lua);
+
+
+};
+
+
+#endif
+
@@ -0,0 +1,262 @@
+#include "handlers.h"
+
+#include <string.h>
+
+
+using namespace xa;
+
+
+/// Names of handler globals in order of Handler enum
+static const char* handlerNames[HANDLERS_COUNT] = { "update",
+    "drawPanelLayer", "drawPopupsLayer", "drawPanel", "onMouseUp",
+    "onMouseDown", "onMouseMove", "onMouseClick", "onKeyUp", "onKeyDown" };
+
+
+Handlers::Handlers(Luna &lua, Log &log): lua(lua), log(log)
+{
+    for (int i = 0; i < HANDLERS_COUNT; i++)
+        refs[i] = LUA_NOREF;
+    dirty = true;
+    installed = tracked = false;
+    metaRef = hiddenRef = setterRef = LUA_NOREF;
+}
+
+
+Handlers::~Handlers()
+{
+    lua_State *L = lua.getLua();
+    for (int i = 0; i < HANDLERS_COUNT; i++)
+        luaL_unref(L, LUA_REGISTRYINDEX, refs[i]);
+    luaL_unref(L, LUA_REGISTRYINDEX, metaRef);
+    luaL_unref(L, LUA_REGISTRYINDEX, hiddenRef);
+    luaL_unref(L, LUA_REGISTRYINDEX, setterRef);
+}
+
+
+const char* Handlers::getName(Handler handler)
+{
+    return handlerNames[handler];
+}
+
+
+/// __newindex of _G.  Stores handlers in hidden table and notifies
+/// cache, other globals are stored in _G as usual.
+/// upvalues: hidden handlers table, Handlers object
+static int luaSetGlobal(lua_State *L)
+{
+    if (LUA_TSTRING == lua_type(L, 2)) {
+        const char *name = lua_tostring(L, 2);
+        for (int i = 0; i < HANDLERS_COUNT; i++)
+            if (! strcmp(name, handlerNames[i])) {
+                lua_settop(L, 3);
+                lua_rawset(L, lua_upvalueindex(1));
+                Handlers *handlers = (Handlers*)lua_touserdata(L,
+                        lua_upvalueindex(2));
+                handlers->onChange();
+                return 0;
+            }
+    }
+    lua_settop(L, 3);
+    lua_rawset(L, 1);
+    return 0;
+}
+
+
+/// rawget which finds handlers moved out of _G to hidden table
+/// upvalues: hidden handlers table
+static int luaRawGet(lua_State *L)
+{
+    luaL_checktype(L, 1, LUA_TTABLE);
+    luaL_checkany(L, 2);
+    lua_settop(L, 2);
+    lua_pushvalue(L, 2);
+    lua_rawget(L, 1);
+    if (lua_isnil(L, -1) && lua_rawequal(L, 1, LUA_GLOBALSINDEX)) {
+        lua_pop(L, 1);
+        lua_rawget(L, lua_upvalueindex(1));
+    }
+    return 1;
+}
+
+
+void Handlers::install()
+{
+    lua_State *L = lua.getLua();
+
+    lua_pushvalue(L, LUA_GLOBALSINDEX);             // _G
+    if (lua_getmetatable(L, -1)) {
+        // somebody else owns _G metatable, resolve handlers on each call
+        lua_pop(L, 2);
+        log.warning("Globals table has metatable, handlers are not cached");
+        installed = true;
+        tracked = false;
+        return;
+    }
+
+    lua_newtable(L);                                // _G hidden
+    for (int i = 0; i < HANDLERS_COUNT; i++) {
+        lua_getfield(L, -2, handlerNames[i]);
+        lua_setfield(L, -2, handlerNames[i]);
+        lua_pushnil(L);
+        lua_setfield(L, -3, handlerNames[i]);
+    }
+
+    lua_pushvalue(L, -1);
+    lua_pushcclosure(L, luaRawGet, 1);
+    lua_setfield(L, -3, "rawget");
+
+    lua_newtable(L);                                // _G hidden mt
+    lua_pushvalue(L, -2);
+    lua_setfield(L, -2, "__index");
+    lua_pushvalue(L, -2);
+    lua_pushlightuserdata(L, this);
+    lua_pushcclosure(L, luaSetGlobal, 2);
+    lua_pushvalue(L, -1);
+    setterRef = luaL_ref(L, LUA_REGISTRYINDEX);
+    lua_setfield(L, -2, "__newindex");
+    lua_pushvalue(L, -1);
+    metaRef = luaL_ref(L, LUA_REGISTRYINDEX);
+    lua_setmetatable(L, -3);                        // _G hidden
+    hiddenRef = luaL_ref(L, LUA_REGISTRYINDEX);     // _G
+    lua_pop(L, 1);
+
+    installed = true;
+    tracked = true;
+}
+
+
+bool Handlers::isTracking()
+{
+    lua_State *L = lua.getLua();
+
+    if (! lua_getmetatable(L, LUA_GLOBALSINDEX))
+        return false;
+    lua_rawgeti(L, LUA_REGISTRYINDEX, metaRef);     // mt ours
+    bool same = lua_rawequal(L, -1, -2);
+    lua_pop(L, 1);
+
+    // modules like strict.lua change existing metatable in place
+    if (same) {
+        lua_pushstring(L, "__newindex");
+        lua_rawget(L, -2);                          // mt setter
+        lua_rawgeti(L, LUA_REGISTRYINDEX, setterRef);
+        lua_pushstring(L, "__index");
+        lua_rawget(L, -4);                          // mt setter ours index
+        lua_rawgeti(L, LUA_REGISTRYINDEX, hiddenRef);
+        same = lua_rawequal(L, -3, -4) && lua_rawequal(L, -1, -2);
+        lua_pop(L, 4);
+    }
+    lua_pop(L, 1);
+    return same;
+}
+
+
+void Handlers::untrack()
+{
+    lua_State *L = lua.getLua();
+
+    log.warning("Globals table metatable changed, handlers are not cached");
+
+    lua_rawgeti(L, LUA_REGISTRYINDEX, hiddenRef);   // hidden
+    for (int i = 0; i < HANDLERS_COUNT; i++) {
+        // new metatable may forbid assignments, so use raw access
+        lua_getfield(L, -1, handlerNames[i]);       // hidden handler
+        lua_pushstring(L, handlerNames[i]);
+        lua_rawget(L, LUA_GLOBALSINDEX);            // hidden handler old
+        if (lua_isnil(L, -1)) {
+            lua_pushstring(L, handlerNames[i]);
+            lua_pushvalue(L, -3);
+            lua_rawset(L, LUA_GLOBALSINDEX);
+        }
+        lua_pop(L, 2);
+
+        // rawget fallback shouldn't find stale handlers
+        lua_pushnil(L);
+        lua_setfield(L, -2, handlerNames[i]);
+    }
+    lua_pop(L, 1);
+
+    tracked = false;
+    dirty = true;
+}
+
+
+void Handlers::resolve()
+{
+    lua_State *L = lua.getLua();
+
+    for (int i = 0; i < HANDLERS_COUNT; i++) {
+        luaL_unref(L, LUA_REGISTRYINDEX, refs[i]);
+        lua_getglobal(L, handlerNames[i]);
+        if (lua_isfunction(L, -1))
+            refs[i] = luaL_ref(L, LUA_REGISTRYINDEX);
+        else {
+            lua_pop(L, 1);
+            refs[i] = LUA_NOREF;
+        }
+    }
+
+    dirty = ! tracked;
+}
+
+
+void Handlers::bind()
+{
+    if (! installed)
+        install();
+    resolve();
+}
+
+
+bool Handlers::pcall(Handler handler, int nargs, int nresults)
+{
+    lua_State *L = lua.getLua();
+    if (lua_pcall(L, nargs, nresults, 0)) {
+        // message points into Lua string which lives until pop
+        const char *msg = lua_tostring(L, -1);
+        log.error("Error calling %s: %s", handlerNames[handler],
+                msg ? msg : "unknown error");
+        lua_pop(L, 1);
+        return false;
+    }
+    return true;
+}
+
+
+bool Handlers::callInts(Handler handler, const int *args, int n)
+{
+    if (! push(handler))
+        return false;
+
+    lua_State *L = lua.getLua();
+    for (int i = 0; i < n; i++)
+        lua_pushnumber(L, args[i]);
+    if (! pcall(handler, n, 1))
+        return false;
+
+    bool res = lua_toboolean(L, -1);
+    lua_pop(L, 1);
+    return res;
+}
+
+
+bool Handlers::call(Handler handler, int a1, int a2)
+{
+    int args[] = { a1, a2 };
+    return callInts(handler, args, 2);
+}
+
+
+bool Handlers::call(Handler handler, int a1, int a2, int a3)
+{
+    int args[] = { a1, a2, a3 };
+    return callInts(handler, args, 3);
+}
+
+
+bool Handlers::call(Handler handler, int a1, int a2, int a3, int a4)
+{
+    int args[] = { a1, a2, a3, a4 };
+    return callInts(handler, args, 4);
+}
+
@@ -0,0 +1,133 @@
+#ifndef __HANDLERS_H__
+#define __HANDLERS_H__
+
+
+#include "luna.h"
+#include "log.h"
+
+
+namespace xa {
+
+
+/// Lua entry points called by avionics
+enum Handler
+{
+    HANDLER_UPDATE,
+    HANDLER_DRAW_GAUGES,
+    HANDLER_DRAW_POPUPS,
+    HANDLER_DRAW_PANEL,
+    HANDLER_MOUSE_UP,
+    HANDLER_MOUSE_DOWN,
+    HANDLER_MOUSE_MOVE,
+    HANDLER_MOUSE_CLICK,
+    HANDLER_KEY_UP,
+    HANDLER_KEY_DOWN,
+    HANDLERS_COUNT
+};
+
+
+/// Cache of Lua handler functions.  Handlers are kept as registry
+/// references so calling them takes no global table lookups.  Handler
+/// globals are moved out of _G into hidden table exposed by _G
+/// metatable, so assignment of any handler goes through __newindex
+/// and invalidates cache.  If panel replaces or modifies _G metatable
+/// handlers are moved back to _G and resolved by name on each call.
+class Handlers
+{
+    private:
+        /// Lua state
+        Luna &lua;
+
+        /// Logger
+        Log &log;
+
+        /// Registry references to handlers or LUA_NOREF if handler
+        /// isn't a function
+        int refs[HANDLERS_COUNT];
+
+        /// True if handler globals changed after refs were resolved
+        bool dirty;
+
+        /// True if install() was called
+        bool installed;
+
+        /// True if assignments of handlers are tracked
+        bool tracked;
+
+        /// Registry reference to _G metatable installed by install()
+        int metaRef;
+
+        /// Registry reference to hidden handlers table
+        int hiddenRef;
+
+        /// Registry reference to __newindex of _G metatable
+        int setterRef;
+
+    public:
+        /// Create empty cache
+        Handlers(Luna &lua, Log &log);
+
+        /// Release references
+        ~Handlers();
+
+    public:
+        /// Start tracking handler globals and resolve references.
+        /// Called after init script and after panel loading.
+        void bind();
+
+        /// Push handler function onto stack.  Returns false and pushes
+        /// nothing if handler isn't defined.
+        bool push(Handler handler)
+        {
+            if (tracked && (! isTracking()))
+                untrack();
+            if (dirty)
+                resolve();
+            if (LUA_NOREF == refs[handler])
+                return false;
+            lua_rawgeti(lua.getLua(), LUA_REGISTRYINDEX, refs[handler]);
+            return true;
+        }
+
+        /// Call handler pushed by push() with nargs arguments on stack.
+        /// Errors are logged without memory allocations.  Returns
+        /// false on error.
+        bool pcall(Handler handler, int nargs, int nresults);
+
+        /// Call handler with integer arguments.  Returns handler
+        /// result converted to boolean or false if handler is not
+        /// defined or failed.
+        bool call(Handler handler, int a1, int a2);
+        bool call(Handler handler, int a1, int a2, int a3);
+        bool call(Handler handler, int a1, int a2, int a3, int a4);
+
+        /// Returns name of handler global
+        static const char* getName(Handler handler);
+
+        /// Called by _G __newindex on assignment of handler global
+        void onChange() { dirty = true; }
+
+    private:
+        /// Install _G metatable tracking handler assignments
+        void install();
+
+        /// Returns true if _G metatable installed by install() is still
+        /// in place and unchanged
+        bool isTracking();
+
+        /// Move handlers from hidden table back to _G and stop caching
+        void untrack();
+
+        /// Update references from current handler values
+        void resolve();
+
+        /// Call handler with n integer arguments
+        bool callInts(Handler handler, const int *args, int n);
+};
+
+
+};
+
+
+#endif
+
@@ -0,0 +1,378 @@
+#include "hitindex.h"
+
+#include "avionics.h"
+
+
+using namespace xa;
+
+
+/// Number of grid cells along each side of layer
+#define GRID_SIZE 32
+
+
+/// Returns grid cell of coordinate clamped to grid
+static int getCell(double v, double origin, double cellSize)
+{
+    int cell = (int)((v - origin) / cellSize);
+    if (0 > cell)
+        return 0;
+    if (GRID_SIZE <= cell)
+        return GRID_SIZE - 1;
+    return cell;
+}
+
+
+HitIndex::HitIndex()
+{
+    recording = -1;
+    frame = 0;
+    clear();
+}
+
+
+void HitIndex::clear()
+{
+    for (int i = 0; i < HIT_LAYERS; i++) {
+        Layer &l = layers[i];
+        l.nodes.clear();
+        l.valid = l.built = false;
+        l.frame = 0;
+    }
+    stack.clear();
+    hits.clear();
+    recording = -1;
+}
+
+
+void HitIndex::beginLayer(int layer)
+{
+    if ((1 > layer) || (HIT_LAYERS < layer)) {
+        recording = -1;
+        return;
+    }
+
+    recording = layer - 1;
+    Layer &l = layers[recording];
+    l.nodes.clear();
+    l.valid = l.built = false;
+    stack.clear();
+}
+
+
+void HitIndex::endLayer()
+{
+    if (-1 == recording)
+        return;
+
+    // draw error leaves components on stack
+    layers[recording].valid = stack.empty();
+    layers[recording].frame = frame;
+    stack.clear();
+    recording = -1;
+}
+
+
+int HitIndex::push(double x, double y, double width, double height,
+        double sizeX, double sizeY)
+{
+    if (-1 == recording)
+        return -1;
+
+    std::vector<Node> &nodes = layers[recording].nodes;
+
+    Node node;
+    double parentOffsetX = 0, parentOffsetY = 0;
+    double parentScaleX = 1, parentScaleY = 1;
+    if (stack.empty())
+        node.parent = -1;
+    else {
+        node.parent = stack.back();
+        const Node &parent = nodes[node.parent];
+        parentOffsetX = parent.offsetX;
+        parentOffsetY = parent.offsetY;
+        parentScaleX = parent.scaleX;
+        parentScaleY = parent.scaleY;
+    }
+
+    if ((0 < parentScaleX) && (0 < parentScaleY) &&
+            (0 < width) && (0 < height))
+    {
+        node.x1 = parentOffsetX + x / parentScaleX;
+        node.y1 = parentOffsetY + y / parentScaleY;
+        node.x2 = parentOffsetX + (x + width) / parentScaleX;
+        node.y2 = parentOffsetY + (y + height) / parentScaleY;
+        node.offsetX = node.x1;
+        node.offsetY = node.y1;
+        node.scaleX = parentScaleX * sizeX / width;
+        node.scaleY = parentScaleY * sizeY / height;
+    } else {
+        // degenerate component and its children can't be hit
+        node.x1 = node.y1 = node.x2 = node.y2 = 0;
+        node.offsetX = node.offsetY = node.scaleX = node.scaleY = 0;
+    }
+
+    int index = (int)nodes.size();
+    nodes.push_back(node);
+    stack.push_back(index);
+    return index;
+}
+
+
+void HitIndex::pop()
+{
+    if ((-1 != recording) && (! stack.empty()))
+        stack.pop_back();
+}
+
+
+bool HitIndex::isValid(int layer) const
+{
+    if ((1 > layer) || (HIT_LAYERS < layer))
+        return false;
+    // layer is drawn after update, queries before next draw use it too
+    const Layer &l = layers[layer - 1];
+    return l.valid && (! l.nodes.empty()) && (l.frame + 1 >= frame);
+}
+
+
+int HitIndex::getParent(int layer, int node) const
+{
+    if (! isValid(layer))
+        return -1;
+    const std::vector<Node> &nodes = layers[layer - 1].nodes;
+    if ((0 > node) || ((int)nodes.size() <= node))
+        return -1;
+    return nodes[node].parent;
+}
+
+
+void HitIndex::build(Layer &l)
+{
+    // grid covers all components except root which is hit everywhere
+    double x1 = 0, y1 = 0, x2 = 0, y2 = 0;
+    bool empty = true;
+    for (int i = 1; i < (int)l.nodes.size(); i++) {
+        const Node &node = l.nodes[i];
+        if ((node.x2 <= node.x1) || (node.y2 <= node.y1))
+            continue;
+        if (empty || (node.x1 < x1)) x1 = node.x1;
+        if (empty || (node.y1 < y1)) y1 = node.y1;
+        if (empty || (node.x2 > x2)) x2 = node.x2;
+        if (empty || (node.y2 > y2)) y2 = node.y2;
+        empty = false;
+    }
+
+    l.gridX = x1;
+    l.gridY = y1;
+    l.cellWidth = (x2 - x1) / GRID_SIZE;
+    l.cellHeight = (y2 - y1) / GRID_SIZE;
+
+    l.cellStart.assign(GRID_SIZE * GRID_SIZE + 1, 0);
+    l.cellNodes.clear();
+    l.built = true;
+    if (empty)
+        return;
+
+    // count nodes of cells in first pass, fill cells in second
+    for (int pass = 0; pass < 2; pass++) {
+        std::vector<int> fill;
+        if (pass) {
+            for (int i = 1; i <= GRID_SIZE * GRID_SIZE; i++)
+                l.cellStart[i] += l.cellStart[i - 1];
+            l.cellNodes.resize(l.cellStart[GRID_SIZE * GRID_SIZE]);
+            fill.assign(l.cellStart.begin(), l.cellStart.end() - 1);
+        }
+
+        for (int i = 1; i < (int)l.nodes.size(); i++) {
+            const Node &node = l.nodes[i];
+            if ((node.x2 <= node.x1) || (node.y2 <= node.y1))
+                continue;
+            int cx1 = getCell(node.x1, l.gridX, l.cellWidth);
+            int cy1 = getCell(node.y1, l.gridY, l.cellHeight);
+            int cx2 = getCell(node.x2, l.gridX, l.cellWidth);
+            int cy2 = getCell(node.y2, l.gridY, l.cellHeight);
+            for (int cy = cy1; cy <= cy2; cy++)
+                for (int cx = cx1; cx <= cx2; cx++) {
+                    int cell = cy * GRID_SIZE + cx;
+                    if (pass)
+                        l.cellNodes[fill[cell]++] = i;
+                    else
+                        l.cellStart[cell + 1]++;
+                }
+        }
+    }
+}
+
+
+void HitIndex::addHit(const Layer &l, int index, double x, double y)
+{
+    const Node &node = l.nodes[index];
+    Hit h;
+    h.node = index;
+    h.x = (x - node.offsetX) * node.scaleX;
+    h.y = (y - node.offsetY) * node.scaleY;
+    if (-1 == node.parent) {
+        h.parentX = x;
+        h.parentY = y;
+    } else {
+        const Node &parent = l.nodes[node.parent];
+        h.parentX = (x - parent.offsetX) * parent.scaleX;
+        h.parentY = (y - parent.offsetY) * parent.scaleY;
+    }
+    hits.push_back(h);
+}
+
+
+int HitIndex::query(int layer, double x, double y)
+{
+    hits.clear();
+    if (! isValid(layer))
+        return 0;
+
+    Layer &l = layers[layer - 1];
+    if (! l.built)
+        build(l);
+
+    if ((0 < l.cellWidth) && (0 < l.cellHeight) &&
+            (l.gridX <= x) && (l.gridY <= y) &&
+            (l.gridX + l.cellWidth * GRID_SIZE > x) &&
+            (l.gridY + l.cellHeight * GRID_SIZE > y))
+    {
+        int cell = getCell(y, l.gridY, l.cellHeight) * GRID_SIZE +
+            getCell(x, l.gridX, l.cellWidth);
+
+        // reversed draw order visits later siblings and their children
+        // before earlier siblings and children before parents
+        for (int i = l.cellStart[cell + 1] - 1; i >= l.cellStart[cell]; 
+                i--) 
+        {
+            int index = l.cellNodes[i];
+            const Node &node = l.nodes[index];
+            if (! contains(node, x, y))
+                continue;
+
+            bool hit = true;
+            for (int p = node.parent; hit && (0 < p); p = l.nodes[p].parent)
+                hit = contains(l.nodes[p], x, y);
+            if (hit)
+                addHit(l, index, x, y);
+        }
+    }
+
+    addHit(l, 0, x, y);
+    return (int)hits.size();
+}
+
+
+/// Start recording components of layer
+/// arguments: layer (1 - popups, 2 - panel)
+static int luaBeginHitLayer(lua_State *L)
+{
+    getAvionics(L)->getHitIndex().beginLayer((int)lua_tonumber(L, 1));
+    return 0;
+}
+
+
+/// Finish recording components of layer
+static int luaEndHitLayer(lua_State *L)
+{
+    getAvionics(L)->getHitIndex().endLayer();
+    return 0;
+}
+
+
+/// Add component to layer being recorded.
+/// arguments: x, y, width, height in parent coordinates, width and height
+/// of component coordinates space
+/// returns: id of component or nil if layer is not recorded
+static int luaPushHitArea(lua_State *L)
+{
+    int node = getAvionics(L)->getHitIndex().push(lua_tonumber(L, 1),
+            lua_tonumber(L, 2), lua_tonumber(L, 3), lua_tonumber(L, 4),
+            lua_tonumber(L, 5), lua_tonumber(L, 6));
+    if (-1 == node)
+        lua_pushnil(L);
+    else
+        lua_pushnumber(L, node + 1);
+    return 1;
+}
+
+
+/// Finish component added by pushHitArea
+static int luaPopHitArea(lua_State *L)
+{
+    getAvionics(L)->getHitIndex().pop();
+    return 0;
+}
+
+
+/// Returns true if layer was recorded completely
+static int luaIsHitLayerValid(lua_State *L)
+{
+    lua_pushboolean(L,
+            getAvionics(L)->getHitIndex().isValid((int)lua_tonumber(L, 1)));
+    return 1;
+}
+
+
+/// Find components under point.
+/// arguments: layer, x, y
+/// returns: number of hits.  Hits are valid until next hitTest call
+static int luaHitTest(lua_State *L)
+{
+    lua_pushnumber(L, getAvionics(L)->getHitIndex().query(
+                (int)lua_tonumber(L, 1), lua_tonumber(L, 2),
+                lua_tonumber(L, 3)));
+    return 1;
+}
+
+
+/// Returns hit of last hitTest
+/// arguments: number of hit starting from 1
+/// returns: id of component, coordinates in component space, coordinates
+/// in parent space
+static int luaGetHit(lua_State *L)
+{
+    HitIndex &index = getAvionics(L)->getHitIndex();
+    int i = (int)lua_tonumber(L, 1) - 1;
+    if ((0 > i) || (index.getHitsCount() <= i))
+        return 0;
+
+    const HitIndex::Hit &hit = index.getHit(i);
+    lua_pushnumber(L, hit.node + 1);
+    lua_pushnumber(L, hit.x);
+    lua_pushnumber(L, hit.y);
+    lua_pushnumber(L, hit.parentX);
+    lua_pushnumber(L, hit.parentY);
+    return 5;
+}
+
+
+/// Returns id of parent component or nil for root
+/// arguments: layer, id of component
+static int luaGetHitParent(lua_State *L)
+{
+    int parent = getAvionics(L)->getHitIndex().getParent(
+            (int)lua_tonumber(L, 1), (int)lua_tonumber(L, 2) - 1);
+    if (-1 == parent)
+        lua_pushnil(L);
+    else
+        lua_pushnumber(L, parent + 1);
+    return 1;
+}
+
+
+void xa::exportHitIndexToLua(Luna &lua)
+{
+    lua_State *L = lua.getLua();
+
+    lua_register(L, "beginHitLayer", luaBeginHitLayer);
+    lua_register(L, "endHitLayer", luaEndHitLayer);
+    lua_register(L, "pushHitArea", luaPushHitArea);
+    lua_register(L, "popHitArea", luaPopHitArea);
+    lua_register(L, "isHitLayerValid", luaIsHitLayerValid);
+    lua_register(L, "hitTest", luaHitTest);
+    lua_register(L, "getHit", luaGetHit);
+    lua_register(L, "getHitParent", luaGetHitParent);
+}
+
@@ -0,0 +1,166 @@
+#ifndef __HIT_INDEX_H__
+#define __HIT_INDEX_H__
+
+
+#include <vector>
+#include "luna.h"
+
+
+namespace xa {
+
+
+/// Number of layers of hit index: popups and panel
+#define HIT_LAYERS 2
+
+
+/// Spatial index of components rectangles used to find components under
+/// mouse.  Positions of components may be functions or simulator
+/// properties so index is recorded while components are drawn: draw
+/// already evaluates position and visibility of every component.  Grid
+/// of nodes is built on first query after layer was drawn.
+class HitIndex
+{
+    public:
+        /// Component drawn on layer
+        struct Node
+        {
+            /// Index of parent node or -1 for root
+            int parent;
+
+            /// Rectangle of component in layer coordinates.  Empty
+            /// rectangle never hits.
+            double x1, y1, x2, y2;
+
+            /// Transformation from layer to component coordinates:
+            /// local = (layer - offset) * scale
+            double offsetX, offsetY, scaleX, scaleY;
+        };
+
+        /// Component hit by query
+        struct Hit
+        {
+            /// Index of node
+            int node;
+
+            /// Coordinates in component space
+            double x, y;
+
+            /// Coordinates in parent component space
+            double parentX, parentY;
+        };
+
+    private:
+        /// Nodes and grid of one layer
+        struct Layer
+        {
+            /// Nodes in draw order
+            std::vector<Node> nodes;
+
+            /// Start of each cell in cellNodes
+            std::vector<int> cellStart;
+
+            /// Nodes overlapping cells in draw order
+            std::vector<int> cellNodes;
+
+            /// Grid origin and cell size in layer coordinates.  Grid
+            /// covers all components except root.
+            double gridX, gridY, cellWidth, cellHeight;
+
+            /// True if all components were recorded
+            bool valid;
+
+            /// Number of frame layer was recorded on
+            long frame;
+
+            /// True if grid matches nodes
+            bool built;
+        };
+
+        /// Layers of index
+        Layer layers[HIT_LAYERS];
+
+        /// Layer being recorded or -1
+        int recording;
+
+        /// Nodes on path from root to component being drawn
+        std::vector<int> stack;
+
+        /// Result of last query
+        std::vector<Hit> hits;
+
+        /// Number of current frame
+        long frame;
+
+    public:
+        /// Create empty index
+        HitIndex();
+
+    public:
+        /// Start recording of layer
+        /// \param layer 1 for popups, 2 for panel
+        void beginLayer(int layer);
+
+        /// Finish recording of layer.  Layer is usable if every
+        /// pushed component was popped.
+        void endLayer();
+
+        /// Add component drawn inside component on top of stack and
+        /// push it to stack.  Returns index of node or -1 if layer is
+        /// not recorded.
+        /// \param x, y, width, height position in parent coordinates
+        /// \param sizeX, sizeY size of component coordinates space
+        int push(double x, double y, double width, double height,
+                double sizeX, double sizeY);
+
+        /// Pop component from stack
+        void pop();
+
+        /// Forget all layers
+        void clear();
+
+        /// Start new frame.  Called on each update.
+        void nextFrame() { frame++; }
+
+        /// Returns true if layer can be queried.  Layer which wasn't
+        /// drawn on current or previous frame is invalid.
+        bool isValid(int layer) const;
+
+        /// Find components under point.  Component is hit if it and all
+        /// its ancestors except root contain point, root is always hit.
+        /// Hits are ordered from topmost deepest component to root, in
+        /// order handlers should be tried.  Returns number of hits.
+        int query(int layer, double x, double y);
+
+        /// Returns number of hits of last query
+        int getHitsCount() const { return (int)hits.size(); }
+
+        /// Returns hit of last query
+        const Hit& getHit(int index) const { return hits[index]; }
+
+        /// Returns parent of node or -1
+        int getParent(int layer, int node) const;
+
+    private:
+        /// Build grid of layer
+        void build(Layer &l);
+
+        /// Add node to hits of query
+        void addHit(const Layer &l, int index, double x, double y);
+
+        /// Returns true if point lies inside node rectangle
+        static bool contains(const Node &node, double x, double y) {
+            return (node.x1 <= x) && (node.x2 > x) &&
+                (node.y1 <= y) && (node.y2 > y);
+        }
+};
+
+
+/// Register hit index functions in Lua
+void exportHitIndexToLua(Luna &lua);
+
+
+};
+
+
+#endif
+
@@ -0,0 +1,101 @@
+#include "inputqueue.h"
+
+#include "avionics.h"
+
+
+using namespace xa;
+
+
+/// Maximum number of queued events.  Moves are collapsed so queue
+/// overflows only if host stopped updating avionics.
+#define MAX_EVENTS 4096
+
+
+InputQueue::InputQueue()
+{
+    enabled = false;
+    for (int i = 0; i < INPUT_EVENT_TYPES; i++)
+        results[i] = false;
+    collapsed = dropped = 0;
+    events.reserve(64);
+    dispatching.reserve(64);
+}
+
+
+bool InputQueue::add(InputEventType type, int a, int b, int c, int d,
+        long time)
+{
+    if (INPUT_MOUSE_MOVE == type) {
+        // moves on other layers may be interleaved, look through all
+        // trailing moves
+        for (std::vector<InputEvent>::reverse_iterator i = events.rbegin();
+                (i != events.rend()) && (INPUT_MOUSE_MOVE == (*i).type); i++)
+        {
+            if ((*i).d == d) {
+                (*i).a = a;
+                (*i).b = b;
+                (*i).time = time;
+                collapsed++;
+                return results[type];
+            }
+        }
+    }
+
+    if (MAX_EVENTS <= events.size()) {
+        dropped++;
+        return false;
+    }
+
+    InputEvent event;
+    event.type = type;
+    event.a = a;
+    event.b = b;
+    event.c = c;
+    event.d = d;
+    event.time = time;
+    events.push_back(event);
+
+    return results[type];
+}
+
+
+const std::vector<InputEvent>& InputQueue::take()
+{
+    dispatching.clear();
+    dispatching.swap(events);
+    return dispatching;
+}
+
+
+/// Returns time of input event being handled in milliseconds since
+/// avionics creation
+static int luaGetEventTime(lua_State *L)
+{
+    lua_pushnumber(L, getAvionics(L)->getEventTime());
+    return 1;
+}
+
+
+/// Returns table of input queue counters
+static int luaGetInputStats(lua_State *L)
+{
+    InputQueue &queue = getAvionics(L)->getInputQueue();
+    lua_newtable(L);
+    lua_pushboolean(L, queue.isEnabled());
+    lua_setfield(L, -2, "queued");
+    lua_pushnumber(L, queue.getCollapsed());
+    lua_setfield(L, -2, "collapsed");
+    lua_pushnumber(L, queue.getDropped());
+    lua_setfield(L, -2, "dropped");
+    return 1;
+}
+
+
+void xa::exportInputToLua(Luna &lua)
+{
+    lua_State *L = lua.getLua();
+
+    lua_register(L, "getEventTime", luaGetEventTime);
+    lua_register(L, "getInputStats", luaGetInputStats);
+}
+
@@ -0,0 +1,115 @@
+#ifndef __INPUT_QUEUE_H__
+#define __INPUT_QUEUE_H__
+
+
+#include <vector>
+#include "luna.h"
+
+
+namespace xa {
+
+
+/// Types of input events
+enum InputEventType
+{
+    INPUT_MOUSE_DOWN,
+    INPUT_MOUSE_UP,
+    INPUT_MOUSE_MOVE,
+    INPUT_MOUSE_CLICK,
+    INPUT_KEY_DOWN,
+    INPUT_KEY_UP,
+    INPUT_EVENT_TYPES
+};
+
+
+/// Input event waiting for dispatch
+struct InputEvent
+{
+    /// type of event
+    InputEventType type;
+
+    /// x coordinate or character code
+    int a;
+
+    /// y coordinate or key code
+    int b;
+
+    /// mouse button
+    int c;
+
+    /// layer
+    int d;
+
+    /// time of event in milliseconds since avionics creation
+    long time;
+};
+
+
+/// Queue of input events dispatched once per frame.  Consecutive mouse
+/// moves on the same layer are collapsed into one event, buttons and
+/// keys are kept in order.  Hosts receive result of handler only after
+/// dispatch, so queued events return result of last dispatched event of
+/// the same type.
+class InputQueue
+{
+    private:
+        /// True if events are queued
+        bool enabled;
+
+        /// Events waiting for dispatch
+        std::vector<InputEvent> events;
+
+        /// Events being dispatched.  Kept separate so events added
+        /// during dispatch go to next frame.
+        std::vector<InputEvent> dispatching;
+
+        /// Results of last dispatched events by type
+        bool results[INPUT_EVENT_TYPES];
+
+        /// Number of collapsed mouse moves
+        unsigned long collapsed;
+
+        /// Number of events dropped because queue was full
+        unsigned long dropped;
+
+    public:
+        /// Create disabled queue
+        InputQueue();
+
+    public:
+        /// Returns true if events are queued
+        bool isEnabled() const { return enabled; }
+
+        /// Enable or disable queueing
+        void setEnabled(bool enabled) { this->enabled = enabled; }
+
+        /// Add event to queue.  Returns result of last dispatched event of
+        /// the same type.
+        bool add(InputEventType type, int a, int b, int c, int d, long time);
+
+        /// Returns events for dispatch and empties queue.  Returned
+        /// vector is valid until next call.
+        const std::vector<InputEvent>& take();
+
+        /// Store result of dispatched event
+        void setResult(InputEventType type, bool result) {
+            results[type] = result;
+        }
+
+        /// Returns number of collapsed mouse moves
+        unsigned long getCollapsed() const { return collapsed; }
+
+        /// Returns number of dropped events
+        unsigned long getDropped() const { return dropped; }
+};
+
+
+/// Register input queue functions in Lua
+void exportInputToLua(Luna &lua);
+
+
+};
+
+
+#endif
+
@@ -251,6 +251,40 @@ typedef void (*sasl_recreate_texture)(struct SaslGraphicsCallbacks *canvas,
         int textureId, int width, int height);
 
 
+/// drawing statistics of graphics backend
+struct SaslGraphicsStats {
+    /// number of draw calls issued since draw_begin
+    int batches;
+
+    /// number of vertices drawn since draw_begin
+    int vertices;
+};
+
+// fill statistics of drawing since last draw_begin
+// may be NULL if backend doesn't count statistics
+typedef void (*sasl_get_graphics_stats)(struct SaslGraphicsCallbacks *canvas, 
+        struct SaslGraphicsStats *stats);
+
+// decode image from memory into pixels without touching graphics context.
+// may be called from worker threads and for several images at once.
+// returns pixels or NULL on errors, pixels are freed with free_image.
+// may be NULL if backend can't decode images separately from upload
+typedef void* (*sasl_decode_image)(struct SaslGraphicsCallbacks *canvas, 
+        const char *buffer, int length, int *width, int *height, 
+        int *channels);
+
+// create texture from pixels returned by decode_image.
+// called from thread owning graphics context.  pixels aren't freed.
+// returns texture id or -1 on errors
+typedef int (*sasl_upload_image)(struct SaslGraphicsCallbacks *canvas, 
+        void *pixels, int width, int height, int channels,
+        int *textureWidth, int *textureHeight);
+
+// free pixels returned by decode_image
+typedef void (*sasl_free_image)(struct SaslGraphicsCallbacks *canvas, 
+        void *pixels);
+
+
 // grpahics callbacks
 struct SaslGraphicsCallbacks {
     sasl_draw_begin draw_begin;
@@ -270,6 +304,10 @@ struct SaslGraphicsCallbacks {
     sasl_find_texture find_texture;
     sasl_set_render_target set_render_target;
     sasl_recreate_texture recreate_texture;
+    sasl_get_graphics_stats get_stats;
+    sasl_decode_image decode_image;
+    sasl_upload_image upload_image;
+    sasl_free_image free_image;
 };
 
 
@@ -449,6 +487,15 @@ typedef void (*sasl_set_master_gain_callback)(struct SaslSoundCallbacks *sound,
 /// \param sound sound callbacks structure.
 typedef void (*sasl_sound_update_callback)(struct SaslSoundCallbacks *sound);
 
+/// Load sample from memory.  Returns sample handler or 0 if can't load
+/// sample.  Data is valid during call only.
+/// \param sound sound callbacks structure.
+/// \param name name of sample used to share loaded samples
+/// \param data contents of sample file
+/// \param size size of data in bytes
+typedef int (*sasl_sample_load_buffer_callback)(struct SaslSoundCallbacks *sound, 
+        const char *name, const void *data, int size);
+
 // sound callbacks
 struct SaslSoundCallbacks {
     sasl_sample_load_callback load;
@@ -479,6 +526,7 @@ struct SaslSoundCallbacks {
     sasl_listener_get_orientation_callback get_listener_orientation;
     sasl_set_master_gain_callback set_master_gain;
     sasl_sound_update_callback update;
+    sasl_sample_load_buffer_callback load_buffer;
 };
 
 
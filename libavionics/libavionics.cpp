@@ -4,8 +4,10 @@
 #include <assert.h>
 #include <stdarg.h>
 #include <stdlib.h>
+#include <string.h>
 #include "avionics.h"
 #include "propsclient.h"
+#include "propsreplay.h"
 
 
 using namespace xa;
@@ -173,6 +175,55 @@ int sasl_enable_click_emulator(SASL sasl, int enable)
     return -1;
 }
 
+int sasl_set_input_queue(SASL sasl, int enable)
+{
+    TRY
+        sasl->avionics->setInputQueue(enable);
+        return 0;
+    CATCH("enabling or disabling input queue")
+    return -1;
+}
+
+int sasl_enable_bytecode_cache(SASL sasl, int enable)
+{
+    TRY
+        sasl->avionics->getBytecodeCache().setEnabled(enable);
+        return 0;
+    CATCH("enabling or disabling bytecode cache")
+    return -1;
+}
+
+int sasl_set_bytecode_cache_dir(SASL sasl, const char *dir)
+{
+    TRY
+        sasl->avionics->getBytecodeCache().setDirectory(dir ? dir : "");
+        return 0;
+    CATCH("setting bytecode cache directory")
+    return -1;
+}
+
+int sasl_mount_archive(SASL sasl, const char *archive, const char *dir)
+{
+    TRY
+        return sasl->avionics->getVfs().mount(archive, dir);
+    CATCH("mounting archive")
+    return -1;
+}
+
+int sasl_enable_startup_profile(SASL sasl, int enable)
+{
+    TRY
+        sasl->avionics->getStartupProfile().setEnabled(enable);
+        return 0;
+    CATCH("enabling or disabling startup profile")
+    return -1;
+}
+
+void sasl_clear_asset_cache()
+{
+    getAssetCache().clear();
+}
+
 void sasl_set_graphics_callbacks(SASL sasl, 
         struct SaslGraphicsCallbacks *callbacks)
 {
@@ -202,12 +253,41 @@ void sasl_add_search_path(SASL sasl, const char *path)
 int sasl_set_props(SASL sasl, struct SaslPropsCallbacks *callbacks, SaslProps props)
 {
     TRY
-        sasl->avionics->getProps().setProps(callbacks, props);
+        // functional properties of snapshot survive backend change
+        Properties &properties = sasl->avionics->getProps();
+        if (! properties.isSnapshotEnabled())
+            sasl->avionics->getMetrics().invalidateProps();
+        properties.setProps(callbacks, props);
         return 0;
     CATCH("installing properties callbacks")
     return -1;
 }
 
+int sasl_detach_props(SASL sasl, struct SaslPropsCallbacks **callbacks,
+        SaslProps *props)
+{
+    TRY
+        return sasl->avionics->getProps().detachProps(callbacks, props);
+    CATCH("detaching properties callbacks")
+    return -1;
+}
+
+int sasl_enable_props_snapshot(SASL sasl)
+{
+    TRY
+        return sasl->avionics->getProps().enableSnapshot();
+    CATCH("enabling properties snapshot")
+    return -1;
+}
+
+int sasl_publish_props(SASL sasl)
+{
+    TRY
+        return sasl->avionics->getProps().publishSnapshot();
+    CATCH("publishing properties")
+    return -1;
+}
+
 SaslPropRef sasl_get_prop_ref(SASL sasl, const char *name, int type)
 {
     TRY
@@ -316,6 +396,23 @@ void sasl_stop_netprop_server(SASL sasl)
 }
 
 
+int sasl_get_netprop_server_stats(SASL sasl, struct SaslNetStats *stats)
+{
+    TRY
+        if (! stats)
+            return -1;
+        PropsServer &server = sasl->avionics->getPropsServer();
+        NetStats netStats = server.getStats();
+        stats->clients = server.getClientsCount();
+        stats->bytesSent = netStats.bytesSent;
+        stats->bytesReceived = netStats.bytesReceived;
+        stats->syscalls = netStats.syscalls;
+        return 0;
+    CATCH("getting network server stats")
+    return -1;
+}
+
+
 void sasl_set_commands(SASL sasl, struct SaslCommandCallbacks *callbacks, void *data)
 {
     TRY
@@ -333,6 +430,244 @@ int sasl_connect_to_server(SASL sasl, const char *host, int port,
 }
 
 
+int sasl_record_prop(SASL sasl, const char *name, int type)
+{
+    TRY
+        if (! name)
+            return -1;
+        return sasl->avionics->getRecorder().addProp(name, type);
+    CATCH("adding recorded property")
+    return -1;
+}
+
+
+int sasl_start_recording(SASL sasl, const char *fileName, int period)
+{
+    TRY
+        if (! fileName)
+            return -1;
+        return sasl->avionics->getRecorder().start(fileName, period,
+                sasl->avionics->getTime());
+    CATCH("starting recording")
+    return -1;
+}
+
+
+void sasl_stop_recording(SASL sasl)
+{
+    TRY
+        sasl->avionics->getRecorder().stop();
+    CATCH("stopping recording")
+}
+
+
+int sasl_replay_props(SASL sasl, const char *fileName, int loop)
+{
+    TRY
+        return startReplay(sasl, sasl->avionics->getLog(), fileName, loop);
+    CATCH("starting properties replay")
+    return -1;
+}
+
+void sasl_set_time_callback(sasl_time_callback callback, void *ref)
+{
+    RtTimer::setTimeSource(callback, ref);
+}
+
+int sasl_enable_profiler(SASL sasl, int enable, int dumpPeriod)
+{
+    TRY
+        sasl->avionics->enableProfiler(enable, dumpPeriod);
+        return 0;
+    CATCH("enabling profiler")
+    return -1;
+}
+
+
+int sasl_get_profile(SASL sasl, struct SaslProfileEntry *entries, 
+        int maxEntries)
+{
+    TRY
+        if ((! entries) && maxEntries)
+            return -1;
+        std::vector<ProfileEntry> report;
+        sasl->avionics->getProfiler().getReport(report);
+        int count = 0;
+        for (std::vector<ProfileEntry>::iterator i = report.begin();
+                (i != report.end()) && (count < maxEntries); i++, count++)
+        {
+            SaslProfileEntry &e = entries[count];
+            ProfileCounter &u = (*i).counters[PROFILE_UPDATE];
+            ProfileCounter &d = (*i).counters[PROFILE_DRAW];
+            strncpy(e.name, (*i).name.c_str(), sizeof(e.name) - 1);
+            e.name[sizeof(e.name) - 1] = 0;
+            e.updateCalls = u.calls;
+            e.updateTotal = u.total;
+            e.updateSelf = u.self;
+            e.updateMax = u.max;
+            e.drawCalls = d.calls;
+            e.drawTotal = d.total;
+            e.drawSelf = d.self;
+            e.drawMax = d.max;
+        }
+        return count;
+    CATCH("getting profile")
+    return -1;
+}
+
+
+void sasl_reset_profiler(SASL sasl)
+{
+    TRY
+        sasl->avionics->getProfiler().reset();
+    CATCH("resetting profiler")
+}
+
+int sasl_start_sampling(SASL sasl, int interval)
+{
+    TRY
+        return sasl->avionics->startSampling(interval);
+    CATCH("starting sampling")
+    return -1;
+}
+
+
+int sasl_stop_sampling(SASL sasl)
+{
+    TRY
+        return sasl->avionics->stopSampling();
+    CATCH("stopping sampling")
+    return -1;
+}
+
+
+int sasl_write_samples(SASL sasl, const char *fileName)
+{
+    TRY
+        if (! fileName)
+            return -1;
+        return sasl->avionics->getSampler().writeSamples(fileName);
+    CATCH("writing samples")
+    return -1;
+}
+
+
+int sasl_write_trace_aborts(SASL sasl, const char *fileName)
+{
+    TRY
+        if (! fileName)
+            return -1;
+        return sasl->avionics->getSampler().writeAborts(fileName);
+    CATCH("writing trace aborts")
+    return -1;
+}
+
+void sasl_start_tracing(SASL sasl)
+{
+    setTracing(true);
+}
+
+
+void sasl_stop_tracing(SASL sasl)
+{
+    setTracing(false);
+}
+
+
+int sasl_write_trace(SASL sasl, const char *fileName)
+{
+    TRY
+        if (! fileName)
+            return -1;
+        if (writeTrace(fileName)) {
+            sasl->avionics->getLog().error("Can't write trace to %s", 
+                    fileName);
+            return -1;
+        }
+        return 0;
+    CATCH("writing trace")
+    return -1;
+}
+
+void sasl_set_gc_budget(SASL sasl, int budget)
+{
+    TRY
+        sasl->avionics->getGcScheduler().setBudget(budget);
+    CATCH("setting garbage collection budget")
+}
+
+
+int sasl_get_gc_stats(SASL sasl, struct SaslGcStats *stats)
+{
+    TRY
+        if (! stats)
+            return -1;
+        const GcStats &s = sasl->avionics->getGcScheduler().getStats();
+        stats->steps = s.steps;
+        stats->cycles = s.cycles;
+        stats->overruns = s.overruns;
+        stats->totalTime = s.totalTime;
+        stats->lastPause = s.lastPause;
+        stats->maxPause = s.maxPause;
+        stats->allocRate = s.allocRate;
+        stats->heapSize = s.heapSize;
+        stats->heapLimit = s.heapLimit;
+        return 0;
+    CATCH("getting garbage collection statistics")
+    return -1;
+}
+
+lua_State* sasl_create_slab_lua()
+{
+    return createSlabLua();
+}
+
+
+void sasl_destroy_slab_lua(lua_State *lua)
+{
+    destroySlabLua(lua);
+}
+
+
+int sasl_set_lua_memory_limit(SASL sasl, unsigned long limit)
+{
+    TRY
+        LuaAllocator *allocator = getLuaAllocator(
+                sasl->avionics->getLuna().getLua());
+        if (! allocator)
+            return -1;
+        allocator->setLimit(limit);
+        return 0;
+    CATCH("setting Lua memory limit")
+    return -1;
+}
+
+
+int sasl_get_lua_alloc_stats(SASL sasl, struct SaslAllocStats *stats)
+{
+    TRY
+        LuaAllocator *allocator = getLuaAllocator(
+                sasl->avionics->getLuna().getLua());
+        if ((! allocator) || (! stats))
+            return -1;
+        const AllocStats &s = allocator->getStats();
+        stats->used = s.used;
+        stats->peak = s.peak;
+        stats->reserved = s.reserved;
+        stats->limit = s.limit;
+        stats->largeBlocks = s.largeBlocks;
+        stats->failures = s.failures;
+        for (int i = 0; i < SASL_ALLOC_CLASSES; i++) {
+            stats->classes[i].size = s.classes[i].size;
+            stats->classes[i].pages = s.classes[i].pages;
+            stats->classes[i].blocks = s.classes[i].blocks;
+            stats->classes[i].allocs = s.classes[i].allocs;
+        }
+        return 0;
+    CATCH("getting Lua allocator statistics")
+    return -1;
+}
+
 
 void sasl_set_sound_engine(SASL sasl, struct SaslSoundCallbacks *callbacks)
 {
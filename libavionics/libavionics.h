@@ -107,6 +107,50 @@ int sasl_set_click_params(SASL sasl, int delay, int period);
 /// Enable or diable mouse click emulation
 int sasl_enable_click_emulator(SASL sasl, int enable);
 
+/// Enable or disable input events queue.  Queued events are dispatched
+/// at start of sasl_update() and consecutive mouse moves on the same
+/// layer are collapsed.  Event functions return result of last
+/// dispatched event of the same type, so hosts which need immediate
+/// result of handler should keep queue disabled (default).
+/// \param sasl SASL handler.
+/// \param enable non-zero to queue events.
+int sasl_set_input_queue(SASL sasl, int enable);
+
+/// Enable or disable cache of compiled components.  Cache is enabled
+/// by default, disable it while editing components if files timestamps
+/// are unreliable.
+/// \param sasl SASL handler.
+/// \param enable non-zero to use cache.
+int sasl_enable_bytecode_cache(SASL sasl, int enable);
+
+/// Set directory of compiled components cache.  Default is cache
+/// subdirectory of SASL data directory.
+/// \param sasl SASL handler.
+/// \param dir path to cache directory or empty string to disable cache.
+int sasl_set_bytecode_cache_dir(SASL sasl, const char *dir);
+
+/// Mount packed archive to directory.  Files of archive hide files of
+/// directory on search paths.  Custom Avionics.pak near panel file is
+/// mounted to Custom Avionics directory automatically.
+/// Returns 0 on success.
+/// \param sasl SASL handler.
+/// \param archive path to archive.
+/// \param dir directory to mount archive to.
+int sasl_mount_archive(SASL sasl, const char *archive, const char *dir);
+
+/// Enable or disable startup profile.  When enabled startup-manifest.txt
+/// and startup-report.txt are written near panel file after panel is
+/// loaded and assets listed in manifest are prefetched on next load.
+/// Enabled by default.
+/// \param sasl SASL handler.
+/// \param enable non-zero to enable profile.
+int sasl_enable_startup_profile(SASL sasl, int enable);
+
+/// Free textures kept for reuse by next loaded panel and forget digests
+/// of files.  Textures of destroyed panels are kept until next panel is
+/// loaded, call it before graphics callbacks are destroyed.
+void sasl_clear_asset_cache();
+
 /// Update gauges.
 /// Call it on each frame
 /// \param sasl SASL handler.
@@ -140,12 +184,46 @@ void sasl_add_search_path(SASL sasl, const char *path);
 
 
 /// Setup properties callbacks
+/// If properties snapshot is enabled it must be called from thread which
+/// calls sasl_publish_props, never concurrently with it.  Writes queued
+/// for previous backend are dropped.
 /// Returns zero on success or something other if failed
 /// \param sasl SASL handler.
 /// \param callbacks structure full of properties callbacks
 int sasl_set_props(SASL sasl, struct SaslPropsCallbacks *callbacks, SaslProps props);
 
 
+/// Returns current properties backend and detaches it from SASL without
+/// destroying.  Used to wrap backend with other one which is installed 
+/// with sasl_set_props.  Doesn't work if properties snapshot is enabled.
+/// Returns zero on success.
+int sasl_detach_props(SASL sasl, struct SaslPropsCallbacks **callbacks,
+        SaslProps *props);
+
+
+/// Serve properties from snapshot instead of live values.
+/// Allows to run sasl_update and drawing functions in a thread other
+/// than thread which owns properties backend.  Values of properties
+/// change only when sasl_publish_props is called by backend thread and
+/// are picked up on next sasl_update.  Properties writes and lookups are
+/// queued and applied to backend by sasl_publish_props, so property read
+/// fails till next publish after lookup.  Functional properties are
+/// served to panel only, they are not registered in backend.
+/// Must be called before sasl_load_panel.
+/// Returns zero on success or -1 if properties were referenced already.
+/// \param sasl SASL handler.
+int sasl_enable_props_snapshot(SASL sasl);
+
+
+/// Apply queued properties writes, update properties backend and publish
+/// values of all referenced properties.  Call it from backend thread once
+/// per simulator frame.  Safe to call concurrently with sasl_update and
+/// drawing functions.
+/// Returns zero on success.
+/// \param sasl SASL handler.
+int sasl_publish_props(SASL sasl);
+
+
 /// Returns reference to property or NULL if property doesn't exists.
 /// \param sasl SASL handler.
 /// \param name name of property.
@@ -248,6 +326,30 @@ int sasl_start_netprop_server(SASL sasl, int port, const char *secret);
 void sasl_stop_netprop_server(SASL sasl);
 
 
+/// Networked properties server activity counters
+struct SaslNetStats {
+    /// number of connected clients
+    int clients;
+
+    /// number of bytes sent to clients
+    unsigned long long bytesSent;
+    
+    /// number of bytes received from clients
+    unsigned long long bytesReceived;
+
+    /// number of network system calls issued by server
+    unsigned long long syscalls;
+};
+
+
+/// Get networked properties server activity counters.
+/// Counters are accumulated since SASL initialization.
+/// Returns zero on success.
+/// \param sasl SASL handler.
+/// \param stats structure to fill with counters values
+int sasl_get_netprop_server_stats(SASL sasl, struct SaslNetStats *stats);
+
+
 /// Connect local properties to remote server.
 /// Returns zero on success.
 /// \param sasl SASL handler.
@@ -258,6 +360,284 @@ int sasl_connect_to_server(SASL sasl, const char *host, int port,
         const char *secret);
 
 
+// flight-data recorder functions
+
+
+/// Add property to set of recorded properties.
+/// Properties can't be added while recording is active.
+/// Returns zero on success.
+/// \param sasl SASL handler.
+/// \param name name of property
+/// \param type type of property
+int sasl_record_prop(SASL sasl, const char *name, int type);
+
+
+/// Start recording properties to binary record file.
+/// Returns zero on success.
+/// \param sasl SASL handler.
+/// \param fileName name of file to write
+/// \param period sampling period in milliseconds, 0 to sample every update
+int sasl_start_recording(SASL sasl, const char *fileName, int period);
+
+
+/// Flush recorded samples to file and stop recording
+/// \param sasl SASL handler.
+void sasl_stop_recording(SASL sasl);
+
+
+/// Serve properties from binary record file instead of simulator.
+/// Recorded properties are replayed in real time.
+/// Returns zero on success.
+/// \param sasl SASL handler.
+/// \param fileName name of record file
+/// \param loop if non-zero replay restarts when record ends
+int sasl_replay_props(SASL sasl, const char *fileName, int loop);
+
+
+/// Returns current time in milliseconds
+typedef long (*sasl_time_callback)(void *ref);
+
+/// Replace system clock used by SASL with custom time source.
+/// Affects whole process and only SASL instances initialized after 
+/// this call.  Used to replay recorded sessions deterministically.
+/// Pass NULL to restore system clock.
+void sasl_set_time_callback(sasl_time_callback callback, void *ref);
+
+
+// components profiler
+
+
+/// Times of update and draw calls of component.
+/// Times are in microseconds.  Self times exclude nested components.
+struct SaslProfileEntry {
+    /// name of component
+    char name[64];
+
+    /// number of update calls
+    unsigned long updateCalls;
+
+    /// time spent in update calls
+    double updateTotal;
+
+    /// time spent in update calls excluding nested components
+    double updateSelf;
+
+    /// longest update call
+    double updateMax;
+
+    /// number of draw calls
+    unsigned long drawCalls;
+
+    /// time spent in draw calls
+    double drawTotal;
+
+    /// time spent in draw calls excluding nested components
+    double drawSelf;
+
+    /// longest draw call
+    double drawMax;
+};
+
+
+/// Enable or disable profiling of components update and draw calls.
+/// Disabled profiler adds no overhead to components calls.
+/// Returns zero on success.
+/// \param sasl SASL handler.
+/// \param enable non-zero to enable profiler
+/// \param dumpPeriod period of report dumps to log in milliseconds or 0
+int sasl_enable_profiler(SASL sasl, int enable, int dumpPeriod);
+
+
+/// Get profiled components sorted by self time in descending order.
+/// Returns number of filled entries or -1 on errors.
+/// \param sasl SASL handler.
+/// \param entries array to fill
+/// \param maxEntries size of entries array
+int sasl_get_profile(SASL sasl, struct SaslProfileEntry *entries, 
+        int maxEntries);
+
+
+/// Zero profiler counters
+/// \param sasl SASL handler.
+void sasl_reset_profiler(SASL sasl);
+
+
+// LuaJIT sampling profiler
+
+
+/// Start LuaJIT sampling profiler and collection of trace aborts.
+/// Samples are attributed to components being updated or drawn.
+/// Previously collected samples are discarded.  Sampling is done by
+/// jit.profile of LuaJIT 2.1.  With older LuaJIT debug hook of main Lua
+/// thread is used instead, it doesn't see compiled code and tasks.
+/// Returns zero on success.
+/// \param sasl SASL handler.
+/// \param interval sampling interval in milliseconds
+int sasl_start_sampling(SASL sasl, int interval);
+
+
+/// Stop LuaJIT sampling profiler.  Returns zero on success.
+/// \param sasl SASL handler.
+int sasl_stop_sampling(SASL sasl);
+
+
+/// Write collected samples in folded stacks format suitable for flame
+/// graph tools.  Returns zero on success.
+/// \param sasl SASL handler.
+/// \param fileName name of file to write
+int sasl_write_samples(SASL sasl, const char *fileName);
+
+
+/// Write trace aborts counted by function sorted by number of aborts.
+/// Returns zero on success.
+/// \param sasl SASL handler.
+/// \param fileName name of file to write
+int sasl_write_trace_aborts(SASL sasl, const char *fileName);
+
+
+// Timeline tracing
+
+
+/// Start recording of trace events.  Events recorded before are
+/// discarded.  Events of libavionics subsystems and Lua traceBegin(),
+/// traceEnd() and traceInstant() calls are recorded.
+/// \param sasl SASL handler.
+void sasl_start_tracing(SASL sasl);
+
+
+/// Stop recording of trace events.
+/// \param sasl SASL handler.
+void sasl_stop_tracing(SASL sasl);
+
+
+/// Write recorded trace events in Chrome trace event JSON format.
+/// Returns zero on success.
+/// \param sasl SASL handler.
+/// \param fileName name of file to write
+int sasl_write_trace(SASL sasl, const char *fileName);
+
+
+// Garbage collection
+
+
+/// Lua garbage collection statistics
+struct SaslGcStats {
+    /// number of incremental steps done
+    unsigned long steps;
+
+    /// number of finished collection cycles
+    unsigned long cycles;
+
+    /// number of frames collection exceeded budget to bound heap size
+    unsigned long overruns;
+
+    /// total time spent in collection in microseconds
+    double totalTime;
+
+    /// time spent in collection during last frame in microseconds
+    double lastPause;
+
+    /// longest collection pause in microseconds
+    double maxPause;
+
+    /// estimated allocation rate in kilobytes per frame
+    double allocRate;
+
+    /// size of Lua heap in kilobytes
+    double heapSize;
+
+    /// heap size which forces collection beyond budget in kilobytes
+    double heapLimit;
+};
+
+
+/// Set time budget of Lua garbage collection per frame.  Garbage is
+/// collected in small steps after last draw stage of frame.  Default
+/// budget is one millisecond.
+/// \param sasl SASL handler.
+/// \param budget time in microseconds or 0 to restore automatic collection
+void sasl_set_gc_budget(SASL sasl, int budget);
+
+
+/// Get garbage collection statistics.  Returns zero on success.
+/// \param sasl SASL handler.
+/// \param stats structure to fill
+int sasl_get_gc_stats(SASL sasl, struct SaslGcStats *stats);
+
+
+// Lua memory allocator
+
+
+/// Number of small blocks size classes of Lua allocator
+#define SASL_ALLOC_CLASSES 16
+
+
+/// Statistics of Lua allocator size class
+struct SaslAllocClassStats {
+    /// size of blocks in bytes
+    int size;
+
+    /// number of 64K pages owned by class
+    unsigned long pages;
+
+    /// number of blocks in use
+    unsigned long blocks;
+
+    /// number of allocations since Lua was created
+    unsigned long allocs;
+};
+
+
+/// Statistics of Lua allocator
+struct SaslAllocStats {
+    /// bytes used by Lua
+    unsigned long used;
+
+    /// maximum of bytes used by Lua
+    unsigned long peak;
+
+    /// bytes taken from system
+    unsigned long reserved;
+
+    /// memory limit in bytes or 0
+    unsigned long limit;
+
+    /// number of blocks larger than 512 bytes
+    unsigned long largeBlocks;
+
+    /// number of allocations refused because of limit
+    unsigned long failures;
+
+    /// statistics of small blocks size classes
+    struct SaslAllocClassStats classes[SASL_ALLOC_CLASSES];
+};
+
+
+/// Lua creator which uses SASL size class allocator.  Pass it and
+/// sasl_destroy_slab_lua() to sasl_init().  Falls back to default
+/// allocator if Lua doesn't support custom allocators.
+lua_State* sasl_create_slab_lua();
+
+
+/// Lua destroyer for states created by sasl_create_slab_lua()
+void sasl_destroy_slab_lua(lua_State *lua);
+
+
+/// Limit memory used by Lua.  Allocations beyond limit raise Lua memory
+/// errors.  Returns zero on success or -1 if Lua doesn't use SASL 
+/// allocator.
+/// \param sasl SASL handler.
+/// \param limit limit in bytes or 0 for unlimited memory
+int sasl_set_lua_memory_limit(SASL sasl, unsigned long limit);
+
+
+/// Get statistics of Lua allocator.  Returns zero on success or -1 if 
+/// Lua doesn't use SASL allocator.
+/// \param sasl SASL handler.
+/// \param stats structure to fill
+int sasl_get_lua_alloc_stats(SASL sasl, struct SaslAllocStats *stats);
+
+
 // Sound API
 
 /// Setup sound engine
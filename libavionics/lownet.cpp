@@ -146,6 +146,14 @@ double xa::netToDouble(const unsigned char *data)
     return *((double*)data);
 }
 
+void NetStats::add(const NetStats &stats)
+{
+    bytesSent += stats.bytesSent;
+    bytesReceived += stats.bytesReceived;
+    syscalls += stats.syscalls;
+}
+
+
 int xa::getPropTypeSize(int type)
 {
     switch (type) {
@@ -327,10 +335,12 @@ int AsyncCon::sendMore()
     size_t sent = ::send(sock, sendBuffer.getData(), sendBuffer.getFilled(),
             MSG_NOSIGNAL | MSG_DONTWAIT);
 #endif
+    stats.syscalls++;
     if (0 >= (int)sent) {
         if (EAGAIN != errno)
             return -1;
     } else {
+        stats.bytesSent += sent;
         sendBuffer.remove(sent);
     }
 
@@ -348,12 +358,14 @@ int AsyncCon::recvMore()
     size_t received = ::recv(sock, recvBuffer.getFreeSpace(), 2048,
             MSG_NOSIGNAL | MSG_DONTWAIT);
 #endif
+    stats.syscalls++;
     if (0 >= (int)received) {
         if (EAGAIN != errno)
             return -1;
         else
             return 0;
     } else {
+        stats.bytesReceived += received;
         recvBuffer.increaseFilled(received);
     }
             
@@ -366,12 +378,15 @@ int AsyncCon::recvMore()
 
 int AsyncCon::update()
 {
-    if (sendBuffer.getFilled() && canSend(sock))
-        if (sendMore()) {
+    if (sendBuffer.getFilled()) {
+        stats.syscalls++;
+        if (canSend(sock) && sendMore()) {
             log.error("error sending data");
             return -1;
         }
+    }
 
+    stats.syscalls++;
     if (canReceive(sock))
         if (recvMore()) {
             log.error("error receiving data");
@@ -385,6 +400,7 @@ int AsyncCon::update()
 int AsyncCon::sendAll()
 {
     while (sendBuffer.getFilled()) {
+        stats.syscalls++;
         if (canSend(sock)) {
             if (sendMore())
                 return -1;
@@ -399,6 +415,7 @@ int AsyncCon::sendAll()
 int AsyncCon::recvData(size_t size)
 {
     while (recvBuffer.getFilled() < size) {
+        stats.syscalls++;
         if (canReceive(sock)) {
             if (recvMore())
                 return -1;
@@ -543,7 +560,9 @@ int TcpServer::update()
     socklen_t addrlen = sizeof(clntAddr);
 #endif
 
+    stats.syscalls++;
     if (canReceive(sock)) {
+        stats.syscalls++;
         int clntSock = accept(sock, (struct sockaddr*)&clntAddr, &addrlen);
         log.debug("accept %i", clntSock);
         if (-1 == clntSock)
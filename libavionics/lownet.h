@@ -91,6 +91,25 @@ double netToDouble(const unsigned char *data);
 int getPropTypeSize(int type);
 
 
+/// Network activity counters
+struct NetStats
+{
+    /// Number of bytes sent
+    uint64_t bytesSent;
+
+    /// Number of bytes received
+    uint64_t bytesReceived;
+
+    /// Number of system calls issued (select, send, recv, accept)
+    uint64_t syscalls;
+
+    NetStats(): bytesSent(0), bytesReceived(0), syscalls(0) { };
+
+    /// Add other counters to this one
+    void add(const NetStats &stats);
+};
+
+
 /// Receiver of network data
 class NetReceiver
 {
@@ -122,6 +141,9 @@ class AsyncCon
         /// Data receiver callback
         NetReceiver *receiver;
 
+        /// Activity counters
+        NetStats stats;
+
     public:
         /// Create async net struture
         AsyncCon(Log &log);
@@ -158,6 +180,9 @@ class AsyncCon
         /// Close connection
         void close();
 
+        /// Returns activity counters of connection
+        const NetStats& getStats() const { return stats; };
+
     private:
         /// Send next portion of data
         int sendMore();
@@ -195,6 +220,9 @@ class TcpServer
         /// Connection acceptor callback
         ConnectionAcceptor *acceptor;
 
+        /// Activity counters
+        NetStats stats;
+
     public:
         /// create server object
         TcpServer(Log &log);
@@ -217,6 +245,9 @@ class TcpServer
 
         /// returns true if server is running
         bool isRunning();
+
+        /// Returns activity counters of listening socket
+        const NetStats& getStats() const { return stats; };
 };
 
 };
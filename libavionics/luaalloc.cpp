@@ -0,0 +1,443 @@
+#include "luaalloc.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#ifdef WINDOWS
+#include <malloc.h>
+#endif
+#include "avionics.h"
+
+
+using namespace xa;
+
+
+/// Size of page in bytes.  Pages are aligned to their size so page
+/// header can be found from block address.
+#define PAGE_SIZE 65536
+
+/// Largest block allocated from pages
+#define MAX_SMALL 512
+
+
+/// Sizes of blocks of size classes
+static const int classSizes[ALLOC_CLASSES] = { 16, 32, 48, 64, 80, 96, 112,
+    128, 160, 192, 224, 256, 320, 384, 448, MAX_SMALL };
+
+/// Size classes by block size divided by 16 and rounded up
+static struct ClassTable {
+    int bySize[MAX_SMALL / 16 + 1];
+
+    ClassTable() {
+        int cls = 0;
+        for (int i = 0; i <= MAX_SMALL / 16; i++) {
+            while (classSizes[cls] < i * 16)
+                cls++;
+            bySize[i] = cls;
+        }
+    }
+} classTable;
+
+
+/// Page of small blocks
+struct LuaAllocator::Page
+{
+    /// previous page in list of partial pages
+    Page *prev;
+
+    /// next page in list of partial pages
+    Page *next;
+
+    /// list of freed blocks
+    void *freeList;
+
+    /// start of never used space
+    char *top;
+
+    /// end of page
+    char *end;
+
+    /// number of blocks in use
+    unsigned used;
+
+    /// size class of page
+    int cls;
+
+    /// true if page is in list of partial pages
+    bool listed;
+};
+
+
+/// Size of page header rounded to largest alignment
+#define HEADER_SIZE ((sizeof(LuaAllocator::Page) + 15) & ~15)
+
+
+/// Returns size class of small block
+static int getClass(size_t size)
+{
+    return classTable.bySize[(size + 15) / 16];
+}
+
+
+/// Allocate memory aligned to page size
+static void* allocAligned()
+{
+#ifdef WINDOWS
+    return _aligned_malloc(PAGE_SIZE, PAGE_SIZE);
+#else
+    void *mem;
+    if (posix_memalign(&mem, PAGE_SIZE, PAGE_SIZE))
+        return NULL;
+    return mem;
+#endif
+}
+
+
+/// Free memory allocated by allocAligned
+static void freeAligned(void *mem)
+{
+#ifdef WINDOWS
+    _aligned_free(mem);
+#else
+    free(mem);
+#endif
+}
+
+
+LuaAllocator::LuaAllocator()
+{
+    for (int i = 0; i < ALLOC_CLASSES; i++) {
+        partial[i] = NULL;
+        AllocClassStats &c = stats.classes[i];
+        c.size = classSizes[i];
+        c.pages = c.blocks = c.allocs = 0;
+    }
+    stats.used = stats.peak = stats.reserved = stats.limit = 0;
+    stats.largeBlocks = stats.failures = 0;
+}
+
+
+LuaAllocator::~LuaAllocator()
+{
+    // full pages are not listed, but Lua frees everything before
+    // allocator is destroyed so only empty partial pages remain
+    for (int i = 0; i < ALLOC_CLASSES; i++)
+        while (partial[i])
+            freePage(partial[i]);
+}
+
+
+LuaAllocator::Page* LuaAllocator::newPage(int cls)
+{
+    Page *page = (Page*)allocAligned();
+    if (! page)
+        return NULL;
+
+    page->freeList = NULL;
+    page->top = (char*)page + HEADER_SIZE;
+    page->end = (char*)page + PAGE_SIZE;
+    page->used = 0;
+    page->cls = cls;
+    page->prev = NULL;
+    page->next = partial[cls];
+    if (page->next)
+        page->next->prev = page;
+    partial[cls] = page;
+    page->listed = true;
+
+    stats.classes[cls].pages++;
+    stats.reserved += PAGE_SIZE;
+    return page;
+}
+
+
+void LuaAllocator::freePage(Page *page)
+{
+    if (page->listed) {
+        if (page->prev)
+            page->prev->next = page->next;
+        else
+            partial[page->cls] = page->next;
+        if (page->next)
+            page->next->prev = page->prev;
+    }
+    stats.classes[page->cls].pages--;
+    stats.reserved -= PAGE_SIZE;
+    freeAligned(page);
+}
+
+
+void* LuaAllocator::allocSmall(int cls)
+{
+    Page *page = partial[cls];
+    if (! page) {
+        page = newPage(cls);
+        if (! page)
+            return NULL;
+    }
+
+    int size = classSizes[cls];
+    void *block;
+    if (page->freeList) {
+        block = page->freeList;
+        page->freeList = *(void**)block;
+    } else {
+        block = page->top;
+        page->top += size;
+    }
+    page->used++;
+
+    // full page leaves list of partial pages
+    if ((! page->freeList) && (page->top + size > page->end)) {
+        partial[cls] = page->next;
+        if (page->next)
+            page->next->prev = NULL;
+        page->listed = false;
+    }
+
+    stats.classes[cls].blocks++;
+    stats.classes[cls].allocs++;
+    return block;
+}
+
+
+void LuaAllocator::freeSmall(void *ptr)
+{
+    Page *page = (Page*)((uintptr_t)ptr & ~(uintptr_t)(PAGE_SIZE - 1));
+    int cls = page->cls;
+
+    *(void**)ptr = page->freeList;
+    page->freeList = ptr;
+    page->used--;
+    stats.classes[cls].blocks--;
+
+    if (! page->listed) {
+        page->prev = NULL;
+        page->next = partial[cls];
+        if (page->next)
+            page->next->prev = page;
+        partial[cls] = page;
+        page->listed = true;
+    }
+
+    // keep last page of class to avoid trashing
+    if ((! page->used) && ((partial[cls] != page) || page->next))
+        freePage(page);
+}
+
+
+void* LuaAllocator::allocate(size_t size)
+{
+    if (stats.limit && (stats.used + size > stats.limit)) {
+        stats.failures++;
+        return NULL;
+    }
+
+    void *ptr;
+    if (MAX_SMALL >= size)
+        ptr = allocSmall(getClass(size));
+    else {
+        ptr = malloc(size);
+        if (ptr) {
+            stats.largeBlocks++;
+            stats.reserved += size;
+        }
+    }
+
+    if (ptr) {
+        stats.used += size;
+        if (stats.used > stats.peak)
+            stats.peak = stats.used;
+    }
+    return ptr;
+}
+
+
+void LuaAllocator::freeLarge(void *ptr, size_t size)
+{
+    free(ptr);
+    stats.largeBlocks--;
+    stats.reserved -= size;
+}
+
+
+bool LuaAllocator::isShrunk(void *ptr) const
+{
+    return (! shrunk.empty()) && (shrunk.end() != shrunk.find(ptr));
+}
+
+
+void LuaAllocator::release(void *ptr, size_t size)
+{
+    if (MAX_SMALL < size)
+        freeLarge(ptr, size);
+    else if (isShrunk(ptr)) {
+        std::unordered_map<void*, size_t>::iterator i = shrunk.find(ptr);
+        freeLarge(ptr, (*i).second);
+        shrunk.erase(i);
+    } else
+        freeSmall(ptr);
+    stats.used -= size;
+}
+
+
+void* LuaAllocator::reallocate(void *ptr, size_t osize, size_t nsize)
+{
+    if ((nsize > osize) && stats.limit &&
+            (stats.used + nsize - osize > stats.limit))
+    {
+        stats.failures++;
+        return NULL;
+    }
+
+    // size of malloc'ed block or 0 for small block
+    size_t large = 0;
+    if (MAX_SMALL < osize)
+        large = osize;
+    else if (isShrunk(ptr))
+        large = shrunk[ptr];
+
+    // block of the same class fits already
+    if ((! large) && (MAX_SMALL >= nsize) &&
+            (getClass(osize) == getClass(nsize)))
+    {
+        stats.used = stats.used - osize + nsize;
+        if (stats.used > stats.peak)
+            stats.peak = stats.used;
+        return ptr;
+    }
+
+    if (large && (MAX_SMALL < nsize)) {
+        void *p = realloc(ptr, nsize);
+        if ((! p) && (nsize > osize))
+            return NULL;
+        if (! p)
+            p = ptr;
+        if (MAX_SMALL >= osize)
+            shrunk.erase(ptr);
+        stats.reserved = stats.reserved - large + nsize;
+        stats.used = stats.used - osize + nsize;
+        if (stats.used > stats.peak)
+            stats.peak = stats.used;
+        return p;
+    }
+
+    // move between size classes or small and large blocks, limit was
+    // checked above
+    size_t limit = stats.limit;
+    stats.limit = 0;
+    void *p = allocate(nsize);
+    stats.limit = limit;
+    if (! p) {
+        if (nsize > osize)
+            return NULL;
+        // Lua requires shrinking to succeed, so block stays in place
+        // and is freed according to its real kind
+        if (MAX_SMALL < osize)
+            shrunk[ptr] = osize;
+        stats.used = stats.used - osize + nsize;
+        return ptr;
+    }
+    memcpy(p, ptr, osize < nsize ? osize : nsize);
+    release(ptr, osize);
+    return p;
+}
+
+
+void* LuaAllocator::alloc(void *ud, void *ptr, size_t osize, size_t nsize)
+{
+    LuaAllocator *allocator = (LuaAllocator*)ud;
+
+    if (! nsize) {
+        if (ptr)
+            allocator->release(ptr, osize);
+        return NULL;
+    }
+
+    if (! ptr)
+        return allocator->allocate(nsize);
+
+    return allocator->reallocate(ptr, osize, nsize);
+}
+
+
+lua_State* xa::createSlabLua()
+{
+    LuaAllocator *allocator = new LuaAllocator();
+    lua_State *L = lua_newstate(LuaAllocator::alloc, allocator);
+    if (! L) {
+        // 64-bit LuaJIT without GC64 refuses custom allocators
+        delete allocator;
+        L = luaL_newstate();
+    }
+    return L;
+}
+
+
+void xa::destroySlabLua(lua_State *L)
+{
+    LuaAllocator *allocator = getLuaAllocator(L);
+    lua_close(L);
+    delete allocator;
+}
+
+
+LuaAllocator* xa::getLuaAllocator(lua_State *L)
+{
+    void *ud;
+    if (LuaAllocator::alloc == lua_getallocf(L, &ud))
+        return (LuaAllocator*)ud;
+    else
+        return NULL;
+}
+
+
+/// Set field of table on top of stack
+static void setField(lua_State *L, const char *name, double value)
+{
+    lua_pushnumber(L, value);
+    lua_setfield(L, -2, name);
+}
+
+
+/// Returns table of allocator statistics or nil if Lua uses other
+/// allocator
+static int luaGetAllocStats(lua_State *L)
+{
+    LuaAllocator *allocator = getLuaAllocator(L);
+    if (! allocator) {
+        lua_pushnil(L);
+        return 1;
+    }
+
+    const AllocStats &stats = allocator->getStats();
+    lua_newtable(L);
+    setField(L, "used", stats.used);
+    setField(L, "peak", stats.peak);
+    setField(L, "reserved", stats.reserved);
+    setField(L, "limit", stats.limit);
+    setField(L, "largeBlocks", stats.largeBlocks);
+    setField(L, "failures", stats.failures);
+
+    lua_newtable(L);
+    for (int i = 0; i < ALLOC_CLASSES; i++) {
+        const AllocClassStats &c = stats.classes[i];
+        lua_pushnumber(L, i + 1);
+        lua_newtable(L);
+        setField(L, "size", c.size);
+        setField(L, "pages", c.pages);
+        setField(L, "blocks", c.blocks);
+        setField(L, "allocs", c.allocs);
+        lua_settable(L, -3);
+    }
+    lua_setfield(L, -2, "classes");
+
+    return 1;
+}
+
+
+void xa::exportAllocToLua(Luna &lua)
+{
+    lua_register(lua.getLua(), "getAllocStats", luaGetAllocStats);
+}
+
@@ -0,0 +1,151 @@
+#ifndef __LUA_ALLOC_H__
+#define __LUA_ALLOC_H__
+
+
+#include <stddef.h>
+#include <unordered_map>
+#include "luna.h"
+
+
+namespace xa {
+
+
+/// Number of size classes of small blocks
+#define ALLOC_CLASSES 16
+
+
+/// Statistics of one size class
+struct AllocClassStats
+{
+    /// Size of blocks in bytes
+    int size;
+
+    /// Number of pages owned by class
+    unsigned long pages;
+
+    /// Number of blocks in use
+    unsigned long blocks;
+
+    /// Number of allocations since creation
+    unsigned long allocs;
+};
+
+
+/// Allocator statistics
+struct AllocStats
+{
+    /// Bytes requested by Lua and not freed yet
+    size_t used;
+
+    /// Maximum value of used
+    size_t peak;
+
+    /// Bytes of pages and large blocks taken from system
+    size_t reserved;
+
+    /// Memory limit in bytes or 0 if unlimited
+    size_t limit;
+
+    /// Number of large blocks in use
+    unsigned long largeBlocks;
+
+    /// Number of allocations refused because of limit
+    unsigned long failures;
+
+    /// Statistics of small blocks size classes
+    AllocClassStats classes[ALLOC_CLASSES];
+};
+
+
+/// Lua memory allocator.  Small blocks are carved from 64K pages
+/// dedicated to one size class, large blocks are passed to malloc.
+/// Lua passes size of freed block so blocks have no headers.  Pages
+/// which become empty are returned to system.  Shrinking never fails:
+/// block is left in place if smaller one can't be allocated.  Allocator
+/// belongs to single Lua state and does no locking.
+class LuaAllocator
+{
+    private:
+        struct Page;
+
+        /// Pages of size class which have free blocks
+        Page *partial[ALLOC_CLASSES];
+
+        /// Statistics
+        AllocStats stats;
+
+        /// Large blocks left in place when shrunk to small size because
+        /// small block wasn't available, by address.  Values are sizes
+        /// of blocks allocated by malloc.
+        std::unordered_map<void*, size_t> shrunk;
+
+    public:
+        /// Create allocator without pages
+        LuaAllocator();
+
+        /// Release all pages
+        ~LuaAllocator();
+
+    public:
+        /// Set memory limit
+        /// \param limit limit in bytes or 0 for unlimited memory
+        void setLimit(size_t limit) { stats.limit = limit; }
+
+        /// Returns allocator statistics
+        const AllocStats& getStats() const { return stats; }
+
+        /// Allocator function passed to lua_newstate
+        static void* alloc(void *ud, void *ptr, size_t osize, size_t nsize);
+
+    private:
+        /// Allocate block
+        void* allocate(size_t size);
+
+        /// Free block
+        void release(void *ptr, size_t size);
+
+        /// Resize block
+        void* reallocate(void *ptr, size_t osize, size_t nsize);
+
+        /// Allocate block of size class
+        void* allocSmall(int cls);
+
+        /// Free small block.  Size class is taken from page, so block
+        /// left in place by shrinking goes back to its own class.
+        void freeSmall(void *ptr);
+
+        /// Free large block
+        /// \param size size of block allocated by malloc
+        void freeLarge(void *ptr, size_t size);
+
+        /// Returns true if block is large block shrunk to small size
+        bool isShrunk(void *ptr) const;
+
+        /// Take new page for size class from system
+        Page* newPage(int cls);
+
+        /// Return page to system
+        void freePage(Page *page);
+};
+
+
+/// Create Lua state which uses LuaAllocator.  Falls back to default
+/// allocator if Lua doesn't support custom allocators (LuaJIT on x64
+/// without GC64 mode).
+lua_State* createSlabLua();
+
+/// Destroy Lua state created by createSlabLua()
+void destroySlabLua(lua_State *L);
+
+/// Returns allocator of Lua state or NULL if state uses other allocator
+LuaAllocator* getLuaAllocator(lua_State *L);
+
+/// Register allocator functions in Lua
+void exportAllocToLua(Luna &lua);
+
+
+};
+
+
+#endif
+
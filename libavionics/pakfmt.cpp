@@ -0,0 +1,122 @@
+#include "pakfmt.h"
+
+#include <string.h>
+#include "recordfmt.h"
+
+
+using namespace xa;
+
+
+const char xa::PAK_SIGNATURE[8] = { 'S', 'A', 'S', 'L', 'P', 'A', 'K', 0 };
+
+
+/// Shortest match worth encoding
+#define MIN_MATCH 4
+
+/// Farthest match
+#define MAX_DISTANCE 65535
+
+/// Number of bits of hash of match start
+#define HASH_BITS 14
+
+
+/// Returns hash of MIN_MATCH bytes
+static uint32_t getHash(const unsigned char *p)
+{
+    uint32_t v = p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+    return (v * 2654435761u) >> (32 - HASH_BITS);
+}
+
+
+/// Append literals and match to buffer
+static void putSequence(std::vector<unsigned char> &buf,
+        const unsigned char *literals, size_t count, size_t length,
+        size_t distance)
+{
+    recordPutVarint(buf, count);
+    buf.insert(buf.end(), literals, literals + count);
+    recordPutVarint(buf, length);
+    if (length)
+        recordPutVarint(buf, distance);
+}
+
+
+void xa::pakCompress(const unsigned char *data, size_t size,
+        std::vector<unsigned char> &buf)
+{
+    const size_t none = (size_t)-1;
+    std::vector<size_t> heads(1 << HASH_BITS, none);
+
+    size_t literal = 0;
+    size_t pos = 0;
+    while (pos + MIN_MATCH <= size) {
+        uint32_t hash = getHash(data + pos);
+        size_t candidate = heads[hash];
+        heads[hash] = pos;
+        if ((none == candidate) || (pos - candidate > MAX_DISTANCE) ||
+                memcmp(data + candidate, data + pos, MIN_MATCH))
+        {
+            pos++;
+            continue;
+        }
+
+        size_t length = MIN_MATCH;
+        while ((pos + length < size) &&
+                (data[candidate + length] == data[pos + length]))
+            length++;
+        putSequence(buf, data + literal, pos - literal, length,
+                pos - candidate);
+
+        // remember positions inside match for following matches
+        size_t end = pos + length;
+        for (pos++; (pos < end) && (pos + MIN_MATCH <= size); pos++)
+            heads[getHash(data + pos)] = pos;
+        pos = literal = end;
+    }
+
+    putSequence(buf, data + literal, size - literal, 0, 0);
+}
+
+
+int xa::pakDecompress(const unsigned char *data, size_t size,
+        unsigned char *out, size_t outSize)
+{
+    const unsigned char *end = data + size;
+    size_t pos = 0;
+
+    while (data < end) {
+        uint64_t count;
+        int len = recordGetVarint(data, end, count);
+        if ((! len) || (count > (uint64_t)(end - data - len)) ||
+                (count > outSize - pos))
+            return -1;
+        data += len;
+        memcpy(out + pos, data, count);
+        data += count;
+        pos += count;
+
+        uint64_t length;
+        len = recordGetVarint(data, end, length);
+        if (! len)
+            return -1;
+        data += len;
+        if (! length)
+            continue;
+
+        uint64_t distance;
+        len = recordGetVarint(data, end, distance);
+        if ((! len) || (! distance) || (distance > pos) ||
+                (length > outSize - pos))
+            return -1;
+        data += len;
+
+        // match may overlap bytes it produces
+        const unsigned char *from = out + pos - distance;
+        for (uint64_t i = 0; i < length; i++)
+            out[pos + i] = from[i];
+        pos += length;
+    }
+
+    return pos == outSize ? 0 : -1;
+}
+
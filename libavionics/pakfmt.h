@@ -0,0 +1,79 @@
+#ifndef __PAK_FMT_H__
+#define __PAK_FMT_H__
+
+
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+
+/// Packed panel archive format.
+///
+/// File starts with header:
+///     8 bytes   signature "SASLPAK\0"
+///     uint32    format version
+///     uint32    number of entries
+///     uint64    size of index
+///
+/// Index follows header:
+///     for every entry:
+///         uint16    length of name
+///         name of file relative to archive root with '/' separators
+///         uint8     storage method
+///         uint64    offset of data from start of file
+///         uint64    size of file
+///         uint64    size of stored data
+///
+/// Data of every entry starts at offset aligned to PAK_ALIGN bytes so
+/// entries of mapped archive can be used in place.  Stored entries are
+/// copies of files, compressed entries are sequences of
+///     varint    number of literal bytes
+///     literal bytes
+///     varint    length of match or 0
+///     varint    distance back to match if length isn't 0
+/// All integers are little-endian.
+
+
+namespace xa {
+
+
+/// Archive file signature
+extern const char PAK_SIGNATURE[8];
+
+/// Current version of format
+const uint32_t PAK_VERSION = 1;
+
+/// Size of archive header in bytes
+const int PAK_HEADER_SIZE = 24;
+
+/// Alignment of entries data
+const int PAK_ALIGN = 16;
+
+/// Entry is copy of file
+const int PAK_STORED = 0;
+
+/// Entry is compressed
+const int PAK_COMPRESSED = 1;
+
+/// Size of index entry with empty name in bytes
+const int PAK_MIN_ENTRY_SIZE = 27;
+
+/// Maximum size of compressed file.  Larger files are stored so reader
+/// never allocates more than this for corrupted archive.
+const uint64_t PAK_MAX_COMPRESSED_SIZE = 256 * 1024 * 1024;
+
+
+/// Compress data and append it to buffer
+void pakCompress(const unsigned char *data, size_t size,
+        std::vector<unsigned char> &buf);
+
+/// Decompress data into buffer of original size.  Returns 0 on success
+/// or -1 if data is invalid.
+int pakDecompress(const unsigned char *data, size_t size,
+        unsigned char *out, size_t outSize);
+
+};
+
+
+#endif
+
@@ -0,0 +1,150 @@
+#include "pakreader.h"
+
+#include <stdio.h>
+#include <string.h>
+#ifndef WINDOWS
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include "recordfmt.h"
+
+
+using namespace xa;
+
+
+PakReader::PakReader()
+{
+    data = NULL;
+    size = 0;
+}
+
+
+PakReader::~PakReader()
+{
+    close();
+}
+
+
+int PakReader::open(const std::string &fileName)
+{
+    close();
+
+#ifndef WINDOWS
+    int fd = ::open(fileName.c_str(), O_RDONLY);
+    if (-1 == fd)
+        return -1;
+    struct stat st;
+    if (fstat(fd, &st) || (! st.st_size)) {
+        ::close(fd);
+        return -1;
+    }
+    void *p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (MAP_FAILED == p)
+        return -1;
+    data = (const unsigned char*)p;
+    size = st.st_size;
+#else
+    FILE *f = fopen(fileName.c_str(), "rb");
+    if (! f)
+        return -1;
+    unsigned char buf[4096];
+    size_t len;
+    while (0 < (len = fread(buf, 1, sizeof(buf), f)))
+        buffer.insert(buffer.end(), buf, buf + len);
+    fclose(f);
+    if (buffer.empty())
+        return -1;
+    data = &buffer[0];
+    size = buffer.size();
+#endif
+
+    if (parse()) {
+        close();
+        return -1;
+    }
+
+    return 0;
+}
+
+
+void PakReader::close()
+{
+#ifndef WINDOWS
+    if (data)
+        munmap((void*)data, size);
+#endif
+    buffer.clear();
+    data = NULL;
+    size = 0;
+    entries.clear();
+}
+
+
+int PakReader::parse()
+{
+    if ((size < (size_t)PAK_HEADER_SIZE) ||
+            memcmp(data, PAK_SIGNATURE, sizeof(PAK_SIGNATURE)))
+        return -1;
+    if (PAK_VERSION != recordGetUint(data + 8, 4))
+        return -1;
+
+    uint32_t count = recordGetUint(data + 12, 4);
+    uint64_t indexSize = recordGetUint(data + 16, 8);
+    if ((indexSize > size - PAK_HEADER_SIZE) ||
+            (count > indexSize / PAK_MIN_ENTRY_SIZE))
+        return -1;
+
+    const unsigned char *p = data + PAK_HEADER_SIZE;
+    const unsigned char *end = p + indexSize;
+    entries.resize(count);
+    for (uint32_t i = 0; i < count; i++) {
+        if (end - p < 2)
+            return -1;
+        size_t nameLen = recordGetUint(p, 2);
+        p += 2;
+        if ((size_t)(end - p) < nameLen + 25)
+            return -1;
+
+        Entry &entry = entries[i];
+        entry.name.assign((const char*)p, nameLen);
+        p += nameLen;
+        entry.method = *p++;
+        uint64_t offset = recordGetUint(p, 8);
+        entry.size = recordGetUint(p + 8, 8);
+        entry.packedSize = recordGetUint(p + 16, 8);
+        p += 24;
+
+        if ((offset > size) || (entry.packedSize > size - offset) ||
+                ((PAK_STORED == entry.method) &&
+                    (entry.size != entry.packedSize)) ||
+                ((PAK_COMPRESSED == entry.method) &&
+                    (entry.size > PAK_MAX_COMPRESSED_SIZE)) ||
+                ((PAK_STORED != entry.method) &&
+                    (PAK_COMPRESSED != entry.method)))
+            return -1;
+        entry.data = data + offset;
+    }
+
+    return 0;
+}
+
+
+int PakReader::read(const Entry &entry, std::vector<unsigned char> &buf,
+        const unsigned char *&fileData, size_t &fileSize) const
+{
+    fileSize = entry.size;
+    if (PAK_STORED == entry.method) {
+        fileData = entry.data;
+        return 0;
+    }
+
+    buf.resize(entry.size + 1);
+    if (pakDecompress(entry.data, entry.packedSize, &buf[0], entry.size))
+        return -1;
+    fileData = &buf[0];
+    return 0;
+}
+
@@ -0,0 +1,87 @@
+#ifndef __PAK_READER_H__
+#define __PAK_READER_H__
+
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "pakfmt.h"
+
+
+namespace xa {
+
+
+/// Reads packed panel archives.  Archive is mapped to memory and only
+/// its index is parsed on open.  Stored entries are used in place,
+/// compressed entries are decompressed on read.
+class PakReader
+{
+    public:
+        /// File in archive
+        struct Entry {
+            /// Path of file relative to archive root
+            std::string name;
+
+            /// Storage method
+            int method;
+
+            /// Pointer to stored data
+            const unsigned char *data;
+
+            /// Size of file
+            uint64_t size;
+
+            /// Size of stored data
+            uint64_t packedSize;
+        };
+
+    private:
+        /// Mapped file data
+        const unsigned char *data;
+
+        /// Size of mapped data
+        size_t size;
+
+        /// File data if memory mapping is unavailable
+        std::vector<unsigned char> buffer;
+
+        /// Files in archive
+        std::vector<Entry> entries;
+
+    public:
+        /// Create closed reader
+        PakReader();
+
+        /// Close archive
+        ~PakReader();
+
+    public:
+        /// Open archive.  Returns 0 on success.
+        int open(const std::string &fileName);
+
+        /// Close archive
+        void close();
+
+        /// Returns number of files in archive
+        int getEntriesCount() const { return (int)entries.size(); }
+
+        /// Returns file in archive
+        const Entry& getEntry(int index) const { return entries[index]; }
+
+        /// Get contents of file.  Stored entry is returned in place,
+        /// compressed entry is decompressed into buffer.  Returns 0 on
+        /// success.
+        int read(const Entry &entry, std::vector<unsigned char> &buf,
+                const unsigned char *&fileData, size_t &fileSize) const;
+
+    private:
+        /// Parse index.  Returns 0 on success.
+        int parse();
+};
+
+
+};
+
+
+#endif
+
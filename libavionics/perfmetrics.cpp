@@ -0,0 +1,186 @@
+#include "perfmetrics.h"
+
+#include <string.h>
+#include <algorithm>
+#include "properties.h"
+#include "propsserv.h"
+#include "texture.h"
+#include "libavconsts.h"
+#include "luna.h"
+
+
+using namespace xa;
+
+
+/// Period of publishing in milliseconds
+#define PERIOD 1000
+
+
+/// Names and types of metrics properties
+static const struct {
+    const char *name;
+    int type;
+} metricProps[METRICS_COUNT] = {
+    { "sasl/perf/update_p50", PROP_DOUBLE },
+    { "sasl/perf/update_p99", PROP_DOUBLE },
+    { "sasl/perf/draw_gauges_p50", PROP_DOUBLE },
+    { "sasl/perf/draw_gauges_p99", PROP_DOUBLE },
+    { "sasl/perf/draw_popups_p50", PROP_DOUBLE },
+    { "sasl/perf/draw_popups_p99", PROP_DOUBLE },
+    { "sasl/perf/draw_panel_p50", PROP_DOUBLE },
+    { "sasl/perf/draw_panel_p99", PROP_DOUBLE },
+    { "sasl/perf/frames", PROP_INT },
+    { "sasl/perf/batches", PROP_INT },
+    { "sasl/perf/vertices", PROP_INT },
+    { "sasl/perf/texture_memory", PROP_DOUBLE },
+    { "sasl/perf/lua_heap", PROP_DOUBLE },
+    { "sasl/perf/gc_time", PROP_DOUBLE },
+    { "sasl/perf/server_clients", PROP_INT },
+    { "sasl/perf/server_sent", PROP_DOUBLE },
+    { "sasl/perf/server_received", PROP_DOUBLE },
+};
+
+
+PerfMetrics::PerfMetrics(Properties &properties): properties(properties)
+{
+    registered = false;
+    for (int i = 0; i < METRICS_COUNT; i++)
+        values[i] = 0;
+    frames = batches = vertices = 0;
+    gcTime = 0;
+    periodStart = 0;
+}
+
+
+void PerfMetrics::addUpdateTime(double time)
+{
+    updateTimes.push_back(time);
+    frames++;
+}
+
+
+void PerfMetrics::addDrawTime(int stage, double time,
+        const struct SaslGraphicsStats *stats)
+{
+    if ((STAGE_GAUGES <= stage) && (stage <= STAGE_ALL))
+        drawTimes[stage - STAGE_GAUGES].push_back(time);
+    if (stats) {
+        batches += stats->batches;
+        vertices += stats->vertices;
+    }
+}
+
+
+void PerfMetrics::addGcTime(double time)
+{
+    gcTime += time;
+}
+
+
+/// Returns value of metric
+static int metricGetterCallback(int type, void *buf, int maxSize, void *ref)
+{
+    double value = *(double*)ref;
+
+    switch (type) {
+        case PROP_INT: {
+                int v = (int)value;
+                if (buf && (maxSize >= (int)sizeof(v)))
+                    memcpy(buf, &v, sizeof(v));
+                return sizeof(v);
+            }
+        case PROP_FLOAT: {
+                float v = (float)value;
+                if (buf && (maxSize >= (int)sizeof(v)))
+                    memcpy(buf, &v, sizeof(v));
+                return sizeof(v);
+            }
+        case PROP_DOUBLE: {
+                if (buf && (maxSize >= (int)sizeof(value)))
+                    memcpy(buf, &value, sizeof(value));
+                return sizeof(value);
+            }
+    }
+
+    return 0;
+}
+
+
+/// Metrics are read only
+static void metricSetterCallback(int type, void *buf, int size, void *ref)
+{
+}
+
+
+void PerfMetrics::registerProps()
+{
+    // properties are created once per backend, backend which doesn't
+    // support functional properties would fail the same way each time
+    // and creating again properties created successfully duplicates them
+    registered = true;
+    for (int i = 0; i < METRICS_COUNT; i++)
+        properties.createFuncProp(metricProps[i].name, metricProps[i].type,
+                metricGetterCallback, metricSetterCallback, &values[i]);
+}
+
+
+/// Returns percentile of samples in milliseconds.  Reorders samples.
+static double getPercentile(std::vector<double> &samples, int percent)
+{
+    if (samples.empty())
+        return 0;
+    size_t n = (samples.size() - 1) * percent / 100;
+    std::nth_element(samples.begin(), samples.begin() + n, samples.end());
+    return samples[n] / 1000.0;
+}
+
+
+void PerfMetrics::update(long now, lua_State *L, PropsServer &server,
+        TextureManager &textures)
+{
+    if (! periodStart) {
+        periodStart = now;
+        lastNetStats = server.getStats();
+    }
+
+    long elapsed = now - periodStart;
+    if (elapsed < PERIOD)
+        return;
+
+    double seconds = elapsed / 1000.0;
+
+    values[METRIC_UPDATE_P50] = getPercentile(updateTimes, 50);
+    values[METRIC_UPDATE_P99] = getPercentile(updateTimes, 99);
+    for (int i = 0; i < 3; i++) {
+        values[METRIC_DRAW_GAUGES_P50 + i * 2] =
+            getPercentile(drawTimes[i], 50);
+        values[METRIC_DRAW_GAUGES_P99 + i * 2] =
+            getPercentile(drawTimes[i], 99);
+        drawTimes[i].clear();
+    }
+    updateTimes.clear();
+
+    values[METRIC_FRAMES] = frames / seconds;
+    values[METRIC_BATCHES] = frames ? (double)batches / frames : 0;
+    values[METRIC_VERTICES] = frames ? (double)vertices / frames : 0;
+    values[METRIC_TEXTURE_MEMORY] = (double)textures.getMemoryUsage();
+    values[METRIC_LUA_HEAP] = lua_gc(L, LUA_GCCOUNT, 0) * 1024.0 +
+        lua_gc(L, LUA_GCCOUNTB, 0);
+    values[METRIC_GC_TIME] = gcTime / 1000.0 / seconds;
+
+    NetStats stats = server.getStats();
+    values[METRIC_SERVER_CLIENTS] = server.getClientsCount();
+    values[METRIC_SERVER_SENT] =
+        (stats.bytesSent - lastNetStats.bytesSent) / seconds;
+    values[METRIC_SERVER_RECEIVED] =
+        (stats.bytesReceived - lastNetStats.bytesReceived) / seconds;
+    lastNetStats = stats;
+
+    frames = batches = vertices = 0;
+    gcTime = 0;
+    periodStart = now;
+
+    if (! registered)
+        registerProps();
+}
+
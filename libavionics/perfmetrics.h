@@ -0,0 +1,125 @@
+#ifndef __PERF_METRICS_H__
+#define __PERF_METRICS_H__
+
+
+#include <vector>
+#include "libavcallbacks.h"
+#include "lownet.h"
+
+
+struct lua_State;
+
+
+namespace xa {
+
+
+class Properties;
+class PropsServer;
+class TextureManager;
+
+
+/// Published metrics
+enum {
+    METRIC_UPDATE_P50 = 0,
+    METRIC_UPDATE_P99,
+    METRIC_DRAW_GAUGES_P50,
+    METRIC_DRAW_GAUGES_P99,
+    METRIC_DRAW_POPUPS_P50,
+    METRIC_DRAW_POPUPS_P99,
+    METRIC_DRAW_PANEL_P50,
+    METRIC_DRAW_PANEL_P99,
+    METRIC_FRAMES,
+    METRIC_BATCHES,
+    METRIC_VERTICES,
+    METRIC_TEXTURE_MEMORY,
+    METRIC_LUA_HEAP,
+    METRIC_GC_TIME,
+    METRIC_SERVER_CLIENTS,
+    METRIC_SERVER_SENT,
+    METRIC_SERVER_RECEIVED,
+    METRICS_COUNT
+};
+
+
+/// Collects frame timings and resources usage and publishes them once
+/// per second as read only properties sasl/perf/*.  Times are published
+/// in milliseconds, sizes in bytes, rates per second.
+class PerfMetrics
+{
+    private:
+        /// Properties subsystem
+        Properties &properties;
+
+        /// True if creation of properties in current backend was tried
+        bool registered;
+
+        /// Published values
+        double values[METRICS_COUNT];
+
+        /// Update times of current period in microseconds
+        std::vector<double> updateTimes;
+
+        /// Draw times of current period by stage in microseconds
+        std::vector<double> drawTimes[3];
+
+        /// Number of frames in current period
+        unsigned long frames;
+
+        /// Batches drawn in current period
+        unsigned long batches;
+
+        /// Vertices drawn in current period
+        unsigned long vertices;
+
+        /// Time spent in garbage collection in current period
+        double gcTime;
+
+        /// Start time of current period in milliseconds
+        long periodStart;
+
+        /// Server counters at start of current period
+        NetStats lastNetStats;
+
+    public:
+        /// Create metrics.  Properties are created on first update.
+        PerfMetrics(Properties &properties);
+
+    public:
+        /// Add duration of avionics update
+        /// \param time time of update in microseconds
+        void addUpdateTime(double time);
+
+        /// Add duration of avionics draw
+        /// \param stage STAGE_GAUGES, STAGE_POPUPS or STAGE_ALL
+        /// \param time time of draw in microseconds
+        /// \param stats statistics of graphics backend or NULL
+        void addDrawTime(int stage, double time,
+                const struct SaslGraphicsStats *stats);
+
+        /// Add time spent in garbage collection
+        /// \param time time in microseconds
+        void addGcTime(double time);
+
+        /// Recreate properties on next update.  Called when properties
+        /// backend was replaced.
+        void invalidateProps() { registered = false; }
+
+        /// Publish metrics if period passed
+        /// \param now current time in milliseconds
+        void update(long now, lua_State *L, PropsServer &server,
+                TextureManager &textures);
+
+        /// Returns published value of metric
+        double getValue(int metric) const { return values[metric]; }
+
+    private:
+        /// Create properties
+        void registerProps();
+};
+
+
+};
+
+
+#endif
+
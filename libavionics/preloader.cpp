@@ -0,0 +1,313 @@
+#include "preloader.h"
+
+#include <stdio.h>
+#include <ctype.h>
+#include "profiler.h"
+#include "assetcache.h"
+#include "avionics.h"
+
+
+using namespace xa;
+
+
+/// Maximum number of worker threads
+#define MAX_WORKERS 8
+
+
+/// Read file.  Returns 0 on success.
+static int readFile(const std::string &fileName,
+        std::vector<unsigned char> &data)
+{
+    FILE *f = fopen(fileName.c_str(), "rb");
+    if (! f)
+        return -1;
+    unsigned char buf[16384];
+    size_t len;
+    while (0 < (len = fread(buf, 1, sizeof(buf), f)))
+        data.insert(data.end(), buf, buf + len);
+    bool failed = ferror(f);
+    fclose(f);
+    return failed || data.empty() ? -1 : 0;
+}
+
+
+Preloader::Preloader()
+{
+    graphics = NULL;
+    running = 0;
+    stopWorkers = false;
+}
+
+
+Preloader::~Preloader()
+{
+    clear();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopWorkers = true;
+    }
+    queued.notify_all();
+    for (size_t i = 0; i < workers.size(); i++)
+        workers[i].join();
+}
+
+
+void Preloader::start()
+{
+    int count = std::thread::hardware_concurrency() - 1;
+    if (count < 1)
+        count = 1;
+    if (count > MAX_WORKERS)
+        count = MAX_WORKERS;
+
+    for (int i = 0; i < count; i++)
+        workers.push_back(std::thread(&Preloader::work, this));
+}
+
+
+int Preloader::request(const std::string &fileName, int kind,
+        const unsigned char *data, size_t size)
+{
+    if (workers.empty())
+        start();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::unordered_map<std::string, int>::iterator i =
+        handles.find(fileName);
+    if (i != handles.end())
+        return (*i).second;
+
+    Asset *asset = new Asset;
+    asset->fileName = fileName;
+    asset->kind = kind;
+    asset->state = PRELOAD_PENDING;
+    asset->taken = false;
+    asset->pixels = NULL;
+    asset->width = asset->height = asset->channels = 0;
+    asset->size = 0;
+    asset->decodeTime = 0;
+    if (data)
+        asset->data.assign(data, data + size);
+
+    int handle = assets.size();
+    assets.push_back(asset);
+    handles[fileName] = handle;
+    queue.push_back(asset);
+    queued.notify_one();
+
+    return handle;
+}
+
+
+int Preloader::getState(int handle)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if ((0 > handle) || ((int)assets.size() <= handle))
+        return PRELOAD_FAILED;
+    return assets[handle]->state;
+}
+
+
+int Preloader::take(const std::string &fileName, Asset &asset)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    std::unordered_map<std::string, int>::iterator i =
+        handles.find(fileName);
+    if (i == handles.end())
+        return -1;
+
+    Asset *a = assets[(*i).second];
+    if (a->taken)
+        return -1;
+    while (PRELOAD_PENDING == a->state)
+        loaded.wait(lock);
+    a->taken = true;
+    if (PRELOAD_READY != a->state)
+        return -1;
+
+    asset.fileName = a->fileName;
+    asset.kind = a->kind;
+    asset.state = a->state;
+    asset.taken = true;
+    asset.data.swap(a->data);
+    asset.pixels = a->pixels;
+    asset.width = a->width;
+    asset.height = a->height;
+    asset.channels = a->channels;
+    asset.size = a->size;
+    asset.decodeTime = a->decodeTime;
+    asset.digest.swap(a->digest);
+    a->pixels = NULL;
+    return 0;
+}
+
+
+void Preloader::wait()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while ((! queue.empty()) || running)
+        loaded.wait(lock);
+}
+
+
+int Preloader::getPendingCount()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return queue.size() + running;
+}
+
+
+void Preloader::freePixels(Asset &asset)
+{
+    if (asset.pixels && graphics && graphics->free_image)
+        graphics->free_image(graphics, asset.pixels);
+    asset.pixels = NULL;
+}
+
+
+void Preloader::clear()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    queue.clear();
+    while (running)
+        loaded.wait(lock);
+
+    for (size_t i = 0; i < assets.size(); i++) {
+        freePixels(*assets[i]);
+        delete assets[i];
+    }
+    assets.clear();
+    handles.clear();
+}
+
+
+void Preloader::work()
+{
+    while (true) {
+        Asset *asset;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (queue.empty() && (! stopWorkers))
+                queued.wait(lock);
+            if (stopWorkers)
+                break;
+            asset = queue.front();
+            queue.pop_front();
+            running++;
+        }
+
+        load(asset);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            running--;
+        }
+        loaded.notify_all();
+    }
+}
+
+
+void Preloader::load(Asset *asset)
+{
+    double startTime = Profiler::getTime();
+    int state = PRELOAD_READY;
+    if (asset->data.empty() && readFile(asset->fileName, asset->data))
+        state = PRELOAD_FAILED;
+    asset->size = asset->data.size();
+    if (PRELOAD_READY == state)
+        asset->digest = AssetCache::getDigest(&asset->data[0],
+                asset->data.size());
+
+    // images are uploaded from file data if backend can't decode them
+    if ((PRELOAD_READY == state) && (PRELOAD_IMAGE == asset->kind) &&
+            graphics && graphics->decode_image && graphics->upload_image)
+    {
+        asset->pixels = graphics->decode_image(graphics,
+                (const char*)&asset->data[0], asset->data.size(),
+                &asset->width, &asset->height, &asset->channels);
+        if (asset->pixels)
+            std::vector<unsigned char>().swap(asset->data);
+        else
+            state = PRELOAD_FAILED;
+    }
+    asset->decodeTime = (Profiler::getTime() - startTime) / 1000.0;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    asset->state = state;
+}
+
+
+int Preloader::getKind(const std::string &fileName)
+{
+    size_t dot = fileName.rfind('.');
+    if (std::string::npos == dot)
+        return -1;
+    std::string ext = fileName.substr(dot + 1);
+    for (size_t i = 0; i < ext.size(); i++)
+        ext[i] = tolower(ext[i]);
+
+    if (("png" == ext) || ("jpg" == ext) || ("jpeg" == ext) ||
+            ("tga" == ext) || ("bmp" == ext) || ("dds" == ext))
+        return PRELOAD_IMAGE;
+    if ("wav" == ext)
+        return PRELOAD_SAMPLE;
+    return -1;
+}
+
+
+/// Start loading asset on worker threads.  Images and sound samples
+/// are supported.
+/// arguments: full name of file
+/// returns: handle of asset or nil if file can't be preloaded
+static int luaPreloadAsset(lua_State *L)
+{
+    const char *fileName = luaL_checkstring(L, 1);
+    int handle = getAvionics(L)->preloadAsset(fileName,
+            Preloader::getKind(fileName));
+    if (-1 == handle)
+        return 0;
+    lua_pushnumber(L, handle);
+    return 1;
+}
+
+
+/// Check if asset is loaded
+/// arguments: handle of asset
+/// returns: true if asset loading is finished and true if it was
+/// loaded successfully
+static int luaIsAssetReady(lua_State *L)
+{
+    int state = getAvionics(L)->getPreloader().getState(
+            (int)luaL_checknumber(L, 1));
+    lua_pushboolean(L, Preloader::PRELOAD_PENDING != state);
+    lua_pushboolean(L, Preloader::PRELOAD_READY == state);
+    return 2;
+}
+
+
+/// Wait until all requested assets are loaded
+static int luaWaitAssets(lua_State *L)
+{
+    getAvionics(L)->getPreloader().wait();
+    return 0;
+}
+
+
+/// Returns number of assets not loaded yet
+static int luaGetPendingAssetsCount(lua_State *L)
+{
+    lua_pushnumber(L, getAvionics(L)->getPreloader().getPendingCount());
+    return 1;
+}
+
+
+void xa::exportPreloaderToLua(Luna &lua)
+{
+    lua_State *L = lua.getLua();
+
+    lua_register(L, "preloadAsset", luaPreloadAsset);
+    lua_register(L, "isAssetReady", luaIsAssetReady);
+    lua_register(L, "waitAssets", luaWaitAssets);
+    lua_register(L, "getPendingAssetsCount", luaGetPendingAssetsCount);
+}
+
@@ -0,0 +1,180 @@
+#ifndef __PRELOADER_H__
+#define __PRELOADER_H__
+
+
+#include <string>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "luna.h"
+#include "libavcallbacks.h"
+
+
+namespace xa {
+
+
+/// Loads panel assets on worker threads.  Workers read files and decode
+/// images, thread owning graphics and sound context only uploads decoded
+/// data when asset is used.  Assets are requested by full file name,
+/// loaders of textures and samples take preloaded asset by the same name
+/// waiting only for that asset if it isn't ready yet.
+class Preloader
+{
+    public:
+        /// Kinds of assets
+        enum Kind {
+            /// Image decoded to pixels if graphics backend can do it
+            PRELOAD_IMAGE,
+
+            /// Sound sample read into memory
+            PRELOAD_SAMPLE
+        };
+
+        /// States of asset
+        enum State {
+            /// Asset is queued or being loaded
+            PRELOAD_PENDING,
+
+            /// Asset is loaded
+            PRELOAD_READY,
+
+            /// Asset can't be read or decoded
+            PRELOAD_FAILED
+        };
+
+        /// Loaded asset
+        struct Asset
+        {
+            /// Full name of file
+            std::string fileName;
+
+            /// Kind of asset
+            int kind;
+
+            /// State of asset
+            int state;
+
+            /// True if asset was taken by loader
+            bool taken;
+
+            /// Contents of file.  Cleared when image is decoded.
+            std::vector<unsigned char> data;
+
+            /// Decoded image or NULL
+            void *pixels;
+
+            /// Size of decoded image
+            int width, height;
+
+            /// Number of channels of decoded image
+            int channels;
+
+            /// Size of file in bytes
+            size_t size;
+
+            /// Time spent reading and decoding in milliseconds
+            double decodeTime;
+
+            /// MD5 of file contents
+            std::string digest;
+        };
+
+    private:
+        /// Graphics funtions
+        SaslGraphicsCallbacks *graphics;
+
+        /// Worker threads, started on first request
+        std::vector<std::thread> workers;
+
+        /// Guards assets states, queue and stopWorkers
+        std::mutex mutex;
+
+        /// Signalled when asset queued or workers should stop
+        std::condition_variable queued;
+
+        /// Signalled when asset is loaded
+        std::condition_variable loaded;
+
+        /// Assets waiting for worker
+        std::list<Asset*> queue;
+
+        /// Requested assets by handle
+        std::vector<Asset*> assets;
+
+        /// Handles of assets by file name
+        std::unordered_map<std::string, int> handles;
+
+        /// Number of assets being loaded by workers
+        int running;
+
+        /// True if workers should exit
+        bool stopWorkers;
+
+    public:
+        /// Create preloader.  Workers aren't started until first request.
+        Preloader();
+
+        /// Stop workers and free assets
+        ~Preloader();
+
+    public:
+        /// Set graphics callbacks used to decode images
+        void setGraphicsCallbacks(SaslGraphicsCallbacks *graphics) {
+            this->graphics = graphics;
+        }
+
+        /// Queue file for loading.  If data is NULL worker reads file,
+        /// otherwise data is copied.  Returns handle of asset, asset
+        /// requested before returns the same handle.
+        int request(const std::string &fileName, int kind,
+                const unsigned char *data = NULL, size_t size = 0);
+
+        /// Returns state of asset or PRELOAD_FAILED for unknown handle
+        int getState(int handle);
+
+        /// Wait until asset is loaded and move it to asset.  Returns 0
+        /// on success or -1 if file wasn't requested, was taken already
+        /// or failed to load.  Caller frees taken pixels.
+        int take(const std::string &fileName, Asset &asset);
+
+        /// Wait until all requested assets are loaded
+        void wait();
+
+        /// Returns number of assets not loaded yet
+        int getPendingCount();
+
+        /// Drop queued assets, wait for workers and free assets which
+        /// weren't taken
+        void clear();
+
+        /// Free decoded pixels of asset
+        void freePixels(Asset &asset);
+
+        /// Returns kind of asset by file extension or -1 if file can't
+        /// be preloaded
+        static int getKind(const std::string &fileName);
+
+    private:
+        /// Start worker threads
+        void start();
+
+        /// Worker thread body
+        void work();
+
+        /// Read and decode asset
+        void load(Asset *asset);
+};
+
+
+/// Register preloading functions in Lua
+void exportPreloaderToLua(Luna &lua);
+
+
+};
+
+
+#endif
+
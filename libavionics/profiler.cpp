@@ -0,0 +1,269 @@
+#include "profiler.h"
+
+#include <chrono>
+#include <algorithm>
+#include "avionics.h"
+
+
+using namespace xa;
+
+
+/// Number of entries written to log by periodic dumps
+#define DUMP_ENTRIES 20
+
+
+Profiler::Profiler(Log &log): log(log)
+{
+    enabled = false;
+    dumpPeriod = 0;
+    lastDump = 0;
+}
+
+
+double Profiler::getTime()
+{
+    return std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+int Profiler::getEntry(const std::string &name)
+{
+    std::map<std::string, int>::iterator i = entriesByName.find(name);
+    if (i != entriesByName.end())
+        return (*i).second;
+
+    ProfileEntry entry;
+    entry.name = name;
+    entries.push_back(entry);
+    int id = entries.size() - 1;
+    entriesByName[name] = id;
+
+    ProfileEntry &e = entries.back();
+    for (int j = 0; j < 2; j++) {
+        ProfileCounter &c = e.counters[j];
+        c.calls = 0;
+        c.total = c.self = c.max = 0;
+    }
+
+    return id;
+}
+
+
+void Profiler::begin(int entry, int kind)
+{
+    Call call;
+    call.entry = entry;
+    call.kind = kind;
+    call.nested = 0;
+    call.start = getTime();
+    stack.push_back(call);
+}
+
+
+void Profiler::end()
+{
+    double now = getTime();
+
+    if (stack.empty())
+        return;
+
+    Call &call = stack.back();
+    double elapsed = now - call.start;
+    if ((0 <= call.entry) && (call.entry < (int)entries.size()) &&
+            (0 <= call.kind) && (call.kind < 2))
+    {
+        ProfileCounter &c = entries[call.entry].counters[call.kind];
+        c.calls++;
+        c.total += elapsed;
+        c.self += elapsed - call.nested;
+        if (elapsed > c.max)
+            c.max = elapsed;
+    }
+    stack.pop_back();
+
+    if (! stack.empty())
+        stack.back().nested += elapsed;
+}
+
+
+void Profiler::reset()
+{
+    for (std::vector<ProfileEntry>::iterator i = entries.begin();
+            i != entries.end(); i++)
+    {
+        for (int j = 0; j < 2; j++) {
+            ProfileCounter &c = (*i).counters[j];
+            c.calls = 0;
+            c.total = c.self = c.max = 0;
+        }
+    }
+}
+
+
+/// Compare entries by self time
+static bool compareSelfTime(const ProfileEntry &a, const ProfileEntry &b)
+{
+    return a.counters[PROFILE_UPDATE].self + a.counters[PROFILE_DRAW].self >
+        b.counters[PROFILE_UPDATE].self + b.counters[PROFILE_DRAW].self;
+}
+
+
+void Profiler::getReport(std::vector<ProfileEntry> &report) const
+{
+    report.clear();
+    for (std::vector<ProfileEntry>::const_iterator i = entries.begin();
+            i != entries.end(); i++)
+        if ((*i).counters[PROFILE_UPDATE].calls ||
+                (*i).counters[PROFILE_DRAW].calls)
+            report.push_back(*i);
+    std::sort(report.begin(), report.end(), compareSelfTime);
+}
+
+
+void Profiler::update(long now)
+{
+    if ((! enabled) || (! dumpPeriod))
+        return;
+
+    if (! lastDump)
+        lastDump = now;
+    if (now - lastDump < dumpPeriod)
+        return;
+
+    dump(DUMP_ENTRIES);
+    reset();
+    lastDump = now;
+}
+
+
+void Profiler::dump(int maxEntries)
+{
+    std::vector<ProfileEntry> report;
+    getReport(report);
+
+    log.info("Components profile (times in microseconds):");
+    log.info("%-32s %8s %10s %10s %8s %10s %10s", "component",
+            "updates", "self", "total", "draws", "self", "total");
+    int n = 0;
+    for (std::vector<ProfileEntry>::iterator i = report.begin();
+            (i != report.end()) && (n < maxEntries); i++, n++)
+    {
+        ProfileCounter &u = (*i).counters[PROFILE_UPDATE];
+        ProfileCounter &d = (*i).counters[PROFILE_DRAW];
+        log.info("%-32s %8lu %10.0f %10.0f %8lu %10.0f %10.0f",
+                (*i).name.c_str(), u.calls, u.self, u.total,
+                d.calls, d.self, d.total);
+    }
+}
+
+
+/// Lua wrapper for getEntry
+static int luaGetProfileEntry(lua_State *L)
+{
+    if (! lua_isstring(L, 1)) {
+        lua_pushnil(L);
+        return 1;
+    }
+    lua_pushnumber(L, getAvionics(L)->getProfiler().getEntry(
+                lua_tostring(L, 1)));
+    return 1;
+}
+
+
+/// Lua wrapper for begin
+static int luaProfileBegin(lua_State *L)
+{
+    getAvionics(L)->getProfiler().begin(lua_tointeger(L, 1),
+            lua_tointeger(L, 2));
+    return 0;
+}
+
+
+/// Lua wrapper for end
+static int luaProfileEnd(lua_State *L)
+{
+    getAvionics(L)->getProfiler().end();
+    return 0;
+}
+
+
+/// Set field of table on top of stack
+static void setField(lua_State *L, const char *name, double value)
+{
+    lua_pushnumber(L, value);
+    lua_setfield(L, -2, name);
+}
+
+
+/// Returns table of profiled entries sorted by self time
+static int luaGetProfileReport(lua_State *L)
+{
+    std::vector<ProfileEntry> report;
+    getAvionics(L)->getProfiler().getReport(report);
+
+    lua_newtable(L);
+    for (size_t i = 0; i < report.size(); i++) {
+        ProfileEntry &e = report[i];
+        ProfileCounter &u = e.counters[PROFILE_UPDATE];
+        ProfileCounter &d = e.counters[PROFILE_DRAW];
+        lua_pushnumber(L, i + 1);
+        lua_newtable(L);
+        lua_pushstring(L, e.name.c_str());
+        lua_setfield(L, -2, "name");
+        setField(L, "updateCalls", u.calls);
+        setField(L, "updateSelf", u.self);
+        setField(L, "updateTotal", u.total);
+        setField(L, "updateMax", u.max);
+        setField(L, "drawCalls", d.calls);
+        setField(L, "drawSelf", d.self);
+        setField(L, "drawTotal", d.total);
+        setField(L, "drawMax", d.max);
+        lua_settable(L, -3);
+    }
+    return 1;
+}
+
+
+/// Lua wrapper for reset
+static int luaResetProfiler(lua_State *L)
+{
+    getAvionics(L)->getProfiler().reset();
+    return 0;
+}
+
+
+/// Enable or disable profiler
+/// arguments: enable flag, optional period of log dumps in milliseconds
+static int luaEnableProfiler(lua_State *L)
+{
+    getAvionics(L)->enableProfiler(lua_toboolean(L, 1),
+            (long)lua_tonumber(L, 2));
+    return 0;
+}
+
+
+/// Lua wrapper for dump
+static int luaDumpProfile(lua_State *L)
+{
+    int maxEntries = DUMP_ENTRIES;
+    if (lua_isnumber(L, 1))
+        maxEntries = lua_tointeger(L, 1);
+    getAvionics(L)->getProfiler().dump(maxEntries);
+    return 0;
+}
+
+
+void xa::exportProfilerToLua(Luna &lua)
+{
+    lua_State *L = lua.getLua();
+
+    lua_register(L, "getProfileEntry", luaGetProfileEntry);
+    lua_register(L, "profileBegin", luaProfileBegin);
+    lua_register(L, "profileEnd", luaProfileEnd);
+    lua_register(L, "getProfileReport", luaGetProfileReport);
+    lua_register(L, "resetProfiler", luaResetProfiler);
+    lua_register(L, "enableProfiler", luaEnableProfiler);
+    lua_register(L, "dumpProfile", luaDumpProfile);
+}
+
@@ -0,0 +1,153 @@
+#ifndef __PROFILER_H__
+#define __PROFILER_H__
+
+
+#include <string>
+#include <vector>
+#include <map>
+#include "luna.h"
+
+
+namespace xa {
+
+
+class Log;
+
+
+/// Kinds of profiled calls
+enum {
+    PROFILE_UPDATE = 0,
+    PROFILE_DRAW = 1
+};
+
+
+/// Accumulated times of one kind of calls of profiled entry
+struct ProfileCounter
+{
+    /// Number of calls
+    unsigned long calls;
+
+    /// Time spent in calls including nested entries in microseconds
+    double total;
+
+    /// Time spent in calls excluding nested entries in microseconds
+    double self;
+
+    /// Longest call in microseconds
+    double max;
+};
+
+
+/// Profiled entry (usually component)
+struct ProfileEntry
+{
+    /// Name of entry
+    std::string name;
+
+    /// Counters of update and draw calls
+    ProfileCounter counters[2];
+};
+
+
+/// Measures time spent in update and draw functions of components.
+/// Lua code calls begin() and end() around profiled calls, nested calls
+/// are subtracted from self time of outer entry.  When profiler is
+/// disabled init.lua doesn't call it at all.
+class Profiler
+{
+    private:
+        /// Call in progress
+        struct Call {
+            /// index of entry
+            int entry;
+
+            /// kind of call
+            int kind;
+
+            /// start time in microseconds
+            double start;
+
+            /// time spent in nested calls
+            double nested;
+        };
+
+        /// Logger
+        Log &log;
+
+        /// True if profiling is enabled
+        bool enabled;
+
+        /// Profiled entries
+        std::vector<ProfileEntry> entries;
+
+        /// Entries indices by names
+        std::map<std::string, int> entriesByName;
+
+        /// Calls in progress
+        std::vector<Call> stack;
+
+        /// Period of report dumps in milliseconds or 0
+        long dumpPeriod;
+
+        /// Time of last dump in milliseconds
+        long lastDump;
+
+    public:
+        /// Create disabled profiler
+        Profiler(Log &log);
+
+    public:
+        /// Enable or disable profiling
+        void setEnabled(bool enabled) { this->enabled = enabled; }
+
+        /// Returns true if profiling is enabled
+        bool isEnabled() const { return enabled; }
+
+        /// Set period of dumping report to log.  Report is reset after
+        /// each dump so every dump shows last period only.
+        /// \param period period in milliseconds or 0 to disable dumps
+        void setDumpPeriod(long period) { dumpPeriod = period; }
+
+        /// Returns index of entry with specified name.  Creates new
+        /// entry if needed.
+        int getEntry(const std::string &name);
+
+        /// Start profiled call
+        void begin(int entry, int kind);
+
+        /// Finish last started call
+        void end();
+
+        /// Forget unfinished calls.  Called at start of update and draw
+        /// so errors inside profiled calls don't break nesting.
+        void resetStack() { stack.clear(); }
+
+        /// Zero all counters
+        void reset();
+
+        /// Returns entries sorted by self time of update and draw calls
+        /// in descending order.  Entries without calls are skipped.
+        void getReport(std::vector<ProfileEntry> &report) const;
+
+        /// Write report to log if dump period passed
+        /// \param now current time in milliseconds
+        void update(long now);
+
+        /// Write report to log
+        /// \param maxEntries maximum number of entries to write
+        void dump(int maxEntries);
+
+        /// Returns current time in microseconds
+        static double getTime();
+};
+
+
+/// Register profiler functions in Lua
+void exportProfilerToLua(Luna &lua);
+
+
+};
+
+
+#endif
+
@@ -2,14 +2,13 @@
 
 #include "avionics.h"
 #include <string.h>
+#include <math.h>
 
 
 using namespace xa;
 
 
-/// convert type name to type constant
-/// returns -1 on errors
-static int getPropType(const std::string &propType)
+int xa::getPropType(const std::string &propType)
 {
     if ("int" == propType)
         return PROP_INT;
@@ -117,13 +116,24 @@ static int luaCreateFuncProp(lua_State *L)
     std::string propName = lua_tostring(L, 1);
     int type = getPropType(lua_tostring(L, 2));
     int maxSize = lua_tonumber(L, 5);
+    int cache = Properties::FUNC_CACHE_NONE;
+    if (lua_isstring(L, 6)) {
+        std::string policy = lua_tostring(L, 6);
+        if ("frame" == policy)
+            cache = Properties::FUNC_CACHE_FRAME;
+        else if ("ttl" == policy)
+            cache = Properties::FUNC_CACHE_TTL;
+        else if ("manual" == policy)
+            cache = Properties::FUNC_CACHE_MANUAL;
+    }
+    long ttl = (long)lua_tonumber(L, 7);
     lua_pushvalue(L, 3);
     int getter = lua.addRef();
     lua_pushvalue(L, 4);
     int setter = lua.addRef();
    
     SaslPropRef p = getAvionics(L)->getProps().registerFuncProp(propName, type, 
-            maxSize, getter, setter);
+            maxSize, getter, setter, cache, ttl);
     if (p)
         lua_pushlightuserdata(L, p);
     else
@@ -133,6 +143,31 @@ static int luaCreateFuncProp(lua_State *L)
 }
 
 
+/// Lua wrapper for invalidateFuncProp
+static int luaInvalidateFuncProp(lua_State *L)
+{
+    if (lua_islightuserdata(L, 1))
+        getAvionics(L)->getProps().invalidateFuncProp(
+                (SaslPropRef)lua_touserdata(L, 1));
+    return 0;
+}
+
+
+/// Returns number of getter calls and number of reads served from cache
+/// of functional property or totals of all functional properties
+static int luaGetFuncPropStats(lua_State *L)
+{
+    SaslPropRef prop = NULL;
+    if (lua_islightuserdata(L, 1))
+        prop = (SaslPropRef)lua_touserdata(L, 1);
+    unsigned long calls, avoidedCalls;
+    getAvionics(L)->getProps().getFuncPropStats(prop, calls, avoidedCalls);
+    lua_pushnumber(L, calls);
+    lua_pushnumber(L, avoidedCalls);
+    return 2;
+}
+
+
 /// Lua wrapper for freeProp
 static int luaFreeProp(lua_State *L)
 {
@@ -245,6 +280,101 @@ static int luaSetProps(lua_State *L)
 }
 
 
+/// Lua wrapper for addWatcher
+/// arguments: name of property, type, callback, epsilon
+static int luaWatchProp(lua_State *L)
+{
+    if ((! lua_isstring(L, 1)) || (! lua_isstring(L, 2)) ||
+            (! lua_isfunction(L, 3))) 
+    {
+        lua_pushnil(L);
+        return 1;
+    }
+
+    std::string name = lua_tostring(L, 1);
+    int type = getPropType(lua_tostring(L, 2));
+    double epsilon = lua_tonumber(L, 4);
+    if (-1 == type) {
+        lua_pushnil(L);
+        return 1;
+    }
+
+    Luna &lua = getAvionics(L)->getLuna();
+    lua_pushvalue(L, 3);
+    int callback = lua.addRef();
+
+    int id = getAvionics(L)->getProps().addWatcher(name, type, epsilon, 
+            callback);
+    if (id)
+        lua_pushnumber(L, id);
+    else {
+        lua.unRef(callback);
+        lua_pushnil(L);
+    }
+
+    return 1;
+}
+
+
+/// Lua wrapper for removeWatcher
+static int luaUnwatchProp(lua_State *L)
+{
+    if (lua_isnumber(L, 1))
+        getAvionics(L)->getProps().removeWatcher(lua_tointeger(L, 1));
+    return 0;
+}
+
+/// Lua wrapper for registerExprProp
+/// arguments: name, type, expression, table of variables where keys
+/// are variables names and values are tables of property reference and
+/// property type.  Returns property reference or nil and error message
+static int luaCreateExprProp(lua_State *L)
+{
+    if ((! lua_isstring(L, 1)) || (! lua_isstring(L, 2)) || 
+            (! lua_isstring(L, 3))) 
+    {
+        lua_pushnil(L);
+        lua_pushstring(L, "invalid arguments");
+        return 2;
+    }
+
+    std::string name = lua_tostring(L, 1);
+    int type = getPropType(lua_tostring(L, 2));
+    std::string expression = lua_tostring(L, 3);
+
+    std::map<std::string, ExprVar> vars;
+    if (lua_istable(L, 4)) {
+        lua_pushnil(L);
+        while (lua_next(L, 4)) {
+            if ((LUA_TSTRING == lua_type(L, -2)) && lua_istable(L, -1)) {
+                lua_rawgeti(L, -1, 1);
+                lua_rawgeti(L, -2, 2);
+                ExprVar var;
+                var.prop = lua_touserdata(L, -2);
+                var.type = lua_isstring(L, -1) ? 
+                    getPropType(lua_tostring(L, -1)) : -1;
+                lua_pop(L, 2);
+                if (var.prop && (PROP_STRING != var.type) && 
+                        (-1 != var.type))
+                    vars[lua_tostring(L, -2)] = var;
+            }
+            lua_pop(L, 1);
+        }
+    }
+
+    std::string error;
+    SaslPropRef prop = getAvionics(L)->getProps().registerExprProp(name, 
+            type, expression, vars, error);
+    if (! prop) {
+        lua_pushnil(L);
+        lua_pushstring(L, error.c_str());
+        return 2;
+    }
+    
+    lua_pushlightuserdata(L, prop);
+    return 1;
+}
+
 
 void xa::exportPropsToLua(Luna &lua)
 {
@@ -253,6 +383,8 @@ void xa::exportPropsToLua(Luna &lua)
     lua_register(L, "findProp", luaGetProp);
     lua_register(L, "createProp", luaCreateProp);
     lua_register(L, "createFuncProp", luaCreateFuncProp);
+    lua_register(L, "invalidateFuncProp", luaInvalidateFuncProp);
+    lua_register(L, "getFuncPropStats", luaGetFuncPropStats);
     lua_register(L, "freeProp", luaFreeProp);
     lua_register(L, "getPropi", luaGetPropi);
     lua_register(L, "setPropi", luaSetPropi);
@@ -262,18 +394,27 @@ void xa::exportPropsToLua(Luna &lua)
     lua_register(L, "setPropd", luaSetPropd);
     lua_register(L, "getProps", luaGetProps);
     lua_register(L, "setProps", luaSetProps);
+    lua_register(L, "watchProp", luaWatchProp);
+    lua_register(L, "unwatchProp", luaUnwatchProp);
+    lua_register(L, "createExprProp", luaCreateExprProp);
 }
 
 
-Properties::Properties(Luna &lua): lua(lua)
+Properties::Properties(Luna &lua, Log &log): lua(lua), log(log)
 {
     propsCallbacks = NULL;
     props = NULL;
+    snapshot = NULL;
+    referenced = false;
+    lastWatcherId = 0;
+    lastHistoryId = 0;
+    frame = 0;
 }
 
 
 Properties::~Properties()
 {
+    releaseRefs();
     if (propsCallbacks && propsCallbacks->props_done)
         propsCallbacks->props_done(props);
 
@@ -284,16 +425,114 @@ Properties::~Properties()
         lua.unRef(h.getter);
         lua.unRef(h.setter);
     }
+
+    for (std::vector<PropWatcher>::iterator i = watchers.begin();
+            i != watchers.end(); i++)
+        if ((*i).id)
+            lua.unRef((*i).callback);
+
+    for (std::map<int, PropHistory*>::iterator i = histories.begin();
+            i != histories.end(); i++)
+        delete (*i).second;
+
+    for (std::list<PropExpression*>::iterator i = expressions.begin();
+            i != expressions.end(); i++)
+        delete *i;
+
+    delete snapshot;
 }
 
 
 void Properties::setProps(struct SaslPropsCallbacks *callbacks, SaslProps p)
 {
+    // snapshot keeps its references valid
+    if (snapshot) {
+        snapshot->setBackend(callbacks, p);
+        return;
+    }
+
+    releaseRefs();
     if (propsCallbacks && propsCallbacks->props_done)
         propsCallbacks->props_done(props);
 
     propsCallbacks = callbacks;
     props = p;
+    resolveRefs();
+}
+
+
+int Properties::detachProps(struct SaslPropsCallbacks **callbacks, 
+        SaslProps *p)
+{
+    // backend of snapshot can't be accessed from reader thread
+    if (snapshot || (! callbacks) || (! p))
+        return -1;
+
+    releaseRefs();
+    *callbacks = propsCallbacks;
+    *p = props;
+    propsCallbacks = NULL;
+    props = NULL;
+    return 0;
+}
+
+
+void Properties::releaseRefs()
+{
+    for (std::vector<PropWatcher>::iterator i = watchers.begin();
+            i != watchers.end(); i++)
+    {
+        freeProp((*i).prop);
+        (*i).prop = NULL;
+    }
+
+    for (std::map<int, PropHistory*>::iterator i = histories.begin();
+            i != histories.end(); i++)
+    {
+        PropHistory *history = (*i).second;
+        freeProp(history->getProp());
+        history->setProp(NULL);
+    }
+}
+
+
+void Properties::resolveRefs()
+{
+    for (std::vector<PropWatcher>::iterator i = watchers.begin();
+            i != watchers.end(); i++)
+        if ((*i).id)
+            (*i).prop = getProp((*i).name, (*i).type);
+
+    for (std::map<int, PropHistory*>::iterator i = histories.begin();
+            i != histories.end(); i++)
+    {
+        PropHistory *history = (*i).second;
+        history->setProp(getProp(history->getName(), history->getType()));
+    }
+}
+
+
+int Properties::enableSnapshot()
+{
+    if (snapshot)
+        return 0;
+    if (referenced)
+        return -1;
+
+    snapshot = new PropsSnapshot();
+    snapshot->setBackend(propsCallbacks, props);
+    propsCallbacks = PropsSnapshot::getCallbacks();
+    props = snapshot;
+    return 0;
+}
+
+
+int Properties::publishSnapshot()
+{
+    if (! snapshot)
+        return -1;
+
+    return snapshot->publish();
 }
 
 
@@ -302,7 +541,10 @@ SaslPropRef Properties::getProp(const std::string &name, int type)
     if (! (propsCallbacks && props))
         return NULL;
 
-    return propsCallbacks->get_prop_ref(props, name.c_str(), type);
+    SaslPropRef prop = propsCallbacks->get_prop_ref(props, name.c_str(), type);
+    if (prop)
+        referenced = true;
+    return prop;
 }
 
 
@@ -311,7 +553,11 @@ SaslPropRef Properties::createProp(const std::string &name, int type, int maxSiz
     if (! (propsCallbacks && props))
         return NULL;
 
-    return propsCallbacks->create_prop(props, name.c_str(), type, maxSize);
+    SaslPropRef prop = propsCallbacks->create_prop(props, name.c_str(), type,
+            maxSize);
+    if (prop)
+        referenced = true;
+    return prop;
 }
 
 
@@ -470,6 +716,10 @@ int Properties::setProp(SaslPropRef prop, const std::string &value)
 
 int Properties::update()
 {
+    TRACE_SCOPE("properties update");
+
+    frame++;
+
     if (! (propsCallbacks && props))
         return 0;
 
@@ -481,52 +731,86 @@ int Properties::update()
 }
 
 
+/// Copy cached value of functional property into buffer
+/// Returns size of value
+static int copyFuncPropValue(Properties::FuncPropHandler *handler, int type,
+        void *buf, int maxSize)
+{
+    switch (type) {
+        case PROP_INT: {
+                int v = (int)handler->cachedNumber;
+                if (buf && (maxSize >= (int)sizeof(v)))
+                    memcpy(buf, &v, sizeof(v));
+                return sizeof(v);
+            }
+        case PROP_FLOAT: {
+                float v = (float)handler->cachedNumber;
+                if (buf && (maxSize >= (int)sizeof(v)))
+                    memcpy(buf, &v, sizeof(v));
+                return sizeof(v);
+            }
+        case PROP_DOUBLE: {
+                double v = handler->cachedNumber;
+                if (buf && (maxSize >= (int)sizeof(v)))
+                    memcpy(buf, &v, sizeof(v));
+                return sizeof(v);
+            }
+        case PROP_STRING: {
+                int len = handler->cachedString.length();
+                if (buf && (maxSize > len))
+                    memcpy(buf, handler->cachedString.c_str(), len + 1);
+                return len + 1;
+            }
+    }
+    return 0;
+}
+
+
 static int propGetterCallback(int type, void *buf, int maxSize, void *ref)
 {
     Properties::FuncPropHandler *handler = (Properties::FuncPropHandler*)ref;
     if (! handler)
         return 0;
 
-    Luna &lua = handler->properties->getLua();
+    Properties *properties = handler->properties;
+    if (properties->isFuncPropCached(*handler, type)) {
+        handler->avoidedCalls++;
+        return copyFuncPropValue(handler, type, buf, maxSize);
+    }
+
+    Luna &lua = properties->getLua();
     lua_State *L = lua.getLua();
     
     lua.getRef(handler->getter);
+    handler->calls++;
     
-    if (lua_pcall(L, 0, 1, 0))
+    if (lua_pcall(L, 0, 1, 0)) {
         getAvionics(L)->getLog().error(
                 "Error calling property getter: %s\n", lua_tostring(L, -1));
-    else {
-        switch (type) {
-            case PROP_INT: {
-                    int v = lua_tointeger(L, -1);
-                    if (buf && (maxSize >= (int)sizeof(v)))
-                        memcpy(buf, &v, sizeof(v));
-                    return sizeof(v);
-                }
-            case PROP_FLOAT: {
-                    float v = (float)lua_tonumber(L, -1);
-                    if (buf && (maxSize >= (int)sizeof(v)))
-                        memcpy(buf, &v, sizeof(v));
-                    return sizeof(v);
-                }
-            case PROP_DOUBLE: {
-                    double v = lua_tonumber(L, -1);
-                    if (buf && (maxSize >= (int)sizeof(v)))
-                        memcpy(buf, &v, sizeof(v));
-                    return sizeof(v);
-                }
-            case PROP_STRING: {
-                    const char *v = lua_tostring(L, -1);
-                    int len = strlen(v);
-                    if (buf && (maxSize >= (int)len))
-                        memcpy(buf, v, len + 1);
-                    return len + 1;
-                }
-        }
         lua_pop(L, 1);
+        return 0;
     }
 
-    return 0;
+    switch (type) {
+        case PROP_INT: 
+            handler->cachedNumber = lua_tointeger(L, -1);
+            break;
+        case PROP_FLOAT: 
+            handler->cachedNumber = (float)lua_tonumber(L, -1);
+            break;
+        case PROP_DOUBLE: 
+            handler->cachedNumber = lua_tonumber(L, -1);
+            break;
+        case PROP_STRING: {
+                const char *v = lua_tostring(L, -1);
+                handler->cachedString = v ? v : "";
+                break;
+            }
+    }
+    lua_pop(L, 1);
+
+    properties->cacheFuncProp(*handler, type);
+    return copyFuncPropValue(handler, type, buf, maxSize);
 }
 
 
@@ -536,6 +820,8 @@ static void propSetterCallback(int type, void *buf, int size, void *ref)
     if ((! handler) || (! buf))
         return;
 
+    handler->valid = false;
+
     Luna &lua = handler->properties->getLua();
     lua_State *L = lua.getLua();
     lua.getRef(handler->setter);
@@ -560,8 +846,99 @@ static void propSetterCallback(int type, void *buf, int size, void *ref)
                 "Error calling property setter: %s\n", lua_tostring(L, -1));
 }
 
+
+/// Returns value of derived property
+static int exprGetterCallback(int type, void *buf, int maxSize, void *ref)
+{
+    PropExpression *expression = (PropExpression*)ref;
+    if (! expression)
+        return 0;
+
+    double value = expression->getValue();
+
+    switch (type) {
+        case PROP_INT: {
+                int v = (int)value;
+                if (buf && (maxSize >= (int)sizeof(v)))
+                    memcpy(buf, &v, sizeof(v));
+                return sizeof(v);
+            }
+        case PROP_FLOAT: {
+                float v = (float)value;
+                if (buf && (maxSize >= (int)sizeof(v)))
+                    memcpy(buf, &v, sizeof(v));
+                return sizeof(v);
+            }
+        case PROP_DOUBLE: {
+                if (buf && (maxSize >= (int)sizeof(value)))
+                    memcpy(buf, &value, sizeof(value));
+                return sizeof(value);
+            }
+    }
+
+    return 0;
+}
+
+
+/// Derived properties are read only
+static void exprSetterCallback(int type, void *buf, int size, void *ref)
+{
+}
+
+
+SaslPropRef Properties::registerExprProp(const std::string &name, int type,
+        const std::string &text, const std::map<std::string, ExprVar> &vars,
+        std::string &error)
+{
+    if (! (propsCallbacks && props && propsCallbacks->create_func_prop)) {
+        error = "properties are not available";
+        return NULL;
+    }
+
+    if ((PROP_INT != type) && (PROP_FLOAT != type) && (PROP_DOUBLE != type)) {
+        error = "invalid property type";
+        return NULL;
+    }
+
+    PropExpression *expression = new PropExpression(*this);
+    if (expression->compile(text, vars)) {
+        error = expression->getError();
+        delete expression;
+        return NULL;
+    }
+    
+    SaslPropRef prop = propsCallbacks->create_func_prop(props, name.c_str(),
+            type, 0, exprGetterCallback, exprSetterCallback, expression);
+    if (! prop) {
+        error = "can't create property '" + name + "'";
+        delete expression;
+        return NULL;
+    }
+
+    expressions.push_back(expression);
+    referenced = true;
+    return prop;
+}
+
+
+SaslPropRef Properties::createFuncProp(const std::string &name, int type,
+        sasl_prop_getter_callback getter, sasl_prop_setter_callback setter,
+        void *ref)
+{
+    if (! (propsCallbacks && props && propsCallbacks->create_func_prop))
+        return NULL;
+    SaslPropRef prop = propsCallbacks->create_func_prop(props, name.c_str(),
+            type, 0, getter, setter, ref);
+    if (prop)
+        referenced = true;
+    else if (snapshot)
+        log.error("Can't create functional property '%s'", name.c_str());
+    return prop;
+}
+
+
 SaslPropRef Properties::registerFuncProp(const std::string &name, int type, 
-        int maxSize, int getter, int setter)
+        int maxSize, int getter, int setter, int cache, long ttl)
 {
     if (! (propsCallbacks && props))
         return 0;
@@ -570,12 +947,77 @@ SaslPropRef Properties::registerFuncProp(const std::string &name, int type,
     handler.properties = this;
     handler.getter = getter;
     handler.setter = setter;
+    handler.prop = NULL;
+    handler.cache = cache;
+    handler.ttl = ttl;
+    handler.valid = false;
+    handler.cachedType = 0;
+    handler.cachedFrame = 0;
+    handler.cachedTime = 0;
+    handler.cachedNumber = 0;
+    handler.calls = 0;
+    handler.avoidedCalls = 0;
 
     funcProps.push_back(handler);
 
-    return propsCallbacks->create_func_prop(props, name.c_str(),
+    SaslPropRef prop = propsCallbacks->create_func_prop(props, name.c_str(),
             type, maxSize, propGetterCallback, propSetterCallback, 
             &(funcProps.back()));
+    funcProps.back().prop = prop;
+    if (prop)
+        referenced = true;
+    else
+        log.error("Can't create functional property '%s'", name.c_str());
+    return prop;
+}
+
+
+void Properties::invalidateFuncProp(SaslPropRef prop)
+{
+    for (std::list<FuncPropHandler>::iterator i = funcProps.begin(); 
+            i != funcProps.end(); i++)
+        if ((*i).prop == prop)
+            (*i).valid = false;
+}
+
+
+bool Properties::isFuncPropCached(FuncPropHandler &handler, int type)
+{
+    if ((! handler.valid) || (handler.cachedType != type))
+        return false;
+
+    switch (handler.cache) {
+        case FUNC_CACHE_FRAME: return handler.cachedFrame == frame;
+        case FUNC_CACHE_TTL: return timer.getTime() - handler.cachedTime < 
+                             handler.ttl;
+        case FUNC_CACHE_MANUAL: return true;
+        default: return false;
+    }
+}
+
+
+void Properties::cacheFuncProp(FuncPropHandler &handler, int type)
+{
+    handler.valid = true;
+    handler.cachedType = type;
+    handler.cachedFrame = frame;
+    if (FUNC_CACHE_TTL == handler.cache)
+        handler.cachedTime = timer.getTime();
+}
+
+
+void Properties::getFuncPropStats(SaslPropRef prop, unsigned long &calls,
+        unsigned long &avoidedCalls)
+{
+    calls = avoidedCalls = 0;
+    for (std::list<FuncPropHandler>::iterator i = funcProps.begin(); 
+            i != funcProps.end(); i++)
+    {
+        if (prop && ((*i).prop != prop))
+            continue;
+        calls += (*i).calls;
+        avoidedCalls += (*i).avoidedCalls;
+    }
 }
 
 
@@ -594,3 +1036,191 @@ void Properties::destroyFuncProp(FuncPropHandler *handler)
     }
 }
 
+
+
+/// Read value of watched property.
+/// Returns non-zero on errors
+static int readWatched(Properties &properties, 
+        const Properties::PropWatcher &watcher, double &value, 
+        std::string &str)
+{
+    if (! watcher.prop)
+        return -1;
+
+    int err = 0;
+    switch (watcher.type) {
+        case PROP_INT: 
+            value = properties.getPropi(watcher.prop, 0, &err); 
+            break;
+        case PROP_FLOAT: 
+            value = properties.getPropf(watcher.prop, 0, &err); 
+            break;
+        case PROP_DOUBLE: 
+            value = properties.getPropd(watcher.prop, 0, &err); 
+            break;
+        case PROP_STRING: 
+            str = properties.getProps(watcher.prop, "", &err); 
+            break;
+        default:
+            err = -1;
+    }
+    return err;
+}
+
+
+int Properties::addWatcher(const std::string &name, int type, 
+        double epsilon, int callback)
+{
+    SaslPropRef prop = getProp(name, type);
+    if (! prop)
+        return 0;
+
+    PropWatcher watcher;
+    watcher.id = ++lastWatcherId;
+    watcher.name = name;
+    watcher.prop = prop;
+    watcher.type = type;
+    watcher.epsilon = fabs(epsilon);
+    watcher.callback = callback;
+    watcher.lastValue = 0;
+    readWatched(*this, watcher, watcher.lastValue, watcher.lastString);
+
+    watchers.push_back(watcher);
+    return watcher.id;
+}
+
+
+void Properties::removeWatcher(int id)
+{
+    // watcher is erased on next check because callbacks may remove 
+    // watchers while they are iterated
+    for (std::vector<PropWatcher>::iterator i = watchers.begin();
+            i != watchers.end(); i++)
+    {
+        PropWatcher &w = *i;
+        if (w.id == id) {
+            lua.unRef(w.callback);
+            freeProp(w.prop);
+            w.prop = NULL;
+            w.id = 0;
+            break;
+        }
+    }
+}
+
+
+void Properties::notifyWatchers()
+{
+    if (watchers.empty())
+        return;
+
+    // compact removed watchers
+    size_t last = 0;
+    for (size_t i = 0; i < watchers.size(); i++)
+        if (watchers[i].id) {
+            if (last != i)
+                watchers[last] = watchers[i];
+            last++;
+        }
+    watchers.resize(last);
+
+    // find changed properties without calling Lua
+    changes.clear();
+    double value;
+    std::string str;
+    for (size_t i = 0; i < watchers.size(); i++) {
+        PropWatcher &w = watchers[i];
+        if (readWatched(*this, w, value, str))
+            continue;
+
+        if (PROP_STRING == w.type) {
+            if (str == w.lastString)
+                continue;
+            changes.push_back(PropChange());
+            PropChange &change = changes.back();
+            change.watcher = i;
+            change.oldString.swap(w.lastString);
+            w.lastString.swap(str);
+        } else {
+            if (w.epsilon ? (fabs(value - w.lastValue) <= w.epsilon) : 
+                    (value == w.lastValue))
+                continue;
+            changes.push_back(PropChange());
+            PropChange &change = changes.back();
+            change.watcher = i;
+            change.oldValue = w.lastValue;
+            w.lastValue = value;
+        }
+    }
+
+    // call callbacks of changed properties
+    lua_State *L = lua.getLua();
+    for (std::vector<PropChange>::iterator i = changes.begin(); 
+            i != changes.end(); i++)
+    {
+        PropChange &change = *i;
+        PropWatcher &w = watchers[change.watcher];
+        if (! w.id)
+            continue;
+
+        lua.getRef(w.callback);
+        if (PROP_STRING == w.type) {
+            lua_pushstring(L, w.lastString.c_str());
+            lua_pushstring(L, change.oldString.c_str());
+        } else {
+            lua_pushnumber(L, w.lastValue);
+            lua_pushnumber(L, change.oldValue);
+        }
+        if (lua_pcall(L, 2, 0, 0)) {
+            getAvionics(L)->getLog().error(
+                    "Error calling property change handler: %s", 
+                    lua_tostring(L, -1));
+            lua_pop(L, 1);
+        }
+    }
+}
+
+
+int Properties::createHistory(const std::string &name, int type, 
+        int capacity, double rate)
+{
+    if ((1 > capacity) || (PROP_STRING == type))
+        return 0;
+
+    SaslPropRef prop = getProp(name, type);
+    if (! prop)
+        return 0;
+
+    int id = ++lastHistoryId;
+    histories[id] = new PropHistory(name, prop, type, capacity, rate);
+    return id;
+}
+
+
+void Properties::destroyHistory(int id)
+{
+    std::map<int, PropHistory*>::iterator i = histories.find(id);
+    if (i != histories.end()) {
+        freeProp((*i).second->getProp());
+        delete (*i).second;
+        histories.erase(i);
+    }
+}
+
+
+PropHistory* Properties::getHistory(int id)
+{
+    std::map<int, PropHistory*>::iterator i = histories.find(id);
+    if (i == histories.end())
+        return NULL;
+    return (*i).second;
+}
+
+
+void Properties::updateHistories(double now)
+{
+    for (std::map<int, PropHistory*>::iterator i = histories.begin();
+            i != histories.end(); i++)
+        (*i).second->update(*this, now);
+}
+
@@ -5,8 +5,14 @@
 #include "libavcallbacks.h"
 #include <string>
 #include <list>
+#include <vector>
+#include <map>
 #include "luna.h"
 #include "log.h"
+#include "propsnapshot.h"
+#include "prophistory.h"
+#include "propexpr.h"
+#include "rttimer.h"
 
 
 namespace xa {
@@ -19,13 +25,37 @@ class Properties
         /// Reference to Lua
         Luna &lua;
 
+        /// Logger
+        Log &log;
+
         /// Pluggable properties module callbacks
         struct SaslPropsCallbacks *propsCallbacks;
 
         /// Pointer to properties subsystem
         SaslProps props;
 
+        /// Properties snapshot or NULL if properties are accessed directly
+        PropsSnapshot *snapshot;
+
+        /// True if any property reference was obtained from backend
+        bool referenced;
+
     public:
+        /// Caching policies of functional properties
+        enum FuncPropCache {
+            /// call getter on every read
+            FUNC_CACHE_NONE,
+
+            /// call getter at most once per frame
+            FUNC_CACHE_FRAME,
+
+            /// call getter at most once per time-to-live period
+            FUNC_CACHE_TTL,
+
+            /// call getter only after explicit invalidation
+            FUNC_CACHE_MANUAL
+        };
+
         /// stpres references to property callbacks
         struct FuncPropHandler{
             /// reference to properties
@@ -36,14 +66,110 @@ class Properties
 
             /// Lua reference to setter func
             int setter;
+
+            /// reference to property
+            SaslPropRef prop;
+
+            /// caching policy
+            int cache;
+
+            /// time-to-live of cached value in milliseconds
+            long ttl;
+
+            /// true if cached value was set
+            bool valid;
+
+            /// type of cached value
+            int cachedType;
+
+            /// frame when value was cached
+            long cachedFrame;
+
+            /// time when value was cached
+            long cachedTime;
+
+            /// cached numeric value
+            double cachedNumber;
+
+            /// cached string value
+            std::string cachedString;
+
+            /// number of getter calls
+            unsigned long calls;
+
+            /// number of reads served from cache
+            unsigned long avoidedCalls;
+        };
+
+        /// Lua callback called on property value change
+        struct PropWatcher {
+            /// watcher ID or 0 if watcher was removed
+            int id;
+
+            /// name of watched property
+            std::string name;
+
+            /// watched property or NULL if it isn't found in backend
+            SaslPropRef prop;
+
+            /// type of property
+            int type;
+
+            /// minimal change of numeric value to report
+            double epsilon;
+
+            /// Lua reference to callback
+            int callback;
+
+            /// last reported value of numeric property
+            double lastValue;
+
+            /// last reported value of string property
+            std::string lastString;
+        };
+
+        /// Value change of watched property
+        struct PropChange {
+            /// index of watcher
+            size_t watcher;
+
+            /// previous value of numeric property
+            double oldValue;
+
+            /// previous value of string property
+            std::string oldString;
         };
 
     private:
         /// list of registered func props
         std::list<FuncPropHandler> funcProps;
 
+        /// registered properties watchers
+        std::vector<PropWatcher> watchers;
+
+        /// changes detected during last watchers check
+        std::vector<PropChange> changes;
+
+        /// ID of last registered watcher
+        int lastWatcherId;
+
+        /// Properties histories by IDs
+        std::map<int, PropHistory*> histories;
+
+        /// ID of last created history
+        int lastHistoryId;
+
+        /// Expressions of derived properties
+        std::list<PropExpression*> expressions;
+
+        /// Number of updates since creation
+        long frame;
+
+        /// Timer for cached functional properties
+        RtTimer timer;
+
     public:
-        Properties(Luna &lua);
+        Properties(Luna &lua, Log &log);
 
         ~Properties();
 
@@ -94,17 +220,120 @@ class Properties
         int update();
 
         /// register functional property
+        /// \param cache caching policy of getter results
+        /// \param ttl time-to-live of cached value for FUNC_CACHE_TTL policy
         SaslPropRef registerFuncProp(const std::string &name, int type, 
-                int maxSize, int getter, int setter);
+                int maxSize, int getter, int setter, 
+                int cache=FUNC_CACHE_NONE, long ttl=0);
+
+        /// Drop cached value of functional property
+        void invalidateFuncProp(SaslPropRef prop);
+
+        /// Returns true if cached value of functional property
+        /// can be used
+        bool isFuncPropCached(FuncPropHandler &handler, int type);
+
+        /// Remember value of functional property
+        void cacheFuncProp(FuncPropHandler &handler, int type);
+
+        /// Returns numbers of getter calls and reads served from cache.
+        /// Returns totals for all functional properties if prop is NULL.
+        void getFuncPropStats(SaslPropRef prop, unsigned long &calls,
+                unsigned long &avoidedCalls);
        
         /// remove property handler from list and unref callbacks
         void destroyFuncProp(FuncPropHandler *handler);
 
         /// Returns Lua wrapper
         Luna& getLua() { return lua; };
+
+        /// Register Lua callback called when value of property changes.
+        /// Numeric values are considered changed if they differ more
+        /// than epsilon from last reported value.  Watcher references
+        /// property by name, so it survives change of backend.
+        /// Returns watcher ID or 0 on errors.
+        int addWatcher(const std::string &name, int type, double epsilon, 
+                int callback);
+
+        /// Unregister property watcher and unref its callback
+        void removeWatcher(int id);
+
+        /// Compare watched properties against last reported values and 
+        /// call callbacks of changed ones.  Called once per frame.
+        void notifyWatchers();
+
+        /// Attach history ring buffer to numeric property.
+        /// Returns history ID or 0 on errors.
+        /// \param name name of property to sample
+        /// \param type type of property
+        /// \param capacity maximum number of samples
+        /// \param rate samples per second or 0 to sample every frame
+        int createHistory(const std::string &name, int type, int capacity, 
+                double rate);
+
+        /// Destroy property history
+        void destroyHistory(int id);
+
+        /// Returns property history or NULL if not found
+        PropHistory* getHistory(int id);
+
+        /// Sample properties histories
+        /// \param now current time in milliseconds
+        void updateHistories(double now);
+
+        /// Register property which value is calculated from expression
+        /// over other properties.  Expression is evaluated natively at
+        /// most once per frame.  Returns NULL on errors.
+        /// \param name name of property
+        /// \param type type of property, string properties are not supported
+        /// \param expression text of expression
+        /// \param vars properties referenced by variables names
+        /// \param error filled with error message on errors
+        SaslPropRef registerExprProp(const std::string &name, int type,
+                const std::string &expression, 
+                const std::map<std::string, ExprVar> &vars,
+                std::string &error);
+
+        /// Create functional property served by native callbacks.
+        /// Returns NULL if backend doesn't support functional properties.
+        SaslPropRef createFuncProp(const std::string &name, int type,
+                sasl_prop_getter_callback getter,
+                sasl_prop_setter_callback setter, void *ref);
+
+        /// Returns number of current frame
+        long getFrame() const { return frame; }
+
+        /// Returns current properties backend and forgets it without
+        /// destroying, so backend can be wrapped and installed again.
+        /// Returns zero on success.
+        int detachProps(struct SaslPropsCallbacks **callbacks, 
+                SaslProps *props);
+
+        /// Free references of watchers and histories.  Called before
+        /// backend is destroyed or detached.
+        void releaseRefs();
+
+        /// Look up properties of watchers and histories in new backend
+        void resolveRefs();
+
+        /// Serve properties from snapshot published by publishSnapshot().
+        /// Returns zero on success or -1 if some property was referenced
+        /// already, such references can't be served by snapshot.
+        int enableSnapshot();
+
+        /// Returns true if properties are served from snapshot
+        bool isSnapshotEnabled() const { return NULL != snapshot; }
+
+        /// Publish values of properties to snapshot.
+        /// Returns zero on success.
+        int publishSnapshot();
 };
 
 
+/// Convert type name to type constant.
+/// Returns -1 on errors
+int getPropType(const std::string &propType);
+
 /// Register properties in Lua
 void exportPropsToLua(Luna &lua);
 
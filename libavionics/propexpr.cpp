@@ -0,0 +1,456 @@
+#include "propexpr.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "properties.h"
+
+
+using namespace xa;
+
+
+/// Expression bytecode operations
+enum {
+    OP_CONST,
+    OP_VAR,
+    OP_ADD,
+    OP_SUB,
+    OP_MUL,
+    OP_DIV,
+    OP_MOD,
+    OP_POW,
+    OP_NEG,
+    OP_NOT,
+    OP_LT,
+    OP_LE,
+    OP_GT,
+    OP_GE,
+    OP_EQ,
+    OP_NE,
+    OP_AND,
+    OP_OR,
+    OP_ABS,
+    OP_MIN,
+    OP_MAX,
+    OP_CLAMP,
+    OP_FLOOR,
+    OP_CEIL,
+    OP_SQRT,
+    OP_SIN,
+    OP_COS,
+    OP_TAN,
+    OP_ATAN2,
+    OP_IF
+};
+
+
+/// Function available in expressions
+struct ExprFunction
+{
+    /// name of function
+    const char *name;
+
+    /// number of arguments
+    int argc;
+
+    /// operation code
+    int op;
+};
+
+
+/// Functions available in expressions
+static const ExprFunction functions[] = {
+    { "abs", 1, OP_ABS },
+    { "min", 2, OP_MIN },
+    { "max", 2, OP_MAX },
+    { "clamp", 3, OP_CLAMP },
+    { "floor", 1, OP_FLOOR },
+    { "ceil", 1, OP_CEIL },
+    { "sqrt", 1, OP_SQRT },
+    { "sin", 1, OP_SIN },
+    { "cos", 1, OP_COS },
+    { "tan", 1, OP_TAN },
+    { "atan2", 2, OP_ATAN2 },
+    { "if", 3, OP_IF },
+    { NULL, 0, 0 }
+};
+
+
+PropExpression::PropExpression(Properties &properties):
+    properties(properties)
+{
+    depth = 0;
+    cachedFrame = -1;
+    cachedValue = 0;
+    evaluating = false;
+    pos = text = NULL;
+    knownVars = NULL;
+}
+
+
+int PropExpression::compile(const std::string &expression,
+        const std::map<std::string, ExprVar> &variables)
+{
+    code.clear();
+    constants.clear();
+    vars.clear();
+    stack.clear();
+    error.clear();
+    depth = 0;
+    cachedFrame = -1;
+
+    knownVars = &variables;
+    text = pos = expression.c_str();
+
+    parseOr();
+    skipSpaces();
+    if (*pos)
+        setError("unexpected symbol");
+
+    knownVars = NULL;
+    pos = text = NULL;
+
+    if (! error.empty()) {
+        code.clear();
+        return -1;
+    }
+    return 0;
+}
+
+
+void PropExpression::emit(int op, int arg, int stackChange)
+{
+    Instruction i;
+    i.op = op;
+    i.arg = arg;
+    code.push_back(i);
+
+    depth += stackChange;
+    if (depth > (int)stack.size())
+        stack.resize(depth);
+}
+
+
+void PropExpression::setError(const std::string &message)
+{
+    if (! error.empty())
+        return;
+    char buf[32];
+    sprintf(buf, " at position %i", (int)(pos - text) + 1);
+    error = message + buf;
+}
+
+
+void PropExpression::skipSpaces()
+{
+    while (isspace(*pos))
+        pos++;
+}
+
+
+bool PropExpression::accept(const char *token)
+{
+    skipSpaces();
+    size_t len = strlen(token);
+    if (strncmp(pos, token, len))
+        return false;
+    pos += len;
+    return true;
+}
+
+
+bool PropExpression::acceptWord(const char *word)
+{
+    skipSpaces();
+    size_t len = strlen(word);
+    if (strncmp(pos, word, len) || isalnum(pos[len]) || ('_' == pos[len]))
+        return false;
+    pos += len;
+    return true;
+}
+
+
+void PropExpression::parseOr()
+{
+    parseAnd();
+    while (error.empty() && (acceptWord("or") || accept("||"))) {
+        parseAnd();
+        emit(OP_OR, 0, -1);
+    }
+}
+
+
+void PropExpression::parseAnd()
+{
+    parseCompare();
+    while (error.empty() && (acceptWord("and") || accept("&&"))) {
+        parseCompare();
+        emit(OP_AND, 0, -1);
+    }
+}
+
+
+void PropExpression::parseCompare()
+{
+    parseSum();
+    while (error.empty()) {
+        int op;
+        if (accept("<="))
+            op = OP_LE;
+        else if (accept(">="))
+            op = OP_GE;
+        else if (accept("=="))
+            op = OP_EQ;
+        else if (accept("~=") || accept("!="))
+            op = OP_NE;
+        else if (accept("<"))
+            op = OP_LT;
+        else if (accept(">"))
+            op = OP_GT;
+        else
+            break;
+        parseSum();
+        emit(op, 0, -1);
+    }
+}
+
+
+void PropExpression::parseSum()
+{
+    parseProduct();
+    while (error.empty()) {
+        int op;
+        if (accept("+"))
+            op = OP_ADD;
+        else if (accept("-"))
+            op = OP_SUB;
+        else
+            break;
+        parseProduct();
+        emit(op, 0, -1);
+    }
+}
+
+
+void PropExpression::parseProduct()
+{
+    parseUnary();
+    while (error.empty()) {
+        int op;
+        if (accept("*"))
+            op = OP_MUL;
+        else if (accept("/"))
+            op = OP_DIV;
+        else if (accept("%"))
+            op = OP_MOD;
+        else
+            break;
+        parseUnary();
+        emit(op, 0, -1);
+    }
+}
+
+
+void PropExpression::parseUnary()
+{
+    if (accept("-")) {
+        parseUnary();
+        emit(OP_NEG, 0, 0);
+    } else if (accept("+"))
+        parseUnary();
+    else if (acceptWord("not") || (accept("!"))) {
+        parseUnary();
+        emit(OP_NOT, 0, 0);
+    } else
+        parsePower();
+}
+
+
+void PropExpression::parsePower()
+{
+    parsePrimary();
+    if (error.empty() && accept("^")) {
+        // right associative and binds tighter than unary minus on the left
+        parseUnary();
+        emit(OP_POW, 0, -1);
+    }
+}
+
+
+void PropExpression::parsePrimary()
+{
+    skipSpaces();
+
+    if (isdigit(*pos) || (('.' == *pos) && isdigit(pos[1]))) {
+        char *end;
+        double value = strtod(pos, &end);
+        pos = end;
+        constants.push_back(value);
+        emit(OP_CONST, constants.size() - 1, 1);
+        return;
+    }
+
+    if (isalpha(*pos) || ('_' == *pos)) {
+        const char *start = pos;
+        while (isalnum(*pos) || ('_' == *pos))
+            pos++;
+        std::string name(start, pos - start);
+
+        if (accept("(")) {
+            parseCall(name);
+            return;
+        }
+
+        std::map<std::string, ExprVar>::const_iterator i =
+            knownVars->find(name);
+        if (i == knownVars->end()) {
+            pos = start;
+            setError("unknown variable '" + name + "'");
+            return;
+        }
+
+        // reuse slot if variable is used more than once
+        int index = -1;
+        for (size_t j = 0; j < vars.size(); j++)
+            if (vars[j].prop == (*i).second.prop)
+                index = j;
+        if (-1 == index) {
+            vars.push_back((*i).second);
+            index = vars.size() - 1;
+        }
+        emit(OP_VAR, index, 1);
+        return;
+    }
+
+    if (accept("(")) {
+        parseOr();
+        if (error.empty() && (! accept(")")))
+            setError("')' expected");
+        return;
+    }
+
+    setError("value expected");
+}
+
+
+void PropExpression::parseCall(const std::string &name)
+{
+    const ExprFunction *func = NULL;
+    for (const ExprFunction *f = functions; f->name; f++)
+        if (name == f->name)
+            func = f;
+    if (! func) {
+        setError("unknown function '" + name + "'");
+        return;
+    }
+
+    for (int i = 0; i < func->argc; i++) {
+        if (i && (! accept(","))) {
+            setError("',' expected");
+            return;
+        }
+        parseOr();
+        if (! error.empty())
+            return;
+    }
+    if (! accept(")")) {
+        setError("')' expected");
+        return;
+    }
+
+    emit(func->op, 0, 1 - func->argc);
+}
+
+
+double PropExpression::evaluate()
+{
+    if (code.empty())
+        return 0;
+
+    double *s = &stack[0] - 1;
+    for (std::vector<Instruction>::const_iterator i = code.begin();
+            i != code.end(); i++)
+    {
+        switch ((*i).op) {
+            case OP_CONST:
+                *(++s) = constants[(*i).arg];
+                break;
+            case OP_VAR: {
+                    const ExprVar &v = vars[(*i).arg];
+                    double value;
+                    switch (v.type) {
+                        case PROP_INT:
+                            value = properties.getPropi(v.prop);
+                            break;
+                        case PROP_FLOAT:
+                            value = properties.getPropf(v.prop);
+                            break;
+                        case PROP_DOUBLE:
+                            value = properties.getPropd(v.prop);
+                            break;
+                        default:
+                            value = 0;
+                    }
+                    *(++s) = value;
+                    break;
+                }
+            case OP_ADD: s--; s[0] = s[0] + s[1]; break;
+            case OP_SUB: s--; s[0] = s[0] - s[1]; break;
+            case OP_MUL: s--; s[0] = s[0] * s[1]; break;
+            case OP_DIV: s--; s[0] = s[0] / s[1]; break;
+            case OP_MOD: s--; s[0] = s[0] - floor(s[0] / s[1]) * s[1]; break;
+            case OP_POW: s--; s[0] = pow(s[0], s[1]); break;
+            case OP_NEG: s[0] = -s[0]; break;
+            case OP_NOT: s[0] = (0 == s[0]) ? 1 : 0; break;
+            case OP_LT: s--; s[0] = (s[0] < s[1]) ? 1 : 0; break;
+            case OP_LE: s--; s[0] = (s[0] <= s[1]) ? 1 : 0; break;
+            case OP_GT: s--; s[0] = (s[0] > s[1]) ? 1 : 0; break;
+            case OP_GE: s--; s[0] = (s[0] >= s[1]) ? 1 : 0; break;
+            case OP_EQ: s--; s[0] = (s[0] == s[1]) ? 1 : 0; break;
+            case OP_NE: s--; s[0] = (s[0] != s[1]) ? 1 : 0; break;
+            case OP_AND: s--; s[0] = ((0 != s[0]) && (0 != s[1])) ? 1 : 0; break;
+            case OP_OR: s--; s[0] = ((0 != s[0]) || (0 != s[1])) ? 1 : 0; break;
+            case OP_ABS: s[0] = fabs(s[0]); break;
+            case OP_MIN: s--; s[0] = (s[1] < s[0]) ? s[1] : s[0]; break;
+            case OP_MAX: s--; s[0] = (s[1] > s[0]) ? s[1] : s[0]; break;
+            case OP_CLAMP:
+                s -= 2;
+                if (s[0] < s[1])
+                    s[0] = s[1];
+                else if (s[0] > s[2])
+                    s[0] = s[2];
+                break;
+            case OP_FLOOR: s[0] = floor(s[0]); break;
+            case OP_CEIL: s[0] = ceil(s[0]); break;
+            case OP_SQRT: s[0] = sqrt(s[0]); break;
+            case OP_SIN: s[0] = sin(s[0]); break;
+            case OP_COS: s[0] = cos(s[0]); break;
+            case OP_TAN: s[0] = tan(s[0]); break;
+            case OP_ATAN2: s--; s[0] = atan2(s[0], s[1]); break;
+            case OP_IF: s -= 2; s[0] = (0 != s[0]) ? s[1] : s[2]; break;
+        }
+    }
+
+    return s[0];
+}
+
+
+double PropExpression::getValue()
+{
+    // expression which depends on itself sees its previous value
+    if (evaluating)
+        return cachedValue;
+
+    long frame = properties.getFrame();
+    if (frame == cachedFrame)
+        return cachedValue;
+
+    evaluating = true;
+    cachedValue = evaluate();
+    cachedFrame = frame;
+    evaluating = false;
+
+    return cachedValue;
+}
+
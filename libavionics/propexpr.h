@@ -0,0 +1,154 @@
+#ifndef __PROP_EXPR_H__
+#define __PROP_EXPR_H__
+
+
+#include <string>
+#include <vector>
+#include <map>
+#include "libavcallbacks.h"
+
+
+namespace xa {
+
+
+class Properties;
+
+
+/// Property used as variable of expression
+struct ExprVar
+{
+    /// Reference to property
+    SaslPropRef prop;
+
+    /// Type of property
+    int type;
+};
+
+
+/// Arithmetic expression over properties values compiled into stack
+/// bytecode.  Supports numbers, variables, + - * / % ^, comparisons
+/// (< <= > >= == ~= !=), and, or, not, parentheses and functions
+/// abs, min, max, clamp, floor, ceil, sqrt, sin, cos, tan, atan2, if.
+/// Value is evaluated lazily at most once per frame.
+class PropExpression
+{
+    private:
+        /// Bytecode instruction
+        struct Instruction {
+            /// operation code
+            int op;
+
+            /// index of constant or variable
+            int arg;
+        };
+
+        /// Properties subsystem
+        Properties &properties;
+
+        /// Compiled code
+        std::vector<Instruction> code;
+
+        /// Constants used by code
+        std::vector<double> constants;
+
+        /// Variables used by code
+        std::vector<ExprVar> vars;
+
+        /// Evaluation stack
+        std::vector<double> stack;
+
+        /// Current stack depth during compilation
+        int depth;
+
+        /// Frame of cached value or -1 if there is no cached value
+        long cachedFrame;
+
+        /// Last calculated value
+        double cachedValue;
+
+        /// True while expression is evaluated
+        bool evaluating;
+
+        /// Current parser position
+        const char *pos;
+
+        /// Beginning of parsed text
+        const char *text;
+
+        /// Known variables during compilation
+        const std::map<std::string, ExprVar> *knownVars;
+
+        /// Compilation error or empty string
+        std::string error;
+
+    public:
+        /// Create empty expression
+        PropExpression(Properties &properties);
+
+    public:
+        /// Compile expression.
+        /// Returns zero on success or non-zero on errors
+        /// \param expression text of expression
+        /// \param vars properties referenced by variables names
+        int compile(const std::string &expression,
+                const std::map<std::string, ExprVar> &vars);
+
+        /// Returns compilation error message
+        const std::string& getError() const { return error; }
+
+        /// Returns value of expression calculated at most once per frame
+        double getValue();
+
+        /// Calculate value of expression
+        double evaluate();
+
+    private:
+        /// Append instruction to code
+        void emit(int op, int arg, int stackChange);
+
+        /// Skip whitespaces
+        void skipSpaces();
+
+        /// Skip token if it is next in text
+        bool accept(const char *token);
+
+        /// Skip keyword if it is next in text
+        bool acceptWord(const char *word);
+
+        /// Set error message if not set yet
+        void setError(const std::string &message);
+
+        /// Parse or expression
+        void parseOr();
+
+        /// Parse and expression
+        void parseAnd();
+
+        /// Parse comparison
+        void parseCompare();
+
+        /// Parse addition and subtraction
+        void parseSum();
+
+        /// Parse multiplication, division and modulo
+        void parseProduct();
+
+        /// Parse unary operators
+        void parseUnary();
+
+        /// Parse power operator
+        void parsePower();
+
+        /// Parse number, variable, function call or parentheses
+        void parsePrimary();
+
+        /// Parse function call arguments and emit call
+        void parseCall(const std::string &name);
+};
+
+
+};
+
+
+#endif
+
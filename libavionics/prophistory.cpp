@@ -0,0 +1,289 @@
+#include "prophistory.h"
+
+#include "avionics.h"
+
+
+using namespace xa;
+
+
+PropHistory::PropHistory(const std::string &name, SaslPropRef prop, 
+        int type, int capacity, double rate): name(name), prop(prop), 
+    type(type), values(capacity), times(capacity)
+{
+    period = (0 < rate) ? 1000.0 / rate : 0;
+    nextSample = 0;
+    clear();
+}
+
+
+void PropHistory::clear()
+{
+    latest = values.size() - 1;
+    count = 0;
+}
+
+
+size_t PropHistory::getIndex(size_t n) const
+{
+    size_t capacity = values.size();
+    return (latest + capacity - n) % capacity;
+}
+
+
+void PropHistory::add(double value, double time)
+{
+    latest = (latest + 1) % values.size();
+    if (count < values.size())
+        count++;
+    values[latest] = value;
+    times[latest] = time;
+}
+
+
+void PropHistory::update(Properties &properties, double now)
+{
+    if (! prop)
+        return;
+
+    if (period) {
+        if (now < nextSample)
+            return;
+        nextSample += period;
+        // don't try to catch up after long pauses
+        if (nextSample <= now)
+            nextSample = now + period;
+    }
+
+    int err = 0;
+    double value;
+    switch (type) {
+        case PROP_INT: value = properties.getPropi(prop, 0, &err); break;
+        case PROP_FLOAT: value = properties.getPropf(prop, 0, &err); break;
+        case PROP_DOUBLE: value = properties.getPropd(prop, 0, &err); break;
+        default: return;
+    }
+
+    if (! err)
+        add(value, now);
+}
+
+
+bool PropHistory::getAgo(size_t n, double &value) const
+{
+    if (n >= count)
+        return false;
+    value = values[getIndex(n)];
+    return true;
+}
+
+
+bool PropHistory::getStats(size_t window, double &min, double &max, 
+        double &mean) const
+{
+    if (! count)
+        return false;
+    if ((! window) || (window > count))
+        window = count;
+
+    double windowSum = 0;
+    min = max = values[latest];
+    for (size_t i = 0; i < window; i++) {
+        double v = values[getIndex(i)];
+        if (v < min)
+            min = v;
+        if (v > max)
+            max = v;
+        windowSum += v;
+    }
+    mean = windowSum / window;
+    return true;
+}
+
+
+bool PropHistory::getDerivative(size_t window, double &derivative) const
+{
+    if (2 > count)
+        return false;
+    if ((2 > window) || (window > count))
+        window = count;
+
+    size_t first = getIndex(window - 1);
+    double dt = times[latest] - times[first];
+    if (0 >= dt)
+        return false;
+    derivative = (values[latest] - values[first]) * 1000.0 / dt;
+    return true;
+}
+
+
+
+/// Returns history by ID passed as first argument or NULL
+static PropHistory* getHistory(lua_State *L)
+{
+    if (! lua_isnumber(L, 1))
+        return NULL;
+    return getAvionics(L)->getProps().getHistory(lua_tointeger(L, 1));
+}
+
+
+/// Lua wrapper for createHistory
+/// arguments: name of property, type, capacity, samples per second
+static int luaCreatePropHistory(lua_State *L)
+{
+    if ((! lua_isstring(L, 1)) || (! lua_isstring(L, 2)) ||
+            (! lua_isnumber(L, 3)))
+    {
+        lua_pushnil(L);
+        return 1;
+    }
+
+    int type = getPropType(lua_tostring(L, 2));
+    int capacity = lua_tointeger(L, 3);
+    if ((-1 == type) || (PROP_STRING == type) || (1 > capacity)) {
+        lua_pushnil(L);
+        return 1;
+    }
+
+    int id = getAvionics(L)->getProps().createHistory(
+            lua_tostring(L, 1), type, capacity, 
+            lua_tonumber(L, 4));
+    if (id)
+        lua_pushnumber(L, id);
+    else
+        lua_pushnil(L);
+    return 1;
+}
+
+
+/// Lua wrapper for destroyHistory
+static int luaDestroyPropHistory(lua_State *L)
+{
+    if (lua_isnumber(L, 1))
+        getAvionics(L)->getProps().destroyHistory(lua_tointeger(L, 1));
+    return 0;
+}
+
+
+/// Lua wrapper for clear
+static int luaClearPropHistory(lua_State *L)
+{
+    PropHistory *history = getHistory(L);
+    if (history)
+        history->clear();
+    return 0;
+}
+
+
+/// Returns number of samples in history
+static int luaGetPropHistorySize(lua_State *L)
+{
+    PropHistory *history = getHistory(L);
+    lua_pushnumber(L, history ? history->getCount() : 0);
+    return 1;
+}
+
+
+/// Returns value sampled n samples ago or nil
+static int luaGetPropHistoryAgo(lua_State *L)
+{
+    PropHistory *history = getHistory(L);
+    double value;
+    if (history && history->getAgo(lua_tointeger(L, 2), value))
+        lua_pushnumber(L, value);
+    else
+        lua_pushnil(L);
+    return 1;
+}
+
+
+/// Returns minimum, maximum and mean of last samples or nil
+static int luaGetPropHistoryStats(lua_State *L)
+{
+    PropHistory *history = getHistory(L);
+    double min, max, mean;
+    if (! (history && history->getStats(lua_tointeger(L, 2), min, max, mean))) {
+        lua_pushnil(L);
+        return 1;
+    }
+    lua_pushnumber(L, min);
+    lua_pushnumber(L, max);
+    lua_pushnumber(L, mean);
+    return 3;
+}
+
+
+/// Returns change of value per second or nil
+static int luaGetPropHistoryDerivative(lua_State *L)
+{
+    PropHistory *history = getHistory(L);
+    double derivative;
+    if (history && history->getDerivative(lua_tointeger(L, 2), derivative))
+        lua_pushnumber(L, derivative);
+    else
+        lua_pushnil(L);
+    return 1;
+}
+
+
+/// Copy last samples into Lua table from oldest to latest.
+/// arguments: history ID, table to fill, number of samples (all by default)
+/// Table is reused so there is no allocations after first call.
+/// Returns number of copied samples
+static int luaPropHistoryToTable(lua_State *L)
+{
+    PropHistory *history = getHistory(L);
+    if ((! history) || (! lua_istable(L, 2))) {
+        lua_pushnumber(L, 0);
+        return 1;
+    }
+
+    size_t window = lua_tointeger(L, 3);
+    if ((! window) || (window > history->getCount()))
+        window = history->getCount();
+
+    double value;
+    for (size_t i = 0; i < window; i++) {
+        history->getAgo(window - i - 1, value);
+        lua_pushnumber(L, value);
+        lua_rawseti(L, 2, i + 1);
+    }
+
+    lua_pushnumber(L, window);
+    return 1;
+}
+
+
+/// Returns pointer to ring buffer of doubles suitable for FFI access,
+/// capacity of buffer, index of latest sample (starting from zero) and 
+/// number of stored samples.  Pointer remains valid until history is 
+/// destroyed.
+static int luaGetPropHistoryData(lua_State *L)
+{
+    PropHistory *history = getHistory(L);
+    if (! history) {
+        lua_pushnil(L);
+        return 1;
+    }
+    lua_pushlightuserdata(L, (void*)history->getData());
+    lua_pushnumber(L, history->getCapacity());
+    lua_pushnumber(L, history->getLatestIndex());
+    lua_pushnumber(L, history->getCount());
+    return 4;
+}
+
+
+void xa::exportPropHistoryToLua(Luna &lua)
+{
+    lua_State *L = lua.getLua();
+
+    lua_register(L, "createPropHistory", luaCreatePropHistory);
+    lua_register(L, "destroyPropHistory", luaDestroyPropHistory);
+    lua_register(L, "clearPropHistory", luaClearPropHistory);
+    lua_register(L, "getPropHistorySize", luaGetPropHistorySize);
+    lua_register(L, "getPropHistoryAgo", luaGetPropHistoryAgo);
+    lua_register(L, "getPropHistoryStats", luaGetPropHistoryStats);
+    lua_register(L, "getPropHistoryDerivative", luaGetPropHistoryDerivative);
+    lua_register(L, "propHistoryToTable", luaPropHistoryToTable);
+    lua_register(L, "getPropHistoryData", luaGetPropHistoryData);
+}
+
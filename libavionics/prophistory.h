@@ -0,0 +1,121 @@
+#ifndef __PROP_HISTORY_H__
+#define __PROP_HISTORY_H__
+
+
+#include <string>
+#include <vector>
+#include "libavcallbacks.h"
+#include "luna.h"
+
+
+namespace xa {
+
+
+class Properties;
+
+
+/// Fixed capacity ring buffer of numeric property values sampled 
+/// at constant rate.
+class PropHistory
+{
+    private:
+        /// Name of sampled property
+        std::string name;
+
+        /// Sampled property or NULL if it isn't found in backend
+        SaslPropRef prop;
+
+        /// Type of property
+        int type;
+
+        /// Time between samples in milliseconds or 0 to sample every frame
+        double period;
+
+        /// Time of next sample in milliseconds
+        double nextSample;
+
+        /// Sampled values
+        std::vector<double> values;
+
+        /// Times of samples in milliseconds
+        std::vector<double> times;
+
+        /// Index of latest sample
+        size_t latest;
+
+        /// Number of stored samples
+        size_t count;
+
+    public:
+        /// Create empty history
+        /// \param name name of property to sample
+        /// \param prop property to sample
+        /// \param type type of property
+        /// \param capacity maximum number of samples to store
+        /// \param rate number of samples per second or 0 to sample every frame
+        PropHistory(const std::string &name, SaslPropRef prop, int type, 
+                int capacity, double rate);
+
+    public:
+        /// Sample property if it is time to do so
+        /// \param properties properties subsystem
+        /// \param now current time in milliseconds
+        void update(Properties &properties, double now);
+
+        /// Append sample
+        void add(double value, double time);
+
+        /// Drop all samples
+        void clear();
+
+        /// Returns value sampled n samples ago, 0 is latest sample.
+        /// Returns false if there is no such sample
+        bool getAgo(size_t n, double &value) const;
+
+        /// Returns minimum, maximum and mean of last window samples.
+        /// Returns false if history is empty
+        bool getStats(size_t window, double &min, double &max, 
+                double &mean) const;
+
+        /// Returns change of value per second over last window samples.
+        /// Returns false if there is less than two samples
+        bool getDerivative(size_t window, double &derivative) const;
+
+        /// Returns name of sampled property
+        const std::string& getName() const { return name; }
+
+        /// Returns type of sampled property
+        int getType() const { return type; }
+
+        /// Returns sampled property
+        SaslPropRef getProp() const { return prop; }
+
+        /// Set sampled property after change of backend
+        void setProp(SaslPropRef prop) { this->prop = prop; }
+
+        /// Returns number of stored samples
+        size_t getCount() const { return count; }
+
+        /// Returns maximum number of samples
+        size_t getCapacity() const { return values.size(); }
+
+        /// Returns index of latest sample in data array
+        size_t getLatestIndex() const { return latest; }
+
+        /// Returns pointer to ring buffer of values
+        const double* getData() const { return &values[0]; }
+
+    private:
+        /// Returns index of sample n samples ago in ring buffer
+        size_t getIndex(size_t n) const;
+};
+
+
+/// Register properties history functions in Lua
+void exportPropHistoryToLua(Luna &lua);
+
+};
+
+
+#endif
+
@@ -0,0 +1,577 @@
+#include "propsnapshot.h"
+
+#include <string.h>
+
+
+using namespace xa;
+
+
+/// Flag of middle buffer index set when buffer wasn't picked up by reader
+#define FRESH_BUFFER 4
+
+/// Mask of middle buffer index
+#define BUFFER_INDEX 3
+
+
+PropsSnapshot::PropsSnapshot(): middleIndex(1)
+{
+    callbacks = NULL;
+    props = NULL;
+    backIndex = 0;
+    frontIndex = 2;
+    slotsCount = 0;
+    writeSerial = 0;
+    appliedSerial = 0;
+    rebind = false;
+}
+
+
+PropsSnapshot::~PropsSnapshot()
+{
+    setBackend(NULL, NULL);
+
+    for (std::map<std::pair<std::string, int>, SnapProp*>::iterator i = 
+            wrappers.begin(); i != wrappers.end(); i++)
+        delete (*i).second;
+    for (std::map<std::string, SnapProp*>::iterator i = funcProps.begin();
+            i != funcProps.end(); i++)
+        delete (*i).second;
+}
+
+
+void PropsSnapshot::setBackend(struct SaslPropsCallbacks *newCallbacks, 
+        SaslProps newProps)
+{
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        slots.insert(slots.end(), newSlots.begin(), newSlots.end());
+        newSlots.clear();
+
+        // writes were queued for old backend.  Reporting them as applied
+        // makes reader drop them.
+        if (! writes.empty())
+            appliedSerial = writes.back().serial;
+        writes.clear();
+    }
+    applying.clear();
+
+    // forget references to old backend, properties are looked up again
+    // on next publish
+    for (std::vector<SnapProp*>::iterator i = slots.begin(); 
+            i != slots.end(); i++)
+    {
+        SnapProp *prop = *i;
+        if (prop->ref && callbacks && callbacks->free_prop_ref)
+            callbacks->free_prop_ref(prop->ref);
+        prop->ref = NULL;
+    }
+
+    if (callbacks && callbacks->props_done)
+        callbacks->props_done(props);
+
+    callbacks = newCallbacks;
+    props = newProps;
+    rebind = true;
+}
+
+
+SnapProp* PropsSnapshot::lookup(const std::string &name, int type, 
+        bool create, int maxSize)
+{
+    std::map<std::string, SnapProp*>::iterator f = funcProps.find(name);
+    if (f != funcProps.end())
+        return (*f).second;
+
+    SnapProp *prop;
+    bool added = false;
+    std::pair<std::string, int> key(name, type);
+    std::map<std::pair<std::string, int>, SnapProp*>::iterator i = 
+        wrappers.find(key);
+    if (i != wrappers.end())
+        prop = (*i).second;
+    else {
+        added = true;
+        prop = new SnapProp();
+        prop->snapshot = this;
+        prop->name = name;
+        prop->type = type;
+        prop->slot = slotsCount++;
+        prop->create = false;
+        prop->maxSize = 0;
+        prop->ref = NULL;
+        prop->getter = NULL;
+        prop->setter = NULL;
+        prop->data = NULL;
+        wrappers[key] = prop;
+    }
+
+    // lookup is repeated each time because property may appear later
+    SnapLookup l;
+    l.prop = prop;
+    l.create = create;
+    l.maxSize = maxSize;
+
+    std::lock_guard<std::mutex> lock(queueMutex);
+    if (added)
+        newSlots.push_back(prop);
+    lookups.push_back(l);
+
+    return prop;
+}
+
+
+void PropsSnapshot::resolve(const SnapLookup &lookup)
+{
+    SnapProp *prop = lookup.prop;
+    if (prop->ref)
+        return;
+
+    // remember creation to repeat it in next backend
+    if (lookup.create) {
+        prop->create = true;
+        prop->maxSize = lookup.maxSize;
+    }
+
+    if (prop->create)
+        prop->ref = callbacks->create_prop(props, prop->name.c_str(), 
+                prop->type, prop->maxSize);
+    else
+        prop->ref = callbacks->get_prop_ref(props, prop->name.c_str(), 
+                prop->type);
+}
+
+
+SnapProp* PropsSnapshot::createFunc(const std::string &name, int type,
+        sasl_prop_getter_callback getter, sasl_prop_setter_callback setter,
+        void *data)
+{
+    if (funcProps.count(name))
+        return NULL;
+
+    SnapProp *prop = new SnapProp();
+    prop->snapshot = this;
+    prop->name = name;
+    prop->type = type;
+    prop->slot = -1;
+    prop->create = false;
+    prop->maxSize = 0;
+    prop->ref = NULL;
+    prop->getter = getter;
+    prop->setter = setter;
+    prop->data = data;
+    funcProps[name] = prop;
+    return prop;
+}
+
+
+const SnapValue* PropsSnapshot::read(SnapProp *prop)
+{
+    SnapBuffer &buffer = buffers[frontIndex];
+    if ((0 > prop->slot) || (prop->slot >= (int)buffer.values.size()))
+        return NULL;
+    return &buffer.values[prop->slot];
+}
+
+
+int PropsSnapshot::write(SnapProp *prop, const SnapValue &value)
+{
+    SnapWrite w;
+    w.prop = prop;
+    w.serial = ++writeSerial;
+    w.value = value;
+
+    applyWrite(buffers[frontIndex], w);
+    unconfirmed.push_back(w);
+
+    std::lock_guard<std::mutex> lock(queueMutex);
+    writes.push_back(w);
+
+    return 0;
+}
+
+
+void PropsSnapshot::applyWrite(SnapBuffer &buffer, const SnapWrite &write)
+{
+    int slot = write.prop->slot;
+    if ((0 <= slot) && (slot < (int)buffer.values.size()))
+        buffer.values[slot] = write.value;
+}
+
+
+void PropsSnapshot::acquire()
+{
+    if (! (middleIndex.load() & FRESH_BUFFER))
+        return;
+
+    frontIndex = middleIndex.exchange(frontIndex) & BUFFER_INDEX;
+
+    // reapply writes which was queued after buffer was filled
+    SnapBuffer &buffer = buffers[frontIndex];
+    for (std::list<SnapWrite>::iterator i = unconfirmed.begin(); 
+            i != unconfirmed.end(); )
+    {
+        if ((*i).serial <= buffer.appliedSerial)
+            i = unconfirmed.erase(i);
+        else {
+            applyWrite(buffer, *i);
+            i++;
+        }
+    }
+}
+
+
+int PropsSnapshot::publish()
+{
+    if (! (callbacks && props))
+        return -1;
+
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        slots.insert(slots.end(), newSlots.begin(), newSlots.end());
+        newSlots.clear();
+        resolving.swap(lookups);
+        applying.swap(writes);
+    }
+
+    for (std::vector<SnapLookup>::iterator i = resolving.begin();
+            i != resolving.end(); i++)
+        resolve(*i);
+    resolving.clear();
+
+    if (rebind) {
+        for (std::vector<SnapProp*>::iterator i = slots.begin(); 
+                i != slots.end(); i++)
+        {
+            SnapLookup l;
+            l.prop = *i;
+            l.create = false;
+            l.maxSize = 0;
+            resolve(l);
+        }
+        rebind = false;
+    }
+
+    for (std::vector<SnapWrite>::iterator i = applying.begin();
+            i != applying.end(); i++)
+    {
+        writeValue((*i).prop, (*i).value);
+        appliedSerial = (*i).serial;
+    }
+    applying.clear();
+
+    int err = 0;
+    if (callbacks->update_props)
+        err = callbacks->update_props(props);
+
+    SnapBuffer &buffer = buffers[backIndex];
+    buffer.values.resize(slots.size());
+    for (size_t i = 0; i < slots.size(); i++)
+        readValue(slots[i], buffer.values[i]);
+    buffer.appliedSerial = appliedSerial;
+
+    backIndex = middleIndex.exchange(backIndex | FRESH_BUFFER) & BUFFER_INDEX;
+
+    return err;
+}
+
+
+void PropsSnapshot::readValue(SnapProp *prop, SnapValue &value)
+{
+    if (! prop->ref) {
+        value.err = -1;
+        return;
+    }
+
+    value.err = 0;
+    switch (prop->type) {
+        case PROP_INT: 
+            value.intValue = callbacks->get_prop_int(prop->ref, &value.err);
+            break;
+        case PROP_FLOAT: 
+            value.floatValue = callbacks->get_prop_float(prop->ref, &value.err);
+            break;
+        case PROP_DOUBLE: 
+            value.doubleValue = callbacks->get_prop_double(prop->ref, 
+                    &value.err);
+            break;
+        case PROP_STRING: {
+                int sz = callbacks->get_prop_string(prop->ref, NULL, 0, 
+                        &value.err);
+                if (value.err || (0 > sz))
+                    break;
+                // reuse capacity of string to avoid allocations
+                value.stringValue.resize(sz + 1);
+                callbacks->get_prop_string(prop->ref, &value.stringValue[0],
+                        sz + 1, &value.err);
+                value.stringValue.resize(strlen(value.stringValue.c_str()));
+                break;
+            }
+        default:
+            value.err = -1;
+    }
+}
+
+
+void PropsSnapshot::writeValue(SnapProp *prop, const SnapValue &value)
+{
+    if (! prop->ref)
+        return;
+
+    switch (prop->type) {
+        case PROP_INT: 
+            callbacks->set_prop_int(prop->ref, value.intValue);
+            break;
+        case PROP_FLOAT: 
+            callbacks->set_prop_float(prop->ref, value.floatValue);
+            break;
+        case PROP_DOUBLE: 
+            callbacks->set_prop_double(prop->ref, value.doubleValue);
+            break;
+        case PROP_STRING: 
+            callbacks->set_prop_string(prop->ref, value.stringValue.c_str());
+            break;
+    }
+}
+
+
+
+/// Returns numeric value of snapshot value
+static double toNumber(const SnapValue &value, int type)
+{
+    switch (type) {
+        case PROP_INT: return value.intValue;
+        case PROP_FLOAT: return value.floatValue;
+        case PROP_DOUBLE: return value.doubleValue;
+        default: return 0;
+    }
+}
+
+
+/// Store number into snapshot value
+static void fromNumber(SnapValue &value, int type, double number)
+{
+    value.err = 0;
+    switch (type) {
+        case PROP_INT: value.intValue = (int)number; break;
+        case PROP_FLOAT: value.floatValue = (float)number; break;
+        case PROP_DOUBLE: value.doubleValue = number; break;
+        default: value.err = -1;
+    }
+}
+
+
+/// Returns value of numeric functional property
+static double getFuncNumber(SnapProp *p)
+{
+    switch (p->type) {
+        case PROP_INT: {
+                int value = 0;
+                p->getter(PROP_INT, &value, sizeof(value), p->data);
+                return value;
+            }
+        case PROP_FLOAT: {
+                float value = 0;
+                p->getter(PROP_FLOAT, &value, sizeof(value), p->data);
+                return value;
+            }
+        default: {
+                double value = 0;
+                p->getter(PROP_DOUBLE, &value, sizeof(value), p->data);
+                return value;
+            }
+    }
+}
+
+
+/// Set value of numeric functional property
+static void setFuncNumber(SnapProp *p, double number)
+{
+    switch (p->type) {
+        case PROP_INT: {
+                int i = (int)number;
+                p->setter(PROP_INT, &i, sizeof(i), p->data);
+                break;
+            }
+        case PROP_FLOAT: {
+                float f = (float)number;
+                p->setter(PROP_FLOAT, &f, sizeof(f), p->data);
+                break;
+            }
+        default:
+            p->setter(PROP_DOUBLE, &number, sizeof(number), p->data);
+    }
+}
+
+
+/// Returns numeric value of property from snapshot
+static double getNumber(SaslPropRef prop, int *err)
+{
+    SnapProp *p = (SnapProp*)prop;
+    if (p->getter && (PROP_STRING != p->type)) {
+        *err = 0;
+        return getFuncNumber(p);
+    }
+
+    const SnapValue *value = p->snapshot->read(p);
+    if ((! value) || value->err || (PROP_STRING == p->type)) {
+        *err = -1;
+        return 0;
+    }
+    *err = 0;
+    return toNumber(*value, p->type);
+}
+
+
+/// Queue write of numeric property value
+static int setNumber(SaslPropRef prop, double number)
+{
+    SnapProp *p = (SnapProp*)prop;
+    if (PROP_STRING == p->type)
+        return -1;
+    if (p->getter) {
+        if (p->setter)
+            setFuncNumber(p, number);
+        return 0;
+    }
+    SnapValue value;
+    fromNumber(value, p->type, number);
+    return p->snapshot->write(p, value);
+}
+
+
+static SaslPropRef getPropRef(SaslProps props, const char *name, int type)
+{
+    return ((PropsSnapshot*)props)->lookup(name, type, false, 0);
+}
+
+
+static SaslPropRef createProp(SaslProps props, const char *name, int type, 
+        int maxSize)
+{
+    return ((PropsSnapshot*)props)->lookup(name, type, true, maxSize);
+}
+
+
+/// Functional properties are served by reader: real backend would call
+/// getters on simulator thread while panel runs on reader thread
+static SaslPropRef createFuncProp(SaslProps props, const char *name, 
+            int type, int maxSize, sasl_prop_getter_callback getter, 
+            sasl_prop_setter_callback setter, void *ref)
+{
+    if (! getter)
+        return NULL;
+    return ((PropsSnapshot*)props)->createFunc(name, type, getter, setter, 
+            ref);
+}
+
+
+static void freePropRef(SaslPropRef prop)
+{
+    // wrappers live as long as snapshot
+}
+
+
+static int getPropInt(SaslPropRef prop, int *err)
+{
+    return (int)getNumber(prop, err);
+}
+
+
+static int setPropInt(SaslPropRef prop, int value)
+{
+    return setNumber(prop, value);
+}
+
+
+static float getPropFloat(SaslPropRef prop, int *err)
+{
+    return (float)getNumber(prop, err);
+}
+
+
+static int setPropFloat(SaslPropRef prop, float value)
+{
+    return setNumber(prop, value);
+}
+
+
+static double getPropDouble(SaslPropRef prop, int *err)
+{
+    return getNumber(prop, err);
+}
+
+
+static int setPropDouble(SaslPropRef prop, double value)
+{
+    return setNumber(prop, value);
+}
+
+
+static int getPropString(SaslPropRef prop, char *buf, int maxSize, int *err)
+{
+    SnapProp *p = (SnapProp*)prop;
+    if (p->getter && (PROP_STRING == p->type)) {
+        *err = 0;
+        return p->getter(PROP_STRING, buf, maxSize, p->data);
+    }
+
+    const SnapValue *value = p->snapshot->read(p);
+    if ((! value) || value->err || (PROP_STRING != p->type)) {
+        *err = -1;
+        return 0;
+    }
+    *err = 0;
+
+    int len = value->stringValue.length();
+    if (buf && (0 < maxSize)) {
+        int sz = (len < maxSize) ? len : maxSize - 1;
+        memcpy(buf, value->stringValue.c_str(), sz);
+        buf[sz] = 0;
+    }
+    return len;
+}
+
+
+static int setPropString(SaslPropRef prop, const char *value)
+{
+    SnapProp *p = (SnapProp*)prop;
+    if ((PROP_STRING != p->type) || (! value))
+        return -1;
+    if (p->getter) {
+        if (p->setter)
+            p->setter(PROP_STRING, (void*)value, strlen(value) + 1, p->data);
+        return 0;
+    }
+
+    SnapValue v;
+    v.err = 0;
+    v.stringValue = value;
+    return p->snapshot->write(p, v);
+}
+
+
+static int updateProps(SaslProps props)
+{
+    ((PropsSnapshot*)props)->acquire();
+    return 0;
+}
+
+
+static void doneProps(SaslProps props)
+{
+    ((PropsSnapshot*)props)->setBackend(NULL, NULL);
+}
+
+
+static SaslPropsCallbacks snapshotCallbacks = { getPropRef, freePropRef, createProp, 
+        createFuncProp, getPropInt, setPropInt, getPropFloat, 
+        setPropFloat, getPropDouble, setPropDouble, 
+        getPropString, setPropString,
+        updateProps, doneProps };
+
+
+struct SaslPropsCallbacks* PropsSnapshot::getCallbacks()
+{
+    return &snapshotCallbacks;
+}
+
@@ -0,0 +1,266 @@
+#ifndef __PROPS_SNAPSHOT_H__
+#define __PROPS_SNAPSHOT_H__
+
+
+#include <string>
+#include <vector>
+#include <list>
+#include <map>
+#include <atomic>
+#include <mutex>
+#include <stdint.h>
+#include "libavcallbacks.h"
+
+
+namespace xa {
+
+
+class PropsSnapshot;
+
+
+/// Property referenced through snapshot
+struct SnapProp
+{
+    /// Snapshot this property belongs to
+    PropsSnapshot *snapshot;
+
+    /// Name of property
+    std::string name;
+
+    /// Type of property
+    int type;
+
+    /// Index of property value in snapshot buffers or -1 for functional
+    /// property
+    int slot;
+
+    /// True if property was created in real backend and should be
+    /// created again in new backend.  Accessed by publisher only.
+    bool create;
+
+    /// Maximum size of created string property.  Accessed by publisher
+    /// only.
+    int maxSize;
+
+    /// Reference to property in real properties backend or NULL if
+    /// property wasn't found yet.  Accessed by publisher only.
+    SaslPropRef ref;
+
+    /// Getter of functional property called by reader
+    sasl_prop_getter_callback getter;
+
+    /// Setter of functional property called by reader
+    sasl_prop_setter_callback setter;
+
+    /// Data passed to getter and setter
+    void *data;
+};
+
+
+/// Lookup of property waiting to be resolved by publisher
+struct SnapLookup
+{
+    /// Property to resolve
+    SnapProp *prop;
+
+    /// True if property should be created if it doesn't exist
+    bool create;
+
+    /// Maximum size of created string property
+    int maxSize;
+};
+
+
+/// Value of property stored in snapshot
+struct SnapValue
+{
+    /// Non-zero if property was not read successfully
+    int err;
+
+    /// Numeric value of property
+    union {
+        int intValue;
+        float floatValue;
+        double doubleValue;
+    };
+
+    /// Value of string property
+    std::string stringValue;
+
+    SnapValue(): err(-1), doubleValue(0) { };
+};
+
+
+/// Property value written by reader and waiting to be applied
+struct SnapWrite
+{
+    /// Property to write
+    SnapProp *prop;
+
+    /// Write serial number
+    uint64_t serial;
+
+    /// New value of property
+    SnapValue value;
+};
+
+
+/// Copy of all referenced properties values
+struct SnapBuffer
+{
+    /// Properties values in slots order
+    std::vector<SnapValue> values;
+
+    /// Serial number of last write applied before values was read
+    uint64_t appliedSerial;
+
+    SnapBuffer(): appliedSerial(0) { };
+};
+
+
+/// Properties backend which serves properties from frame-consistent
+/// snapshot instead of live values.
+/// Simulator thread calls publish() to apply queued writes and copy values
+/// of all referenced properties into free buffer which is handed to reader
+/// with atomic exchange.  Reader (thread running panel) picks up latest
+/// buffer in update_props callback and sees the same values till next
+/// update.  Three buffers are used so neither side ever waits for other one.
+/// Real backend is accessed by publisher only: lookups and creation of
+/// properties are queued and resolved on next publish(), till then
+/// property reads as error.  Functional properties are served by reader
+/// directly and never reach real backend because it would call their
+/// getters from simulator thread.
+class PropsSnapshot
+{
+    private:
+        /// Real properties backend callbacks
+        struct SaslPropsCallbacks *callbacks;
+
+        /// Real properties backend
+        SaslProps props;
+
+        /// Snapshot buffers
+        SnapBuffer buffers[3];
+
+        /// Index of buffer being filled by publisher
+        int backIndex;
+
+        /// Index of latest published buffer and fresh flag
+        std::atomic<int> middleIndex;
+
+        /// Index of buffer being read by reader
+        int frontIndex;
+
+        /// Properties wrappers by names and types.
+        /// Accessed by reader only.
+        std::map<std::pair<std::string, int>, SnapProp*> wrappers;
+
+        /// Functional properties by names.  Accessed by reader only.
+        std::map<std::string, SnapProp*> funcProps;
+
+        /// Number of allocated slots.  Accessed by reader only.
+        int slotsCount;
+
+        /// Serial number of last write.  Accessed by reader only.
+        uint64_t writeSerial;
+
+        /// Writes not yet seen in published buffers.  Accessed by reader only.
+        std::list<SnapWrite> unconfirmed;
+
+        /// Guards newSlots, lookups and writes
+        std::mutex queueMutex;
+
+        /// Properties registered since last publish
+        std::vector<SnapProp*> newSlots;
+
+        /// Lookups queued since last publish
+        std::vector<SnapLookup> lookups;
+
+        /// Lookups being resolved.  Accessed by publisher only.
+        std::vector<SnapLookup> resolving;
+
+        /// True if backend was changed and all properties should be
+        /// looked up again.  Accessed by publisher only.
+        bool rebind;
+
+        /// Writes queued since last publish
+        std::vector<SnapWrite> writes;
+
+        /// Properties to copy.  Accessed by publisher only.
+        std::vector<SnapProp*> slots;
+
+        /// Writes being applied.  Accessed by publisher only.
+        std::vector<SnapWrite> applying;
+
+        /// Serial number of last applied write.  Accessed by publisher only.
+        uint64_t appliedSerial;
+
+    public:
+        /// Create snapshot without backend
+        PropsSnapshot();
+
+        /// Destroy snapshot and real backend
+        ~PropsSnapshot();
+
+    public:
+        /// Set real properties backend.  Previous backend is destroyed,
+        /// properties references obtained through snapshot stay valid
+        /// and are looked up in new backend on next publish().  Queued
+        /// writes are dropped.  Called by publisher thread, or by any
+        /// thread while reader and publisher don't run.
+        void setBackend(struct SaslPropsCallbacks *callbacks, SaslProps props);
+
+        /// Apply queued writes, update real backend and publish values of
+        /// all referenced properties.  Called by simulator thread.
+        /// Returns zero on success.
+        int publish();
+
+        /// Switch reader to latest published buffer if any.
+        /// Called by reader thread.
+        void acquire();
+
+        /// Returns callbacks which serve properties from snapshot.
+        /// Properties handler for these callbacks is pointer to snapshot.
+        static struct SaslPropsCallbacks* getCallbacks();
+
+    public:
+        /// Returns property wrapper and queue its lookup in real backend
+        /// \param name name of property
+        /// \param type type of property
+        /// \param create true if property should be created
+        /// \param maxSize maximum size of created string property
+        SnapProp* lookup(const std::string &name, int type, bool create,
+                int maxSize);
+
+        /// Returns value of property as seen by reader
+        const SnapValue* read(SnapProp *prop);
+
+        /// Queue property write
+        int write(SnapProp *prop, const SnapValue &value);
+
+        /// Returns functional property served by reader or NULL if
+        /// property with such name exists already
+        SnapProp* createFunc(const std::string &name, int type,
+                sasl_prop_getter_callback getter,
+                sasl_prop_setter_callback setter, void *data);
+
+    private:
+        /// Find or create property in real backend
+        void resolve(const SnapLookup &lookup);
+
+        /// Apply write to buffer
+        static void applyWrite(SnapBuffer &buffer, const SnapWrite &write);
+
+        /// Read property value from real backend
+        void readValue(SnapProp *prop, SnapValue &value);
+
+        /// Write property value to real backend
+        void writeValue(SnapProp *prop, const SnapValue &value);
+};
+
+
+};
+
+
+#endif
+
@@ -0,0 +1,328 @@
+#include "propsreplay.h"
+
+#include <string>
+#include <vector>
+#include <string.h>
+#include "recordreader.h"
+#include "rttimer.h"
+
+
+using namespace xa;
+
+
+struct ReplayProps;
+
+
+/// Property served by replay backend
+struct ReplayValue
+{
+    /// Replay this property belongs to
+    ReplayProps *props;
+
+    /// Name of property
+    std::string name;
+
+    /// Type of property
+    int type;
+
+    /// Index of recorded column or -1 for local properties
+    int column;
+
+    /// Maximum size of string property
+    int maxSize;
+
+    /// Value of local numeric property
+    double number;
+
+    /// Value of local string property
+    std::string string;
+
+    /// Getter of functional property
+    sasl_prop_getter_callback getter;
+
+    /// Setter of functional property
+    sasl_prop_setter_callback setter;
+
+    /// Reference passed to functional property callbacks
+    void *ref;
+};
+
+
+/// Storage of replayed properties
+struct ReplayProps
+{
+    Log &log;
+    RecordReader reader;
+    RtTimer timer;
+    long startTime;
+    std::vector<ReplayValue*> values;
+    bool loop;
+    unsigned long row;
+
+    ReplayProps(Log &log, bool loop): log(log), loop(loop), row(0) { 
+        startTime = timer.getTime();
+    };
+
+    ~ReplayProps() {
+        for (std::vector<ReplayValue*>::iterator i = values.begin();
+                i != values.end(); i++)
+            delete *i;
+    }
+};
+
+
+/// Find property or create new one
+/// \param local create local property if property wasn't recorded
+static ReplayValue* findValue(ReplayProps *p, const char *name, int type,
+        int maxSize, bool local)
+{
+    if ((! p) || (! name) || (PROP_INT > type) || (PROP_STRING < type))
+        return NULL;
+
+    for (std::vector<ReplayValue*>::iterator i = p->values.begin();
+            i != p->values.end(); i++)
+        if (((*i)->type == type) && ((*i)->name == name))
+            return *i;
+
+    int column = p->reader.findColumn(name, type);
+    if ((-1 == column) && (! local))
+        return NULL;
+
+    ReplayValue *v = new ReplayValue();
+    v->props = p;
+    v->name = name;
+    v->type = type;
+    v->column = column;
+    v->maxSize = maxSize;
+    v->number = 0;
+    v->getter = NULL;
+    v->setter = NULL;
+    v->ref = NULL;
+    p->values.push_back(v);
+    return v;
+}
+
+
+static SaslPropRef getPropRef(SaslProps props, const char *name, int type)
+{
+    return findValue((ReplayProps*)props, name, type, 0, false);
+}
+
+
+static SaslPropRef createProp(SaslProps props, const char *name, int type, 
+        int maxSize)
+{
+    return findValue((ReplayProps*)props, name, type, maxSize, true);
+}
+
+
+static SaslPropRef createFuncProp(SaslProps props, const char *name, 
+            int type, int maxSize, sasl_prop_getter_callback getter, 
+            sasl_prop_setter_callback setter, void *ref)
+{
+    ReplayValue *v = findValue((ReplayProps*)props, name, type, maxSize, true);
+    if (! v)
+        return NULL;
+    if (v->getter) {
+        v->props->log.error("Property '%s' already exists", name);
+        return NULL;
+    }
+    v->column = -1;
+    v->getter = getter;
+    v->setter = setter;
+    v->ref = ref;
+    return v;
+}
+
+
+/// properties are referenced forever
+static void freePropRef(SaslPropRef prop)
+{
+}
+
+
+/// Returns value of numeric property
+static double getNumber(ReplayValue *v, int *err)
+{
+    if ((! v) || (PROP_STRING == v->type)) {
+        if (err)
+            *err = 1;
+        return 0;
+    }
+    if (err)
+        *err = 0;
+
+    if (v->getter) {
+        switch (v->type) {
+            case PROP_INT: {
+                    int value = 0;
+                    v->getter(PROP_INT, &value, sizeof(value), v->ref);
+                    return value;
+                }
+            case PROP_FLOAT: {
+                    float value = 0;
+                    v->getter(PROP_FLOAT, &value, sizeof(value), v->ref);
+                    return value;
+                }
+            default: {
+                    double value = 0;
+                    v->getter(PROP_DOUBLE, &value, sizeof(value), v->ref);
+                    return value;
+                }
+        }
+    }
+
+    if (-1 != v->column)
+        return v->props->reader.getNumber(v->props->row, v->column);
+    return v->number;
+}
+
+
+/// Set value of numeric property
+static int setNumber(ReplayValue *v, double value)
+{
+    if ((! v) || (PROP_STRING == v->type))
+        return -1;
+
+    if (v->setter) {
+        switch (v->type) {
+            case PROP_INT: {
+                    int i = (int)value;
+                    v->setter(PROP_INT, &i, sizeof(i), v->ref);
+                    break;
+                }
+            case PROP_FLOAT: {
+                    float f = (float)value;
+                    v->setter(PROP_FLOAT, &f, sizeof(f), v->ref);
+                    break;
+                }
+            default:
+                v->setter(PROP_DOUBLE, &value, sizeof(value), v->ref);
+        }
+    } else if (-1 == v->column)
+        v->number = value;
+    return 0;
+}
+
+
+static int getPropInt(SaslPropRef prop, int *err)
+{
+    return (int)getNumber((ReplayValue*)prop, err);
+}
+
+
+static int setPropInt(SaslPropRef prop, int value)
+{
+    return setNumber((ReplayValue*)prop, value);
+}
+
+
+static float getPropFloat(SaslPropRef prop, int *err)
+{
+    return (float)getNumber((ReplayValue*)prop, err);
+}
+
+
+static int setPropFloat(SaslPropRef prop, float value)
+{
+    return setNumber((ReplayValue*)prop, value);
+}
+
+
+static double getPropDouble(SaslPropRef prop, int *err)
+{
+    return getNumber((ReplayValue*)prop, err);
+}
+
+
+static int setPropDouble(SaslPropRef prop, double value)
+{
+    return setNumber((ReplayValue*)prop, value);
+}
+
+
+static int getPropString(SaslPropRef prop, char *buf, int maxSize, int *err)
+{
+    ReplayValue *v = (ReplayValue*)prop;
+    if ((! v) || (PROP_STRING != v->type)) {
+        if (err)
+            *err = 1;
+        return 0;
+    }
+    if (err)
+        *err = 0;
+
+    if (v->getter)
+        return v->getter(PROP_STRING, buf, maxSize, v->ref);
+
+    const std::string &value = (-1 != v->column) ? 
+        v->props->reader.getString(v->props->row, v->column) : v->string;
+    int len = value.length();
+    if (buf && (maxSize > len))
+        memcpy(buf, value.c_str(), len + 1);
+    return len + 1;
+}
+
+
+static int setPropString(SaslPropRef prop, const char *value)
+{
+    ReplayValue *v = (ReplayValue*)prop;
+    if ((! v) || (PROP_STRING != v->type) || (! value))
+        return -1;
+
+    if (v->setter)
+        v->setter(PROP_STRING, (void*)value, strlen(value) + 1, v->ref);
+    else if (-1 == v->column)
+        v->string = value;
+    return 0;
+}
+
+
+/// Move to row recorded at current replay time
+static int updateProps(SaslProps props)
+{
+    ReplayProps *p = (ReplayProps*)props;
+    if (! p)
+        return -1;
+
+    long time = p->timer.getTime() - p->startTime;
+    long length = p->reader.getDuration() + p->reader.getPeriod();
+    if (p->loop && (0 < length))
+        time %= length;
+    p->row = p->reader.findRow(time);
+
+    return 0;
+}
+
+
+static void doneProps(SaslProps props)
+{
+    delete (ReplayProps*)props;
+}
+
+
+static SaslPropsCallbacks callbacks = { getPropRef, freePropRef, createProp, 
+        createFuncProp, getPropInt, setPropInt, getPropFloat, 
+        setPropFloat, getPropDouble, setPropDouble, 
+        getPropString, setPropString,
+        updateProps, doneProps };
+
+
+int xa::startReplay(SASL sasl, Log &log, const char *fileName, bool loop)
+{
+    ReplayProps *rp = new ReplayProps(log, loop);
+
+    if ((! fileName) || rp->reader.open(fileName)) {
+        log.error("Can't open record file '%s'", fileName ? fileName : "");
+        delete rp;
+        return -1;
+    }
+
+    if (! rp->reader.getRowsCount())
+        log.warning("Record file '%s' is empty", fileName);
+
+    sasl_set_props(sasl, &callbacks, rp);
+
+    return 0;
+}
+
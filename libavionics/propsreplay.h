@@ -0,0 +1,23 @@
+#ifndef __PROPS_REPLAY_H__
+#define __PROPS_REPLAY_H__
+
+
+#include "libavionics.h"
+#include "log.h"
+
+
+namespace xa {
+
+/// Serve properties from flight-data record file.
+/// Recorded properties follow recorded values in real time, writes to
+/// them are ignored.  Properties created by panel are stored locally.
+/// Properties which are neither recorded nor created are not found.
+/// Returns zero on success.
+/// \param loop if true replay restarts when record ends, otherwise 
+///     last recorded values are kept
+int startReplay(SASL sasl, Log &log, const char *fileName, bool loop);
+
+};
+
+#endif
+
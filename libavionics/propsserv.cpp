@@ -3,6 +3,7 @@
 #include <string.h>
 #include "md5.h"
 #include "libavcallbacks.h"
+#include "tracer.h"
 
 
 using namespace xa;
@@ -139,6 +140,8 @@ int PropsServer::start(const char *password, int port)
 
 int PropsServer::update()
 {
+    TRACE_SCOPE("props server update");
+
     int err = 0;
 
     if (server.update()) {
@@ -151,6 +154,7 @@ int PropsServer::update()
     {
         if ((*i).update()) {
             log.debug("closing client connection");
+            closedStats.add((*i).getStats());
             i = clients.erase(i);
         } else
             i++;
@@ -163,6 +167,9 @@ int PropsServer::update()
 void PropsServer::stop()
 {
     server.stop();
+    for (std::list<PropsClient>::iterator i = clients.begin(); 
+            i != clients.end(); i++)
+        closedStats.add((*i).getStats());
     clients.clear();
 }
 
@@ -179,6 +186,23 @@ bool PropsServer::isRunning()
 }
 
 
+int PropsServer::getClientsCount() const
+{
+    return clients.size();
+}
+
+
+NetStats PropsServer::getStats() const
+{
+    NetStats stats = closedStats;
+    stats.add(server.getStats());
+    for (std::list<PropsClient>::const_iterator i = clients.begin(); 
+            i != clients.end(); i++)
+        stats.add((*i).getStats());
+    return stats;
+}
+
+
 
 
 PropsClient::PropsClient(Log &log, const std::string &secret, Properties &properties): 
@@ -129,6 +129,9 @@ class PropsClient: private NetReceiver
         /// shutdown connection
         void stop();
 
+        /// Returns activity counters of connection
+        const NetStats& getStats() const { return con.getStats(); };
+
     private:
         /// called on data received
         virtual void onDataReceived(NetBuf &buffer);
@@ -172,6 +175,9 @@ class PropsServer: private ConnectionAcceptor
         /// Properties subsystem
         Properties &properties;
 
+        /// Counters of already closed connections
+        NetStats closedStats;
+
     public:
         /// create props server
         PropsServer(Log &log, Properties &properties);
@@ -192,6 +198,13 @@ class PropsServer: private ConnectionAcceptor
         /// Returns true if server is running
         bool isRunning();
 
+        /// Returns number of connected clients
+        int getClientsCount() const;
+
+        /// Returns activity counters of server and all connections
+        /// served since creation of server
+        NetStats getStats() const;
+
     private:
         /// create new connection
         virtual void onConnectionReceived(int sock);
@@ -0,0 +1,344 @@
+#include "recorder.h"
+
+#include "avionics.h"
+
+
+using namespace xa;
+
+
+/// Number of rows in chunk when sampled at 20 Hz is about 25 seconds
+#define CHUNK_ROWS 512
+
+
+Recorder::Recorder(Properties &properties, Log &log):
+    properties(properties), log(log)
+{
+    period = 0;
+    chunkRows = CHUNK_ROWS;
+    startTime = lastSampleTime = 0;
+    recording = false;
+    current = NULL;
+    file = NULL;
+    stopWriter = false;
+    writeFailed = false;
+    rowsCount = 0;
+}
+
+
+Recorder::~Recorder()
+{
+    stop();
+    for (std::list<RecordChunk*>::iterator i = freeChunks.begin();
+            i != freeChunks.end(); i++)
+        delete *i;
+}
+
+
+int Recorder::addProp(const std::string &name, int type)
+{
+    if (recording || (PROP_INT > type) || (PROP_STRING < type))
+        return -1;
+
+    for (std::vector<RecordedProp>::iterator i = props.begin();
+            i != props.end(); i++)
+        if (((*i).name == name) && ((*i).type == type))
+            return 0;
+
+    RecordedProp prop;
+    prop.name = name;
+    prop.type = type;
+    prop.ref = NULL;
+    props.push_back(prop);
+    return 0;
+}
+
+
+void Recorder::clearProps()
+{
+    if (! recording)
+        props.clear();
+}
+
+
+int Recorder::start(const std::string &fileName, long period, long now)
+{
+    stop();
+
+    if (props.empty()) {
+        log.error("Nothing to record");
+        return -1;
+    }
+
+    this->period = period > 0 ? period : 0;
+    file = fopen(fileName.c_str(), "wb");
+    if (! file) {
+        log.error("Can't create record file '%s'", fileName.c_str());
+        return -1;
+    }
+
+    if (writeHeader()) {
+        log.error("Can't write record file '%s'", fileName.c_str());
+        fclose(file);
+        file = NULL;
+        return -1;
+    }
+
+    for (std::vector<RecordedProp>::iterator i = props.begin();
+            i != props.end(); i++)
+    {
+        (*i).ref = properties.getProp((*i).name, (*i).type);
+        if (! (*i).ref)
+            log.warning("Recorded property '%s' not found",
+                    (*i).name.c_str());
+    }
+
+    startTime = now;
+    lastSampleTime = now - this->period;
+    rowsCount = 0;
+    stopWriter = false;
+    writeFailed = false;
+    current = getChunk();
+    recording = true;
+
+    writer = std::thread(&Recorder::writeChunks, this);
+
+    return 0;
+}
+
+
+void Recorder::stop()
+{
+    if (! recording)
+        return;
+
+    flush();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopWriter = true;
+    }
+    queued.notify_one();
+    writer.join();
+
+    if (writeFailed)
+        log.error("Error writing record file");
+
+    fclose(file);
+    file = NULL;
+    recording = false;
+
+    for (std::vector<RecordedProp>::iterator i = props.begin();
+            i != props.end(); i++)
+    {
+        if ((*i).ref)
+            properties.freeProp((*i).ref);
+        (*i).ref = NULL;
+    }
+}
+
+
+RecordChunk* Recorder::getChunk()
+{
+    RecordChunk *chunk = NULL;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (! freeChunks.empty()) {
+            chunk = freeChunks.front();
+            freeChunks.pop_front();
+        }
+    }
+
+    if (! chunk)
+        chunk = new RecordChunk();
+
+    chunk->times.clear();
+    chunk->columns.resize(props.size());
+    for (size_t i = 0; i < props.size(); i++) {
+        chunk->columns[i].type = props[i].type;
+        chunk->columns[i].clear();
+    }
+    chunk->times.reserve(chunkRows);
+
+    return chunk;
+}
+
+
+void Recorder::flush()
+{
+    if ((! current) || current->times.empty())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.push_back(current);
+    }
+    queued.notify_one();
+    current = getChunk();
+}
+
+
+void Recorder::update(long now)
+{
+    if (! recording)
+        return;
+
+    if (now - lastSampleTime < period)
+        return;
+    // keep sampling grid even if frames are late
+    if (period)
+        lastSampleTime = now - (now - lastSampleTime) % period;
+    else
+        lastSampleTime = now;
+
+    current->times.push_back(now - startTime);
+    for (size_t i = 0; i < props.size(); i++) {
+        RecordedProp &prop = props[i];
+        RecordColumn &column = current->columns[i];
+        switch (prop.type) {
+            case PROP_INT:
+                column.numbers.push_back((uint64_t)(int64_t)
+                        properties.getPropi(prop.ref));
+                break;
+            case PROP_FLOAT:
+                column.numbers.push_back(recordFloatBits(
+                            properties.getPropf(prop.ref)));
+                break;
+            case PROP_DOUBLE:
+                column.numbers.push_back(recordDoubleBits(
+                            properties.getPropd(prop.ref)));
+                break;
+            case PROP_STRING:
+                column.strings.push_back(properties.getProps(prop.ref));
+                break;
+        }
+    }
+    rowsCount++;
+
+    if ((int)current->times.size() >= chunkRows)
+        flush();
+}
+
+
+void Recorder::writeChunks()
+{
+    std::vector<unsigned char> buf;
+
+    while (true) {
+        RecordChunk *chunk;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (queue.empty() && (! stopWriter))
+                queued.wait(lock);
+            if (queue.empty())
+                break;
+            chunk = queue.front();
+            queue.pop_front();
+        }
+
+        int err = writeChunk(chunk, buf);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (err)
+            writeFailed = true;
+        freeChunks.push_back(chunk);
+    }
+}
+
+
+int Recorder::writeChunk(RecordChunk *chunk, std::vector<unsigned char> &buf)
+{
+    TRACE_SCOPE("recorder write");
+
+    int rows = chunk->times.size();
+
+    buf.clear();
+    recordPutUint(buf, RECORD_CHUNK_SIGNATURE, 4);
+    recordPutUint(buf, rows, 4);
+    recordPutUint(buf, chunk->times.front(), 4);
+    recordPutUint(buf, chunk->times.back(), 4);
+    recordPutUint(buf, 0, 4);
+
+    recordEncodeTimes(buf, chunk->times);
+    for (std::vector<RecordColumn>::const_iterator i =
+            chunk->columns.begin(); i != chunk->columns.end(); i++)
+        recordEncodeColumn(buf, *i);
+
+    uint32_t size = buf.size() - RECORD_CHUNK_HEADER_SIZE;
+    for (int i = 0; i < 4; i++)
+        buf[16 + i] = (size >> (8 * i)) & 0xff;
+
+    if (1 != fwrite(&buf[0], buf.size(), 1, file))
+        return -1;
+    return fflush(file) ? -1 : 0;
+}
+
+
+int Recorder::writeHeader()
+{
+    std::vector<unsigned char> buf(RECORD_SIGNATURE,
+            RECORD_SIGNATURE + sizeof(RECORD_SIGNATURE));
+    recordPutUint(buf, RECORD_VERSION, 4);
+    recordPutUint(buf, period, 4);
+    recordPutUint(buf, props.size(), 4);
+    for (std::vector<RecordedProp>::iterator i = props.begin();
+            i != props.end(); i++)
+    {
+        recordPutUint(buf, (*i).type, 1);
+        recordPutUint(buf, (*i).name.length(), 2);
+        buf.insert(buf.end(), (*i).name.begin(), (*i).name.end());
+    }
+
+    if (1 != fwrite(&buf[0], buf.size(), 1, file))
+        return -1;
+    return fflush(file) ? -1 : 0;
+}
+
+
+/// Lua wrapper for addProp
+/// arguments: name of property, type of property
+static int luaRecordProperty(lua_State *L)
+{
+    if ((! lua_isstring(L, 1)) || (! lua_isstring(L, 2))) {
+        lua_pushboolean(L, 0);
+        return 1;
+    }
+
+    int type = getPropType(lua_tostring(L, 2));
+    lua_pushboolean(L, ! getAvionics(L)->getRecorder().addProp(
+                lua_tostring(L, 1), type));
+    return 1;
+}
+
+
+/// Lua wrapper for start
+/// arguments: name of file, sampling period in milliseconds
+static int luaStartRecording(lua_State *L)
+{
+    if (! lua_isstring(L, 1)) {
+        lua_pushboolean(L, 0);
+        return 1;
+    }
+
+    Avionics *avionics = getAvionics(L);
+    lua_pushboolean(L, ! avionics->getRecorder().start(lua_tostring(L, 1),
+                (long)lua_tonumber(L, 2), avionics->getTime()));
+    return 1;
+}
+
+
+/// Lua wrapper for stop
+static int luaStopRecording(lua_State *L)
+{
+    getAvionics(L)->getRecorder().stop();
+    return 0;
+}
+
+
+void xa::exportRecorderToLua(Luna &lua)
+{
+    lua_State *L = lua.getLua();
+
+    lua_register(L, "recordProperty", luaRecordProperty);
+    lua_register(L, "startRecording", luaStartRecording);
+    lua_register(L, "stopRecording", luaStopRecording);
+}
+
@@ -0,0 +1,172 @@
+#ifndef __RECORDER_H__
+#define __RECORDER_H__
+
+
+#include <string>
+#include <vector>
+#include <list>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <stdio.h>
+#include <stdint.h>
+#include "recordfmt.h"
+#include "libavcallbacks.h"
+
+
+namespace xa {
+
+
+class Properties;
+class Log;
+class Luna;
+
+
+/// Block of samples handed to writer thread
+struct RecordChunk
+{
+    /// Times of rows
+    std::vector<uint32_t> times;
+
+    /// Values of properties
+    std::vector<RecordColumn> columns;
+};
+
+
+/// Samples set of properties at fixed rate and writes them to binary
+/// record file (see recordfmt.h).  Frame thread only copies values into
+/// current chunk, full chunks are encoded and written by background
+/// thread.  Chunks are reused so sampling of numeric properties doesn't
+/// allocate memory once chunk buffers reached their sizes.
+class Recorder
+{
+    private:
+        /// Recorded property
+        struct RecordedProp {
+            /// name of property
+            std::string name;
+
+            /// type of property
+            int type;
+
+            /// reference to property
+            SaslPropRef ref;
+        };
+
+        /// Properties subsystem
+        Properties &properties;
+
+        /// Logger
+        Log &log;
+
+        /// Properties to record
+        std::vector<RecordedProp> props;
+
+        /// Sampling period in milliseconds
+        long period;
+
+        /// Maximum number of rows in chunk
+        int chunkRows;
+
+        /// Time of recording start
+        long startTime;
+
+        /// Time of last sample
+        long lastSampleTime;
+
+        /// True if recording is active
+        bool recording;
+
+        /// Chunk being filled
+        RecordChunk *current;
+
+        /// Output file
+        FILE *file;
+
+        /// Writer thread
+        std::thread writer;
+
+        /// Guards queue, freeChunks, stopWriter and writeFailed
+        std::mutex mutex;
+
+        /// Signalled when chunk queued or writer should stop
+        std::condition_variable queued;
+
+        /// Chunks waiting to be written
+        std::list<RecordChunk*> queue;
+
+        /// Chunks available for reuse
+        std::list<RecordChunk*> freeChunks;
+
+        /// True if writer thread should exit after queue is written
+        bool stopWriter;
+
+        /// True if writer failed to write file
+        bool writeFailed;
+
+        /// Number of rows written since recording start
+        unsigned long rowsCount;
+
+    public:
+        /// Create recorder
+        Recorder(Properties &properties, Log &log);
+
+        /// Stop recording and free chunks
+        ~Recorder();
+
+    public:
+        /// Add property to set of recorded properties.
+        /// Properties can't be added while recording is active.
+        /// Returns zero on success.
+        int addProp(const std::string &name, int type);
+
+        /// Remove all properties from recorded set
+        void clearProps();
+
+        /// Start recording to file.
+        /// Returns zero on success.
+        /// \param fileName name of record file, overwritten if exists
+        /// \param period sampling period in milliseconds
+        /// \param now current time in milliseconds
+        int start(const std::string &fileName, long period, long now);
+
+        /// Flush samples and stop recording
+        void stop();
+
+        /// Returns true if recording is active
+        bool isRecording() const { return recording; }
+
+        /// Returns number of recorded rows
+        unsigned long getRowsCount() const { return rowsCount; }
+
+        /// Sample properties if sampling period passed.  Called every frame.
+        /// \param now current time in milliseconds
+        void update(long now);
+
+    private:
+        /// Returns empty chunk
+        RecordChunk* getChunk();
+
+        /// Pass current chunk to writer
+        void flush();
+
+        /// Writer thread body
+        void writeChunks();
+
+        /// Encode and write chunk.  Returns zero on success.
+        int writeChunk(RecordChunk *chunk, std::vector<unsigned char> &buf);
+
+        /// Write file header.  Returns zero on success.
+        int writeHeader();
+};
+
+
+/// Register recorder functions in Lua
+void exportRecorderToLua(Luna &lua);
+
+
+};
+
+
+#endif
+
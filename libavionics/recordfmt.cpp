@@ -0,0 +1,249 @@
+#include "recordfmt.h"
+
+#include <string.h>
+#include "libavcallbacks.h"
+
+
+using namespace xa;
+
+
+const char xa::RECORD_SIGNATURE[8] = { 'S', 'A', 'S', 'L', 'R', 'E', 'C', 0 };
+
+
+void RecordColumn::clear()
+{
+    numbers.clear();
+    strings.clear();
+}
+
+
+void xa::recordPutUint(std::vector<unsigned char> &buf, uint64_t value,
+        int size)
+{
+    for (int i = 0; i < size; i++) {
+        buf.push_back(value & 0xff);
+        value >>= 8;
+    }
+}
+
+
+uint64_t xa::recordGetUint(const unsigned char *data, int size)
+{
+    uint64_t value = 0;
+    for (int i = size - 1; i >= 0; i--)
+        value = (value << 8) | data[i];
+    return value;
+}
+
+
+void xa::recordPutVarint(std::vector<unsigned char> &buf, uint64_t value)
+{
+    while (value >= 0x80) {
+        buf.push_back((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    buf.push_back(value);
+}
+
+
+int xa::recordGetVarint(const unsigned char *data, const unsigned char *end,
+        uint64_t &value)
+{
+    value = 0;
+    for (int i = 0; (i < 10) && (data + i < end); i++) {
+        value |= (uint64_t)(data[i] & 0x7f) << (7 * i);
+        if (! (data[i] & 0x80))
+            return i + 1;
+    }
+    return 0;
+}
+
+
+/// Map signed integer to unsigned so small negative numbers are small
+static uint64_t zigZag(int64_t value)
+{
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+
+/// Reverse zig-zag encoding
+static int64_t unZigZag(uint64_t value)
+{
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+
+void xa::recordEncodeTimes(std::vector<unsigned char> &buf,
+        const std::vector<uint32_t> &times)
+{
+    uint32_t prev = 0;
+    for (std::vector<uint32_t>::const_iterator i = times.begin();
+            i != times.end(); i++)
+    {
+        recordPutVarint(buf, *i - prev);
+        prev = *i;
+    }
+}
+
+
+const unsigned char* xa::recordDecodeTimes(const unsigned char *data,
+        const unsigned char *end, int rows, std::vector<uint32_t> &times)
+{
+    times.resize(rows);
+    uint32_t prev = 0;
+    for (int i = 0; i < rows; i++) {
+        uint64_t delta;
+        int len = recordGetVarint(data, end, delta);
+        if (! len)
+            return NULL;
+        data += len;
+        prev += delta;
+        times[i] = prev;
+    }
+    return data;
+}
+
+
+void xa::recordEncodeColumn(std::vector<unsigned char> &buf,
+        const RecordColumn &column)
+{
+    if (PROP_STRING == column.type) {
+        const std::string *prev = NULL;
+        for (std::vector<std::string>::const_iterator i =
+                column.strings.begin(); i != column.strings.end(); i++)
+        {
+            if (prev && (*prev == *i))
+                recordPutVarint(buf, 0);
+            else {
+                recordPutVarint(buf, (*i).length() + 1);
+                buf.insert(buf.end(), (*i).begin(), (*i).end());
+            }
+            prev = &(*i);
+        }
+        return;
+    }
+
+    uint64_t prev = 0;
+    for (std::vector<uint64_t>::const_iterator i = column.numbers.begin();
+            i != column.numbers.end(); i++)
+    {
+        if (PROP_INT == column.type)
+            recordPutVarint(buf, zigZag((int64_t)*i - (int64_t)prev));
+        else {
+            uint64_t x = *i ^ prev;
+            if (! x)
+                buf.push_back(0);
+            else {
+                int zeros = 0;
+                while (! (x & 1)) {
+                    x >>= 1;
+                    zeros++;
+                }
+                buf.push_back(zeros + 1);
+                recordPutVarint(buf, x);
+            }
+        }
+        prev = *i;
+    }
+}
+
+
+const unsigned char* xa::recordDecodeColumn(const unsigned char *data,
+        const unsigned char *end, int rows, RecordColumn &column)
+{
+    column.clear();
+
+    if (PROP_STRING == column.type) {
+        column.strings.resize(rows);
+        for (int i = 0; i < rows; i++) {
+            uint64_t len;
+            int sz = recordGetVarint(data, end, len);
+            if (! sz)
+                return NULL;
+            data += sz;
+            if (! len) {
+                if (i)
+                    column.strings[i] = column.strings[i - 1];
+                continue;
+            }
+            len--;
+            if ((uint64_t)(end - data) < len)
+                return NULL;
+            column.strings[i].assign((const char*)data, len);
+            data += len;
+        }
+        return data;
+    }
+
+    column.numbers.resize(rows);
+    uint64_t prev = 0;
+    for (int i = 0; i < rows; i++) {
+        if (PROP_INT == column.type) {
+            uint64_t delta;
+            int sz = recordGetVarint(data, end, delta);
+            if (! sz)
+                return NULL;
+            data += sz;
+            prev = (uint64_t)((int64_t)prev + unZigZag(delta));
+        } else {
+            if (data >= end)
+                return NULL;
+            int zeros = *data++;
+            if (zeros) {
+                uint64_t x;
+                int sz = recordGetVarint(data, end, x);
+                if ((! sz) || (zeros > 64))
+                    return NULL;
+                data += sz;
+                prev ^= x << (zeros - 1);
+            }
+        }
+        column.numbers[i] = prev;
+    }
+    return data;
+}
+
+
+uint64_t xa::recordFloatBits(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+
+float xa::recordBitsFloat(uint64_t bits)
+{
+    uint32_t v = (uint32_t)bits;
+    float value;
+    memcpy(&value, &v, sizeof(value));
+    return value;
+}
+
+
+uint64_t xa::recordDoubleBits(double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+
+double xa::recordBitsDouble(uint64_t bits)
+{
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+
+double xa::recordBitsToNumber(int type, uint64_t bits)
+{
+    switch (type) {
+        case PROP_INT: return (int64_t)bits;
+        case PROP_FLOAT: return recordBitsFloat(bits);
+        case PROP_DOUBLE: return recordBitsDouble(bits);
+    }
+    return 0;
+}
+
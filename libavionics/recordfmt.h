@@ -0,0 +1,127 @@
+#ifndef __RECORD_FMT_H__
+#define __RECORD_FMT_H__
+
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+
+/// Flight-data record file format.
+///
+/// File starts with header:
+///     8 bytes   signature "SASLREC\0"
+///     uint32    format version
+///     uint32    sampling period in milliseconds
+///     uint32    number of columns
+///     for every column:
+///         uint8     type of property
+///         uint16    length of name
+///         name of property
+///
+/// Header is followed by chunks appended one after another:
+///     uint32    chunk signature
+///     uint32    number of rows
+///     uint32    time of first row in milliseconds since recording start
+///     uint32    time of last row
+///     uint32    size of payload
+///     payload
+///
+/// Payload stores values column by column.  First column is time of rows
+/// encoded as deltas, then columns of properties in header order.
+/// Integers are stored as zig-zag encoded varint deltas from previous
+/// value, floats and doubles are XORed with bits of previous value and
+/// stored with trailing zeros stripped, strings are stored as length
+/// prefixed bytes or single zero byte if string didn't change.
+/// Every chunk starts from zero previous values so chunks can be decoded
+/// independently.  All integers are little-endian.  Truncated last chunk
+/// is ignored by reader.
+
+
+namespace xa {
+
+
+/// Record file signature
+extern const char RECORD_SIGNATURE[8];
+
+/// Current version of format
+const uint32_t RECORD_VERSION = 1;
+
+/// Chunk signature
+const uint32_t RECORD_CHUNK_SIGNATURE = 0x4b4e4843;
+
+/// Size of chunk header in bytes
+const int RECORD_CHUNK_HEADER_SIZE = 20;
+
+
+/// Values of one property column.  Numbers are stored as raw bits:
+/// integers as is, floats and doubles as bits of IEEE representation.
+struct RecordColumn
+{
+    /// Type of property
+    int type;
+
+    /// Bits of numeric values
+    std::vector<uint64_t> numbers;
+
+    /// String values
+    std::vector<std::string> strings;
+
+    /// Remove all values
+    void clear();
+};
+
+
+/// Append unsigned integer to buffer as little-endian bytes
+void recordPutUint(std::vector<unsigned char> &buf, uint64_t value,
+        int size);
+
+/// Read little-endian integer of specified size
+uint64_t recordGetUint(const unsigned char *data, int size);
+
+/// Append variable length integer
+void recordPutVarint(std::vector<unsigned char> &buf, uint64_t value);
+
+/// Read variable length integer.  Returns number of bytes read or zero
+/// if data is truncated or invalid
+int recordGetVarint(const unsigned char *data, const unsigned char *end,
+        uint64_t &value);
+
+/// Encode column of row times
+void recordEncodeTimes(std::vector<unsigned char> &buf,
+        const std::vector<uint32_t> &times);
+
+/// Decode column of row times.  Returns pointer after decoded data or
+/// NULL on errors
+const unsigned char* recordDecodeTimes(const unsigned char *data,
+        const unsigned char *end, int rows, std::vector<uint32_t> &times);
+
+/// Encode column of property values
+void recordEncodeColumn(std::vector<unsigned char> &buf,
+        const RecordColumn &column);
+
+/// Decode column of property values.  Type of column must be set.
+/// Returns pointer after decoded data or NULL on errors
+const unsigned char* recordDecodeColumn(const unsigned char *data,
+        const unsigned char *end, int rows, RecordColumn &column);
+
+/// Convert float to raw bits
+uint64_t recordFloatBits(float value);
+
+/// Convert raw bits to float
+float recordBitsFloat(uint64_t bits);
+
+/// Convert double to raw bits
+uint64_t recordDoubleBits(double value);
+
+/// Convert raw bits to double
+double recordBitsDouble(uint64_t bits);
+
+/// Convert raw bits of column value to double
+double recordBitsToNumber(int type, uint64_t bits);
+
+};
+
+
+#endif
+
@@ -0,0 +1,271 @@
+#include "recordreader.h"
+
+#include <stdio.h>
+#include <string.h>
+#ifndef WINDOWS
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include "libavcallbacks.h"
+
+
+using namespace xa;
+
+
+/// Size of file header without columns
+#define HEADER_SIZE 20
+
+
+RecordReader::RecordReader()
+{
+    data = NULL;
+    size = 0;
+    period = 0;
+    rowsCount = 0;
+    decodedChunk = -1;
+}
+
+
+RecordReader::~RecordReader()
+{
+    close();
+}
+
+
+int RecordReader::open(const std::string &fileName)
+{
+    close();
+
+#ifndef WINDOWS
+    int fd = ::open(fileName.c_str(), O_RDONLY);
+    if (-1 == fd)
+        return -1;
+    struct stat st;
+    if (fstat(fd, &st) || (! st.st_size)) {
+        ::close(fd);
+        return -1;
+    }
+    void *p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (MAP_FAILED == p)
+        return -1;
+    data = (const unsigned char*)p;
+    size = st.st_size;
+#else
+    FILE *f = fopen(fileName.c_str(), "rb");
+    if (! f)
+        return -1;
+    unsigned char buf[4096];
+    size_t len;
+    while (0 < (len = fread(buf, 1, sizeof(buf), f)))
+        buffer.insert(buffer.end(), buf, buf + len);
+    fclose(f);
+    if (buffer.empty())
+        return -1;
+    data = &buffer[0];
+    size = buffer.size();
+#endif
+
+    if (parse()) {
+        close();
+        return -1;
+    }
+
+    return 0;
+}
+
+
+void RecordReader::close()
+{
+#ifndef WINDOWS
+    if (data)
+        munmap((void*)data, size);
+#endif
+    buffer.clear();
+    data = NULL;
+    size = 0;
+    period = 0;
+    rowsCount = 0;
+    columns.clear();
+    chunks.clear();
+    decodedChunk = -1;
+}
+
+
+int RecordReader::parse()
+{
+    if ((size < HEADER_SIZE) || memcmp(data, RECORD_SIGNATURE,
+                sizeof(RECORD_SIGNATURE)))
+        return -1;
+    if (RECORD_VERSION != recordGetUint(data + 8, 4))
+        return -1;
+
+    period = recordGetUint(data + 12, 4);
+    uint32_t count = recordGetUint(data + 16, 4);
+
+    const unsigned char *p = data + HEADER_SIZE;
+    const unsigned char *end = data + size;
+    for (uint32_t i = 0; i < count; i++) {
+        if (end - p < 3)
+            return -1;
+        Column column;
+        column.type = p[0];
+        int len = recordGetUint(p + 1, 2);
+        p += 3;
+        if ((end - p < len) || (PROP_INT > column.type) ||
+                (PROP_STRING < column.type))
+            return -1;
+        column.name.assign((const char*)p, len);
+        p += len;
+        columns.push_back(column);
+    }
+
+    // chunk which is truncated or broken ends the file
+    while (end - p >= RECORD_CHUNK_HEADER_SIZE) {
+        if (RECORD_CHUNK_SIGNATURE != recordGetUint(p, 4))
+            break;
+        ChunkInfo chunk;
+        chunk.rows = recordGetUint(p + 4, 4);
+        chunk.firstTime = recordGetUint(p + 8, 4);
+        chunk.lastTime = recordGetUint(p + 12, 4);
+        chunk.size = recordGetUint(p + 16, 4);
+        chunk.payload = p + RECORD_CHUNK_HEADER_SIZE;
+        chunk.firstRow = rowsCount;
+        if ((chunk.rows <= 0) ||
+                ((uint64_t)(end - chunk.payload) < chunk.size))
+            break;
+        chunks.push_back(chunk);
+        rowsCount += chunk.rows;
+        p = chunk.payload + chunk.size;
+    }
+
+    return 0;
+}
+
+
+int RecordReader::findColumn(const std::string &name, int type) const
+{
+    for (size_t i = 0; i < columns.size(); i++)
+        if ((columns[i].name == name) && (columns[i].type == type))
+            return i;
+    return -1;
+}
+
+
+long RecordReader::getDuration() const
+{
+    if (chunks.empty())
+        return 0;
+    return chunks.back().lastTime;
+}
+
+
+int RecordReader::load(unsigned long row)
+{
+    if (row >= rowsCount)
+        return -1;
+
+    if (-1 != decodedChunk) {
+        const ChunkInfo &chunk = chunks[decodedChunk];
+        if ((row >= chunk.firstRow) && (row < chunk.firstRow + chunk.rows))
+            return row - chunk.firstRow;
+    }
+
+    // binary search of chunk containing row
+    int lo = 0, hi = chunks.size() - 1;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if (chunks[mid].firstRow <= row)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+
+    const ChunkInfo &chunk = chunks[lo];
+    const unsigned char *p = chunk.payload;
+    const unsigned char *end = p + chunk.size;
+
+    decodedChunk = -1;
+    p = recordDecodeTimes(p, end, chunk.rows, times);
+    values.resize(columns.size());
+    for (size_t i = 0; p && (i < columns.size()); i++) {
+        values[i].type = columns[i].type;
+        p = recordDecodeColumn(p, end, chunk.rows, values[i]);
+    }
+    if (! p)
+        return -1;
+
+    decodedChunk = lo;
+    return row - chunk.firstRow;
+}
+
+
+unsigned long RecordReader::findRow(long time)
+{
+    if (chunks.empty())
+        return 0;
+
+    int lo = 0, hi = chunks.size() - 1;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if ((long)chunks[mid].firstTime <= time)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+
+    const ChunkInfo &chunk = chunks[lo];
+    if (-1 == load(chunk.firstRow))
+        return 0;
+
+    int first = 0, last = chunk.rows - 1;
+    while (first < last) {
+        int mid = (first + last + 1) / 2;
+        if ((long)times[mid] <= time)
+            first = mid;
+        else
+            last = mid - 1;
+    }
+    return chunk.firstRow + first;
+}
+
+
+long RecordReader::getTime(unsigned long row)
+{
+    int i = load(row);
+    if (-1 == i)
+        return 0;
+    return times[i];
+}
+
+
+uint64_t RecordReader::getBits(unsigned long row, int column)
+{
+    int i = load(row);
+    if ((-1 == i) || (0 > column) || (column >= (int)columns.size()) ||
+            (PROP_STRING == columns[column].type))
+        return 0;
+    return values[column].numbers[i];
+}
+
+
+double RecordReader::getNumber(unsigned long row, int column)
+{
+    if ((0 > column) || (column >= (int)columns.size()))
+        return 0;
+    return recordBitsToNumber(columns[column].type, getBits(row, column));
+}
+
+
+const std::string& RecordReader::getString(unsigned long row, int column)
+{
+    static const std::string empty;
+    int i = load(row);
+    if ((-1 == i) || (0 > column) || (column >= (int)columns.size()) ||
+            (PROP_STRING != columns[column].type))
+        return empty;
+    return values[column].strings[i];
+}
+
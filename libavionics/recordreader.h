@@ -0,0 +1,148 @@
+#ifndef __RECORD_READER_H__
+#define __RECORD_READER_H__
+
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "recordfmt.h"
+
+
+namespace xa {
+
+
+/// Reads flight-data record files written by Recorder.
+/// File is mapped to memory and only chunks index is built on open.
+/// Chunks are decoded on demand, last decoded chunk is cached so
+/// sequential access decodes every chunk once.
+class RecordReader
+{
+    private:
+        /// Recorded property
+        struct Column {
+            /// name of property
+            std::string name;
+
+            /// type of property
+            int type;
+        };
+
+        /// Position of chunk in file
+        struct ChunkInfo {
+            /// pointer to chunk payload
+            const unsigned char *payload;
+
+            /// size of payload
+            uint32_t size;
+
+            /// index of first row
+            unsigned long firstRow;
+
+            /// number of rows
+            int rows;
+
+            /// time of first row
+            uint32_t firstTime;
+
+            /// time of last row
+            uint32_t lastTime;
+        };
+
+        /// Mapped file data
+        const unsigned char *data;
+
+        /// Size of mapped data
+        size_t size;
+
+        /// File data if memory mapping is unavailable
+        std::vector<unsigned char> buffer;
+
+        /// Sampling period
+        long period;
+
+        /// Recorded properties
+        std::vector<Column> columns;
+
+        /// Chunks index
+        std::vector<ChunkInfo> chunks;
+
+        /// Total number of rows
+        unsigned long rowsCount;
+
+        /// Index of decoded chunk or -1
+        int decodedChunk;
+
+        /// Times of decoded chunk rows
+        std::vector<uint32_t> times;
+
+        /// Values of decoded chunk
+        std::vector<RecordColumn> values;
+
+    public:
+        /// Create reader without file
+        RecordReader();
+
+        /// Close file
+        ~RecordReader();
+
+    public:
+        /// Open record file.  Returns zero on success.
+        int open(const std::string &fileName);
+
+        /// Close record file
+        void close();
+
+        /// Returns sampling period in milliseconds
+        long getPeriod() const { return period; }
+
+        /// Returns number of recorded properties
+        int getColumnsCount() const { return columns.size(); }
+
+        /// Returns name of recorded property
+        const std::string& getColumnName(int column) const {
+            return columns[column].name;
+        }
+
+        /// Returns type of recorded property
+        int getColumnType(int column) const { return columns[column].type; }
+
+        /// Returns index of column or -1 if property wasn't recorded
+        int findColumn(const std::string &name, int type) const;
+
+        /// Returns number of recorded rows
+        unsigned long getRowsCount() const { return rowsCount; }
+
+        /// Returns time of last row
+        long getDuration() const;
+
+        /// Returns index of last row recorded not later than time
+        /// or 0 if there is no such row
+        unsigned long findRow(long time);
+
+        /// Returns time of row in milliseconds since recording start
+        long getTime(unsigned long row);
+
+        /// Returns value of numeric property
+        double getNumber(unsigned long row, int column);
+
+        /// Returns raw bits of numeric property value
+        uint64_t getBits(unsigned long row, int column);
+
+        /// Returns value of string property
+        const std::string& getString(unsigned long row, int column);
+
+    private:
+        /// Parse header and build chunks index.  Returns zero on success.
+        int parse();
+
+        /// Decode chunk containing row.  Returns index of row in chunk
+        /// or -1 on errors
+        int load(unsigned long row);
+};
+
+
+};
+
+
+#endif
+
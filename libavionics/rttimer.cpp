@@ -8,14 +8,33 @@
 
 using namespace xa;
 
+
+/// Custom time source or NULL to use system clock
+static RtTimeSource timeSource = NULL;
+
+/// Reference passed to custom time source
+static void *timeSourceRef = NULL;
+
+
+void RtTimer::setTimeSource(RtTimeSource source, void *ref)
+{
+    timeSource = source;
+    timeSourceRef = ref;
+}
+
 #ifdef _MSC_VER
 RtTimer::RtTimer()
 {
     startSeconds = GetTickCount();
+    source = timeSource;
+    sourceRef = timeSourceRef;
+    startTime = source ? source(sourceRef) : 0;
 }
 
 long RtTimer::getTime()
 {
+    if (source)
+        return source(sourceRef) - startTime;
     return GetTickCount() - startSeconds;
 }
 #else
@@ -24,10 +43,16 @@ RtTimer::RtTimer()
     struct timeval tv;
     gettimeofday(&tv, NULL);
     startSeconds = tv.tv_sec;
+    source = timeSource;
+    sourceRef = timeSourceRef;
+    startTime = source ? source(sourceRef) : 0;
 }
 
 long RtTimer::getTime()
 {
+    if (source)
+        return source(sourceRef) - startTime;
+
     struct timeval tv;
     gettimeofday(&tv, NULL);
     int seconds = tv.tv_sec - startSeconds;
@@ -11,18 +11,36 @@
 namespace xa {
 
 
+/// Returns current time in milliseconds
+typedef long (*RtTimeSource)(void *ref);
+
+
 /// Counts time in milliseconds since tmer start
 class RtTimer
 {
     private:
         time_t startSeconds;
 
+        /// Value of time source at timer creation
+        long startTime;
+
+        /// Time source captured at timer creation or NULL
+        RtTimeSource source;
+
+        /// Reference passed to time source
+        void *sourceRef;
+
     public:
         RtTimer();
 
     public:
         /// Returns number of milliseconds passed from timer creation
         long getTime();
+
+        /// Replace system clock with custom time source for all timers
+        /// created after this call.  Used to replay recorded sessions.
+        /// Pass NULL to restore system clock.
+        static void setTimeSource(RtTimeSource source, void *ref);
 };
 
 
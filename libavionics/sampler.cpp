@@ -0,0 +1,204 @@
+#include "sampler.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include "avionics.h"
+
+
+using namespace xa;
+
+
+/// Number of aborted functions written to log by default
+#define DUMP_ENTRIES 20
+
+
+Sampler::Sampler(Log &log): log(log)
+{
+    samples = 0;
+}
+
+
+void Sampler::addSamples(const std::string &stack, unsigned long count)
+{
+    stacks[stack] += count;
+    samples += count;
+}
+
+
+void Sampler::addAbort(const std::string &location, const std::string &reason)
+{
+    std::map<std::string, TraceAbort>::iterator i = aborts.find(location);
+    if (i == aborts.end()) {
+        TraceAbort abort;
+        abort.location = location;
+        abort.count = 1;
+        abort.reason = reason;
+        aborts[location] = abort;
+    } else {
+        (*i).second.count++;
+        (*i).second.reason = reason;
+    }
+}
+
+
+void Sampler::reset()
+{
+    stacks.clear();
+    aborts.clear();
+    samples = 0;
+}
+
+
+int Sampler::writeSamples(const std::string &fileName) const
+{
+    FILE *f = fopen(fileName.c_str(), "w");
+    if (! f) {
+        log.error("Can't create samples file %s", fileName.c_str());
+        return -1;
+    }
+
+    for (std::map<std::string, unsigned long>::const_iterator i =
+            stacks.begin(); i != stacks.end(); i++)
+        fprintf(f, "%s %lu\n", (*i).first.c_str(), (*i).second);
+
+    fclose(f);
+    return 0;
+}
+
+
+/// Compare aborts by count
+static bool compareAborts(const TraceAbort &a, const TraceAbort &b)
+{
+    return a.count > b.count;
+}
+
+
+void Sampler::getAborts(std::vector<TraceAbort> &report) const
+{
+    report.clear();
+    for (std::map<std::string, TraceAbort>::const_iterator i =
+            aborts.begin(); i != aborts.end(); i++)
+        report.push_back((*i).second);
+    std::sort(report.begin(), report.end(), compareAborts);
+}
+
+
+int Sampler::writeAborts(const std::string &fileName) const
+{
+    FILE *f = fopen(fileName.c_str(), "w");
+    if (! f) {
+        log.error("Can't create trace aborts file %s", fileName.c_str());
+        return -1;
+    }
+
+    std::vector<TraceAbort> report;
+    getAborts(report);
+    for (std::vector<TraceAbort>::iterator i = report.begin();
+            i != report.end(); i++)
+        fprintf(f, "%lu\t%s\t%s\n", (*i).count, (*i).location.c_str(),
+                (*i).reason.c_str());
+
+    fclose(f);
+    return 0;
+}
+
+
+void Sampler::dump(int maxEntries) const
+{
+    log.info("Samples collected: %lu, distinct stacks: %lu", samples,
+            (unsigned long)stacks.size());
+
+    std::vector<TraceAbort> report;
+    getAborts(report);
+    if (report.empty())
+        return;
+
+    log.info("Trace aborts:");
+    int n = 0;
+    for (std::vector<TraceAbort>::iterator i = report.begin();
+            (i != report.end()) && (n < maxEntries); i++, n++)
+        log.info("%6lu %s: %s", (*i).count, (*i).location.c_str(),
+                (*i).reason.c_str());
+}
+
+
+/// Add samples of stack
+/// arguments: folded stack, number of samples
+static int luaAddSamples(lua_State *L)
+{
+    if (! lua_isstring(L, 1))
+        return 0;
+    unsigned long count = 1;
+    if (lua_isnumber(L, 2))
+        count = (unsigned long)lua_tonumber(L, 2);
+    getAvionics(L)->getSampler().addSamples(lua_tostring(L, 1), count);
+    return 0;
+}
+
+
+/// Add trace abort
+/// arguments: location of function, reason of abort
+static int luaAddTraceAbort(lua_State *L)
+{
+    if (! lua_isstring(L, 1))
+        return 0;
+    const char *reason = lua_tostring(L, 2);
+    getAvionics(L)->getSampler().addAbort(lua_tostring(L, 1),
+            reason ? reason : "");
+    return 0;
+}
+
+
+/// Lua wrapper for writeSamples
+static int luaWriteSamples(lua_State *L)
+{
+    if (! lua_isstring(L, 1))
+        return 0;
+    lua_pushboolean(L, ! getAvionics(L)->getSampler().writeSamples(
+                lua_tostring(L, 1)));
+    return 1;
+}
+
+
+/// Lua wrapper for writeAborts
+static int luaWriteTraceAborts(lua_State *L)
+{
+    if (! lua_isstring(L, 1))
+        return 0;
+    lua_pushboolean(L, ! getAvionics(L)->getSampler().writeAborts(
+                lua_tostring(L, 1)));
+    return 1;
+}
+
+
+/// Lua wrapper for reset
+static int luaResetSamples(lua_State *L)
+{
+    getAvionics(L)->getSampler().reset();
+    return 0;
+}
+
+
+/// Lua wrapper for dump
+static int luaDumpSamples(lua_State *L)
+{
+    int maxEntries = DUMP_ENTRIES;
+    if (lua_isnumber(L, 1))
+        maxEntries = lua_tointeger(L, 1);
+    getAvionics(L)->getSampler().dump(maxEntries);
+    return 0;
+}
+
+
+void xa::exportSamplerToLua(Luna &lua)
+{
+    lua_State *L = lua.getLua();
+
+    lua_register(L, "addSamples", luaAddSamples);
+    lua_register(L, "addTraceAbort", luaAddTraceAbort);
+    lua_register(L, "writeSamples", luaWriteSamples);
+    lua_register(L, "writeTraceAborts", luaWriteTraceAborts);
+    lua_register(L, "resetSamples", luaResetSamples);
+    lua_register(L, "dumpSamples", luaDumpSamples);
+}
+
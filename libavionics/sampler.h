@@ -0,0 +1,94 @@
+#ifndef __SAMPLER_H__
+#define __SAMPLER_H__
+
+
+#include <string>
+#include <map>
+#include <vector>
+#include "luna.h"
+
+
+namespace xa {
+
+
+class Log;
+
+
+/// Trace aborts of one function
+struct TraceAbort
+{
+    /// Source file and line of function
+    std::string location;
+
+    /// Number of aborts
+    unsigned long count;
+
+    /// Reason of last abort
+    std::string reason;
+};
+
+
+/// Collects samples of LuaJIT sampling profiler and trace aborts.
+/// Sampling itself is done by jit.profile module driven by init.lua which
+/// passes folded stacks prefixed with path of current component here.
+class Sampler
+{
+    private:
+        /// Logger
+        Log &log;
+
+        /// Number of samples by folded stacks
+        std::map<std::string, unsigned long> stacks;
+
+        /// Trace aborts by location of function
+        std::map<std::string, TraceAbort> aborts;
+
+        /// Total number of samples
+        unsigned long samples;
+
+    public:
+        /// Create empty sampler
+        Sampler(Log &log);
+
+    public:
+        /// Add samples of stack
+        /// \param stack frames separated by semicolons, outermost first
+        /// \param count number of samples
+        void addSamples(const std::string &stack, unsigned long count);
+
+        /// Add trace abort
+        /// \param location source file and line of aborted function
+        /// \param reason description of abort
+        void addAbort(const std::string &location, const std::string &reason);
+
+        /// Forget all samples and aborts
+        void reset();
+
+        /// Write samples in folded stacks format used by flame graph tools.
+        /// Returns zero on success.
+        int writeSamples(const std::string &fileName) const;
+
+        /// Returns trace aborts sorted by count in descending order
+        void getAborts(std::vector<TraceAbort> &report) const;
+
+        /// Write trace aborts sorted by count.  Returns zero on success.
+        int writeAborts(const std::string &fileName) const;
+
+        /// Returns total number of samples
+        unsigned long getSamplesCount() const { return samples; }
+
+        /// Write summary of samples and aborts to log
+        /// \param maxEntries maximum number of aborted functions to write
+        void dump(int maxEntries) const;
+};
+
+
+/// Register sampler functions in Lua
+void exportSamplerToLua(Luna &lua);
+
+
+};
+
+
+#endif
+
@@ -28,6 +28,15 @@ int Sound::loadSample(const char *fileName)
 }
 
 
+int Sound::loadSample(const char *name, const void *data, int size)
+{
+    if (sound && sound->load_buffer)
+        return sound->load_buffer(sound, name, data, size);
+    else
+        return 0;
+}
+
+
 void Sound::unloadSample(int sampleId)
 {
     if (sound && sound->unload)
@@ -222,6 +231,8 @@ void Sound::setMasterGain(int gain)
 
 void Sound::update()
 {
+    TRACE_SCOPE("sound update");
+
     if (sound && sound->update)
         sound->update(sound);
 }
@@ -229,7 +240,40 @@ void Sound::update()
 
 static int luaLoadSample(lua_State *L)
 {
-    int sampleId = getAvionics(L)->getSound().loadSample(lua_tostring(L, 1));
+    Avionics *avionics = getAvionics(L);
+    Sound &sound = avionics->getSound();
+    const char *fileName = lua_tostring(L, 1);
+
+    StartupProfile &startup = avionics->getStartupProfile();
+    double startTime = Profiler::getTime();
+
+    Preloader::Asset asset;
+    if (fileName && sound.canLoadBuffers() &&
+            (! avionics->getPreloader().take(fileName, asset)))
+    {
+        double uploadTime = Profiler::getTime();
+        int sampleId = sound.loadSample(fileName, &asset.data[0],
+                asset.data.size());
+        startup.addAsset(fileName, Preloader::PRELOAD_SAMPLE, asset.size,
+                asset.decodeTime, (Profiler::getTime() - uploadTime) / 1000.0,
+                (uploadTime - startTime) / 1000.0);
+        lua_pushnumber(L, sampleId);
+        return 1;
+    }
+
+    const unsigned char *data;
+    size_t size = 0;
+    int sampleId;
+    if (fileName && sound.canLoadBuffers() &&
+            (! avionics->getVfs().readPacked(fileName, data, size)))
+        sampleId = sound.loadSample(fileName, data, size);
+    else
+        sampleId = sound.loadSample(fileName);
+
+    // samples loaded by sound engine are read and decoded with upload
+    if (fileName && sampleId)
+        startup.addAsset(fileName, Preloader::PRELOAD_SAMPLE, size, 0,
+                (Profiler::getTime() - startTime) / 1000.0, 0);
     lua_pushnumber(L, sampleId);
     return 1;
 }
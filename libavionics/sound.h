@@ -27,6 +27,16 @@ class Sound
         /// Load sample into memory.  Returns sample handler or 0 if can't load sample
         /// \param fileName path to sample on disk
         int loadSample(const char *fileName);
+
+        /// Load sample from memory.  Returns sample handler or 0 if can't
+        /// load sample
+        /// \param name name of sample
+        /// \param data contents of sample file
+        /// \param size size of data
+        int loadSample(const char *name, const void *data, int size);
+
+        /// Returns true if sound engine can load samples from memory
+        bool canLoadBuffers() const { return sound && sound->load_buffer; };
         
         /// Unload sample to free memory
         /// \param sampleId sample handler
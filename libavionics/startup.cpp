@@ -0,0 +1,315 @@
+#include "startup.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include "preloader.h"
+#include "profiler.h"
+#include "avionics.h"
+
+
+using namespace xa;
+
+
+/// First line of manifest
+#define MANIFEST_SIGNATURE "# SASL startup manifest 1"
+
+
+/// Returns name of kind of asset
+static const char* getKindName(int kind)
+{
+    return Preloader::PRELOAD_SAMPLE == kind ? "sample" : "image";
+}
+
+
+/// Returns total cost of asset
+static double getCost(const StartupAsset &asset)
+{
+    return asset.decodeTime + asset.uploadTime + asset.waitTime;
+}
+
+
+/// Compare assets by cost in descending order
+static bool isCostlierAsset(const StartupAsset &a, const StartupAsset &b)
+{
+    return getCost(a) > getCost(b);
+}
+
+
+/// Compare components by self time in descending order
+static bool isCostlierComponent(const StartupComponent &a,
+        const StartupComponent &b)
+{
+    return a.self > b.self;
+}
+
+
+StartupProfile::StartupProfile()
+{
+    enabled = true;
+    recording = false;
+    startTime = 0;
+    loadTime = 0;
+}
+
+
+void StartupProfile::begin()
+{
+    assets.clear();
+    assetsByName.clear();
+    components.clear();
+    componentsByName.clear();
+    stack.clear();
+    loadTime = 0;
+    startTime = Profiler::getTime();
+    recording = true;
+}
+
+
+void StartupProfile::end()
+{
+    loadTime = (Profiler::getTime() - startTime) / 1000.0;
+    recording = false;
+    stack.clear();
+}
+
+
+void StartupProfile::addAsset(const std::string &fileName, int kind,
+        size_t size, double decodeTime, double uploadTime, double waitTime)
+{
+    if (! recording)
+        return;
+
+    std::map<std::string, int>::iterator i = assetsByName.find(fileName);
+    if (i != assetsByName.end()) {
+        StartupAsset &asset = assets[(*i).second];
+        asset.decodeTime += decodeTime;
+        asset.uploadTime += uploadTime;
+        asset.waitTime += waitTime;
+        return;
+    }
+
+    StartupAsset asset;
+    asset.fileName = fileName;
+    asset.kind = kind;
+    asset.size = size;
+    asset.decodeTime = decodeTime;
+    asset.uploadTime = uploadTime;
+    asset.waitTime = waitTime;
+    assetsByName[fileName] = assets.size();
+    assets.push_back(asset);
+}
+
+
+void StartupProfile::beginComponent(const std::string &name)
+{
+    if (! recording)
+        return;
+
+    Call call;
+    std::map<std::string, int>::iterator i = componentsByName.find(name);
+    if (i != componentsByName.end())
+        call.component = (*i).second;
+    else {
+        StartupComponent component;
+        component.name = name;
+        component.count = 0;
+        component.total = component.self = 0;
+        call.component = components.size();
+        componentsByName[name] = call.component;
+        components.push_back(component);
+    }
+    call.nested = 0;
+    call.start = Profiler::getTime();
+    stack.push_back(call);
+}
+
+
+void StartupProfile::endComponent()
+{
+    if (stack.empty())
+        return;
+
+    Call &call = stack.back();
+    double elapsed = (Profiler::getTime() - call.start) / 1000.0;
+    StartupComponent &component = components[call.component];
+    component.count++;
+    component.total += elapsed;
+    component.self += elapsed - call.nested;
+    stack.pop_back();
+
+    if (! stack.empty())
+        stack.back().nested += elapsed;
+}
+
+
+int StartupProfile::writeManifest(const std::string &fileName,
+        const std::string &panelDir) const
+{
+    FILE *f = fopen(fileName.c_str(), "w");
+    if (! f)
+        return -1;
+
+    fprintf(f, "%s\n", MANIFEST_SIGNATURE);
+    fprintf(f, "# kind size decode_ms upload_ms wait_ms file\n");
+
+    std::string prefix = panelDir + "/";
+    for (std::vector<StartupAsset>::const_iterator i = assets.begin();
+            i != assets.end(); i++)
+    {
+        const StartupAsset &asset = *i;
+        std::string name = asset.fileName;
+        if ((! panelDir.empty()) && (! name.compare(0, prefix.size(), prefix)))
+            name = name.substr(prefix.size());
+        fprintf(f, "%s %lu %.3f %.3f %.3f %s\n", getKindName(asset.kind),
+                (unsigned long)asset.size, asset.decodeTime,
+                asset.uploadTime, asset.waitTime, name.c_str());
+    }
+
+    bool failed = ferror(f);
+    if (fclose(f) || failed)
+        return -1;
+    return 0;
+}
+
+
+int StartupProfile::readManifest(const std::string &fileName,
+        const std::string &panelDir, std::vector<StartupAsset> &assets)
+{
+    FILE *f = fopen(fileName.c_str(), "r");
+    if (! f)
+        return -1;
+
+    char line[4096];
+    if ((! fgets(line, sizeof(line), f)) ||
+            strncmp(line, MANIFEST_SIGNATURE, strlen(MANIFEST_SIGNATURE)))
+    {
+        fclose(f);
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), f)) {
+        size_t len = strlen(line);
+        while (len && (('\n' == line[len - 1]) || ('\r' == line[len - 1])))
+            line[--len] = 0;
+        if ((! len) || ('#' == line[0]))
+            continue;
+
+        char kind[16];
+        unsigned long size;
+        int pos = 0;
+        StartupAsset asset;
+        if ((5 != sscanf(line, "%15s %lu %lf %lf %lf %n", kind, &size,
+                    &asset.decodeTime, &asset.uploadTime, &asset.waitTime,
+                    &pos)) || (! pos) || (! line[pos]))
+            continue;
+
+        asset.kind = strcmp(kind, "sample") ? Preloader::PRELOAD_IMAGE :
+            Preloader::PRELOAD_SAMPLE;
+        asset.size = size;
+        asset.fileName = line + pos;
+        if (('/' != asset.fileName[0]) && (std::string::npos ==
+                    asset.fileName.find(':')) && (! panelDir.empty()))
+            asset.fileName = panelDir + "/" + asset.fileName;
+        assets.push_back(asset);
+    }
+
+    fclose(f);
+    return 0;
+}
+
+
+int StartupProfile::writeReport(const std::string &fileName,
+        int maxEntries) const
+{
+    FILE *f = fopen(fileName.c_str(), "w");
+    if (! f)
+        return -1;
+
+    double decode = 0, upload = 0, wait = 0;
+    size_t size = 0;
+    for (std::vector<StartupAsset>::const_iterator i = assets.begin();
+            i != assets.end(); i++)
+    {
+        decode += (*i).decodeTime;
+        upload += (*i).uploadTime;
+        wait += (*i).waitTime;
+        size += (*i).size;
+    }
+
+    fprintf(f, "SASL startup report\n\n");
+    fprintf(f, "Panel loaded in %.1f ms\n", loadTime);
+    fprintf(f, "Assets: %i, %lu KB, decode %.1f ms, upload %.1f ms, "
+            "wait %.1f ms\n", (int)assets.size(), (unsigned long)size / 1024,
+            decode, upload, wait);
+    fprintf(f, "Components: %i\n", (int)components.size());
+
+    std::vector<StartupComponent> sortedComponents(components);
+    std::sort(sortedComponents.begin(), sortedComponents.end(),
+            isCostlierComponent);
+    fprintf(f, "\nSlowest components (ms):\n");
+    fprintf(f, "%10s %10s %6s  %s\n", "self", "total", "count", "name");
+    for (int i = 0; (i < (int)sortedComponents.size()) && (i < maxEntries);
+            i++)
+    {
+        const StartupComponent &c = sortedComponents[i];
+        fprintf(f, "%10.2f %10.2f %6i  %s\n", c.self, c.total, c.count,
+                c.name.c_str());
+    }
+
+    std::vector<StartupAsset> sortedAssets(assets);
+    std::sort(sortedAssets.begin(), sortedAssets.end(), isCostlierAsset);
+    fprintf(f, "\nSlowest assets (ms):\n");
+    fprintf(f, "%10s %10s %10s %10s  %s\n", "decode", "upload", "wait",
+            "size", "file");
+    for (int i = 0; (i < (int)sortedAssets.size()) && (i < maxEntries); i++) {
+        const StartupAsset &a = sortedAssets[i];
+        fprintf(f, "%10.2f %10.2f %10.2f %10lu  %s\n", a.decodeTime,
+                a.uploadTime, a.waitTime, (unsigned long)a.size,
+                a.fileName.c_str());
+    }
+
+    bool failed = ferror(f);
+    if (fclose(f) || failed)
+        return -1;
+    return 0;
+}
+
+
+/// Start loading or creating component during panel startup
+/// arguments: name of component
+static int luaStartupComponentBegin(lua_State *L)
+{
+    StartupProfile &startup = getAvionics(L)->getStartupProfile();
+    if (startup.isRecording())
+        startup.beginComponent(luaL_checkstring(L, 1));
+    return 0;
+}
+
+
+/// Finish loading or creating component
+static int luaStartupComponentEnd(lua_State *L)
+{
+    getAvionics(L)->getStartupProfile().endComponent();
+    return 0;
+}
+
+
+/// Enable or disable writing of startup manifest and report
+/// arguments: true to enable
+static int luaEnableStartupProfile(lua_State *L)
+{
+    getAvionics(L)->getStartupProfile().setEnabled(lua_toboolean(L, 1));
+    return 0;
+}
+
+
+void xa::exportStartupToLua(Luna &lua)
+{
+    lua_State *L = lua.getLua();
+
+    lua_register(L, "startupComponentBegin", luaStartupComponentBegin);
+    lua_register(L, "startupComponentEnd", luaStartupComponentEnd);
+    lua_register(L, "enableStartupProfile", luaEnableStartupProfile);
+}
+
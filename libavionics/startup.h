@@ -0,0 +1,164 @@
+#ifndef __STARTUP_H__
+#define __STARTUP_H__
+
+
+#include <string>
+#include <vector>
+#include <map>
+#include "luna.h"
+
+
+namespace xa {
+
+
+/// Asset loaded during panel startup
+struct StartupAsset
+{
+    /// Full name of file
+    std::string fileName;
+
+    /// Kind of asset (see Preloader::Kind)
+    int kind;
+
+    /// Size of file in bytes or 0 if unknown
+    size_t size;
+
+    /// Time spent reading and decoding file in milliseconds.  Images
+    /// which weren't preloaded are decoded together with upload.
+    double decodeTime;
+
+    /// Time spent creating texture or sound buffer in milliseconds
+    double uploadTime;
+
+    /// Time spent waiting for preloader in milliseconds
+    double waitTime;
+};
+
+
+/// Component created during panel startup
+struct StartupComponent
+{
+    /// Name of component
+    std::string name;
+
+    /// Number of loads and instances created
+    int count;
+
+    /// Time including nested components in milliseconds
+    double total;
+
+    /// Time excluding nested components in milliseconds
+    double self;
+};
+
+
+/// Records costs of panel loading.  Assets are recorded in order of
+/// first use, the list is written as manifest next to panel and
+/// drives prefetching of assets on next load of the panel.  Components
+/// and assets are ranked by cost in startup report.
+class StartupProfile
+{
+    private:
+        /// Component being loaded
+        struct Call {
+            /// index of component
+            int component;
+
+            /// start time in microseconds
+            double start;
+
+            /// time spent in nested components
+            double nested;
+        };
+
+        /// True if profile is written after panel load
+        bool enabled;
+
+        /// True while panel is loading
+        bool recording;
+
+        /// Time of start of panel loading in microseconds
+        double startTime;
+
+        /// Duration of panel loading in milliseconds
+        double loadTime;
+
+        /// Recorded assets
+        std::vector<StartupAsset> assets;
+
+        /// Indices of recorded assets by file name
+        std::map<std::string, int> assetsByName;
+
+        /// Recorded components
+        std::vector<StartupComponent> components;
+
+        /// Indices of components by name
+        std::map<std::string, int> componentsByName;
+
+        /// Components being loaded
+        std::vector<Call> stack;
+
+    public:
+        /// Create enabled profile
+        StartupProfile();
+
+    public:
+        /// Enable or disable writing manifest and report
+        void setEnabled(bool enabled) { this->enabled = enabled; }
+
+        /// Returns true if manifest and report are written
+        bool isEnabled() const { return enabled; }
+
+        /// Returns true while panel is loading
+        bool isRecording() const { return recording; }
+
+        /// Forget recorded costs and start recording
+        void begin();
+
+        /// Stop recording
+        void end();
+
+        /// Record asset cost.  Costs of asset loaded several times are
+        /// summed.
+        void addAsset(const std::string &fileName, int kind, size_t size,
+                double decodeTime, double uploadTime, double waitTime);
+
+        /// Start loading or creating component
+        void beginComponent(const std::string &name);
+
+        /// Finish last started component
+        void endComponent();
+
+        /// Returns duration of panel loading in milliseconds
+        double getLoadTime() const { return loadTime; }
+
+        /// Returns recorded assets in order of first use
+        const std::vector<StartupAsset>& getAssets() const { return assets; }
+
+        /// Write manifest.  Names of files inside of panel directory are
+        /// written relative to it.  Returns 0 on success.
+        int writeManifest(const std::string &fileName,
+                const std::string &panelDir) const;
+
+        /// Write report ranking components and assets by cost.
+        /// Returns 0 on success.
+        /// \param maxEntries maximum number of entries in each list
+        int writeReport(const std::string &fileName, int maxEntries) const;
+
+        /// Read assets from manifest in order of use.  Only names, kinds
+        /// and costs are filled.  Returns 0 on success.
+        static int readManifest(const std::string &fileName,
+                const std::string &panelDir,
+                std::vector<StartupAsset> &assets);
+};
+
+
+/// Register startup profile functions in Lua
+void exportStartupToLua(Luna &lua);
+
+
+};
+
+
+#endif
+
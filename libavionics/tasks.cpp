@@ -0,0 +1,315 @@
+#include "tasks.h"
+
+#include <string.h>
+#include <algorithm>
+#include "avionics.h"
+
+
+using namespace xa;
+
+
+TaskScheduler::TaskScheduler(Luna &lua, Log &log): lua(lua), log(log)
+{
+    now = frame = 0;
+    current = -1;
+    nextHandle = 0;
+}
+
+
+TaskScheduler::~TaskScheduler()
+{
+    clear();
+}
+
+
+void TaskScheduler::clear()
+{
+    lua_State *L = lua.getLua();
+    for (size_t i = 0; i < tasks.size(); i++)
+        if (tasks[i].active)
+            luaL_unref(L, LUA_REGISTRYINDEX, tasks[i].ref);
+    tasks.clear();
+    freeIds.clear();
+    ids.clear();
+    timeHeap.clear();
+    frameHeap.clear();
+}
+
+
+int TaskScheduler::add(lua_State *L, bool coroutine, long period)
+{
+    int id;
+    if (freeIds.empty()) {
+        id = (int)tasks.size();
+        tasks.push_back(Task());
+        tasks[id].serial = 0;
+    } else {
+        id = freeIds.back();
+        freeIds.pop_back();
+    }
+
+    Task &task = tasks[id];
+    task.ref = luaL_ref(L, LUA_REGISTRYINDEX);
+    task.handle = nextHandle++;
+    if (0 > nextHandle)
+        nextHandle = 0;
+    ids[task.handle] = id;
+    task.coroutine = coroutine;
+    task.period = period;
+    task.active = true;
+    task.running = false;
+    return id;
+}
+
+
+void TaskScheduler::remove(int id)
+{
+    Task &task = tasks[id];
+    luaL_unref(lua.getLua(), LUA_REGISTRYINDEX, task.ref);
+    ids.erase(task.handle);
+    task.active = false;
+    task.serial++;
+
+    // running task is released when it returns
+    if (! task.running)
+        freeIds.push_back(id);
+}
+
+
+void TaskScheduler::schedule(std::vector<Wait> &heap, int id, long due)
+{
+    Wait wait;
+    wait.due = due;
+    wait.id = id;
+    wait.serial = ++tasks[id].serial;
+    heap.push_back(wait);
+    std::push_heap(heap.begin(), heap.end());
+}
+
+
+int TaskScheduler::find(int handle) const
+{
+    std::unordered_map<int, int>::const_iterator i = ids.find(handle);
+    return ids.end() == i ? -1 : (*i).second;
+}
+
+
+int TaskScheduler::getCurrent() const
+{
+    return -1 == current ? -1 : tasks[current].handle;
+}
+
+
+int TaskScheduler::addTimer(lua_State *L, long delay, long period)
+{
+    int id = add(L, false, 0 < period ? period : 0);
+    schedule(timeHeap, id, now + (0 < delay ? delay : 0));
+    return tasks[id].handle;
+}
+
+
+int TaskScheduler::startTask(lua_State *L, int nargs)
+{
+    // move function and arguments to new thread
+    lua_State *co = lua_newthread(L);
+    lua_insert(L, -2 - nargs);
+    lua_xmove(L, co, nargs + 1);
+
+    int id = add(L, true, 0);
+    int handle = tasks[id].handle;
+    resume(L, id, nargs);
+    return tasks[id].active ? handle : -1;
+}
+
+
+void TaskScheduler::cancel(int handle)
+{
+    int id = find(handle);
+    if (-1 != id)
+        remove(id);
+}
+
+
+void TaskScheduler::wake(int handle)
+{
+    int id = find(handle);
+    if ((-1 != id) && tasks[id].coroutine)
+        schedule(timeHeap, id, now);
+}
+
+
+void TaskScheduler::resume(lua_State *L, int id, int nargs)
+{
+    // thread stays on stack so it isn't collected if task is cancelled
+    lua_rawgeti(L, LUA_REGISTRYINDEX, tasks[id].ref);
+    lua_State *co = lua_tothread(L, -1);
+
+    int saved = current;
+    current = id;
+    tasks[id].running = true;
+    int status = lua_resume(co, nargs);
+    tasks[id].running = false;
+    current = saved;
+
+    // tasks may be reallocated by tasks started from coroutine
+    if (! tasks[id].active) {
+        freeIds.push_back(id);
+    } else if (LUA_YIELD == status) {
+        const char *kind = lua_isstring(co, 1) ? lua_tostring(co, 1) : "";
+        long arg = (long)lua_tonumber(co, 2);
+        if (! strcmp(kind, "sleep"))
+            schedule(timeHeap, id, now + (0 < arg ? arg : 0));
+        else if (! strcmp(kind, "frames"))
+            schedule(frameHeap, id, frame + (1 < arg ? arg : 1));
+        else if (strcmp(kind, "event"))
+            schedule(frameHeap, id, frame + 1);
+        lua_settop(co, 0);
+    } else {
+        if (status) {
+            const char *msg = lua_tostring(co, -1);
+            log.error("Error running task: %s", msg ? msg : "unknown error");
+        }
+        remove(id);
+    }
+
+    lua_pop(L, 1);
+}
+
+
+void TaskScheduler::call(int id)
+{
+    lua_State *L = lua.getLua();
+
+    lua_rawgeti(L, LUA_REGISTRYINDEX, tasks[id].ref);
+    tasks[id].running = true;
+    if (lua_pcall(L, 0, 0, 0)) {
+        const char *msg = lua_tostring(L, -1);
+        log.error("Error calling timer: %s", msg ? msg : "unknown error");
+        lua_pop(L, 1);
+    }
+    tasks[id].running = false;
+
+    if (! tasks[id].active)
+        freeIds.push_back(id);
+    else if (tasks[id].period)
+        schedule(timeHeap, id, now + tasks[id].period);
+    else
+        remove(id);
+}
+
+
+void TaskScheduler::popDue(std::vector<Wait> &heap, long limit)
+{
+    while ((! heap.empty()) && (heap.front().due <= limit)) {
+        std::pop_heap(heap.begin(), heap.end());
+        dueTasks.push_back(heap.back());
+        heap.pop_back();
+    }
+}
+
+
+void TaskScheduler::update(long time)
+{
+    now = time;
+    frame++;
+
+    // tasks scheduled while running due tasks wait for next frame
+    dueTasks.clear();
+    popDue(timeHeap, now);
+    popDue(frameHeap, frame);
+
+    for (size_t i = 0; i < dueTasks.size(); i++) {
+        const Wait &wait = dueTasks[i];
+        if ((! tasks[wait.id].active) ||
+                (tasks[wait.id].serial != wait.serial))
+            continue;
+        if (tasks[wait.id].coroutine)
+            resume(lua.getLua(), wait.id, 0);
+        else
+            call(wait.id);
+    }
+}
+
+
+/// Call function after delay once or periodically
+/// arguments: function, delay in milliseconds, period in milliseconds
+/// (optional)
+/// returns: handle of timer
+static int luaAddTimer(lua_State *L)
+{
+    if (! lua_isfunction(L, 1)) {
+        lua_pushnil(L);
+        return 1;
+    }
+    long delay = (long)lua_tonumber(L, 2);
+    long period = (long)lua_tonumber(L, 3);
+    lua_pushvalue(L, 1);
+    lua_pushnumber(L, getAvionics(L)->getTasks().addTimer(L, delay,
+                period));
+    return 1;
+}
+
+
+/// Start coroutine task
+/// arguments: function, arguments of function
+/// returns: handle of task or nil if task finished without waiting
+static int luaStartTask(lua_State *L)
+{
+    int nargs = lua_gettop(L) - 1;
+    if ((0 > nargs) || (! lua_isfunction(L, 1))) {
+        lua_pushnil(L);
+        return 1;
+    }
+    int id = getAvionics(L)->getTasks().startTask(L, nargs);
+    if (-1 == id)
+        lua_pushnil(L);
+    else
+        lua_pushnumber(L, id);
+    return 1;
+}
+
+
+/// Cancel timer or task
+/// arguments: handle of timer or task
+static int luaCancelTask(lua_State *L)
+{
+    if (lua_isnumber(L, 1))
+        getAvionics(L)->getTasks().cancel((int)lua_tonumber(L, 1));
+    return 0;
+}
+
+
+/// Resume task waiting for event on next frame
+/// arguments: handle of task
+static int luaWakeTask(lua_State *L)
+{
+    if (lua_isnumber(L, 1))
+        getAvionics(L)->getTasks().wake((int)lua_tonumber(L, 1));
+    return 0;
+}
+
+
+/// Returns handle of running task or nil
+static int luaGetCurrentTask(lua_State *L)
+{
+    int id = getAvionics(L)->getTasks().getCurrent();
+    if (-1 == id)
+        lua_pushnil(L);
+    else
+        lua_pushnumber(L, id);
+    return 1;
+}
+
+
+void xa::exportTasksToLua(Luna &lua)
+{
+    lua_State *L = lua.getLua();
+
+    lua_register(L, "addTimer", luaAddTimer);
+    lua_register(L, "stopTimer", luaCancelTask);
+    lua_register(L, "startTask", luaStartTask);
+    lua_register(L, "stopTask", luaCancelTask);
+    lua_register(L, "wakeTask", luaWakeTask);
+    lua_register(L, "getCurrentTask", luaGetCurrentTask);
+}
+
@@ -0,0 +1,179 @@
+#ifndef __TASKS_H__
+#define __TASKS_H__
+
+
+#include <vector>
+#include <unordered_map>
+#include "luna.h"
+#include "log.h"
+
+
+namespace xa {
+
+
+/// Runs Lua timers and coroutine tasks when they are due.  Waiting
+/// tasks are kept in min-heaps by time and by frame number so frame
+/// costs nothing for tasks which are not due.  Tasks are referred by
+/// handles which are never reused so stale handle doesn't affect task
+/// which took slot of finished one.  Coroutines yield kind of
+/// wait and its argument:
+///   coroutine.yield('sleep', ms) - resume after ms milliseconds
+///   coroutine.yield('frames', n) - resume after n frames
+///   coroutine.yield('event') - resume after wake() call
+///   coroutine.yield() - resume on next frame
+class TaskScheduler
+{
+    private:
+        /// Timer or coroutine
+        struct Task
+        {
+            /// Registry reference to function or thread
+            int ref;
+
+            /// Handle of task
+            int handle;
+
+            /// True if task is coroutine
+            bool coroutine;
+
+            /// Period of periodic timer in milliseconds or 0
+            long period;
+
+            /// Counter of task schedules.  Heap entries with other
+            /// serial are stale.
+            unsigned serial;
+
+            /// False if task is finished or cancelled
+            bool active;
+
+            /// True while task is called or resumed
+            bool running;
+        };
+
+        /// Entry of heap of waiting tasks
+        struct Wait
+        {
+            /// Time or frame number when task is due
+            long due;
+
+            /// Task id
+            int id;
+
+            /// Serial of task when it was scheduled
+            unsigned serial;
+
+            /// Heap ordering: earliest due on top
+            bool operator < (const Wait &other) const {
+                return due > other.due;
+            }
+        };
+
+    private:
+        /// Lua state
+        Luna &lua;
+
+        /// Logger
+        Log &log;
+
+        /// Tasks by id
+        std::vector<Task> tasks;
+
+        /// Ids of finished tasks
+        std::vector<int> freeIds;
+
+        /// Ids of active tasks by handles
+        std::unordered_map<int, int> ids;
+
+        /// Handle of next task
+        int nextHandle;
+
+        /// Tasks waiting for time
+        std::vector<Wait> timeHeap;
+
+        /// Tasks waiting for frames
+        std::vector<Wait> frameHeap;
+
+        /// Tasks due on current frame
+        std::vector<Wait> dueTasks;
+
+        /// Current time in milliseconds
+        long now;
+
+        /// Current frame number
+        long frame;
+
+        /// Id of running task or -1
+        int current;
+
+    public:
+        /// Create empty scheduler
+        TaskScheduler(Luna &lua, Log &log);
+
+        /// Release tasks
+        ~TaskScheduler();
+
+    public:
+        /// Add timer calling function on top of stack of L.  Function
+        /// is popped from stack.  Returns handle of timer.
+        /// \param L Lua state of caller, main state or coroutine
+        /// \param delay time before first call in milliseconds
+        /// \param period period of calls in milliseconds or 0 for
+        ///     one-shot timer
+        int addTimer(lua_State *L, long delay, long period);
+
+        /// Start coroutine running function with nargs arguments on top
+        /// of stack of L.  Function and arguments are popped.  Coroutine
+        /// runs until first wait immediately.  Returns handle of task or
+        /// -1 if task finished already.
+        int startTask(lua_State *L, int nargs);
+
+        /// Cancel timer or task by handle
+        void cancel(int handle);
+
+        /// Make task waiting for event due on next update
+        void wake(int handle);
+
+        /// Returns handle of running task or -1
+        int getCurrent() const;
+
+        /// Run due timers and tasks
+        /// \param time current time in milliseconds
+        void update(long time);
+
+        /// Cancel all tasks
+        void clear();
+
+    private:
+        /// Allocate task for function or thread on top of stack of L
+        int add(lua_State *L, bool coroutine, long period);
+
+        /// Returns id of active task by handle or -1
+        int find(int handle) const;
+
+        /// Release task
+        void remove(int id);
+
+        /// Put task to heap
+        void schedule(std::vector<Wait> &heap, int id, long due);
+
+        /// Resume coroutine and schedule its next wait
+        /// \param L Lua state of caller
+        void resume(lua_State *L, int id, int nargs);
+
+        /// Call timer function
+        void call(int id);
+
+        /// Move entries due up to limit from heap to due tasks
+        void popDue(std::vector<Wait> &heap, long limit);
+};
+
+
+/// Register timers and tasks functions in Lua
+void exportTasksToLua(Luna &lua);
+
+
+};
+
+
+#endif
+
@@ -7,6 +7,7 @@
 #include "utils.h"
 #include "luna.h"
 #include "avionics.h"
+#include "assetcache.h"
 
 
 using namespace xa;
@@ -48,7 +49,9 @@ TexturePart::TexturePart(Texture *tex, double x1, double y1,
 
 
 
-TextureManager::TextureManager()
+TextureManager::TextureManager(Vfs &vfs, Preloader &preloader,
+        StartupProfile &startup): 
+    vfs(vfs), preloader(preloader), startup(startup)
 {
     buffer = NULL;
     bufLength = 0;
@@ -65,8 +68,20 @@ TextureManager::~TextureManager()
 
 
 
+size_t TextureManager::getMemoryUsage() const
+{
+    size_t size = 0;
+    for (TexturesList::const_iterator i = loaded.begin(); 
+            i != loaded.end(); i++)
+        size += (size_t)(*i)->getWidth() * (*i)->getHeight() * 4;
+    return size;
+}
+
+
 Texture* TextureManager::loadImage(const unsigned char *buffer, int length)
 {
+    TRACE_SCOPE("texture load");
+
     int width, height;
     int id = graphics->load_texture(graphics, (const char*)buffer, length, 
             &width, &height);
@@ -78,49 +93,168 @@ Texture* TextureManager::loadImage(const unsigned char *buffer, int length)
     return tex;
 }
 
+Texture* TextureManager::loadImage(Preloader::Asset &asset)
+{
+    if (! asset.pixels)
+        return loadImage(&asset.data[0], asset.data.size());
+
+    TRACE_SCOPE("texture upload");
+
+    int width, height;
+    int id = graphics->upload_image(graphics, asset.pixels, asset.width, 
+            asset.height, asset.channels, &width, &height);
+    preloader.freePixels(asset);
+    if (-1 == id)
+        return NULL;
+    
+    Texture *tex = new Texture(id, width, height, this);
+    loaded.push_back(tex);
+    return tex;
+}
+
+Texture* TextureManager::reuseImage(const std::string &digest)
+{
+    int width, height;
+    int id = getAssetCache().takeTexture(digest, graphics, width, height);
+    if (-1 == id)
+        return NULL;
+
+    Texture *tex = new Texture(id, width, height, this);
+    loaded.push_back(tex);
+    return tex;
+}
+
+int TextureManager::findDigest(const std::string &fileName, 
+        std::string &digest)
+{
+    const unsigned char *data;
+    size_t length;
+    if (! vfs.readPacked(fileName, data, length)) {
+        digest = AssetCache::getDigest(data, length);
+        return 0;
+    }
+    return getAssetCache().findDigest(fileName, digest);
+}
+
+bool TextureManager::canReuse(const std::string &fileName)
+{
+    std::string digest;
+    return (cache.end() != cache.find(fileName)) || 
+        ((! findDigest(fileName, digest)) && 
+            getAssetCache().hasTexture(digest, graphics));
+}
+
 Texture* TextureManager::loadImage(const std::string &fileName)
 {
     TexturesMap::iterator i = cache.find(fileName);
-    if (i != cache.end()) {
+    if (i != cache.end())
         return (*i).second;
-    } else {
-        FILE *f = fopen(fileName.c_str(), "rb");
-        if (! f)
-            return NULL;
-        if (fseek(f, 0, SEEK_END)) {
-            fclose(f);
-            return NULL;
-        }
-        int size = ftell(f);
-        if (0 >= size) {
-            fclose(f);
-            return NULL;
-        }
-        if (fseek(f, 0, SEEK_SET)) {
-            fclose(f);
-            return NULL;
-        }
-        if (! buffer) {
-            buffer = (unsigned char*)malloc(size);
-            bufLength = size;
-        } else if (size > bufLength) {
-            buffer = (unsigned char*)realloc(buffer, size);
-            bufLength = size;
-        }
-        if (! buffer) {
-            fclose(f);
-            return NULL;
-        }
-        int res = fread(buffer, 1, size, f);
-        fclose(f);
-        if (res != size) {
-            return NULL;
+
+    // texture of unchanged file may be left by previous panel
+    std::string digest;
+    Texture *tex = NULL;
+    if (! findDigest(fileName, digest)) {
+        tex = reuseImage(digest);
+        if (tex)
+            startup.addAsset(fileName, Preloader::PRELOAD_IMAGE, 0, 0, 0, 0);
+    }
+    if (! tex)
+        tex = loadImageFile(fileName, digest);
+
+    if (tex) {
+        tex->setDigest(digest);
+        cache[fileName] = tex;
+    }
+    return tex;
+}
+
+Texture* TextureManager::loadImageFile(const std::string &fileName,
+        std::string &digest)
+{
+    // image may be decoded already by preloader
+    double startTime = Profiler::getTime();
+    Preloader::Asset asset;
+    if (! preloader.take(fileName, asset)) {
+        digest.swap(asset.digest);
+        getAssetCache().setDigest(fileName, digest);
+        double uploadTime = Profiler::getTime();
+        Texture *tex = loadImage(asset);
+        if (tex) {
+            double now = Profiler::getTime();
+            startup.addAsset(fileName, Preloader::PRELOAD_IMAGE, 
+                    asset.size, asset.decodeTime, 
+                    (now - uploadTime) / 1000.0,
+                    (uploadTime - startTime) / 1000.0);
+            return tex;
         }
-        Texture *tex = loadImage(buffer, size);
+    }
+
+    // packed images are decoded in place
+    const unsigned char *data;
+    size_t length;
+    if (! vfs.readPacked(fileName, data, length)) {
+        if (digest.empty())
+            digest = AssetCache::getDigest(data, length);
+        double uploadTime = Profiler::getTime();
+        Texture *tex = loadImage(data, length);
         if (tex)
-            cache[fileName] = tex;
+            startup.addAsset(fileName, Preloader::PRELOAD_IMAGE, length,
+                    (uploadTime - startTime) / 1000.0,
+                    (Profiler::getTime() - uploadTime) / 1000.0, 0);
         return tex;
     }
+
+    TRACE_SCOPE("texture load");
+    FILE *f = fopen(fileName.c_str(), "rb");
+    if (! f)
+        return NULL;
+    if (fseek(f, 0, SEEK_END)) {
+        fclose(f);
+        return NULL;
+    }
+    int size = ftell(f);
+    if (0 >= size) {
+        fclose(f);
+        return NULL;
+    }
+    if (fseek(f, 0, SEEK_SET)) {
+        fclose(f);
+        return NULL;
+    }
+    if (! buffer) {
+        buffer = (unsigned char*)malloc(size);
+        bufLength = size;
+    } else if (size > bufLength) {
+        buffer = (unsigned char*)realloc(buffer, size);
+        bufLength = size;
+    }
+    if (! buffer) {
+        fclose(f);
+        return NULL;
+    }
+    int res = fread(buffer, 1, size, f);
+    fclose(f);
+    if (res != size) {
+        return NULL;
+    }
+
+    // file may be touched without changes
+    digest = AssetCache::getDigest(buffer, size);
+    getAssetCache().setDigest(fileName, digest);
+    Texture *tex = reuseImage(digest);
+    if (tex) {
+        startup.addAsset(fileName, Preloader::PRELOAD_IMAGE, size,
+                (Profiler::getTime() - startTime) / 1000.0, 0, 0);
+        return tex;
+    }
+
+    double uploadTime = Profiler::getTime();
+    tex = loadImage(buffer, size);
+    if (tex)
+        startup.addAsset(fileName, Preloader::PRELOAD_IMAGE, size,
+                (uploadTime - startTime) / 1000.0,
+                (Profiler::getTime() - uploadTime) / 1000.0, 0);
+    return tex;
 }
 
 
@@ -323,8 +457,16 @@ void TextureManager::unloadAll()
         delete (*i);
     partsLoaded.clear();
 
-    for (TexturesList::iterator i = loaded.begin(); i != loaded.end(); i++)
-        delete (*i);
+    AssetCache &assets = getAssetCache();
+    for (TexturesList::iterator i = loaded.begin(); i != loaded.end(); i++) {
+        Texture *texture = *i;
+        if (texture->managed && (! texture->digest.empty())) {
+            assets.putTexture(texture->digest, graphics, texture->id,
+                    texture->width, texture->height);
+            texture->managed = false;
+        }
+        delete texture;
+    }
     loaded.clear();
     cache.clear();
 }
@@ -442,6 +584,7 @@ static int luaRecreateImage(lua_State *L)
             graphics->recreate_texture(graphics, part->getTexture()->getId(), 
                     width, height);
             part->getTexture()->setSize(width, height);
+            part->getTexture()->setDigest("");
         }
     }
 
@@ -500,6 +643,7 @@ static int luaSetRenderTarget(lua_State *L)
                 return 1;
             }
             texId = tex->getTexture()->getId();
+            tex->getTexture()->setDigest("");
         }
     }
 
@@ -6,11 +6,14 @@
 #include <string>
 #include "luna.h"
 #include "libavcallbacks.h"
+#include "preloader.h"
+#include "startup.h"
 
 namespace xa {
 
 
 class TextureManager;
+class Vfs;
 
 
 /// Simple wrapper for x-plane textures
@@ -34,6 +37,9 @@ class Texture
         /// Reference to texture manager
         TextureManager *manager;
 
+        /// MD5 of image file or empty string if texture can't be reused
+        std::string digest;
+
     private:
         /// Create unmanaged texture object
         Texture(int id, TextureManager *manager);
@@ -57,6 +63,13 @@ class Texture
 
         /// Sets texture size in pixels
         void setSize(int w, int h) { width = w; height = h; }
+
+        /// Returns MD5 of image file
+        const std::string& getDigest() const { return digest; }
+
+        /// Sets MD5 of image file.  Textures drawn into or resized
+        /// should have empty digest, so they aren't reused.
+        void setDigest(const std::string &digest) { this->digest = digest; }
 };
 
 
@@ -112,6 +125,15 @@ class TextureManager
         /// Graphics funtions
         SaslGraphicsCallbacks *graphics;
 
+        /// Files of search paths
+        Vfs &vfs;
+
+        /// Images decoded by worker threads
+        Preloader &preloader;
+
+        /// Costs of panel loading
+        StartupProfile &startup;
+
         /// texture loader buffer
         unsigned char *buffer;
 
@@ -132,7 +154,8 @@ class TextureManager
         
     public:
         /// Create texture manager
-        TextureManager();
+        TextureManager(Vfs &vfs, Preloader &preloader,
+                StartupProfile &startup);
 
         /// Destroy texture manager and all cached textures
         ~TextureManager();
@@ -167,9 +190,17 @@ class TextureManager
         /// Use it on your own risk!
         void unload(TexturePart *texturePart);
 
-        /// Unload all textures
+        /// Unload all textures.  Textures loaded from files are kept in
+        /// asset cache for next panel.
         void unloadAll();
 
+        /// Returns true if image is loaded already or its texture may be
+        /// taken from asset cache
+        bool canReuse(const std::string &fileName);
+
+        /// Returns estimated video memory used by loaded textures in bytes
+        size_t getMemoryUsage() const;
+
         /// set graphics callbacks
         void setGraphicsCallbacks(struct SaslGraphicsCallbacks *graphics);
 
@@ -183,6 +214,20 @@ class TextureManager
         /// Load image from file or return cached image if already loaded.
         Texture* loadImage(const std::string &fileName);
 
+        /// Load image taken from preloader
+        Texture* loadImage(Preloader::Asset &asset);
+
+        /// Load image from preloader, archive or disk.  Sets MD5 of file.
+        Texture* loadImageFile(const std::string &fileName, 
+                std::string &digest);
+
+        /// Take texture with the same contents from asset cache
+        Texture* reuseImage(const std::string &digest);
+
+        /// Get MD5 of packed file or remembered MD5 of unchanged file on
+        /// disk.  Returns 0 on success.
+        int findDigest(const std::string &fileName, std::string &digest);
+
         /// Returns texture coords which covers entire image
         void getPartCoords(Texture *texture, double &x1, double &y1,
                 double &x2, double &y2);
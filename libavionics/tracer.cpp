@@ -0,0 +1,234 @@
+#include "tracer.h"
+
+#include <stdio.h>
+#include <vector>
+#include <set>
+#include <mutex>
+#include <chrono>
+#include "avionics.h"
+
+
+using namespace xa;
+
+
+/// Number of events in ring buffer of each thread
+#define BUFFER_EVENTS 65536
+
+
+namespace {
+
+/// Recorded event
+struct TraceRecord
+{
+    /// Name of event
+    const char *name;
+
+    /// Type of event
+    char phase;
+
+    /// Time of event in microseconds
+    double time;
+};
+
+
+/// Ring buffer of events written by single thread
+struct TraceBuffer
+{
+    /// Number of thread in trace
+    int tid;
+
+    /// Number of events written since tracing started
+    std::atomic<unsigned long> head;
+
+    /// Events
+    TraceRecord events[BUFFER_EVENTS];
+};
+
+};
+
+
+std::atomic<bool> xa::tracingEnabled(false);
+
+/// Buffers of all threads ever traced.  Buffers are never freed because
+/// threads may exit before trace is written.
+static std::vector<TraceBuffer*> buffers;
+
+/// Persistent copies of event names
+static std::set<std::string> names;
+
+/// Guards buffers and names
+static std::mutex tracerMutex;
+
+/// Buffer of current thread
+static thread_local TraceBuffer *threadBuffer = NULL;
+
+
+/// Returns current time in microseconds
+static double getTraceTime()
+{
+    return std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+void xa::setTracing(bool enable)
+{
+    if (enable && ! isTracing()) {
+        std::lock_guard<std::mutex> lock(tracerMutex);
+        for (std::vector<TraceBuffer*>::iterator i = buffers.begin();
+                i != buffers.end(); i++)
+            (*i)->head.store(0, std::memory_order_relaxed);
+    }
+    tracingEnabled.store(enable, std::memory_order_release);
+}
+
+
+void xa::traceEvent(const char *name, char phase)
+{
+    TraceBuffer *buffer = threadBuffer;
+    if (! buffer) {
+        buffer = new TraceBuffer;
+        buffer->head.store(0, std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(tracerMutex);
+        buffer->tid = buffers.size() + 1;
+        buffers.push_back(buffer);
+        threadBuffer = buffer;
+    }
+
+    unsigned long head = buffer->head.load(std::memory_order_relaxed);
+    TraceRecord &event = buffer->events[head % BUFFER_EVENTS];
+    event.name = name;
+    event.phase = phase;
+    event.time = getTraceTime();
+    buffer->head.store(head + 1, std::memory_order_release);
+}
+
+
+const char* xa::internTraceName(const std::string &name)
+{
+    std::lock_guard<std::mutex> lock(tracerMutex);
+    return (*names.insert(name).first).c_str();
+}
+
+
+/// Write string as JSON string literal
+static void writeJsonString(FILE *f, const char *s)
+{
+    fputc('"', f);
+    for (; *s; s++) {
+        unsigned char c = *s;
+        if (('"' == c) || ('\\' == c))
+            fprintf(f, "\\%c", c);
+        else if (c < 0x20)
+            fprintf(f, "\\u%04x", c);
+        else
+            fputc(c, f);
+    }
+    fputc('"', f);
+}
+
+
+int xa::writeTrace(const std::string &fileName)
+{
+    FILE *f = fopen(fileName.c_str(), "w");
+    if (! f)
+        return -1;
+
+    std::lock_guard<std::mutex> lock(tracerMutex);
+
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+    for (std::vector<TraceBuffer*>::iterator i = buffers.begin();
+            i != buffers.end(); i++)
+    {
+        TraceBuffer *buffer = *i;
+        unsigned long head = buffer->head.load(std::memory_order_acquire);
+        unsigned long start = 0;
+        if (head > BUFFER_EVENTS)
+            start = head - BUFFER_EVENTS;
+
+        fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                "\"tid\":%i,\"args\":{\"name\":\"thread %i\"}}",
+                first ? "" : ",\n", buffer->tid, buffer->tid);
+        first = false;
+
+        for (unsigned long j = start; j < head; j++) {
+            TraceRecord &event = buffer->events[j % BUFFER_EVENTS];
+            fprintf(f, ",\n{\"name\":");
+            writeJsonString(f, event.name);
+            fprintf(f, ",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%i%s}",
+                    event.phase, event.time, buffer->tid,
+                    'i' == event.phase ? ",\"s\":\"t\"" : "");
+        }
+    }
+    fprintf(f, "\n]}\n");
+
+    fclose(f);
+    return 0;
+}
+
+
+/// Start or stop tracing
+/// arguments: enable flag
+static int luaSetTracing(lua_State *L)
+{
+    setTracing(lua_toboolean(L, 1));
+    return 0;
+}
+
+
+/// Record user event
+static int luaTraceEvent(lua_State *L, char phase)
+{
+    if (isTracing() && lua_isstring(L, 1))
+        traceEvent(internTraceName(lua_tostring(L, 1)), phase);
+    return 0;
+}
+
+
+/// Record begin of user event
+/// arguments: name of event
+static int luaTraceBegin(lua_State *L)
+{
+    return luaTraceEvent(L, 'B');
+}
+
+
+/// Record end of user event
+/// arguments: name of event
+static int luaTraceEnd(lua_State *L)
+{
+    return luaTraceEvent(L, 'E');
+}
+
+
+/// Record instant user event
+/// arguments: name of event
+static int luaTraceInstant(lua_State *L)
+{
+    return luaTraceEvent(L, 'i');
+}
+
+
+/// Write trace to file
+/// arguments: file name
+static int luaWriteTrace(lua_State *L)
+{
+    if (! lua_isstring(L, 1))
+        return 0;
+    lua_pushboolean(L, ! writeTrace(lua_tostring(L, 1)));
+    return 1;
+}
+
+
+void xa::exportTracerToLua(Luna &lua)
+{
+    lua_State *L = lua.getLua();
+
+    lua_register(L, "setTracing", luaSetTracing);
+    lua_register(L, "traceBegin", luaTraceBegin);
+    lua_register(L, "traceEnd", luaTraceEnd);
+    lua_register(L, "traceInstant", luaTraceInstant);
+    lua_register(L, "writeTrace", luaWriteTrace);
+}
+
@@ -0,0 +1,83 @@
+#ifndef __TRACER_H__
+#define __TRACER_H__
+
+
+#include <string>
+#include <atomic>
+#include "luna.h"
+
+
+namespace xa {
+
+
+/// True if trace events are recorded.  Use isTracing() to check it.
+extern std::atomic<bool> tracingEnabled;
+
+
+/// Returns true if trace events are recorded
+inline bool isTracing()
+{
+    return tracingEnabled.load(std::memory_order_relaxed);
+}
+
+
+/// Start or stop recording of trace events.  Starting discards events
+/// recorded before.
+void setTracing(bool enable);
+
+/// Record trace event in ring buffer of calling thread.
+/// Oldest events are overwritten when buffer is full.
+/// \param name name of event.  Must stay valid until trace is written,
+///     use string literals or names returned by internTraceName().
+/// \param phase type of event: 'B' begin, 'E' end or 'i' instant
+void traceEvent(const char *name, char phase);
+
+/// Returns persistent copy of event name
+const char* internTraceName(const std::string &name);
+
+/// Write recorded events in Chrome trace event JSON format which can be
+/// opened by chrome://tracing or Perfetto UI.  Returns zero on success.
+/// Events of other threads being recorded while writing may be lost.
+int writeTrace(const std::string &fileName);
+
+
+/// Records begin and end events of scope if tracing is enabled
+class TraceScope
+{
+    private:
+        /// Name of event or NULL if tracing was disabled
+        const char *name;
+
+    public:
+        /// Record begin event
+        TraceScope(const char *name) {
+            this->name = isTracing() ? name : NULL;
+            if (this->name)
+                traceEvent(this->name, 'B');
+        }
+
+        /// Record end event
+        ~TraceScope() {
+            if (name)
+                traceEvent(name, 'E');
+        }
+};
+
+
+/// Register tracing functions in Lua
+void exportTracerToLua(Luna &lua);
+
+
+};
+
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+/// Trace current scope.  name must be string literal.
+#define TRACE_SCOPE(name) \
+    xa::TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+
+
+#endif
+
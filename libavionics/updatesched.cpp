@@ -0,0 +1,186 @@
+#include "updatesched.h"
+
+#include <math.h>
+#include "avionics.h"
+
+
+using namespace xa;
+
+
+/// Number of slots in timer wheel
+#define WHEEL_SLOTS 128
+
+/// Time covered by wheel slot in milliseconds
+#define SLOT_TIME 10
+
+
+/// Returns wheel tick of time
+static long getTick(long time)
+{
+    return time / SLOT_TIME;
+}
+
+
+UpdateScheduler::UpdateScheduler(): wheel(WHEEL_SLOTS)
+{
+    lastTime = 0;
+    added = 0;
+}
+
+
+void UpdateScheduler::clear()
+{
+    entries.clear();
+    freeIds.clear();
+    for (int i = 0; i < WHEEL_SLOTS; i++)
+        wheel[i].clear();
+    added = 0;
+}
+
+
+void UpdateScheduler::insert(int id)
+{
+    wheel[getTick(entries[id].next) % WHEEL_SLOTS].push_back(id);
+}
+
+
+int UpdateScheduler::add(long period, double phase, long now)
+{
+    if (1 > period)
+        period = 1;
+
+    // golden ratio sequence spreads entries evenly whatever their count
+    if (0 > phase) {
+        phase = added * 0.618033988749895;
+        phase -= floor(phase);
+    }
+    added++;
+
+    if (entries.empty() || (now < lastTime))
+        lastTime = now;
+
+    int id;
+    if (freeIds.empty()) {
+        id = (int)entries.size();
+        entries.push_back(Entry());
+    } else {
+        id = freeIds.back();
+        freeIds.pop_back();
+    }
+
+    Entry &entry = entries[id];
+    entry.period = period;
+    entry.next = now + (long)(period * phase);
+    entry.active = true;
+    insert(id);
+
+    return id;
+}
+
+
+void UpdateScheduler::remove(int id)
+{
+    if ((0 > id) || ((int)entries.size() <= id) || (! entries[id].active))
+        return;
+
+    // wheel slot forgets entry when it is visited next time
+    entries[id].active = false;
+}
+
+
+const std::vector<int>& UpdateScheduler::advance(long now)
+{
+    due.clear();
+    if (now < lastTime)
+        return due;
+
+    long first = getTick(lastTime);
+    long last = getTick(now);
+    if (last - first >= WHEEL_SLOTS)
+        first = last - WHEEL_SLOTS + 1;
+    lastTime = now;
+
+    rescheduled.clear();
+    for (long tick = first; tick <= last; tick++) {
+        std::vector<int> &slot = wheel[tick % WHEEL_SLOTS];
+        size_t kept = 0;
+        for (size_t i = 0; i < slot.size(); i++) {
+            int id = slot[i];
+            Entry &entry = entries[id];
+            if (! entry.active) {
+                freeIds.push_back(id);
+                continue;
+            }
+            if (entry.next > now) {
+                // entry of one of next wheel turns
+                slot[kept++] = id;
+                continue;
+            }
+
+            due.push_back(id);
+            entry.next += entry.period;
+            if (entry.next <= now)
+                entry.next = now + entry.period;
+            rescheduled.push_back(id);
+        }
+        slot.resize(kept);
+    }
+
+    // reinsert after all slots were visited so entry isn't due twice
+    for (size_t i = 0; i < rescheduled.size(); i++)
+        insert(rescheduled[i]);
+
+    return due;
+}
+
+
+/// Add component update to scheduler
+/// arguments: update rate in Hz, phase as part of period (optional)
+/// returns: id of scheduled update
+static int luaAddScheduledUpdate(lua_State *L)
+{
+    Avionics *avionics = getAvionics(L);
+    double rate = lua_tonumber(L, 1);
+    long period = 0 < rate ? (long)(1000.0 / rate) : 0;
+    double phase = lua_isnumber(L, 2) ? lua_tonumber(L, 2) : -1.0;
+    lua_pushnumber(L, avionics->getUpdateScheduler().add(period, phase,
+                avionics->getTime()));
+    return 1;
+}
+
+
+/// Remove component update from scheduler
+/// arguments: id of scheduled update
+static int luaRemoveScheduledUpdate(lua_State *L)
+{
+    getAvionics(L)->getUpdateScheduler().remove((int)lua_tonumber(L, 1));
+    return 0;
+}
+
+
+/// Store ids of updates due on this frame in table
+/// arguments: table to fill starting from index 1
+/// returns: number of due updates
+static int luaCollectDueUpdates(lua_State *L)
+{
+    Avionics *avionics = getAvionics(L);
+    const std::vector<int> &due =
+        avionics->getUpdateScheduler().advance(avionics->getTime());
+    for (size_t i = 0; i < due.size(); i++) {
+        lua_pushnumber(L, due[i]);
+        lua_rawseti(L, 1, i + 1);
+    }
+    lua_pushnumber(L, due.size());
+    return 1;
+}
+
+
+void xa::exportUpdateSchedulerToLua(Luna &lua)
+{
+    lua_State *L = lua.getLua();
+
+    lua_register(L, "addScheduledUpdate", luaAddScheduledUpdate);
+    lua_register(L, "removeScheduledUpdate", luaRemoveScheduledUpdate);
+    lua_register(L, "collectDueUpdates", luaCollectDueUpdates);
+}
+
@@ -0,0 +1,87 @@
+#ifndef __UPDATE_SCHEDULER_H__
+#define __UPDATE_SCHEDULER_H__
+
+
+#include <vector>
+#include "luna.h"
+
+
+namespace xa {
+
+
+/// Decides which components with reduced update rate should be updated
+/// on current frame.  Entries are kept in hashed timer wheel so frame
+/// costs only entries of wheel slots passed since previous frame.
+class UpdateScheduler
+{
+    private:
+        /// Scheduled update
+        struct Entry
+        {
+            /// Update period in milliseconds
+            long period;
+
+            /// Time of next update
+            long next;
+
+            /// False if entry was removed
+            bool active;
+        };
+
+        /// Entries by id
+        std::vector<Entry> entries;
+
+        /// Ids of removed entries
+        std::vector<int> freeIds;
+
+        /// Slots of timer wheel with ids of entries
+        std::vector<std::vector<int> > wheel;
+
+        /// Time of last advance
+        long lastTime;
+
+        /// Number of entries added, used to spread phases
+        unsigned long added;
+
+        /// Ids of entries due on last advance
+        std::vector<int> due;
+
+        /// Due entries waiting for reinsertion into wheel
+        std::vector<int> rescheduled;
+
+    public:
+        /// Create empty scheduler
+        UpdateScheduler();
+
+    public:
+        /// Add entry.  Returns id of entry.
+        /// \param period update period in milliseconds
+        /// \param phase offset of first update as part of period between
+        ///     0 and 1 or negative to spread entries automatically
+        /// \param now current time in milliseconds
+        int add(long period, double phase, long now);
+
+        /// Remove entry
+        void remove(int id);
+
+        /// Remove all entries
+        void clear();
+
+        /// Returns ids of entries due up to specified time
+        const std::vector<int>& advance(long now);
+
+    private:
+        /// Put entry into wheel slot of its next update time
+        void insert(int id);
+};
+
+
+/// Register update scheduler functions in Lua
+void exportUpdateSchedulerToLua(Luna &lua);
+
+
+};
+
+
+#endif
+
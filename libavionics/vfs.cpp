@@ -0,0 +1,248 @@
+#include "vfs.h"
+
+#include <ctype.h>
+#ifdef WINDOWS
+#include <windows.h>
+#else
+#include <dirent.h>
+#endif
+#include "avionics.h"
+
+
+using namespace xa;
+
+
+/// Convert name to key of index.  File systems of Windows and Mac are
+/// case insensitive.
+static std::string getKey(const std::string &name)
+{
+#if defined(WINDOWS) || defined(APL)
+    std::string key(name);
+    for (size_t i = 0; i < key.size(); i++)
+        key[i] = tolower((unsigned char)key[i]);
+    return key;
+#else
+    return name;
+#endif
+}
+
+
+/// Add names of files of directory to set
+static void listDir(const std::string &dir,
+        std::unordered_set<std::string> &names)
+{
+#ifdef WINDOWS
+    WIN32_FIND_DATAA data;
+    HANDLE h = FindFirstFileA((dir + "/*").c_str(), &data);
+    if (INVALID_HANDLE_VALUE == h)
+        return;
+    do {
+        names.insert(getKey(data.cFileName));
+    } while (FindNextFileA(h, &data));
+    FindClose(h);
+#else
+    DIR *d = opendir(dir.c_str());
+    if (! d)
+        return;
+    struct dirent *entry;
+    while ((entry = readdir(d)))
+        names.insert(getKey(entry->d_name));
+    closedir(d);
+#endif
+}
+
+
+Vfs::~Vfs()
+{
+    for (size_t i = 0; i < archives.size(); i++)
+        delete archives[i];
+}
+
+
+void Vfs::clear()
+{
+    dirs.clear();
+}
+
+
+int Vfs::mount(const std::string &archiveName, const std::string &dir)
+{
+    PakReader *archive = new PakReader;
+    if (archive->open(archiveName)) {
+        delete archive;
+        return -1;
+    }
+
+    std::string root = dir;
+    while ((1 < root.size()) && ('/' == root[root.size() - 1]))
+        root.erase(root.size() - 1);
+
+    size_t i;
+    for (i = 0; i < roots.size(); i++)
+        if (getKey(roots[i]) == getKey(root))
+            break;
+    if (i < roots.size()) {
+        delete archives[i];
+        archives[i] = archive;
+    } else {
+        archives.push_back(archive);
+        roots.push_back(root);
+    }
+
+    indexPacked();
+    return 0;
+}
+
+
+void Vfs::indexPacked()
+{
+    packed.clear();
+    for (size_t i = 0; i < archives.size(); i++) {
+        PakReader *archive = archives[i];
+        for (int j = 0; j < archive->getEntriesCount(); j++) {
+            PackedFile &file = packed[getKey(roots[i] + "/" +
+                    archive->getEntry(j).name)];
+            file.archive = i;
+            file.entry = j;
+        }
+    }
+}
+
+
+bool Vfs::isPacked(const std::string &fileName) const
+{
+    return (! packed.empty()) && packed.count(getKey(fileName));
+}
+
+
+int Vfs::readPacked(const std::string &fileName, const unsigned char *&data,
+        size_t &size)
+{
+    if (packed.empty())
+        return -1;
+    auto i = packed.find(getKey(fileName));
+    if (i == packed.end())
+        return -1;
+
+    const PakReader *archive = archives[(*i).second.archive];
+    return archive->read(archive->getEntry((*i).second.entry), buffer,
+            data, size);
+}
+
+
+const std::unordered_set<std::string>& Vfs::getDir(const std::string &dir)
+{
+    std::string key = getKey(dir);
+    auto i = dirs.find(key);
+    if (i != dirs.end())
+        return (*i).second;
+
+    std::unordered_set<std::string> &names = dirs[key];
+    listDir(dir.empty() ? "." : dir, names);
+    return names;
+}
+
+
+bool Vfs::exists(const std::string &fileName)
+{
+    if (isPacked(fileName))
+        return true;
+
+    size_t pos = fileName.find_last_of("/\\");
+    if (std::string::npos == pos)
+        return getDir("").count(getKey(fileName));
+    if (fileName.size() == pos + 1)
+        return false;
+
+    // root directory of absolute path
+    std::string dir = fileName.substr(0, pos ? pos : 1);
+    const std::unordered_set<std::string> &names = getDir(dir);
+    return names.count(getKey(fileName.substr(pos + 1)));
+}
+
+
+/// Returns true if file exists using file index
+/// arguments: name of file
+static int luaIsFileIndexed(lua_State *L)
+{
+    const char *fileName = lua_tostring(L, 1);
+    lua_pushboolean(L, fileName && getAvionics(L)->getVfs().exists(fileName));
+    return 1;
+}
+
+
+/// Find file on search paths using file index
+/// arguments: name of file, table of search paths in priority order
+/// returns: path to file or nil.  File name itself is tried after
+/// search paths.
+static int luaFindFile(lua_State *L)
+{
+    const char *fileName = lua_tostring(L, 1);
+    if (! fileName) {
+        lua_pushnil(L);
+        return 1;
+    }
+    Vfs &vfs = getAvionics(L)->getVfs();
+
+    std::string fullName;
+    if (lua_istable(L, 2)) {
+        for (int i = 1; ; i++) {
+            lua_rawgeti(L, 2, i);
+            const char *path = lua_tostring(L, -1);
+            if (! path) {
+                lua_pop(L, 1);
+                break;
+            }
+            if (*path)
+                fullName = std::string(path) + "/" + fileName;
+            else
+                fullName = fileName;
+            lua_pop(L, 1);
+            if (vfs.exists(fullName)) {
+                lua_pushstring(L, fullName.c_str());
+                return 1;
+            }
+        }
+    }
+
+    if (vfs.exists(fileName)) {
+        lua_pushstring(L, fileName);
+        return 1;
+    }
+
+    lua_pushnil(L);
+    return 1;
+}
+
+
+/// Mount packed archive to directory
+/// arguments: name of archive, directory
+/// returns: true on success
+static int luaMountArchive(lua_State *L)
+{
+    const char *archiveName = lua_tostring(L, 1);
+    const char *dir = lua_tostring(L, 2);
+    lua_pushboolean(L, archiveName && dir &&
+            (! getAvionics(L)->getVfs().mount(archiveName, dir)));
+    return 1;
+}
+
+
+/// Forget listed directories.  Use it if files were added.
+static int luaRescanFiles(lua_State *L)
+{
+    getAvionics(L)->getVfs().clear();
+    return 0;
+}
+
+
+void xa::exportVfsToLua(Luna &lua)
+{
+    lua_State *L = lua.getLua();
+
+    lua_register(L, "isFileIndexed", luaIsFileIndexed);
+    lua_register(L, "findFile", luaFindFile);
+    lua_register(L, "rescanFiles", luaRescanFiles);
+    lua_register(L, "mountArchive", luaMountArchive);
+}
+
@@ -0,0 +1,93 @@
+#ifndef __VFS_H__
+#define __VFS_H__
+
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "luna.h"
+#include "pakreader.h"
+
+
+namespace xa {
+
+
+/// Index of files on components and images search paths.  Every
+/// directory is listed once on first lookup and its names are kept in
+/// hash set, so looking for file on several search paths costs hash
+/// probes instead of failed fopen calls.  Index doesn't notice files
+/// created after directory was listed, it is rescanned when panel is
+/// loaded.  Packed archives may be mounted over directories, their
+/// files hide files on disk.
+class Vfs
+{
+    private:
+        /// File of mounted archive
+        struct PackedFile
+        {
+            /// Index of archive
+            int archive;
+
+            /// Index of entry in archive
+            int entry;
+        };
+
+        /// Names of files by directory
+        std::unordered_map<std::string, std::unordered_set<std::string> >
+            dirs;
+
+        /// Mounted archives
+        std::vector<PakReader*> archives;
+
+        /// Directories archives are mounted to
+        std::vector<std::string> roots;
+
+        /// Files of mounted archives by full name
+        std::unordered_map<std::string, PackedFile> packed;
+
+        /// Decompressed file
+        std::vector<unsigned char> buffer;
+
+    public:
+        /// Unmount archives
+        ~Vfs();
+
+    public:
+        /// Returns true if file exists
+        bool exists(const std::string &fileName);
+
+        /// Forget listed directories
+        void clear();
+
+        /// Mount archive to directory.  Archive mounted to the same
+        /// directory before is replaced.  Returns 0 on success.
+        int mount(const std::string &archiveName, const std::string &dir);
+
+        /// Returns true if file is in mounted archive
+        bool isPacked(const std::string &fileName) const;
+
+        /// Get contents of file from mounted archive.  Data is valid
+        /// until next read or until archive is unmounted.  Returns 0 on
+        /// success or -1 if file isn't packed or can't be read.
+        int readPacked(const std::string &fileName, const unsigned char *&data,
+                size_t &size);
+
+    private:
+        /// Returns names of files of directory, lists it if needed
+        const std::unordered_set<std::string>& getDir(const std::string &dir);
+
+        /// Index files of mounted archives
+        void indexPacked();
+};
+
+
+/// Register file index functions in Lua
+void exportVfsToLua(Luna &lua);
+
+
+};
+
+
+#endif
+
@@ -0,0 +1,136 @@
+#include "benchclient.h"
+
+#include <string.h>
+#include "libavcallbacks.h"
+#include "md5.h"
+#include "benchprops.h"
+#include "utils.h"
+
+
+using namespace netbench;
+using namespace xa;
+
+
+BenchClient::BenchClient(Log &log): log(log), con(log)
+{
+    props = 0;
+    propsToGo = 0;
+    pendingResponse = false;
+    replies = 0;
+}
+
+
+int BenchClient::connect(int port, const std::string &secret, int propsCount)
+{
+    int sock = establishConnection("127.0.0.1", port);
+    if (1 > sock)
+        return -1;
+    if (con.setSocket(sock))
+        return -1;
+
+    con.send((unsigned char*)"NP2\n", 4);
+    if (con.sendAll() || con.recvData(20))
+        return -1;
+
+    NetBuf &buf = con.getRecvBuffer();
+    if (20 != buf.getFilled())
+        return -1;
+
+    md5_state_t md5;
+    md5_init(&md5);
+    md5_append(&md5, buf.getData(), 20);
+    md5_append(&md5, (md5_byte_t*)secret.c_str(), secret.length());
+    md5_byte_t digest[16];
+    md5_finish(&md5, digest);
+    buf.remove(20);
+    
+    con.send(digest, 16);
+    if (con.sendAll())
+        return -1;
+    
+    if (con.recvData(4) || (4 != buf.getFilled()) || 
+            memcmp(buf.getData(), "PASS", 4)) 
+    {
+        log.error("authentication failed");
+        return -1;
+    }
+    buf.remove(4);
+
+    props = propsCount;
+    NetBuf &sendBuf = con.getSendBuffer();
+    for (int i = 0; i < props; i++) {
+        std::string name = getBenchPropName(i);
+        sendBuf.addUint8(1);
+        sendBuf.addUint8(PROP_FLOAT);
+        sendBuf.addUint8(i + 1);
+        sendBuf.addUint8(name.length());
+        sendBuf.addUint16(0);
+        sendBuf.add((const unsigned char*)name.c_str(), name.length());
+    }
+    if (con.sendAll())
+        return -1;
+
+    propsToGo = 0;
+    pendingResponse = false;
+    return 0;
+}
+
+
+int BenchClient::update(std::vector<double> *latencies)
+{
+    if (con.update())
+        return -1;
+
+    NetBuf &buf = con.getRecvBuffer();
+    double now = getTime();
+
+    while (true) {
+        if (! propsToGo) {
+            if (4 > buf.getFilled())
+                break;
+            if (4 != buf.getData()[0]) {
+                log.error("invalid reply %i", buf.getData()[0]);
+                return -1;
+            }
+            propsToGo = buf.getData()[1];
+            buf.remove(4);
+            if (! propsToGo) {
+                pendingResponse = false;
+                replies++;
+                continue;
+            }
+        }
+
+        size_t sz = 1 + getPropTypeSize(PROP_FLOAT);
+        while (propsToGo && (sz <= buf.getFilled())) {
+            int id = buf.getData()[0];
+            if ((! id) || (id > props)) {
+                log.error("invalid property id %i", id);
+                return -1;
+            }
+            if (latencies)
+                latencies->push_back(now - netToFloat(buf.getData() + 1));
+            buf.remove(sz);
+            propsToGo--;
+        }
+
+        if (propsToGo)
+            break;
+        pendingResponse = false;
+        replies++;
+    }
+
+    if (! pendingResponse) {
+        con.getSendBuffer().addUint8(3);
+        pendingResponse = true;
+    }
+
+    return 0;
+}
+
+
+void BenchClient::close()
+{
+    con.close();
+}
+
@@ -0,0 +1,63 @@
+#ifndef __BENCH_CLIENT_H__
+#define __BENCH_CLIENT_H__
+
+
+#include <string>
+#include <vector>
+#include "lownet.h"
+
+
+namespace netbench {
+
+
+/// Simulated networked properties client.
+/// Subscribes to benchmark properties and requests their values as fast
+/// as server replies.  Values of benchmark properties are times of their
+/// change so latency is difference between current time and received value.
+class BenchClient
+{
+    private:
+        /// Logger to use
+        xa::Log &log;
+
+        /// Connection to server
+        xa::AsyncCon con;
+
+        /// Number of properties subscribed to
+        int props;
+
+        /// Number of properties left to parse in current reply
+        int propsToGo;
+
+        /// Equals true if get values request was sent but not answered yet
+        bool pendingResponse;
+
+        /// Number of replies received
+        int replies;
+
+    public:
+        /// Create disconnected client
+        BenchClient(xa::Log &log);
+
+    public:
+        /// Connect to server, authenticate and subscribe to properties.
+        /// Returns zero on success
+        int connect(int port, const std::string &secret, int props);
+
+        /// Receive replies and send new requests.
+        /// Latencies of received values in milliseconds are appended
+        /// to latencies if it is not NULL.
+        /// Returns zero on success
+        int update(std::vector<double> *latencies);
+
+        /// Close connection
+        void close();
+
+        /// Returns number of replies received
+        int getReplies() const { return replies; }
+};
+
+};
+
+#endif
+
@@ -0,0 +1,277 @@
+#include "benchprops.h"
+
+#include <string>
+#include <map>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include "utils.h"
+
+
+using namespace netbench;
+
+
+struct BenchProps;
+
+
+/// Property stored in memory
+struct BenchProp
+{
+    /// Storage this property belongs to
+    BenchProps *props;
+
+    /// Type of property
+    int type;
+
+    /// Maximum size of string property
+    int maxSize;
+
+    /// Index of synthetic property or -1 for stored values
+    int synthIndex;
+
+    int intValue;
+    float floatValue;
+    double doubleValue;
+    std::string stringValue;
+
+    BenchProp(BenchProps *props, int type, int maxSize, int synthIndex): 
+        props(props), type(type), maxSize(maxSize), synthIndex(synthIndex),
+        intValue(0), floatValue(0), doubleValue(0) { };
+};
+
+
+/// In-memory properties storage
+struct BenchProps
+{
+    /// Properties by names
+    std::map<std::string, BenchProp*> props;
+
+    /// Generate values of benchmark properties on read
+    bool synthetic;
+
+    /// Changes per second of synthetic properties
+    double rate;
+
+    ~BenchProps() {
+        for (std::map<std::string, BenchProp*>::iterator i = props.begin();
+                i != props.end(); i++)
+            delete (*i).second;
+    }
+};
+
+
+/// Returns index of benchmark property or -1 if name is not
+/// benchmark property name
+static int getSynthIndex(const char *name)
+{
+    int index;
+    char c;
+    if (1 == sscanf(name, "netbench/prop%i%c", &index, &c))
+        return index;
+    else
+        return -1;
+}
+
+
+/// Returns value of synthetic property
+static float getSynthValue(BenchProps *props, int index)
+{
+    return getChangeTime(index, props->rate, getTime());
+}
+
+
+static SaslPropRef createProp(SaslProps props, const char *name, int type, 
+        int maxSize)
+{
+    BenchProps *p = (BenchProps*)props;
+    if ((! p) || (! name))
+        return NULL;
+
+    std::map<std::string, BenchProp*>::iterator i = p->props.find(name);
+    if (i != p->props.end()) 
+        return ((*i).second->type == type) ? (*i).second : NULL;
+
+    int synthIndex = -1;
+    if (p->synthetic && (PROP_FLOAT == type))
+        synthIndex = getSynthIndex(name);
+    BenchProp *prop = new BenchProp(p, type, maxSize, synthIndex);
+    p->props[name] = prop;
+    return prop;
+}
+
+
+static SaslPropRef getPropRef(SaslProps props, const char *name, int type)
+{
+    BenchProps *p = (BenchProps*)props;
+    if ((! p) || (! name))
+        return NULL;
+
+    std::map<std::string, BenchProp*>::iterator i = p->props.find(name);
+    if ((i == p->props.end()) || ((*i).second->type != type))
+        return NULL;
+    return (*i).second;
+}
+
+
+static SaslPropRef createFuncProp(SaslProps props, const char *name, 
+            int type, int maxSize, sasl_prop_getter_callback getter, 
+            sasl_prop_setter_callback setter, void *ref)
+{
+    return NULL;
+}
+
+
+static void freePropRef(SaslPropRef prop)
+{
+}
+
+
+static int getPropInt(SaslPropRef prop, int *err)
+{
+    BenchProp *p = (BenchProp*)prop;
+    if ((! p) || (PROP_INT != p->type)) {
+        if (err) *err = 1;
+        return 0;
+    }
+    if (err) *err = 0;
+    return p->intValue;
+}
+
+
+static int setPropInt(SaslPropRef prop, int value)
+{
+    BenchProp *p = (BenchProp*)prop;
+    if ((! p) || (PROP_INT != p->type))
+        return -1;
+    p->intValue = value;
+    return 0;
+}
+
+
+static float getPropFloat(SaslPropRef prop, int *err)
+{
+    BenchProp *p = (BenchProp*)prop;
+    if ((! p) || (PROP_FLOAT != p->type)) {
+        if (err) *err = 1;
+        return 0;
+    }
+    if (err) *err = 0;
+    if (-1 != p->synthIndex)
+        return getSynthValue(p->props, p->synthIndex);
+    return p->floatValue;
+}
+
+
+static int setPropFloat(SaslPropRef prop, float value)
+{
+    BenchProp *p = (BenchProp*)prop;
+    if ((! p) || (PROP_FLOAT != p->type) || (-1 != p->synthIndex))
+        return -1;
+    p->floatValue = value;
+    return 0;
+}
+
+
+static double getPropDouble(SaslPropRef prop, int *err)
+{
+    BenchProp *p = (BenchProp*)prop;
+    if ((! p) || (PROP_DOUBLE != p->type)) {
+        if (err) *err = 1;
+        return 0;
+    }
+    if (err) *err = 0;
+    return p->doubleValue;
+}
+
+
+static int setPropDouble(SaslPropRef prop, double value)
+{
+    BenchProp *p = (BenchProp*)prop;
+    if ((! p) || (PROP_DOUBLE != p->type))
+        return -1;
+    p->doubleValue = value;
+    return 0;
+}
+
+
+static int getPropString(SaslPropRef prop, char *buf, int maxSize, int *err)
+{
+    BenchProp *p = (BenchProp*)prop;
+    if ((! p) || (PROP_STRING != p->type)) {
+        if (err) *err = 1;
+        return 0;
+    }
+    if (err) *err = 0;
+    int len = p->stringValue.length();
+    if (buf && (0 < maxSize)) {
+        int sz = (len < maxSize) ? len : maxSize - 1;
+        memcpy(buf, p->stringValue.c_str(), sz);
+        buf[sz] = 0;
+    }
+    return len;
+}
+
+
+static int setPropString(SaslPropRef prop, const char *value)
+{
+    BenchProp *p = (BenchProp*)prop;
+    if ((! p) || (PROP_STRING != p->type) || (! value))
+        return -1;
+    p->stringValue = value;
+    if (p->maxSize && ((int)p->stringValue.length() > p->maxSize))
+        p->stringValue.resize(p->maxSize);
+    return 0;
+}
+
+
+static int updateProps(SaslProps props)
+{
+    return 0;
+}
+
+
+static void doneProps(SaslProps props)
+{
+    delete (BenchProps*)props;
+}
+
+
+static SaslPropsCallbacks callbacks = { getPropRef, freePropRef, createProp, 
+        createFuncProp, getPropInt, setPropInt, getPropFloat, 
+        setPropFloat, getPropDouble, setPropDouble, 
+        getPropString, setPropString,
+        updateProps, doneProps };
+
+
+SaslProps netbench::createBenchProps(bool synthetic, double rate)
+{
+    BenchProps *props = new BenchProps();
+    props->synthetic = synthetic;
+    props->rate = rate;
+    return props;
+}
+
+
+struct SaslPropsCallbacks* netbench::getBenchPropsCallbacks()
+{
+    return &callbacks;
+}
+
+
+double netbench::getChangeTime(int index, double rate, double now)
+{
+    double period = 1000.0 / rate;
+    double phase = period * (index % 16) / 16.0;
+    if (now < phase)
+        return 0;
+    return floor((now - phase) / period) * period + phase;
+}
+
+
+std::string netbench::getBenchPropName(int index)
+{
+    char buf[64];
+    snprintf(buf, sizeof(buf), "netbench/prop%i", index);
+    return buf;
+}
+
@@ -0,0 +1,37 @@
+#ifndef __BENCH_PROPS_H__
+#define __BENCH_PROPS_H__
+
+
+#include <string>
+#include "libavcallbacks.h"
+
+
+namespace netbench {
+
+
+/// Create in-memory properties storage.
+/// If synthetic is true values of float properties named
+/// netbench/propN are not stored but generated on read: each property
+/// changes rate times per second and its value is time of last change.
+/// \param synthetic enable synthetic backend
+/// \param rate number of changes per second of synthetic properties
+SaslProps createBenchProps(bool synthetic, double rate);
+
+/// Returns callbacks for storage created by createBenchProps
+struct SaslPropsCallbacks* getBenchPropsCallbacks();
+
+/// Returns name of benchmark property with specified index
+std::string getBenchPropName(int index);
+
+/// Returns time of last scheduled change of benchmark property.
+/// Changes of properties are spread evenly over change period.
+/// \param index index of benchmark property
+/// \param rate number of changes per second
+/// \param now current time in milliseconds
+double getChangeTime(int index, double rate, double now);
+
+};
+
+
+#endif
+
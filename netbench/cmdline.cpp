@@ -0,0 +1,97 @@
+#include "cmdline.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include "utils.h"
+#include "../version.h"
+
+
+using namespace netbench;
+
+
+/// Print version and exit
+static void printVersion()
+{
+    printf("Networked Properties Benchmark v%i.%i.%i\n", 
+            VERSION_MAJOR, VERSION_MINOR, VERSION_PATCH);
+    exit(0);
+}
+
+
+/// Print short command line help and exit
+static void printHelp()
+{
+    printf("USAGE:\n");
+    printf("  netbench [options]\n");
+    printf("OPTIONS:\n");
+    printf("  --data <path>        - location of sasl data dir\n");
+    printf("  --port <portnumber>  - port to run properties server on\n");
+    printf("  --secret <password>  - properties server password\n");
+    printf("  --clients <number>   - number of simulated clients\n");
+    printf("  --props <number>     - number of properties per client (1-255)\n");
+    printf("  --rate <number>      - changes per second of each property\n");
+    printf("  --fps <number>       - server frames per second\n");
+    printf("  --duration <seconds> - duration of measurement\n");
+    printf("  --warmup <seconds>   - duration of warm-up before measurement\n");
+    printf("  --synthetic          - use synthetic properties backend\n");
+    printf("  --snapshot           - publish properties from simulator thread\n");
+    printf("  --version            - print version number\n");
+    printf("  --help               - print this help\n");
+    exit(0);
+}
+
+
+netbench::CmdLine::CmdLine(int argc, char *argv[]): 
+    dataDir("./data"), port(45829), secret("netbench"), 
+    clients(8), props(32), rate(10), fps(60), duration(10), warmup(1),
+    synthetic(false), snapshot(false)
+{
+    for (int i = 1; i < argc; i++) {
+        if (! argv[i])
+            continue;
+
+        if ((! strcmp(argv[i], "--data")) && (i < argc - 1))
+            dataDir = std::string(argv[++i]);
+        else if ((! strcmp(argv[i], "--port")) && (i < argc - 1))
+            port = strToInt(argv[++i]);
+        else if ((! strcmp(argv[i], "--secret")) && (i < argc - 1))
+            secret = std::string(argv[++i]);
+        else if ((! strcmp(argv[i], "--clients")) && (i < argc - 1))
+            clients = strToInt(argv[++i], clients);
+        else if ((! strcmp(argv[i], "--props")) && (i < argc - 1))
+            props = strToInt(argv[++i], props);
+        else if ((! strcmp(argv[i], "--rate")) && (i < argc - 1))
+            rate = strToDouble(argv[++i], rate);
+        else if ((! strcmp(argv[i], "--fps")) && (i < argc - 1))
+            fps = strToInt(argv[++i], fps);
+        else if ((! strcmp(argv[i], "--duration")) && (i < argc - 1))
+            duration = strToInt(argv[++i], duration);
+        else if ((! strcmp(argv[i], "--warmup")) && (i < argc - 1))
+            warmup = strToInt(argv[++i], warmup);
+        else if (! strcmp(argv[i], "--synthetic"))
+            synthetic = true;
+        else if (! strcmp(argv[i], "--snapshot"))
+            snapshot = true;
+        else if (! strcmp(argv[i], "--version"))
+            printVersion();
+        else if (! strcmp(argv[i], "--help"))
+            printHelp();
+        else {
+            printf("Invalid option '%s'.\n", argv[i]);
+            exit(1);
+        }
+    }
+
+    if ((1 > props) || (255 < props)) {
+        printf("Number of properties must be in range 1-255.\n");
+        exit(1);
+    }
+    if ((1 > clients) || (0 >= rate) || (1 > fps) || (1 > duration) ||
+            (0 > warmup)) 
+    {
+        printf("Invalid benchmark parameters.\n");
+        exit(1);
+    }
+}
+
@@ -0,0 +1,89 @@
+#ifndef __CMD_LINE_H__
+#define __CMD_LINE_H__
+
+
+#include <string>
+
+
+namespace netbench {
+
+
+class CmdLine
+{
+    private:
+        /// path to data dir
+        std::string dataDir;
+
+        /// port to run properties server on
+        int port;
+
+        /// properties server password
+        std::string secret;
+
+        /// Number of simulated clients
+        int clients;
+
+        /// Number of properties each client subscribed to
+        int props;
+
+        /// How many times per second each property is changed
+        double rate;
+
+        /// Server frames per second
+        int fps;
+
+        /// Duration of measurement in seconds
+        int duration;
+
+        /// Duration of warm-up in seconds
+        int warmup;
+
+        /// Use synthetic properties backend instead of in-process store
+        bool synthetic;
+
+        /// Serve properties from snapshot published by simulator thread
+        bool snapshot;
+
+    public:
+        /// Parse command line
+        CmdLine(int argc, char *argv[]);
+
+    public:
+        /// Returns path to data dir
+        const std::string& getDataDir() const { return dataDir; }
+        
+        /// Returns properties server port
+        int getPort() const { return port; }
+        
+        /// Returns properties server password
+        const std::string& getSecret() const { return secret; }
+        
+        /// Returns number of simulated clients
+        int getClients() const { return clients; }
+        
+        /// Returns number of properties per client
+        int getProps() const { return props; }
+        
+        /// Returns number of changes per second of each property
+        double getRate() const { return rate; }
+        
+        /// Returns server frames per second
+        int getFps() const { return fps; }
+        
+        /// Returns duration of measurement in seconds
+        int getDuration() const { return duration; }
+        
+        /// Returns duration of warm-up in seconds
+        int getWarmup() const { return warmup; }
+
+        /// Returns true if synthetic properties backend requested
+        bool isSynthetic() const { return synthetic; }
+
+        /// Returns true if properties snapshot requested
+        bool isSnapshot() const { return snapshot; }
+};
+
+};
+
+#endif
+
@@ -0,0 +1,294 @@
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+
+#include "libavionics.h"
+#include "log.h"
+#include "cmdline.h"
+#include "benchprops.h"
+#include "benchclient.h"
+#include "utils.h"
+
+
+using namespace netbench;
+
+
+/// Benchmark stage shared between server and clients threads
+enum Stage {
+    STAGE_CONNECT,
+    STAGE_WARMUP,
+    STAGE_MEASURE,
+    STAGE_DONE,
+    STAGE_FAILED
+};
+
+
+/// Current benchmark stage
+static std::atomic<int> stage(STAGE_CONNECT);
+
+
+/// Latencies of received values in milliseconds
+static std::vector<double> latencies;
+
+/// Total number of replies received by clients
+static int totalReplies = 0;
+
+
+/// Connect all clients and poll them till benchmark is over
+static void runClients(const CmdLine &cmdLine)
+{
+    xa::Log log;
+    std::vector<BenchClient*> clients;
+
+    for (int i = 0; i < cmdLine.getClients(); i++) {
+        BenchClient *client = new BenchClient(log);
+        clients.push_back(client);
+        if (client->connect(cmdLine.getPort(), cmdLine.getSecret(), 
+                    cmdLine.getProps())) 
+        {
+            fprintf(stderr, "Client %i can't connect to server\n", i);
+            stage = STAGE_FAILED;
+            break;
+        }
+    }
+
+    if (STAGE_CONNECT == stage)
+        stage = STAGE_WARMUP;
+
+    int measureReplies = 0;
+    while ((STAGE_WARMUP == stage) || (STAGE_MEASURE == stage)) {
+        bool measure = (STAGE_MEASURE == stage);
+        for (std::vector<BenchClient*>::iterator i = clients.begin();
+                i != clients.end(); i++)
+        {
+            BenchClient *client = *i;
+            int replies = client->getReplies();
+            if (client->update(measure ? &latencies : NULL)) {
+                fprintf(stderr, "Client connection failed\n");
+                stage = STAGE_FAILED;
+                break;
+            }
+            if (measure)
+                measureReplies += client->getReplies() - replies;
+        }
+        sleepMs(0.1);
+    }
+    totalReplies = measureReplies;
+
+    for (std::vector<BenchClient*>::iterator i = clients.begin();
+            i != clients.end(); i++)
+    {
+        (*i)->close();
+        delete *i;
+    }
+}
+
+
+/// Returns value of percentile of sorted samples
+static double percentile(const std::vector<double> &samples, double p)
+{
+    if (samples.empty())
+        return 0;
+    return samples[(size_t)((samples.size() - 1) * p)];
+}
+
+
+/// Set new values of changed properties
+static void changeProps(SASL sasl, const CmdLine &cmdLine,
+        std::vector<SaslPropRef> &refs, std::vector<double> &lastChange)
+{
+    double now = getTime();
+    for (size_t i = 0; i < refs.size(); i++) {
+        double changeTime = getChangeTime(i, cmdLine.getRate(), now);
+        if (changeTime != lastChange[i]) {
+            sasl_set_prop_float(sasl, refs[i], changeTime);
+            lastChange[i] = changeTime;
+        }
+    }
+}
+
+
+/// Own properties backend like simulator does: change properties and
+/// publish snapshot once per frame while main thread runs server
+static void runSimulator(SASL sasl, const CmdLine &cmdLine,
+        struct SaslPropsCallbacks *callbacks, SaslProps props)
+{
+    std::vector<SaslPropRef> refs;
+    std::vector<double> lastChange;
+    for (int i = 0; i < cmdLine.getProps(); i++) {
+        refs.push_back(callbacks->create_prop(props, 
+                    getBenchPropName(i).c_str(), PROP_FLOAT, 0));
+        lastChange.push_back(-1);
+    }
+
+    double framePeriod = 1000.0 / cmdLine.getFps();
+    double nextFrame = getTime();
+    while ((STAGE_DONE != stage) && (STAGE_FAILED != stage)) {
+        if (! cmdLine.isSynthetic()) {
+            double now = getTime();
+            for (size_t i = 0; i < refs.size(); i++) {
+                double changeTime = getChangeTime(i, cmdLine.getRate(), now);
+                if (changeTime != lastChange[i]) {
+                    callbacks->set_prop_float(refs[i], changeTime);
+                    lastChange[i] = changeTime;
+                }
+            }
+        }
+
+        sasl_publish_props(sasl);
+
+        nextFrame += framePeriod;
+        double now = getTime();
+        if (nextFrame > now)
+            sleepMs(nextFrame - now);
+        else
+            nextFrame = now;
+    }
+
+    for (size_t i = 0; i < refs.size(); i++)
+        callbacks->free_prop_ref(refs[i]);
+}
+
+
+int main(int argc, char *argv[])
+{
+    CmdLine cmdLine(argc, argv);
+
+    getTime();
+
+    SASL sasl = sasl_init(cmdLine.getDataDir().c_str(), NULL, NULL);
+    if (! sasl) {
+        fprintf(stderr, "Can't initialize SASL at '%s'\n", 
+                cmdLine.getDataDir().c_str());
+        return 1;
+    }
+
+    struct SaslPropsCallbacks *callbacks = getBenchPropsCallbacks();
+    SaslProps props = createBenchProps(cmdLine.isSynthetic(), 
+            cmdLine.getRate());
+    if (cmdLine.isSnapshot() && sasl_enable_props_snapshot(sasl)) {
+        fprintf(stderr, "Can't enable properties snapshot\n");
+        sasl_done(sasl);
+        return 1;
+    }
+    sasl_set_props(sasl, callbacks, props);
+
+    std::vector<SaslPropRef> refs;
+    std::vector<double> lastChange;
+    if (! cmdLine.isSnapshot())
+        for (int i = 0; i < cmdLine.getProps(); i++) {
+            refs.push_back(sasl_create_prop(sasl, 
+                        getBenchPropName(i).c_str(), PROP_FLOAT));
+            lastChange.push_back(-1);
+        }
+
+    if (sasl_start_netprop_server(sasl, cmdLine.getPort(), 
+                cmdLine.getSecret().c_str())) 
+    {
+        fprintf(stderr, "Can't start properties server on port %i\n", 
+                cmdLine.getPort());
+        sasl_done(sasl);
+        return 1;
+    }
+
+    std::thread clientsThread(runClients, std::cref(cmdLine));
+    std::thread simulatorThread;
+    if (cmdLine.isSnapshot())
+        simulatorThread = std::thread(runSimulator, sasl, std::cref(cmdLine),
+                callbacks, props);
+
+    double framePeriod = 1000.0 / cmdLine.getFps();
+    double stageStart = -1;
+    double measureStart = 0, measureEnd = 0;
+    std::vector<double> cpuTimes;
+    SaslNetStats startStats, endStats;
+    memset(&startStats, 0, sizeof(startStats));
+    memset(&endStats, 0, sizeof(endStats));
+
+    double nextFrame = getTime();
+    while ((STAGE_DONE != stage) && (STAGE_FAILED != stage)) {
+        double now = getTime();
+        if ((STAGE_WARMUP == stage) && (0 > stageStart))
+            stageStart = now;
+        else if ((STAGE_WARMUP == stage) && 
+                (now - stageStart >= cmdLine.getWarmup() * 1000.0)) 
+        {
+            sasl_get_netprop_server_stats(sasl, &startStats);
+            measureStart = now;
+            stage = STAGE_MEASURE;
+        } else if ((STAGE_MEASURE == stage) && 
+                (now - measureStart >= cmdLine.getDuration() * 1000.0)) 
+        {
+            sasl_get_netprop_server_stats(sasl, &endStats);
+            measureEnd = now;
+            stage = STAGE_DONE;
+            break;
+        }
+
+        if (! (cmdLine.isSynthetic() || cmdLine.isSnapshot()))
+            changeProps(sasl, cmdLine, refs, lastChange);
+
+        bool measure = (STAGE_MEASURE == stage);
+        double cpuStart = getThreadCpuTime();
+        sasl_update(sasl);
+        if (measure)
+            cpuTimes.push_back(getThreadCpuTime() - cpuStart);
+
+        nextFrame += framePeriod;
+        now = getTime();
+        if (nextFrame > now)
+            sleepMs(nextFrame - now);
+        else
+            nextFrame = now;
+    }
+
+    clientsThread.join();
+    if (simulatorThread.joinable())
+        simulatorThread.join();
+
+    int result = 0;
+    if (STAGE_DONE == stage) {
+        std::sort(cpuTimes.begin(), cpuTimes.end());
+        std::sort(latencies.begin(), latencies.end());
+        double cpuTotal = 0;
+        for (std::vector<double>::iterator i = cpuTimes.begin();
+                i != cpuTimes.end(); i++)
+            cpuTotal += *i;
+        double seconds = (measureEnd - measureStart) / 1000.0;
+        int frames = cpuTimes.size();
+
+        printf("clients:             %i\n", cmdLine.getClients());
+        printf("props per client:    %i\n", cmdLine.getProps());
+        printf("changes per second:  %g\n", cmdLine.getRate());
+        printf("backend:             %s\n", 
+                cmdLine.isSynthetic() ? "synthetic" : "store");
+        printf("properties access:   %s\n", 
+                cmdLine.isSnapshot() ? "snapshot" : "direct");
+        printf("frames:              %i in %.2f s\n", frames, seconds);
+        printf("server cpu/update:   mean %.1f us, p50 %.1f us, p99 %.1f us\n",
+                frames ? cpuTotal / frames : 0.0, percentile(cpuTimes, 0.5), 
+                percentile(cpuTimes, 0.99));
+        printf("latency:             p50 %.2f ms, p99 %.2f ms (%i samples)\n",
+                percentile(latencies, 0.5), percentile(latencies, 0.99),
+                (int)latencies.size());
+        printf("replies per second:  %.1f\n", totalReplies / seconds);
+        printf("bytes per second:    sent %.0f, received %.0f\n",
+                (endStats.bytesSent - startStats.bytesSent) / seconds,
+                (endStats.bytesReceived - startStats.bytesReceived) / seconds);
+        printf("syscalls per frame:  %.1f\n", frames ? 
+                (double)(endStats.syscalls - startStats.syscalls) / frames : 0);
+    } else {
+        fprintf(stderr, "Benchmark failed\n");
+        result = 1;
+    }
+
+    sasl_stop_netprop_server(sasl);
+    sasl_done(sasl);
+
+    return result;
+}
+
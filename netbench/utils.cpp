@@ -0,0 +1,75 @@
+#include "utils.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+
+using namespace netbench;
+
+
+int netbench::strToInt(const std::string &str, int dflt)
+{
+    int n;
+    char *endptr;
+
+    n = strtol(str.c_str(), &endptr, 10);
+    if ((! str.c_str()[0]) || (endptr[0])) 
+        return dflt;
+    else
+        return n;
+}
+
+
+double netbench::strToDouble(const std::string &str, double dflt)
+{
+    double n;
+    char *endptr;
+
+    n = strtod(str.c_str(), &endptr);
+    if ((! str.c_str()[0]) || (endptr[0])) 
+        return dflt;
+    else
+        return n;
+}
+
+
+/// Convert timespec to milliseconds
+static double toMs(const struct timespec &ts)
+{
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+
+double netbench::getTime()
+{
+    static double startTime = -1;
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    double now = toMs(ts);
+    if (0 > startTime)
+        startTime = now;
+    return now - startTime;
+}
+
+
+double netbench::getThreadCpuTime()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return toMs(ts) * 1000.0;
+}
+
+
+void netbench::sleepMs(double ms)
+{
+    if (0 >= ms)
+        return;
+    struct timespec ts;
+    ts.tv_sec = (time_t)(ms / 1000);
+    ts.tv_nsec = (long)((ms - ts.tv_sec * 1000.0) * 1000000.0);
+    nanosleep(&ts, NULL);
+}
+
@@ -0,0 +1,31 @@
+#ifndef __UTILS_H__
+#define __UTILS_H__
+
+
+#include <string>
+
+
+namespace netbench {
+
+
+/// convert number to integer
+int strToInt(const std::string &str, int dflt=0);
+
+/// convert number to double
+double strToDouble(const std::string &str, double dflt=0);
+
+/// Returns monotonic time in milliseconds since first call
+double getTime();
+
+/// Returns CPU time consumed by calling thread in microseconds
+double getThreadCpuTime();
+
+/// Sleep specified number of milliseconds
+void sleepMs(double ms);
+
+
+};
+
+
+#endif
+
@@ -0,0 +1,245 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef WINDOWS
+#include <windows.h>
+#else
+#include <dirent.h>
+#endif
+
+#include "pakfmt.h"
+#include "pakreader.h"
+#include "recordfmt.h"
+#include "../version.h"
+
+
+using namespace xa;
+
+
+/// File to pack
+struct PackedFile
+{
+    /// Path relative to packed directory
+    std::string name;
+
+    /// Storage method
+    int method;
+
+    /// Size of file
+    size_t size;
+
+    /// Stored data
+    std::vector<unsigned char> data;
+};
+
+
+/// Print short command line help and exit
+static void printHelp()
+{
+    printf("SASL Panel Packer v%i.%i.%i\n",
+            VERSION_MAJOR, VERSION_MINOR, VERSION_PATCH);
+    printf("USAGE:\n");
+    printf("  saslpack [--store] <directory> <archive> - pack directory\n");
+    printf("  saslpack --list <archive>                 - list archive\n");
+    printf("OPTIONS:\n");
+    printf("  --store  - don't compress files\n");
+    printf("EXAMPLE:\n");
+    printf("  saslpack \"Custom Avionics\" \"Custom Avionics.pak\"\n");
+    exit(0);
+}
+
+
+/// Add names of files of directory and its subdirectories to list
+static void listFiles(const std::string &root, const std::string &dir,
+        std::vector<std::string> &names)
+{
+    std::string path = dir.empty() ? root : root + "/" + dir;
+    std::vector<std::string> entries;
+
+#ifdef WINDOWS
+    WIN32_FIND_DATAA data;
+    HANDLE h = FindFirstFileA((path + "/*").c_str(), &data);
+    if (INVALID_HANDLE_VALUE == h)
+        return;
+    do {
+        entries.push_back(data.cFileName);
+    } while (FindNextFileA(h, &data));
+    FindClose(h);
+#else
+    DIR *d = opendir(path.c_str());
+    if (! d)
+        return;
+    struct dirent *entry;
+    while ((entry = readdir(d)))
+        entries.push_back(entry->d_name);
+    closedir(d);
+#endif
+
+    for (size_t i = 0; i < entries.size(); i++) {
+        const std::string &entry = entries[i];
+        if (("." == entry) || (".." == entry))
+            continue;
+        std::string name = dir.empty() ? entry : dir + "/" + entry;
+        struct stat st;
+        if (stat((root + "/" + name).c_str(), &st))
+            continue;
+        if (S_ISDIR(st.st_mode))
+            listFiles(root, name, names);
+        else if (S_ISREG(st.st_mode))
+            names.push_back(name);
+    }
+}
+
+
+/// Read file.  Returns 0 on success.
+static int readFile(const std::string &fileName,
+        std::vector<unsigned char> &data)
+{
+    FILE *f = fopen(fileName.c_str(), "rb");
+    if (! f)
+        return -1;
+    unsigned char buf[65536];
+    size_t len;
+    while (0 < (len = fread(buf, 1, sizeof(buf), f)))
+        data.insert(data.end(), buf, buf + len);
+    bool failed = ferror(f);
+    fclose(f);
+    return failed ? -1 : 0;
+}
+
+
+/// Pack directory into archive.  Returns 0 on success.
+static int pack(const std::string &dir, const std::string &archiveName,
+        bool compress)
+{
+    std::vector<std::string> names;
+    listFiles(dir, "", names);
+    std::sort(names.begin(), names.end());
+
+    std::vector<PackedFile> files(names.size());
+    size_t totalSize = 0;
+    size_t indexSize = 0;
+    for (size_t i = 0; i < names.size(); i++) {
+        PackedFile &file = files[i];
+        file.name = names[i];
+        if (readFile(dir + "/" + file.name, file.data)) {
+            fprintf(stderr, "Can't read %s\n", file.name.c_str());
+            return -1;
+        }
+        file.size = file.data.size();
+        file.method = PAK_STORED;
+
+        // already compressed images and sounds are stored
+        if (compress && file.size &&
+                (file.size <= PAK_MAX_COMPRESSED_SIZE)) {
+            std::vector<unsigned char> packed;
+            pakCompress(&file.data[0], file.size, packed);
+            if (packed.size() < file.size - file.size / 8) {
+                file.data.swap(packed);
+                file.method = PAK_COMPRESSED;
+            }
+        }
+
+        totalSize += file.size;
+        indexSize += PAK_MIN_ENTRY_SIZE + file.name.size();
+    }
+
+    std::vector<unsigned char> index(PAK_SIGNATURE,
+            PAK_SIGNATURE + sizeof(PAK_SIGNATURE));
+    recordPutUint(index, PAK_VERSION, 4);
+    recordPutUint(index, files.size(), 4);
+    recordPutUint(index, indexSize, 8);
+
+    uint64_t offset = PAK_HEADER_SIZE + indexSize;
+    for (size_t i = 0; i < files.size(); i++) {
+        const PackedFile &file = files[i];
+        offset = (offset + PAK_ALIGN - 1) / PAK_ALIGN * PAK_ALIGN;
+        recordPutUint(index, file.name.size(), 2);
+        index.insert(index.end(), file.name.begin(), file.name.end());
+        index.push_back(file.method);
+        recordPutUint(index, offset, 8);
+        recordPutUint(index, file.size, 8);
+        recordPutUint(index, file.data.size(), 8);
+        offset += file.data.size();
+    }
+
+    FILE *f = fopen(archiveName.c_str(), "wb");
+    if (! f) {
+        fprintf(stderr, "Can't create %s\n", archiveName.c_str());
+        return -1;
+    }
+    bool failed = (1 != fwrite(&index[0], index.size(), 1, f));
+    size_t pos = index.size();
+    static const unsigned char padding[PAK_ALIGN] = { 0 };
+    for (size_t i = 0; (i < files.size()) && (! failed); i++) {
+        const PackedFile &file = files[i];
+        size_t pad = (PAK_ALIGN - pos % PAK_ALIGN) % PAK_ALIGN;
+        if (pad && (1 != fwrite(padding, pad, 1, f)))
+            failed = true;
+        if (file.data.size() &&
+                (1 != fwrite(&file.data[0], file.data.size(), 1, f)))
+            failed = true;
+        pos += pad + file.data.size();
+    }
+    if (fclose(f) || failed) {
+        fprintf(stderr, "Can't write %s\n", archiveName.c_str());
+        remove(archiveName.c_str());
+        return -1;
+    }
+
+    printf("%i files, %lu bytes packed into %lu bytes\n", (int)files.size(),
+            (unsigned long)totalSize, (unsigned long)pos);
+    return 0;
+}
+
+
+/// Print files of archive.  Returns 0 on success.
+static int list(const std::string &archiveName)
+{
+    PakReader reader;
+    if (reader.open(archiveName)) {
+        fprintf(stderr, "Can't open %s\n", archiveName.c_str());
+        return -1;
+    }
+
+    for (int i = 0; i < reader.getEntriesCount(); i++) {
+        const PakReader::Entry &entry = reader.getEntry(i);
+        printf("%10lu %10lu  %s\n", (unsigned long)entry.size,
+                (unsigned long)entry.packedSize, entry.name.c_str());
+    }
+
+    return 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+    bool compress = true;
+    bool listArchive = false;
+    std::vector<std::string> args;
+
+    for (int i = 1; i < argc; i++) {
+        if (! strcmp(argv[i], "--store"))
+            compress = false;
+        else if (! strcmp(argv[i], "--list"))
+            listArchive = true;
+        else if (! strcmp(argv[i], "--help"))
+            printHelp();
+        else
+            args.push_back(argv[i]);
+    }
+
+    if (listArchive && (1 == args.size()))
+        return list(args[0]) ? 1 : 0;
+    if ((! listArchive) && (2 == args.size()))
+        return pack(args[0], args[1], compress) ? 1 : 0;
+
+    printHelp();
+    return 1;
+}
+
@@ -44,6 +44,11 @@ static void printHelp()
     printf("  --data <path>        - location of sasl data dir\n");
     printf("  --fps <limit>        - limit maximum FPS (use 0 for unlimited)\n");
     printf("  --hide-mouse         - hide mouse cursor\n");
+    printf("  --record-session <file> - record input events, properties and\n");
+    printf("                          timer readings to file\n");
+    printf("  --replay-session <file> - replay recorded session without window\n");
+    printf("                          and print update and draw times\n");
+    printf("  --report <file>      - write per-frame times of replayed session\n");
     printf("  --version            - print version number\n");
     printf("  --help               - print this help\n");
     exit(0);
@@ -84,6 +89,12 @@ slava::CmdLine::CmdLine(int argc, char *argv[]):
              hideMouse = true;
         else if (! strcmp(argv[i], "--show-fps"))
              showFps = true;
+        else if ((! strcmp(argv[i], "--record-session")) && (i < argc - 1))
+            recordSession = std::string(argv[++i]);
+        else if ((! strcmp(argv[i], "--replay-session")) && (i < argc - 1))
+            replaySession = std::string(argv[++i]);
+        else if ((! strcmp(argv[i], "--report")) && (i < argc - 1))
+            report = std::string(argv[++i]);
         else if (! strcmp(argv[i], "--version"))
             printVersion();
         else if (! strcmp(argv[i], "--help"))
@@ -48,6 +48,15 @@ class CmdLine
         // equals true if FPS must be displayed
         bool showFps;
 
+        /// file to record session to
+        std::string recordSession;
+
+        /// file of session to replay
+        std::string replaySession;
+
+        /// file to write per-frame times of replayed session
+        std::string report;
+
     public:
         /// Parse command line
         CmdLine(int argc, char *argv[]);
@@ -88,6 +97,15 @@ class CmdLine
         
         /// Returns true if FPS must be shown
         bool isShowFps() const { return showFps; }
+
+        /// Returns name of file to record session or empty string
+        const std::string& getRecordSession() const { return recordSession; }
+
+        /// Returns name of session file to replay or empty string
+        const std::string& getReplaySession() const { return replaySession; }
+
+        /// Returns name of replay report file or empty string
+        const std::string& getReport() const { return report; }
 };
 
 };
@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <string>
+#include <map>
 
 #ifdef WINDOWS
 #include <Winsock2.h>
@@ -23,6 +24,9 @@
 #include "cmdline.h"
 #include "fps.h"
 #include "alsound.h"
+#include "session.h"
+#include "sessionprops.h"
+#include "player.h"
 
 
 using namespace slava;
@@ -34,6 +38,9 @@ static SDL_Window *window = NULL;
 // OpenGL context
 static SDL_GLContext glContext = NULL;
 
+// characters of pressed keys by virtual key codes
+static std::map<int, int> pressedChars;
+
 
 static void initSDL()
 {
@@ -103,12 +110,93 @@ static void initScreen(int &width, int &height, bool fullscreen,
 }
 
 
+// returns X-Plane virtual key code of SDL key or -1 if key has no such code
+static int getVirtualKey(SDL_Keycode key)
+{
+    if ((SDLK_a <= key) && (key <= SDLK_z))
+        return 0x41 + key - SDLK_a;
+    if ((SDLK_0 <= key) && (key <= SDLK_9))
+        return 0x30 + key - SDLK_0;
+    if ((SDLK_F1 <= key) && (key <= SDLK_F12))
+        return 0x70 + key - SDLK_F1;
+    if ((SDLK_KP_1 <= key) && (key <= SDLK_KP_9))
+        return 0x61 + key - SDLK_KP_1;
+
+    switch (key) {
+        case SDLK_BACKSPACE: return 0x08;
+        case SDLK_TAB: return 0x09;
+        case SDLK_RETURN: return 0x0D;
+        case SDLK_ESCAPE: return 0x1B;
+        case SDLK_SPACE: return 0x20;
+        case SDLK_PAGEUP: return 0x21;
+        case SDLK_PAGEDOWN: return 0x22;
+        case SDLK_END: return 0x23;
+        case SDLK_HOME: return 0x24;
+        case SDLK_LEFT: return 0x25;
+        case SDLK_UP: return 0x26;
+        case SDLK_RIGHT: return 0x27;
+        case SDLK_DOWN: return 0x28;
+        case SDLK_INSERT: return 0x2D;
+        case SDLK_DELETE: return 0x2E;
+        case SDLK_KP_0: return 0x60;
+        case SDLK_KP_MULTIPLY: return 0x6A;
+        case SDLK_KP_PLUS: return 0x6B;
+        case SDLK_KP_MINUS: return 0x6D;
+        case SDLK_KP_PERIOD: return 0x6E;
+        case SDLK_KP_DIVIDE: return 0x6F;
+        case SDLK_EQUALS: return 0xB0;
+        case SDLK_MINUS: return 0xB1;
+        case SDLK_RIGHTBRACKET: return 0xB2;
+        case SDLK_LEFTBRACKET: return 0xB3;
+        case SDLK_QUOTE: return 0xB4;
+        case SDLK_SEMICOLON: return 0xB5;
+        case SDLK_BACKSLASH: return 0xB6;
+        case SDLK_COMMA: return 0xB7;
+        case SDLK_SLASH: return 0xB8;
+        case SDLK_PERIOD: return 0xB9;
+        case SDLK_BACKQUOTE: return 0xBA;
+        case SDLK_KP_ENTER: return 0xBC;
+        default: return -1;
+    }
+}
+
+
+// returns character code of keys which don't produce text input
+static int getControlChar(SDL_Keycode key)
+{
+    switch (key) {
+        case SDLK_BACKSPACE: return '\b';
+        case SDLK_TAB: return '\t';
+        case SDLK_RETURN: 
+        case SDLK_KP_ENTER: return '\r';
+        case SDLK_ESCAPE: return 27;
+        case SDLK_DELETE: return 127;
+        default: return 0;
+    }
+}
+
+
+// pass input event to SASL and record it
+static void sendInput(SASL sasl, SessionWriter &session, 
+        const SessionEvent &input)
+{
+    // key up event gets the same character as key down
+    if (EVENT_KEY_DOWN == input.type)
+        pressedChars[input.b] = input.a;
+
+    sendEvent(sasl, input);
+    session.addEvent(input);
+}
+
+
 static SASL createPanel(SaslGraphicsCallbacks* graphics, int width, int height, 
         const std::string &data, const std::string &panel, 
         const std::string &host, int port, const std::string &secret,
-        std::vector<std::string> &paths, SaslAlSound* &sound)
+        std::vector<std::string> &paths, SaslAlSound* &sound,
+        SessionWriter &session)
 {
-    SASL sasl = sasl_init(data.c_str(), NULL, NULL);
+    SASL sasl = sasl_init(data.c_str(), sasl_create_slab_lua, 
+            sasl_destroy_slab_lua);
     if (! sasl) {
         fprintf(stderr, "Unable to initialize avionics library\n");
         exit(1);
@@ -120,6 +208,7 @@ static SASL createPanel(SaslGraphicsCallbacks* graphics, int width, int height,
     sasl_set_panel_size(sasl, width, height);
     sasl_set_popup_size(sasl, width, height);
     sasl_enable_click_emulator(sasl, true);
+    sasl_set_input_queue(sasl, true);
     sasl_set_background_color(sasl, 1, 1, 1, 1);
 
     for (std::vector<std::string>::iterator i = paths.begin(); 
@@ -132,6 +221,12 @@ static SASL createPanel(SaslGraphicsCallbacks* graphics, int width, int height,
             exit(1);
         }
 
+    if (session.isOpen())
+        if (captureSessionProps(sasl, session)) {
+            fprintf(stderr, "Can't record properties\n");
+            exit(1);
+        }
+
     if (sasl_load_panel(sasl, panel.c_str())) {
         fprintf(stderr, "Can't load panel\n");
         exit(1);
@@ -159,6 +254,9 @@ int main(int argc, char *argv[])
 
     CmdLine cmdLine(argc, argv);
 
+    if (cmdLine.getReplaySession().size())
+        return playSession(cmdLine) ? 1 : 0;
+
     initSDL();
 
     int width = cmdLine.getScreenWidth();
@@ -173,16 +271,31 @@ int main(int argc, char *argv[])
     SaslGraphicsCallbacks* graphics = saslgl_init_graphics();
     SaslAlSound *sound = NULL;
 
+    SessionWriter session;
+    if (cmdLine.getRecordSession().size()) {
+        if (session.open(cmdLine.getRecordSession(), width, height, 
+                    SDL_GetTicks())) 
+        {
+            fprintf(stderr, "Can't create session file '%s'\n", 
+                    cmdLine.getRecordSession().c_str());
+            exit(1);
+        }
+        // timers read clock once per frame so replay sees the same time
+        sasl_set_time_callback(SessionWriter::timeSource, &session);
+    }
+
     SASL sasl = createPanel(graphics, width, height, 
             cmdLine.getDataDir(), cmdLine.getPanel(), 
             cmdLine.getNetHost(), cmdLine.getNetPort(),
-            cmdLine.getNetSecret(), cmdLine.getPaths(), sound);
+            cmdLine.getNetSecret(), cmdLine.getPaths(), sound, session);
 
     Fps fps(cmdLine.isShowFps());
     fps.setTargetFps(cmdLine.getTargetFps());
 
     bool done = false;
     while (! done) {
+        session.addFrame(SDL_GetTicks());
+
         if (sasl_update(sasl))
             break;
 
@@ -191,26 +304,47 @@ int main(int argc, char *argv[])
             break;
         SDL_GL_SwapWindow(window);
 
+        // key down waits for text input event with its character
+        SessionEvent keyDown;
+        keyDown.type = 0;
+
         SDL_Event event;
         while (SDL_PollEvent(&event)) {
+            SessionEvent input;
+            input.type = 0;
+
+            if (keyDown.type && (SDL_TEXTINPUT != event.type)) {
+                sendInput(sasl, session, keyDown);
+                keyDown.type = 0;
+            }
+
             switch (event.type) {
                 case SDL_QUIT: 
                     done = true; 
                     break;
 
                 case SDL_MOUSEBUTTONDOWN: 
-                    sasl_mouse_button_down(sasl, event.button.x, 
-                            height - event.button.y, event.button.button, 3);
+                    input.type = EVENT_MOUSE_DOWN;
+                    input.a = event.button.x;
+                    input.b = height - event.button.y;
+                    input.c = event.button.button;
+                    input.d = 3;
                     break;
 
                 case SDL_MOUSEBUTTONUP: 
-                    sasl_mouse_button_up(sasl, event.button.x, 
-                            height - event.button.y, event.button.button, 3);
+                    input.type = EVENT_MOUSE_UP;
+                    input.a = event.button.x;
+                    input.b = height - event.button.y;
+                    input.c = event.button.button;
+                    input.d = 3;
                     break;
 
                 case SDL_MOUSEMOTION: 
-                    sasl_mouse_move(sasl, event.button.x, 
-                            height - event.button.y, 3);
+                    input.type = EVENT_MOUSE_MOVE;
+                    input.a = event.button.x;
+                    input.b = height - event.button.y;
+                    input.c = 0;
+                    input.d = 3;
                     break;
 
                 case SDL_KEYDOWN:
@@ -221,6 +355,11 @@ int main(int argc, char *argv[])
                             break;
 
                         case SDLK_F8:
+                            if (session.isOpen()) {
+                                printf("Panel can't be reloaded while "
+                                        "session is recorded\n");
+                                break;
+                            }
                             if (sound)
                                 sasl_done_al_sound(sound);
                             sasl_done(sasl);
@@ -228,7 +367,7 @@ int main(int argc, char *argv[])
                                     cmdLine.getDataDir(), cmdLine.getPanel(), 
                                     cmdLine.getNetHost(), cmdLine.getNetPort(),
                                     cmdLine.getNetSecret(), cmdLine.getPaths(),
-                                    sound);
+                                    sound, session);
                             showClickable = false;
                             break;
                         
@@ -236,10 +375,43 @@ int main(int argc, char *argv[])
                             done = true;
                             break;
 
-                        default: break;
+                        default: 
+                            keyDown.b = getVirtualKey(event.key.keysym.sym);
+                            if (-1 == keyDown.b)
+                                break;
+                            keyDown.type = EVENT_KEY_DOWN;
+                            keyDown.a = getControlChar(event.key.keysym.sym);
+                            keyDown.c = keyDown.d = 0;
+                            break;
                     };
                     break;
 
+                case SDL_TEXTINPUT:
+                    if (keyDown.type) {
+                        unsigned char c = event.text.text[0];
+                        keyDown.a = (0x80 > c) ? c : 0;
+                        input = keyDown;
+                        keyDown.type = 0;
+                    }
+                    break;
+
+                case SDL_KEYUP:
+                    {
+                        int key = getVirtualKey(event.key.keysym.sym);
+                        if (-1 == key)
+                            break;
+                        std::map<int, int>::iterator i = pressedChars.find(key);
+                        input.type = EVENT_KEY_UP;
+                        if (i != pressedChars.end()) {
+                            input.a = (*i).second;
+                            pressedChars.erase(i);
+                        } else
+                            input.a = getControlChar(event.key.keysym.sym);
+                        input.b = key;
+                        input.c = input.d = 0;
+                    }
+                    break;
+
                 case SDL_WINDOWEVENT: 
                     {
                         int newWidth, newHeight;
@@ -248,14 +420,22 @@ int main(int argc, char *argv[])
                             width = newWidth;
                             height = newHeight;
                             updateScreenSettings(width, height);
-                            sasl_set_panel_size(sasl, width, height);
-                            sasl_set_popup_size(sasl, width, height);
+                            input.type = EVENT_RESIZE;
+                            input.a = width;
+                            input.b = height;
+                            input.c = input.d = 0;
                         }
                     }
                     break;
             }
+
+            if (input.type)
+                sendInput(sasl, session, input);
         }
 
+        if (keyDown.type)
+            sendInput(sasl, session, keyDown);
+
         fps.update();
     }
 
@@ -263,7 +443,10 @@ int main(int argc, char *argv[])
         sasl_done_al_sound(sound);
 
     sasl_done(sasl);
+    sasl_clear_asset_cache();
+    sasl_close_al_sound();
     saslgl_done_graphics(graphics);
+    session.close();
 
     if (glContext)
         SDL_GL_DeleteContext(glContext);
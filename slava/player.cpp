@@ -0,0 +1,130 @@
+#include "player.h"
+
+#include <stdio.h>
+#include <vector>
+#include <algorithm>
+#include <SDL.h>
+#include "libavionics.h"
+#include "session.h"
+#include "sessionprops.h"
+
+
+using namespace slava;
+
+
+/// Returns microseconds passed since start
+static double getElapsed(Uint64 start)
+{
+    return (SDL_GetPerformanceCounter() - start) * 1000000.0 / 
+        SDL_GetPerformanceFrequency();
+}
+
+
+/// Print statistics of frame times
+static void printStats(const char *name, std::vector<double> times)
+{
+    if (times.empty())
+        return;
+
+    std::sort(times.begin(), times.end());
+    double total = 0;
+    for (std::vector<double>::iterator i = times.begin(); 
+            i != times.end(); i++)
+        total += *i;
+
+    int n = times.size();
+    printf("%-8s mean %9.1f  p50 %9.1f  p95 %9.1f  p99 %9.1f  max %9.1f us\n",
+            name, total / n, times[n / 2], times[(n * 95) / 100], 
+            times[(n * 99) / 100], times[n - 1]);
+}
+
+
+int slava::playSession(CmdLine &cmdLine)
+{
+    SessionReader reader;
+    if (reader.open(cmdLine.getReplaySession())) {
+        fprintf(stderr, "Can't load session '%s'\n", 
+                cmdLine.getReplaySession().c_str());
+        return -1;
+    }
+
+    // all SASL timers follow recorded clock
+    sasl_set_time_callback(SessionReader::timeSource, &reader);
+
+    SASL sasl = sasl_init(cmdLine.getDataDir().c_str(), sasl_create_slab_lua,
+            sasl_destroy_slab_lua);
+    if (! sasl) {
+        fprintf(stderr, "Unable to initialize avionics library\n");
+        return -1;
+    }
+
+    sasl_set_panel_size(sasl, reader.getWidth(), reader.getHeight());
+    sasl_set_popup_size(sasl, reader.getWidth(), reader.getHeight());
+    sasl_enable_click_emulator(sasl, true);
+    sasl_set_input_queue(sasl, true);
+    sasl_set_background_color(sasl, 1, 1, 1, 1);
+
+    std::vector<std::string> &paths = cmdLine.getPaths();
+    for (std::vector<std::string>::iterator i = paths.begin(); 
+            i != paths.end(); i++) 
+        sasl_add_search_path(sasl, (*i).c_str());
+
+    replaySessionProps(sasl, reader);
+
+    if (sasl_load_panel(sasl, cmdLine.getPanel().c_str())) {
+        fprintf(stderr, "Can't load panel\n");
+        sasl_done(sasl);
+        return -1;
+    }
+
+    FILE *report = NULL;
+    if (cmdLine.getReport().size()) {
+        report = fopen(cmdLine.getReport().c_str(), "w");
+        if (! report)
+            fprintf(stderr, "Can't create report '%s'\n", 
+                    cmdLine.getReport().c_str());
+        else
+            fprintf(report, "frame,time,update_us,draw_us\n");
+    }
+
+    const std::vector<SessionFrame> &frames = reader.getFrames();
+    std::vector<double> updateTimes, drawTimes;
+    updateTimes.reserve(frames.size());
+    drawTimes.reserve(frames.size());
+
+    for (size_t i = 0; i < frames.size(); i++) {
+        const SessionFrame &frame = frames[i];
+        reader.setClock(frame.time);
+
+        Uint64 start = SDL_GetPerformanceCounter();
+        sasl_update(sasl);
+        double updateTime = getElapsed(start);
+
+        start = SDL_GetPerformanceCounter();
+        sasl_draw_panel(sasl, STAGE_ALL);
+        double drawTime = getElapsed(start);
+
+        for (std::vector<SessionEvent>::const_iterator j = 
+                frame.events.begin(); j != frame.events.end(); j++)
+            sendEvent(sasl, *j);
+
+        updateTimes.push_back(updateTime);
+        drawTimes.push_back(drawTime);
+        if (report)
+            fprintf(report, "%i,%li,%.1f,%.1f\n", (int)i, 
+                    frame.time - reader.getInitTime(), updateTime, drawTime);
+    }
+
+    if (report)
+        fclose(report);
+
+    printf("frames   %i\n", (int)frames.size());
+    printStats("update", updateTimes);
+    printStats("draw", drawTimes);
+
+    sasl_done(sasl);
+    sasl_set_time_callback(NULL, NULL);
+
+    return 0;
+}
+
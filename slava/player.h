@@ -0,0 +1,21 @@
+#ifndef __PLAYER_H__
+#define __PLAYER_H__
+
+
+#include "cmdline.h"
+
+
+namespace slava {
+
+
+/// Replay recorded session without window and simulator and print
+/// update and draw times of every frame.
+/// Returns zero on success.
+int playSession(CmdLine &cmdLine);
+
+
+};
+
+
+#endif
+
@@ -0,0 +1,296 @@
+#include "session.h"
+
+#include <string.h>
+
+
+using namespace slava;
+
+
+/// Session file signature
+static const char SIGNATURE[8] = { 'S', 'L', 'V', 'S', 'E', 'S', 'S', 0 };
+
+/// Version of session file format
+#define VERSION 1
+
+/// Records tags
+#define TAG_PROP 'P'
+#define TAG_FRAME 'F'
+#define TAG_VALUE 'V'
+#define TAG_EVENT 'E'
+
+/// Kinds of recorded values
+#define VALUE_NUMBER 0
+#define VALUE_STRING 1
+
+
+void slava::sendEvent(SASL sasl, const SessionEvent &event)
+{
+    switch (event.type) {
+        case EVENT_MOUSE_DOWN:
+            sasl_mouse_button_down(sasl, event.a, event.b, event.c, event.d);
+            break;
+        case EVENT_MOUSE_UP:
+            sasl_mouse_button_up(sasl, event.a, event.b, event.c, event.d);
+            break;
+        case EVENT_MOUSE_MOVE:
+            sasl_mouse_move(sasl, event.a, event.b, event.d);
+            break;
+        case EVENT_KEY_DOWN:
+            sasl_key_down(sasl, event.a, event.b);
+            break;
+        case EVENT_KEY_UP:
+            sasl_key_up(sasl, event.a, event.b);
+            break;
+        case EVENT_RESIZE:
+            sasl_set_panel_size(sasl, event.a, event.b);
+            sasl_set_popup_size(sasl, event.a, event.b);
+            break;
+    }
+}
+
+
+SessionWriter::SessionWriter()
+{
+    file = NULL;
+    clock = 0;
+    lastPropId = 0;
+}
+
+
+SessionWriter::~SessionWriter()
+{
+    close();
+}
+
+
+int SessionWriter::open(const std::string &fileName, int width, int height,
+        long clock)
+{
+    close();
+
+    file = fopen(fileName.c_str(), "wb");
+    if (! file)
+        return -1;
+
+    this->clock = clock;
+    lastPropId = 0;
+
+    fwrite(SIGNATURE, sizeof(SIGNATURE), 1, file);
+    putInt(VERSION, 4);
+    putInt(width, 4);
+    putInt(height, 4);
+    putInt(clock, 8);
+
+    return 0;
+}
+
+
+void SessionWriter::close()
+{
+    if (file)
+        fclose(file);
+    file = NULL;
+}
+
+
+void SessionWriter::putInt(unsigned long long value, int size)
+{
+    unsigned char buf[8];
+    for (int i = 0; i < size; i++) {
+        buf[i] = value & 0xff;
+        value >>= 8;
+    }
+    fwrite(buf, size, 1, file);
+}
+
+
+void SessionWriter::addFrame(long time)
+{
+    clock = time;
+    if (! file)
+        return;
+    putInt(TAG_FRAME, 1);
+    putInt(time, 8);
+}
+
+
+void SessionWriter::addEvent(const SessionEvent &event)
+{
+    if (! file)
+        return;
+    putInt(TAG_EVENT, 1);
+    putInt(event.type, 1);
+    putInt((unsigned)event.a, 4);
+    putInt((unsigned)event.b, 4);
+    putInt((unsigned)event.c, 4);
+    putInt((unsigned)event.d, 4);
+}
+
+
+int SessionWriter::addProp(const std::string &name, int type)
+{
+    int id = ++lastPropId;
+    if (! file)
+        return id;
+    putInt(TAG_PROP, 1);
+    putInt(id, 2);
+    putInt(type, 1);
+    putInt(name.length(), 2);
+    fwrite(name.c_str(), name.length(), 1, file);
+    return id;
+}
+
+
+void SessionWriter::addValue(int id, double value)
+{
+    if (! file)
+        return;
+    unsigned long long bits;
+    memcpy(&bits, &value, sizeof(bits));
+    putInt(TAG_VALUE, 1);
+    putInt(id, 2);
+    putInt(VALUE_NUMBER, 1);
+    putInt(bits, 8);
+}
+
+
+void SessionWriter::addValue(int id, const std::string &value)
+{
+    if (! file)
+        return;
+    putInt(TAG_VALUE, 1);
+    putInt(id, 2);
+    putInt(VALUE_STRING, 1);
+    putInt(value.length(), 4);
+    fwrite(value.c_str(), value.length(), 1, file);
+}
+
+
+long SessionWriter::timeSource(void *writer)
+{
+    return ((SessionWriter*)writer)->clock;
+}
+
+
+SessionReader::SessionReader()
+{
+    width = height = 0;
+    initTime = clock = 0;
+}
+
+
+/// Read little-endian integer from buffer.
+/// Returns false if there is not enough data.
+static bool getInt(const std::vector<unsigned char> &data, size_t &pos,
+        int size, unsigned long long &value)
+{
+    if (pos + size > data.size())
+        return false;
+    value = 0;
+    for (int i = size - 1; i >= 0; i--)
+        value = (value << 8) | data[pos + i];
+    pos += size;
+    return true;
+}
+
+
+int SessionReader::open(const std::string &fileName)
+{
+    FILE *f = fopen(fileName.c_str(), "rb");
+    if (! f)
+        return -1;
+
+    std::vector<unsigned char> data;
+    unsigned char buf[4096];
+    size_t len;
+    while (0 < (len = fread(buf, 1, sizeof(buf), f)))
+        data.insert(data.end(), buf, buf + len);
+    fclose(f);
+
+    props.clear();
+    frames.clear();
+
+    size_t pos = sizeof(SIGNATURE);
+    unsigned long long v, w, h, t;
+    if ((data.size() < pos) || memcmp(&data[0], SIGNATURE, pos) ||
+            (! getInt(data, pos, 4, v)) || (VERSION != v) ||
+            (! getInt(data, pos, 4, w)) || (! getInt(data, pos, 4, h)) ||
+            (! getInt(data, pos, 8, t)))
+        return -1;
+    width = (int)w;
+    height = (int)h;
+    clock = initTime = (long)t;
+
+    // truncated last record is ignored
+    unsigned long long tag;
+    while (getInt(data, pos, 1, tag)) {
+        if (TAG_FRAME == tag) {
+            if (! getInt(data, pos, 8, t))
+                break;
+            SessionFrame frame;
+            frame.time = (long)t;
+            frames.push_back(frame);
+        } else if (TAG_PROP == tag) {
+            unsigned long long id, type, len;
+            if ((! getInt(data, pos, 2, id)) ||
+                    (! getInt(data, pos, 1, type)) ||
+                    (! getInt(data, pos, 2, len)) ||
+                    (pos + len > data.size()))
+                break;
+            SessionProp prop;
+            prop.id = (int)id;
+            prop.type = (int)type;
+            prop.name.assign((const char*)&data[pos], len);
+            pos += len;
+            props.push_back(prop);
+        } else if (TAG_VALUE == tag) {
+            unsigned long long id, kind, bits;
+            if ((! getInt(data, pos, 2, id)) ||
+                    (! getInt(data, pos, 1, kind)))
+                break;
+            SessionValue value;
+            value.id = (int)id;
+            value.number = 0;
+            if (VALUE_NUMBER == kind) {
+                if (! getInt(data, pos, 8, bits))
+                    break;
+                memcpy(&value.number, &bits, sizeof(bits));
+            } else {
+                unsigned long long len;
+                if ((! getInt(data, pos, 4, len)) ||
+                        (pos + len > data.size()))
+                    break;
+                value.string.assign((const char*)&data[pos], len);
+                pos += len;
+            }
+            if (! frames.empty())
+                frames.back().values.push_back(value);
+        } else if (TAG_EVENT == tag) {
+            unsigned long long type, a, b, c, d;
+            if ((! getInt(data, pos, 1, type)) ||
+                    (! getInt(data, pos, 4, a)) ||
+                    (! getInt(data, pos, 4, b)) ||
+                    (! getInt(data, pos, 4, c)) ||
+                    (! getInt(data, pos, 4, d)))
+                break;
+            SessionEvent event;
+            event.type = (int)type;
+            event.a = (int)(unsigned)a;
+            event.b = (int)(unsigned)b;
+            event.c = (int)(unsigned)c;
+            event.d = (int)(unsigned)d;
+            if (! frames.empty())
+                frames.back().events.push_back(event);
+        } else
+            break;
+    }
+
+    return 0;
+}
+
+
+long SessionReader::timeSource(void *reader)
+{
+    return ((SessionReader*)reader)->clock;
+}
+
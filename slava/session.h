@@ -0,0 +1,210 @@
+#ifndef __SESSION_H__
+#define __SESSION_H__
+
+
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include "libavionics.h"
+
+
+namespace slava {
+
+
+/// Types of recorded input events
+enum {
+    EVENT_MOUSE_DOWN = 1,
+    EVENT_MOUSE_UP,
+    EVENT_MOUSE_MOVE,
+    EVENT_KEY_DOWN,
+    EVENT_KEY_UP,
+    EVENT_RESIZE
+};
+
+
+/// Input event passed to SASL
+struct SessionEvent
+{
+    /// type of event
+    int type;
+
+    /// x coordinate, character code or width
+    int a;
+
+    /// y coordinate, key code or height
+    int b;
+
+    /// mouse button
+    int c;
+
+    /// layer
+    int d;
+};
+
+
+/// Value of property received from simulator
+struct SessionValue
+{
+    /// ID of property
+    int id;
+
+    /// Numeric value
+    double number;
+
+    /// String value
+    std::string string;
+};
+
+
+/// Property referenced by panel
+struct SessionProp
+{
+    /// ID of property
+    int id;
+
+    /// Name of property
+    std::string name;
+
+    /// Type of property
+    int type;
+};
+
+
+/// Recorded frame
+struct SessionFrame
+{
+    /// Clock reading in milliseconds
+    long time;
+
+    /// Properties changed by simulator before frame update
+    std::vector<SessionValue> values;
+
+    /// Input events received after frame was drawn
+    std::vector<SessionEvent> events;
+};
+
+
+/// Pass event to SASL
+void sendEvent(SASL sasl, const SessionEvent &event);
+
+
+/// Writes session file.
+/// Session file starts with header: signature, version, panel width and
+/// height and clock reading at SASL initialization.  Header is followed
+/// by records of properties, frames, values and events in order they
+/// happened.  Values and events belong to last frame record.
+class SessionWriter
+{
+    private:
+        /// Output file
+        FILE *file;
+
+        /// Current clock reading
+        long clock;
+
+        /// Last assigned property ID
+        int lastPropId;
+
+    public:
+        /// Create writer without file
+        SessionWriter();
+
+        /// Close file
+        ~SessionWriter();
+
+    public:
+        /// Create session file.  Returns zero on success.
+        int open(const std::string &fileName, int width, int height,
+                long clock);
+
+        /// Flush and close file
+        void close();
+
+        /// Returns true if session is being recorded
+        bool isOpen() const { return NULL != file; }
+
+        /// Start new frame
+        void addFrame(long time);
+
+        /// Record input event
+        void addEvent(const SessionEvent &event);
+
+        /// Register property.  Returns ID of property.
+        int addProp(const std::string &name, int type);
+
+        /// Record new value of numeric property
+        void addValue(int id, double value);
+
+        /// Record new value of string property
+        void addValue(int id, const std::string &value);
+
+        /// Returns current clock reading
+        long getClock() const { return clock; }
+
+        /// Time source for SASL
+        static long timeSource(void *writer);
+
+    private:
+        /// Write integer as little-endian bytes
+        void putInt(unsigned long long value, int size);
+};
+
+
+/// Reads whole session file to memory
+class SessionReader
+{
+    private:
+        /// Width of panel
+        int width;
+
+        /// Height of panel
+        int height;
+
+        /// Clock reading at SASL initialization
+        long initTime;
+
+        /// Properties referenced by panel
+        std::vector<SessionProp> props;
+
+        /// Recorded frames
+        std::vector<SessionFrame> frames;
+
+        /// Current clock reading
+        long clock;
+
+    public:
+        /// Create empty reader
+        SessionReader();
+
+    public:
+        /// Load session file.  Returns zero on success.
+        int open(const std::string &fileName);
+
+        /// Returns width of panel
+        int getWidth() const { return width; }
+
+        /// Returns height of panel
+        int getHeight() const { return height; }
+
+        /// Returns clock reading at SASL initialization
+        long getInitTime() const { return initTime; }
+
+        /// Returns properties referenced by panel
+        const std::vector<SessionProp>& getProps() const { return props; }
+
+        /// Returns recorded frames
+        const std::vector<SessionFrame>& getFrames() const { return frames; }
+
+        /// Set current clock reading
+        void setClock(long time) { clock = time; }
+
+        /// Time source for SASL
+        static long timeSource(void *reader);
+};
+
+
+};
+
+
+#endif
+
@@ -0,0 +1,575 @@
+#include "sessionprops.h"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <string.h>
+
+
+using namespace slava;
+
+
+struct CaptureProps;
+
+
+/// Property of wrapped backend
+struct CaptureValue
+{
+    /// Capture this property belongs to
+    CaptureProps *props;
+
+    /// Reference to property in wrapped backend
+    SaslPropRef ref;
+
+    /// ID of property in session or 0 for functional properties
+    int id;
+
+    /// Type of property
+    int type;
+
+    /// True if value was recorded at least once
+    bool known;
+
+    /// Last recorded numeric value
+    double number;
+
+    /// Last recorded string value
+    std::string string;
+};
+
+
+/// Wrapped properties backend
+struct CaptureProps
+{
+    SaslPropsCallbacks *callbacks;
+    SaslProps props;
+    SessionWriter &writer;
+    std::vector<CaptureValue*> values;
+    std::vector<char> buffer;
+
+    CaptureProps(SaslPropsCallbacks *callbacks, SaslProps props, 
+            SessionWriter &writer): callbacks(callbacks), props(props), 
+        writer(writer), buffer(256) { };
+
+    ~CaptureProps() {
+        for (std::vector<CaptureValue*>::iterator i = values.begin();
+                i != values.end(); i++)
+            delete *i;
+    }
+};
+
+
+/// Returns wrapper of property
+static CaptureValue* wrapValue(CaptureProps *p, SaslPropRef ref, 
+        const char *name, int type, bool func)
+{
+    if (! ref)
+        return NULL;
+
+    for (std::vector<CaptureValue*>::iterator i = p->values.begin();
+            i != p->values.end(); i++)
+        if (((*i)->ref == ref) && ((*i)->type == type))
+            return *i;
+
+    CaptureValue *v = new CaptureValue();
+    v->props = p;
+    v->ref = ref;
+    v->id = func ? 0 : p->writer.addProp(name, type);
+    v->type = type;
+    v->known = false;
+    v->number = 0;
+    p->values.push_back(v);
+    return v;
+}
+
+
+static SaslPropRef captureGetPropRef(SaslProps props, const char *name, 
+        int type)
+{
+    CaptureProps *p = (CaptureProps*)props;
+    if ((! p->callbacks) || (! p->callbacks->get_prop_ref))
+        return NULL;
+    return wrapValue(p, p->callbacks->get_prop_ref(p->props, name, type),
+            name, type, false);
+}
+
+
+static SaslPropRef captureCreateProp(SaslProps props, const char *name, 
+        int type, int maxSize)
+{
+    CaptureProps *p = (CaptureProps*)props;
+    if ((! p->callbacks) || (! p->callbacks->create_prop))
+        return NULL;
+    return wrapValue(p, p->callbacks->create_prop(p->props, name, type, 
+                maxSize), name, type, false);
+}
+
+
+static SaslPropRef captureCreateFuncProp(SaslProps props, const char *name, 
+            int type, int maxSize, sasl_prop_getter_callback getter, 
+            sasl_prop_setter_callback setter, void *ref)
+{
+    CaptureProps *p = (CaptureProps*)props;
+    if ((! p->callbacks) || (! p->callbacks->create_func_prop))
+        return NULL;
+    return wrapValue(p, p->callbacks->create_func_prop(p->props, name, type, 
+                maxSize, getter, setter, ref), name, type, true);
+}
+
+
+/// properties are referenced forever
+static void captureFreePropRef(SaslPropRef prop)
+{
+}
+
+
+static int captureGetPropInt(SaslPropRef prop, int *err)
+{
+    CaptureValue *v = (CaptureValue*)prop;
+    return v->props->callbacks->get_prop_int(v->ref, err);
+}
+
+
+static int captureSetPropInt(SaslPropRef prop, int value)
+{
+    CaptureValue *v = (CaptureValue*)prop;
+    return v->props->callbacks->set_prop_int(v->ref, value);
+}
+
+
+static float captureGetPropFloat(SaslPropRef prop, int *err)
+{
+    CaptureValue *v = (CaptureValue*)prop;
+    return v->props->callbacks->get_prop_float(v->ref, err);
+}
+
+
+static int captureSetPropFloat(SaslPropRef prop, float value)
+{
+    CaptureValue *v = (CaptureValue*)prop;
+    return v->props->callbacks->set_prop_float(v->ref, value);
+}
+
+
+static double captureGetPropDouble(SaslPropRef prop, int *err)
+{
+    CaptureValue *v = (CaptureValue*)prop;
+    return v->props->callbacks->get_prop_double(v->ref, err);
+}
+
+
+static int captureSetPropDouble(SaslPropRef prop, double value)
+{
+    CaptureValue *v = (CaptureValue*)prop;
+    return v->props->callbacks->set_prop_double(v->ref, value);
+}
+
+
+static int captureGetPropString(SaslPropRef prop, char *buf, int maxSize, 
+        int *err)
+{
+    CaptureValue *v = (CaptureValue*)prop;
+    return v->props->callbacks->get_prop_string(v->ref, buf, maxSize, err);
+}
+
+
+static int captureSetPropString(SaslPropRef prop, const char *value)
+{
+    CaptureValue *v = (CaptureValue*)prop;
+    return v->props->callbacks->set_prop_string(v->ref, value);
+}
+
+
+/// Record value of property if it was changed
+static void captureValue(CaptureProps *p, CaptureValue *v)
+{
+    SaslPropsCallbacks *c = p->callbacks;
+    int err = 0;
+
+    if (PROP_STRING == v->type) {
+        int size = c->get_prop_string(v->ref, &p->buffer[0], 
+                p->buffer.size(), &err);
+        if (size > (int)p->buffer.size()) {
+            p->buffer.resize(size);
+            size = c->get_prop_string(v->ref, &p->buffer[0], 
+                    p->buffer.size(), &err);
+        }
+        if (err || (0 >= size) || (size > (int)p->buffer.size()))
+            return;
+        p->buffer[size - 1] = 0;
+        std::string value(&p->buffer[0]);
+        if (v->known && (value == v->string))
+            return;
+        v->string = value;
+        v->known = true;
+        p->writer.addValue(v->id, value);
+        return;
+    }
+
+    double value;
+    switch (v->type) {
+        case PROP_INT: value = c->get_prop_int(v->ref, &err); break;
+        case PROP_FLOAT: value = c->get_prop_float(v->ref, &err); break;
+        default: value = c->get_prop_double(v->ref, &err);
+    }
+    if (err || (v->known && (value == v->number)))
+        return;
+    v->number = value;
+    v->known = true;
+    p->writer.addValue(v->id, value);
+}
+
+
+static int captureUpdateProps(SaslProps props)
+{
+    CaptureProps *p = (CaptureProps*)props;
+    if (! p->callbacks)
+        return 0;
+
+    int res = 0;
+    if (p->callbacks->update_props)
+        res = p->callbacks->update_props(p->props);
+
+    for (std::vector<CaptureValue*>::iterator i = p->values.begin();
+            i != p->values.end(); i++)
+        if ((*i)->id)
+            captureValue(p, *i);
+
+    return res;
+}
+
+
+static void captureDoneProps(SaslProps props)
+{
+    CaptureProps *p = (CaptureProps*)props;
+    if (p->callbacks && p->callbacks->props_done)
+        p->callbacks->props_done(p->props);
+    delete p;
+}
+
+
+static SaslPropsCallbacks captureCallbacks = { captureGetPropRef, 
+        captureFreePropRef, captureCreateProp, captureCreateFuncProp, 
+        captureGetPropInt, captureSetPropInt, 
+        captureGetPropFloat, captureSetPropFloat, 
+        captureGetPropDouble, captureSetPropDouble, 
+        captureGetPropString, captureSetPropString,
+        captureUpdateProps, captureDoneProps };
+
+
+int slava::captureSessionProps(SASL sasl, SessionWriter &writer)
+{
+    SaslPropsCallbacks *callbacks;
+    SaslProps props;
+    if (sasl_detach_props(sasl, &callbacks, &props))
+        return -1;
+
+    CaptureProps *p = new CaptureProps(callbacks, props, writer);
+    return sasl_set_props(sasl, &captureCallbacks, p);
+}
+
+
+
+struct ReplayProps;
+
+
+/// Property served from session
+struct ReplayValue
+{
+    /// Replay this property belongs to
+    ReplayProps *props;
+
+    /// ID of property in session or 0 for local properties
+    int id;
+
+    /// Name of property
+    std::string name;
+
+    /// Type of property
+    int type;
+
+    /// Numeric value
+    double number;
+
+    /// String value
+    std::string string;
+
+    /// Getter of functional property
+    sasl_prop_getter_callback getter;
+
+    /// Setter of functional property
+    sasl_prop_setter_callback setter;
+
+    /// Reference passed to functional property callbacks
+    void *ref;
+};
+
+
+/// Storage of replayed properties
+struct ReplayProps
+{
+    SessionReader &reader;
+    std::vector<ReplayValue*> values;
+    std::map<int, ReplayValue*> recorded;
+    size_t frame;
+
+    ReplayProps(SessionReader &reader): reader(reader), frame(0) { };
+
+    ~ReplayProps() {
+        for (std::vector<ReplayValue*>::iterator i = values.begin();
+                i != values.end(); i++)
+            delete *i;
+    }
+};
+
+
+/// Find property or create new one
+/// \param local create local property if property wasn't recorded
+static ReplayValue* findValue(ReplayProps *p, const char *name, int type,
+        bool local)
+{
+    if ((! name) || (PROP_INT > type) || (PROP_STRING < type))
+        return NULL;
+
+    for (std::vector<ReplayValue*>::iterator i = p->values.begin();
+            i != p->values.end(); i++)
+        if (((*i)->type == type) && ((*i)->name == name))
+            return *i;
+
+    int id = 0;
+    const std::vector<SessionProp> &props = p->reader.getProps();
+    for (std::vector<SessionProp>::const_iterator i = props.begin(); 
+            i != props.end(); i++)
+        if (((*i).type == type) && ((*i).name == name))
+            id = (*i).id;
+    if ((! id) && (! local))
+        return NULL;
+
+    ReplayValue *v = new ReplayValue();
+    v->props = p;
+    v->id = id;
+    v->name = name;
+    v->type = type;
+    v->number = 0;
+    v->getter = NULL;
+    v->setter = NULL;
+    v->ref = NULL;
+    p->values.push_back(v);
+    if (id)
+        p->recorded[id] = v;
+    return v;
+}
+
+
+static SaslPropRef replayGetPropRef(SaslProps props, const char *name, 
+        int type)
+{
+    return findValue((ReplayProps*)props, name, type, false);
+}
+
+
+static SaslPropRef replayCreateProp(SaslProps props, const char *name, 
+        int type, int maxSize)
+{
+    return findValue((ReplayProps*)props, name, type, true);
+}
+
+
+static SaslPropRef replayCreateFuncProp(SaslProps props, const char *name, 
+            int type, int maxSize, sasl_prop_getter_callback getter, 
+            sasl_prop_setter_callback setter, void *ref)
+{
+    ReplayValue *v = findValue((ReplayProps*)props, name, type, true);
+    if ((! v) || v->getter)
+        return NULL;
+    v->getter = getter;
+    v->setter = setter;
+    v->ref = ref;
+    return v;
+}
+
+
+/// properties are referenced forever
+static void replayFreePropRef(SaslPropRef prop)
+{
+}
+
+
+/// Returns value of numeric property
+static double getNumber(ReplayValue *v, int *err)
+{
+    if ((! v) || (PROP_STRING == v->type)) {
+        if (err)
+            *err = 1;
+        return 0;
+    }
+    if (err)
+        *err = 0;
+
+    if (v->getter) {
+        switch (v->type) {
+            case PROP_INT: {
+                    int value = 0;
+                    v->getter(PROP_INT, &value, sizeof(value), v->ref);
+                    return value;
+                }
+            case PROP_FLOAT: {
+                    float value = 0;
+                    v->getter(PROP_FLOAT, &value, sizeof(value), v->ref);
+                    return value;
+                }
+            default: {
+                    double value = 0;
+                    v->getter(PROP_DOUBLE, &value, sizeof(value), v->ref);
+                    return value;
+                }
+        }
+    }
+
+    return v->number;
+}
+
+
+/// Set value of numeric property
+static int setNumber(ReplayValue *v, double value)
+{
+    if ((! v) || (PROP_STRING == v->type))
+        return -1;
+
+    if (v->setter) {
+        switch (v->type) {
+            case PROP_INT: {
+                    int i = (int)value;
+                    v->setter(PROP_INT, &i, sizeof(i), v->ref);
+                    break;
+                }
+            case PROP_FLOAT: {
+                    float f = (float)value;
+                    v->setter(PROP_FLOAT, &f, sizeof(f), v->ref);
+                    break;
+                }
+            default:
+                v->setter(PROP_DOUBLE, &value, sizeof(value), v->ref);
+        }
+    } else
+        v->number = value;
+    return 0;
+}
+
+
+static int replayGetPropInt(SaslPropRef prop, int *err)
+{
+    return (int)getNumber((ReplayValue*)prop, err);
+}
+
+
+static int replaySetPropInt(SaslPropRef prop, int value)
+{
+    return setNumber((ReplayValue*)prop, (int)value);
+}
+
+
+static float replayGetPropFloat(SaslPropRef prop, int *err)
+{
+    return (float)getNumber((ReplayValue*)prop, err);
+}
+
+
+static int replaySetPropFloat(SaslPropRef prop, float value)
+{
+    return setNumber((ReplayValue*)prop, (float)value);
+}
+
+
+static double replayGetPropDouble(SaslPropRef prop, int *err)
+{
+    return getNumber((ReplayValue*)prop, err);
+}
+
+
+static int replaySetPropDouble(SaslPropRef prop, double value)
+{
+    return setNumber((ReplayValue*)prop, value);
+}
+
+
+static int replayGetPropString(SaslPropRef prop, char *buf, int maxSize, 
+        int *err)
+{
+    ReplayValue *v = (ReplayValue*)prop;
+    if ((! v) || (PROP_STRING != v->type)) {
+        if (err)
+            *err = 1;
+        return 0;
+    }
+    if (err)
+        *err = 0;
+
+    if (v->getter)
+        return v->getter(PROP_STRING, buf, maxSize, v->ref);
+
+    int len = v->string.length();
+    if (buf && (maxSize > len))
+        memcpy(buf, v->string.c_str(), len + 1);
+    return len + 1;
+}
+
+
+static int replaySetPropString(SaslPropRef prop, const char *value)
+{
+    ReplayValue *v = (ReplayValue*)prop;
+    if ((! v) || (PROP_STRING != v->type) || (! value))
+        return -1;
+
+    if (v->setter)
+        v->setter(PROP_STRING, (void*)value, strlen(value) + 1, v->ref);
+    else
+        v->string = value;
+    return 0;
+}
+
+
+/// Apply values recorded for next frame
+static int replayUpdateProps(SaslProps props)
+{
+    ReplayProps *p = (ReplayProps*)props;
+    const std::vector<SessionFrame> &frames = p->reader.getFrames();
+    if (p->frame >= frames.size())
+        return 0;
+
+    const std::vector<SessionValue> &values = frames[p->frame].values;
+    for (std::vector<SessionValue>::const_iterator i = values.begin();
+            i != values.end(); i++)
+    {
+        std::map<int, ReplayValue*>::iterator v = p->recorded.find((*i).id);
+        if (v == p->recorded.end())
+            continue;
+        (*v).second->number = (*i).number;
+        (*v).second->string = (*i).string;
+    }
+    p->frame++;
+
+    return 0;
+}
+
+
+static void replayDoneProps(SaslProps props)
+{
+    delete (ReplayProps*)props;
+}
+
+
+static SaslPropsCallbacks replayCallbacks = { replayGetPropRef, 
+        replayFreePropRef, replayCreateProp, replayCreateFuncProp, 
+        replayGetPropInt, replaySetPropInt, 
+        replayGetPropFloat, replaySetPropFloat, 
+        replayGetPropDouble, replaySetPropDouble, 
+        replayGetPropString, replaySetPropString,
+        replayUpdateProps, replayDoneProps };
+
+
+int slava::replaySessionProps(SASL sasl, SessionReader &reader)
+{
+    return sasl_set_props(sasl, &replayCallbacks, new ReplayProps(reader));
+}
+
@@ -0,0 +1,29 @@
+#ifndef __SESSION_PROPS_H__
+#define __SESSION_PROPS_H__
+
+
+#include "libavionics.h"
+#include "session.h"
+
+
+namespace slava {
+
+
+/// Wrap current properties backend of SASL so properties referenced by
+/// panel and their values after every update are written to session.
+/// Returns zero on success.
+int captureSessionProps(SASL sasl, SessionWriter &writer);
+
+
+/// Serve properties from recorded session.  Every properties update
+/// applies values recorded for next frame.  Properties written by panel
+/// keep written values till next recorded change.
+/// Returns zero on success.
+int replaySessionProps(SASL sasl, SessionReader &reader);
+
+
+};
+
+
+#endif
+
@@ -907,6 +907,8 @@ PLUGIN_API void XPluginDisable(void)
     disabled = true;
     XPLMDestroyWindow(fakeWindow);
     freeAvionics(false);
+    sasl_clear_asset_cache();
+    sasl_close_al_sound();
 }
 
 
@@ -629,7 +629,7 @@ lua_State* xap::luaCreatorCallback()
     	xplane_wants_allocator = true;
     } 
     else 
-    	lua = luaL_newstate();
+    	lua = sasl_create_slab_lua();
     return lua;
 }
 
@@ -637,12 +637,13 @@ lua_State* xap::luaCreatorCallback()
 // destroy lua state with external allocator
 void xap::luaDestroyerCallback(lua_State *lua)
 {
-    lua_close(lua);
     if (xplane_wants_allocator) 
     {
+        lua_close(lua);
     	struct lua_alloc_request_t r = { 0 };
 	    r.ud = ud;
     	XPLMSendMessageToPlugin(XPLM_PLUGIN_XPLANE, ALLOC_CLOSE,&r);
-    }
+    } else
+        sasl_destroy_slab_lua(lua);
 }
 